@@ -0,0 +1,428 @@
+/*
+ * linux/arch/arm/crypto/aesbs-core.c
+ *
+ * Bit sliced AES for ARM NEON
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Eight blocks are processed at once. They are transposed into eight
+ * 128-bit planes, plane k holding bit k of every byte: lane j of a plane is
+ * byte j of the AES state and bit m of that lane belongs to block m. In
+ * this layout SubBytes is a boolean circuit evaluated on whole planes,
+ * which takes the same time whatever the data and needs no tables,
+ * ShiftRows is a byte shuffle of each plane, and MixColumns is a rotation
+ * of the bytes within each 32-bit column plus xtime, which is a rotation
+ * of the planes.
+ *
+ * This file is built with -mfpu=neon and must only be called between
+ * kernel_neon_begin() and kernel_neon_end(). It does not include any kernel
+ * header, see arch/arm/crypto/aesbs-glue.c for the prototypes.
+ */
+
+#include <arm_neon.h>
+
+#define AESBS_PLANE_BYTES	16
+#define AESBS_KEY_BYTES		(8 * AESBS_PLANE_BYTES)
+
+/*
+ * Swap the bits of a masked by m with the bits n positions higher in b.
+ * Three rounds of this transpose the 8x8 bit matrix held in byte j of
+ * eight registers, which converts between blocks and planes both ways.
+ */
+#define SWAPMOVE(a, b, n, m) do {					\
+	uint8x16_t __t = vandq_u8(veorq_u8(vshrq_n_u8(b, n), a), m);	\
+	a = veorq_u8(a, __t);						\
+	b = veorq_u8(b, vshlq_n_u8(__t, n));				\
+} while (0)
+
+static inline void bitslice(uint8x16_t x[8])
+{
+	const uint8x16_t m0 = vdupq_n_u8(0x55);
+	const uint8x16_t m1 = vdupq_n_u8(0x33);
+	const uint8x16_t m2 = vdupq_n_u8(0x0f);
+
+	SWAPMOVE(x[1], x[0], 1, m0);
+	SWAPMOVE(x[3], x[2], 1, m0);
+	SWAPMOVE(x[5], x[4], 1, m0);
+	SWAPMOVE(x[7], x[6], 1, m0);
+
+	SWAPMOVE(x[2], x[0], 2, m1);
+	SWAPMOVE(x[3], x[1], 2, m1);
+	SWAPMOVE(x[6], x[4], 2, m1);
+	SWAPMOVE(x[7], x[5], 2, m1);
+
+	SWAPMOVE(x[4], x[0], 4, m2);
+	SWAPMOVE(x[5], x[1], 4, m2);
+	SWAPMOVE(x[6], x[2], 4, m2);
+	SWAPMOVE(x[7], x[3], 4, m2);
+}
+
+/*
+ * Shared part of the S-box and its inverse: the circuit of Boyar and
+ * Peralta, "A depth-16 circuit for the AES S-box", without the constant
+ * of the affine transform. u[0] is the most significant bit.
+ */
+static inline void sbox_core(uint8x16_t u[8], uint8x16_t s[8])
+{
+	uint8x16_t t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13;
+	uint8x16_t t14, t15, t16, t17, t18, t19, t20, t21, t22, t23, t24;
+	uint8x16_t t25, t26, t27;
+	uint8x16_t m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13;
+	uint8x16_t m14, m15, m16, m17, m18, m19, m20, m21, m22, m23, m24;
+	uint8x16_t m25, m26, m27, m28, m29, m30, m31, m32, m33, m34, m35;
+	uint8x16_t m36, m37, m38, m39, m40, m41, m42, m43, m44, m45, m46;
+	uint8x16_t m47, m48, m49, m50, m51, m52, m53, m54, m55, m56, m57;
+	uint8x16_t m58, m59, m60, m61, m62, m63;
+	uint8x16_t l0, l1, l2, l3, l4, l5, l6, l7, l8, l9, l10, l11, l12;
+	uint8x16_t l13, l14, l15, l16, l17, l18, l19, l20, l21, l22, l23;
+	uint8x16_t l24, l25, l26, l27, l28, l29;
+
+	/* top linear transform */
+	t1 = veorq_u8(u[0], u[3]);
+	t2 = veorq_u8(u[0], u[5]);
+	t3 = veorq_u8(u[0], u[6]);
+	t4 = veorq_u8(u[3], u[5]);
+	t5 = veorq_u8(u[4], u[6]);
+	t6 = veorq_u8(t1, t5);
+	t7 = veorq_u8(u[1], u[2]);
+	t8 = veorq_u8(u[7], t6);
+	t9 = veorq_u8(u[7], t7);
+	t10 = veorq_u8(t6, t7);
+	t11 = veorq_u8(u[1], u[5]);
+	t12 = veorq_u8(u[2], u[5]);
+	t13 = veorq_u8(t3, t4);
+	t14 = veorq_u8(t6, t11);
+	t15 = veorq_u8(t5, t11);
+	t16 = veorq_u8(t5, t12);
+	t17 = veorq_u8(t9, t16);
+	t18 = veorq_u8(u[3], u[7]);
+	t19 = veorq_u8(t7, t18);
+	t20 = veorq_u8(t1, t19);
+	t21 = veorq_u8(u[6], u[7]);
+	t22 = veorq_u8(t7, t21);
+	t23 = veorq_u8(t2, t22);
+	t24 = veorq_u8(t2, t10);
+	t25 = veorq_u8(t20, t17);
+	t26 = veorq_u8(t3, t16);
+	t27 = veorq_u8(t1, t12);
+
+	/* shared inversion in GF(2^8) */
+	m1 = vandq_u8(t13, t6);
+	m2 = vandq_u8(t23, t8);
+	m3 = veorq_u8(t14, m1);
+	m4 = vandq_u8(t19, u[7]);
+	m5 = veorq_u8(m4, m1);
+	m6 = vandq_u8(t3, t16);
+	m7 = vandq_u8(t22, t9);
+	m8 = veorq_u8(t26, m6);
+	m9 = vandq_u8(t20, t17);
+	m10 = veorq_u8(m9, m6);
+	m11 = vandq_u8(t1, t15);
+	m12 = vandq_u8(t4, t27);
+	m13 = veorq_u8(m12, m11);
+	m14 = vandq_u8(t2, t10);
+	m15 = veorq_u8(m14, m11);
+	m16 = veorq_u8(m3, m2);
+	m17 = veorq_u8(m5, t24);
+	m18 = veorq_u8(m8, m7);
+	m19 = veorq_u8(m10, m15);
+	m20 = veorq_u8(m16, m13);
+	m21 = veorq_u8(m17, m15);
+	m22 = veorq_u8(m18, m13);
+	m23 = veorq_u8(m19, t25);
+	m24 = veorq_u8(m22, m23);
+	m25 = vandq_u8(m22, m20);
+	m26 = veorq_u8(m21, m25);
+	m27 = veorq_u8(m20, m21);
+	m28 = veorq_u8(m23, m25);
+	m29 = vandq_u8(m28, m27);
+	m30 = vandq_u8(m26, m24);
+	m31 = vandq_u8(m20, m23);
+	m32 = vandq_u8(m27, m31);
+	m33 = veorq_u8(m27, m25);
+	m34 = vandq_u8(m21, m22);
+	m35 = vandq_u8(m24, m34);
+	m36 = veorq_u8(m24, m25);
+	m37 = veorq_u8(m21, m29);
+	m38 = veorq_u8(m32, m33);
+	m39 = veorq_u8(m23, m30);
+	m40 = veorq_u8(m35, m36);
+	m41 = veorq_u8(m38, m40);
+	m42 = veorq_u8(m37, m39);
+	m43 = veorq_u8(m37, m38);
+	m44 = veorq_u8(m39, m40);
+	m45 = veorq_u8(m42, m41);
+	m46 = vandq_u8(m44, t6);
+	m47 = vandq_u8(m40, t8);
+	m48 = vandq_u8(m39, u[7]);
+	m49 = vandq_u8(m43, t16);
+	m50 = vandq_u8(m38, t9);
+	m51 = vandq_u8(m37, t17);
+	m52 = vandq_u8(m42, t15);
+	m53 = vandq_u8(m45, t27);
+	m54 = vandq_u8(m41, t10);
+	m55 = vandq_u8(m44, t13);
+	m56 = vandq_u8(m40, t23);
+	m57 = vandq_u8(m39, t19);
+	m58 = vandq_u8(m43, t3);
+	m59 = vandq_u8(m38, t22);
+	m60 = vandq_u8(m37, t20);
+	m61 = vandq_u8(m42, t1);
+	m62 = vandq_u8(m45, t4);
+	m63 = vandq_u8(m41, t2);
+
+	/* bottom linear transform */
+	l0 = veorq_u8(m61, m62);
+	l1 = veorq_u8(m50, m56);
+	l2 = veorq_u8(m46, m48);
+	l3 = veorq_u8(m47, m55);
+	l4 = veorq_u8(m54, m58);
+	l5 = veorq_u8(m49, m61);
+	l6 = veorq_u8(m62, l5);
+	l7 = veorq_u8(m46, l3);
+	l8 = veorq_u8(m51, m59);
+	l9 = veorq_u8(m52, m53);
+	l10 = veorq_u8(m53, l4);
+	l11 = veorq_u8(m60, l2);
+	l12 = veorq_u8(m48, m51);
+	l13 = veorq_u8(m50, l0);
+	l14 = veorq_u8(m52, m61);
+	l15 = veorq_u8(m55, l1);
+	l16 = veorq_u8(m56, l0);
+	l17 = veorq_u8(m57, l1);
+	l18 = veorq_u8(m58, l8);
+	l19 = veorq_u8(m63, l4);
+	l20 = veorq_u8(l0, l1);
+	l21 = veorq_u8(l1, l7);
+	l22 = veorq_u8(l3, l12);
+	l23 = veorq_u8(l18, l2);
+	l24 = veorq_u8(l15, l9);
+	l25 = veorq_u8(l6, l10);
+	l26 = veorq_u8(l7, l9);
+	l27 = veorq_u8(l8, l10);
+	l28 = veorq_u8(l11, l14);
+	l29 = veorq_u8(l11, l17);
+
+	s[0] = veorq_u8(l6, l24);
+	s[1] = veorq_u8(l16, l26);
+	s[2] = veorq_u8(l19, l28);
+	s[3] = veorq_u8(l6, l21);
+	s[4] = veorq_u8(l20, l22);
+	s[5] = veorq_u8(l25, l29);
+	s[6] = veorq_u8(l13, l27);
+	s[7] = veorq_u8(l6, l23);
+}
+
+static inline void sub_bytes(uint8x16_t x[8])
+{
+	uint8x16_t u[8], s[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		u[i] = x[7 - i];
+	sbox_core(u, s);
+
+	/* add the affine constant 0x63 */
+	x[7] = s[0];
+	x[6] = vmvnq_u8(s[1]);
+	x[5] = vmvnq_u8(s[2]);
+	x[4] = s[3];
+	x[3] = s[4];
+	x[2] = s[5];
+	x[1] = vmvnq_u8(s[6]);
+	x[0] = vmvnq_u8(s[7]);
+}
+
+/* the linear part of the inverse of the affine transform of the S-box */
+static inline void inv_affine(const uint8x16_t x[8], uint8x16_t y[8])
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		y[i] = veorq_u8(veorq_u8(x[(i + 2) & 7], x[(i + 5) & 7]),
+				x[(i + 7) & 7]);
+}
+
+/*
+ * The inverse S-box reuses the inversion of the forward circuit: with
+ * S(x) = A(x^-1) + 0x63, S^-1(y) = A^-1(C(A^-1(y) + 0x05)) where C is the
+ * circuit without its constant and A^-1 the linear map above.
+ */
+static inline void inv_sub_bytes(uint8x16_t x[8])
+{
+	uint8x16_t y[8], u[8], s[8];
+	int i;
+
+	inv_affine(x, y);
+	y[0] = vmvnq_u8(y[0]);
+	y[2] = vmvnq_u8(y[2]);
+
+	for (i = 0; i < 8; i++)
+		u[i] = y[7 - i];
+	sbox_core(u, s);
+	for (i = 0; i < 8; i++)
+		y[i] = s[7 - i];
+
+	inv_affine(y, x);
+}
+
+static const uint8_t shift_rows_idx[16] = {
+	0x0, 0x5, 0xa, 0xf, 0x4, 0x9, 0xe, 0x3,
+	0x8, 0xd, 0x2, 0x7, 0xc, 0x1, 0x6, 0xb,
+};
+
+static const uint8_t inv_shift_rows_idx[16] = {
+	0x0, 0xd, 0xa, 0x7, 0x4, 0x1, 0xe, 0xb,
+	0x8, 0x5, 0x2, 0xf, 0xc, 0x9, 0x6, 0x3,
+};
+
+static inline void shift_rows(uint8x16_t x[8], const uint8_t *idx)
+{
+	const uint8x8_t lo = vld1_u8(idx);
+	const uint8x8_t hi = vld1_u8(idx + 8);
+	uint8x8x2_t t;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		t.val[0] = vget_low_u8(x[i]);
+		t.val[1] = vget_high_u8(x[i]);
+		x[i] = vcombine_u8(vtbl2_u8(t, lo), vtbl2_u8(t, hi));
+	}
+}
+
+/* byte r of each column becomes byte r + 1 (rot1) or r + 2 (rot2) */
+static inline uint8x16_t rot1(uint8x16_t a)
+{
+	uint32x4_t w = vreinterpretq_u32_u8(a);
+
+	return vreinterpretq_u8_u32(vsliq_n_u32(vshrq_n_u32(w, 8), w, 24));
+}
+
+static inline uint8x16_t rot2(uint8x16_t a)
+{
+	return vreinterpretq_u8_u16(vrev32q_u16(vreinterpretq_u16_u8(a)));
+}
+
+/* multiply by x modulo x^8 + x^4 + x^3 + x + 1, in place */
+static inline void xtime(uint8x16_t x[8])
+{
+	uint8x16_t hi = x[7];
+
+	x[7] = x[6];
+	x[6] = x[5];
+	x[5] = x[4];
+	x[4] = veorq_u8(x[3], hi);
+	x[3] = veorq_u8(x[2], hi);
+	x[2] = x[1];
+	x[1] = veorq_u8(x[0], hi);
+	x[0] = hi;
+}
+
+/*
+ * out[r] = 2 a[r] + 3 a[r + 1] + a[r + 2] + a[r + 3]
+ *	  = 2 t[r] + a[r + 1] + t[r + 2]	with t[r] = a[r] + a[r + 1]
+ */
+static inline void mix_columns(uint8x16_t x[8])
+{
+	uint8x16_t r[8], t[8];
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		r[i] = rot1(x[i]);
+		t[i] = veorq_u8(x[i], r[i]);
+		x[i] = veorq_u8(r[i], rot2(t[i]));
+	}
+	xtime(t);
+	for (i = 0; i < 8; i++)
+		x[i] = veorq_u8(x[i], t[i]);
+}
+
+/*
+ * InvMixColumns is MixColumns applied after multiplying every column by
+ * 4 x^2 + 5, that is a[r] += 4 (a[r] + a[r + 2]).
+ */
+static inline void inv_mix_columns(uint8x16_t x[8])
+{
+	uint8x16_t u[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		u[i] = veorq_u8(x[i], rot2(x[i]));
+	xtime(u);
+	xtime(u);
+	for (i = 0; i < 8; i++)
+		x[i] = veorq_u8(x[i], u[i]);
+	mix_columns(x);
+}
+
+static inline void add_round_key(uint8x16_t x[8], const uint8_t *rk)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		x[i] = veorq_u8(x[i], vld1q_u8(rk + i * AESBS_PLANE_BYTES));
+}
+
+static inline void load_blocks(uint8x16_t x[8], const uint8_t *in)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		x[i] = vld1q_u8(in + i * 16);
+	bitslice(x);
+}
+
+static inline void store_blocks(uint8x16_t x[8], uint8_t *out)
+{
+	int i;
+
+	bitslice(x);
+	for (i = 0; i < 8; i++)
+		vst1q_u8(out + i * 16, x[i]);
+}
+
+/* encrypt/decrypt the 8 consecutive blocks at in, in and out may overlap */
+void aesbs_encrypt8(const uint8_t *rk, int rounds, uint8_t *out,
+		    const uint8_t *in)
+{
+	uint8x16_t x[8];
+	int r;
+
+	load_blocks(x, in);
+	add_round_key(x, rk);
+	for (r = 1; r < rounds; r++) {
+		rk += AESBS_KEY_BYTES;
+		sub_bytes(x);
+		shift_rows(x, shift_rows_idx);
+		mix_columns(x);
+		add_round_key(x, rk);
+	}
+	sub_bytes(x);
+	shift_rows(x, shift_rows_idx);
+	add_round_key(x, rk + AESBS_KEY_BYTES);
+	store_blocks(x, out);
+}
+
+void aesbs_decrypt8(const uint8_t *rk, int rounds, uint8_t *out,
+		    const uint8_t *in)
+{
+	uint8x16_t x[8];
+	int r;
+
+	rk += rounds * AESBS_KEY_BYTES;
+	load_blocks(x, in);
+	add_round_key(x, rk);
+	for (r = 1; r < rounds; r++) {
+		rk -= AESBS_KEY_BYTES;
+		shift_rows(x, inv_shift_rows_idx);
+		inv_sub_bytes(x);
+		add_round_key(x, rk);
+		inv_mix_columns(x);
+	}
+	shift_rows(x, inv_shift_rows_idx);
+	inv_sub_bytes(x);
+	add_round_key(x, rk - AESBS_KEY_BYTES);
+	store_blocks(x, out);
+}
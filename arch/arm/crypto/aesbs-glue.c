@@ -0,0 +1,488 @@
+/*
+ * Glue Code for the bit sliced NEON version of AES
+ *
+ * CBC decryption, CTR and XTS handle eight blocks at a time with the
+ * bit sliced code of aesbs-core.c. CBC encryption is serial and always
+ * uses the scalar cipher, which also handles the blocks left over at the
+ * end of a walk, the XTS tweak, and the whole request when NEON cannot be
+ * used because we are in interrupt context.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/crypto.h>
+#include <linux/hardirq.h>
+#include <crypto/algapi.h>
+#include <crypto/aes.h>
+#include <crypto/xts.h>
+#include <asm/aes.h>
+#include <asm/neon.h>
+
+#define AESBS_PARALLEL_BLOCKS	8
+#define AESBS_BATCH_BYTES	(AES_BLOCK_SIZE * AESBS_PARALLEL_BLOCKS)
+#define AESBS_KEY_BYTES		128
+#define AESBS_MAX_ROUNDS	14
+
+/* aesbs-core.c, in, out and bskey can have any alignment */
+asmlinkage void aesbs_encrypt8(const u8 *bskey, int rounds, u8 *out,
+			       const u8 *in);
+asmlinkage void aesbs_decrypt8(const u8 *bskey, int rounds, u8 *out,
+			       const u8 *in);
+
+struct aesbs_ctx {
+	struct crypto_aes_ctx aes;
+	int rounds;
+	u8 bskey[(AESBS_MAX_ROUNDS + 1) * AESBS_KEY_BYTES];
+};
+
+struct aesbs_xts_ctx {
+	struct aesbs_ctx crypt;
+	struct crypto_aes_ctx tweak;
+};
+
+/*
+ * Expand each of the rounds + 1 round keys into eight planes of 0x00/0xff
+ * bytes, plane i holding bit i of the bytes of the round key.
+ */
+static void aesbs_convert_key(u8 *bskey, const u32 *rk, int rounds)
+{
+	int r, i, j;
+
+	for (r = 0; r <= rounds; r++, rk += 4)
+		for (i = 0; i < 8; i++)
+			for (j = 0; j < AES_BLOCK_SIZE; j++)
+				*bskey++ = (rk[j / 4] >> (8 * (j % 4) + i)) & 1 ?
+					   0xff : 0;
+}
+
+static int __aesbs_setkey(struct aesbs_ctx *ctx, const u8 *in_key,
+			  unsigned int key_len, u32 *flags)
+{
+	if (crypto_aes_expand_key(&ctx->aes, in_key, key_len)) {
+		*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+
+	ctx->rounds = 6 + key_len / 4;
+
+	aesbs_convert_key(ctx->bskey, ctx->aes.key_enc, ctx->rounds);
+	return 0;
+}
+
+static int aesbs_setkey(struct crypto_tfm *tfm, const u8 *in_key,
+			unsigned int key_len)
+{
+	return __aesbs_setkey(crypto_tfm_ctx(tfm), in_key, key_len,
+			      &tfm->crt_flags);
+}
+
+static int aesbs_xts_setkey(struct crypto_tfm *tfm, const u8 *in_key,
+			    unsigned int key_len)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	u32 *flags = &tfm->crt_flags;
+	int err;
+
+	/* key consists of keys of equal size concatenated, therefore
+	 * the length must be even
+	 */
+	if (key_len % 2) {
+		*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+
+	/* first half of xts-key is for crypt */
+	err = __aesbs_setkey(&ctx->crypt, in_key, key_len / 2, flags);
+	if (err)
+		return err;
+
+	/* second half of xts-key is for tweak */
+	if (crypto_aes_expand_key(&ctx->tweak, in_key + key_len / 2,
+				  key_len / 2)) {
+		*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static inline bool aesbs_neon_begin(bool neon_enabled, unsigned int nbytes)
+{
+	if (neon_enabled)
+		return true;
+
+	/* NEON is only used when chunk to be processed is large enough, so
+	 * do not enable it until it is necessary. It cannot be used from
+	 * interrupt context, the scalar code handles such requests.
+	 */
+	if (nbytes < AESBS_BATCH_BYTES || in_interrupt())
+		return false;
+
+	kernel_neon_begin();
+	return true;
+}
+
+static inline void aesbs_neon_end(bool neon_enabled)
+{
+	if (neon_enabled)
+		kernel_neon_end();
+}
+
+static int cbc_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *wsrc = walk.src.virt.addr;
+		u8 *wdst = walk.dst.virt.addr;
+		u8 *iv = walk.iv;
+
+		do {
+			crypto_xor(iv, wsrc, AES_BLOCK_SIZE);
+			crypto_aes_encrypt_arm(&ctx->aes, wdst, iv);
+			memcpy(iv, wdst, AES_BLOCK_SIZE);
+
+			wsrc += AES_BLOCK_SIZE;
+			wdst += AES_BLOCK_SIZE;
+			nbytes -= AES_BLOCK_SIZE;
+		} while (nbytes >= AES_BLOCK_SIZE);
+
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static unsigned int __cbc_decrypt(struct aesbs_ctx *ctx,
+				  struct blkcipher_walk *walk, bool neon)
+{
+	unsigned int nbytes = walk->nbytes;
+	u8 *src = walk->src.virt.addr;
+	u8 *dst = walk->dst.virt.addr;
+	u8 *iv = walk->iv;
+	u8 buf[AESBS_BATCH_BYTES] __aligned(4);
+
+	/* src is read completely before dst is written, for in place */
+	while (neon && nbytes >= AESBS_BATCH_BYTES) {
+		aesbs_decrypt8(ctx->bskey, ctx->rounds, buf, src);
+		crypto_xor(buf, iv, AES_BLOCK_SIZE);
+		crypto_xor(buf + AES_BLOCK_SIZE, src,
+			   AESBS_BATCH_BYTES - AES_BLOCK_SIZE);
+		memcpy(iv, src + AESBS_BATCH_BYTES - AES_BLOCK_SIZE,
+		       AES_BLOCK_SIZE);
+		memcpy(dst, buf, AESBS_BATCH_BYTES);
+
+		src += AESBS_BATCH_BYTES;
+		dst += AESBS_BATCH_BYTES;
+		nbytes -= AESBS_BATCH_BYTES;
+	}
+
+	while (nbytes >= AES_BLOCK_SIZE) {
+		memcpy(buf, src, AES_BLOCK_SIZE);
+		crypto_aes_decrypt_arm(&ctx->aes, dst, src);
+		crypto_xor(dst, iv, AES_BLOCK_SIZE);
+		memcpy(iv, buf, AES_BLOCK_SIZE);
+
+		src += AES_BLOCK_SIZE;
+		dst += AES_BLOCK_SIZE;
+		nbytes -= AES_BLOCK_SIZE;
+	}
+
+	return nbytes;
+}
+
+static int cbc_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	bool neon_enabled = false;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	while ((nbytes = walk.nbytes)) {
+		neon_enabled = aesbs_neon_begin(neon_enabled, nbytes);
+		nbytes = __cbc_decrypt(ctx, &walk, neon_enabled);
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	aesbs_neon_end(neon_enabled);
+	return err;
+}
+
+static void ctr_crypt_final(struct aesbs_ctx *ctx, struct blkcipher_walk *walk)
+{
+	u8 *ctrblk = walk->iv;
+	u8 keystream[AES_BLOCK_SIZE] __aligned(4);
+	u8 *src = walk->src.virt.addr;
+	u8 *dst = walk->dst.virt.addr;
+	unsigned int nbytes = walk->nbytes;
+
+	crypto_aes_encrypt_arm(&ctx->aes, keystream, ctrblk);
+	crypto_xor(keystream, src, nbytes);
+	memcpy(dst, keystream, nbytes);
+
+	crypto_inc(ctrblk, AES_BLOCK_SIZE);
+}
+
+static unsigned int __ctr_crypt(struct aesbs_ctx *ctx,
+				struct blkcipher_walk *walk, bool neon)
+{
+	unsigned int nbytes = walk->nbytes;
+	u8 *src = walk->src.virt.addr;
+	u8 *dst = walk->dst.virt.addr;
+	u8 *ctrblk = walk->iv;
+	u8 keystream[AESBS_BATCH_BYTES] __aligned(4);
+	int i;
+
+	while (neon && nbytes >= AESBS_BATCH_BYTES) {
+		for (i = 0; i < AESBS_PARALLEL_BLOCKS; i++) {
+			memcpy(keystream + i * AES_BLOCK_SIZE, ctrblk,
+			       AES_BLOCK_SIZE);
+			crypto_inc(ctrblk, AES_BLOCK_SIZE);
+		}
+		aesbs_encrypt8(ctx->bskey, ctx->rounds, keystream, keystream);
+
+		if (dst != src)
+			memcpy(dst, src, AESBS_BATCH_BYTES);
+		crypto_xor(dst, keystream, AESBS_BATCH_BYTES);
+
+		src += AESBS_BATCH_BYTES;
+		dst += AESBS_BATCH_BYTES;
+		nbytes -= AESBS_BATCH_BYTES;
+	}
+
+	while (nbytes >= AES_BLOCK_SIZE) {
+		crypto_aes_encrypt_arm(&ctx->aes, keystream, ctrblk);
+		crypto_inc(ctrblk, AES_BLOCK_SIZE);
+
+		if (dst != src)
+			memcpy(dst, src, AES_BLOCK_SIZE);
+		crypto_xor(dst, keystream, AES_BLOCK_SIZE);
+
+		src += AES_BLOCK_SIZE;
+		dst += AES_BLOCK_SIZE;
+		nbytes -= AES_BLOCK_SIZE;
+	}
+
+	return nbytes;
+}
+
+static int ctr_crypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		     struct scatterlist *src, unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	bool neon_enabled = false;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		neon_enabled = aesbs_neon_begin(neon_enabled, nbytes);
+		nbytes = __ctr_crypt(ctx, &walk, neon_enabled);
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	aesbs_neon_end(neon_enabled);
+
+	if (walk.nbytes) {
+		ctr_crypt_final(ctx, &walk);
+		err = blkcipher_walk_done(desc, &walk, 0);
+	}
+
+	return err;
+}
+
+struct crypt_priv {
+	struct aesbs_ctx *ctx;
+	bool neon_enabled;
+};
+
+static void encrypt_callback(void *priv, u8 *srcdst, unsigned int nbytes)
+{
+	struct crypt_priv *p = priv;
+	struct aesbs_ctx *ctx = p->ctx;
+	int i;
+
+	p->neon_enabled = aesbs_neon_begin(p->neon_enabled, nbytes);
+
+	if (p->neon_enabled && nbytes == AESBS_BATCH_BYTES) {
+		aesbs_encrypt8(ctx->bskey, ctx->rounds, srcdst, srcdst);
+		return;
+	}
+
+	for (i = 0; i < nbytes / AES_BLOCK_SIZE; i++, srcdst += AES_BLOCK_SIZE)
+		crypto_aes_encrypt_arm(&ctx->aes, srcdst, srcdst);
+}
+
+static void decrypt_callback(void *priv, u8 *srcdst, unsigned int nbytes)
+{
+	struct crypt_priv *p = priv;
+	struct aesbs_ctx *ctx = p->ctx;
+	int i;
+
+	p->neon_enabled = aesbs_neon_begin(p->neon_enabled, nbytes);
+
+	if (p->neon_enabled && nbytes == AESBS_BATCH_BYTES) {
+		aesbs_decrypt8(ctx->bskey, ctx->rounds, srcdst, srcdst);
+		return;
+	}
+
+	for (i = 0; i < nbytes / AES_BLOCK_SIZE; i++, srcdst += AES_BLOCK_SIZE)
+		crypto_aes_decrypt_arm(&ctx->aes, srcdst, srcdst);
+}
+
+static int xts_encrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	struct aesbs_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	be128 buf[AESBS_PARALLEL_BLOCKS];
+	struct crypt_priv crypt_ctx = {
+		.ctx = &ctx->crypt,
+		.neon_enabled = false,
+	};
+	struct xts_crypt_req req = {
+		.tbuf = buf,
+		.tbuflen = sizeof(buf),
+
+		.tweak_ctx = &ctx->tweak,
+		.tweak_fn = XTS_TWEAK_CAST(crypto_aes_encrypt_arm),
+		.crypt_ctx = &crypt_ctx,
+		.crypt_fn = encrypt_callback,
+	};
+	int ret;
+
+	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
+	ret = xts_crypt(desc, dst, src, nbytes, &req);
+	aesbs_neon_end(crypt_ctx.neon_enabled);
+
+	return ret;
+}
+
+static int xts_decrypt(struct blkcipher_desc *desc, struct scatterlist *dst,
+		       struct scatterlist *src, unsigned int nbytes)
+{
+	struct aesbs_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	be128 buf[AESBS_PARALLEL_BLOCKS];
+	struct crypt_priv crypt_ctx = {
+		.ctx = &ctx->crypt,
+		.neon_enabled = false,
+	};
+	struct xts_crypt_req req = {
+		.tbuf = buf,
+		.tbuflen = sizeof(buf),
+
+		.tweak_ctx = &ctx->tweak,
+		.tweak_fn = XTS_TWEAK_CAST(crypto_aes_encrypt_arm),
+		.crypt_ctx = &crypt_ctx,
+		.crypt_fn = decrypt_callback,
+	};
+	int ret;
+
+	desc->flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
+	ret = xts_crypt(desc, dst, src, nbytes, &req);
+	aesbs_neon_end(crypt_ctx.neon_enabled);
+
+	return ret;
+}
+
+static struct crypto_alg aesbs_algs[3] = { {
+	.cra_name		= "cbc(aes)",
+	.cra_driver_name	= "cbc-aes-neonbs",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aesbs_algs[0].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_setkey,
+			.encrypt	= cbc_encrypt,
+			.decrypt	= cbc_decrypt,
+		},
+	},
+}, {
+	.cra_name		= "ctr(aes)",
+	.cra_driver_name	= "ctr-aes-neonbs",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aesbs_algs[1].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_setkey,
+			.encrypt	= ctr_crypt,
+			.decrypt	= ctr_crypt,
+		},
+	},
+}, {
+	.cra_name		= "xts(aes)",
+	.cra_driver_name	= "xts-aes-neonbs",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_xts_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(aesbs_algs[2].cra_list),
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_xts_setkey,
+			.encrypt	= xts_encrypt,
+			.decrypt	= xts_decrypt,
+		},
+	},
+} };
+
+static int __init aesbs_mod_init(void)
+{
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	return crypto_register_algs(aesbs_algs, ARRAY_SIZE(aesbs_algs));
+}
+
+static void __exit aesbs_mod_exit(void)
+{
+	crypto_unregister_algs(aesbs_algs, ARRAY_SIZE(aesbs_algs));
+}
+
+module_init(aesbs_mod_init);
+module_exit(aesbs_mod_exit);
+
+MODULE_DESCRIPTION("Bit sliced AES in CBC/CTR/XTS modes using NEON");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("cbc(aes)");
+MODULE_ALIAS("ctr(aes)");
+MODULE_ALIAS("xts(aes)");
@@ -0,0 +1,201 @@
+/*
+ * linux/arch/arm/crypto/sha-mb-neon-core.c
+ *
+ * Four lane SHA-1 and SHA-256 block transforms using NEON
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Each 32-bit lane of a quad register belongs to a different message, so
+ * four independent messages are hashed with the instructions a single
+ * one would take on the integer core. The state is kept transposed:
+ * state[i][lane] is word i of the hash value of that lane. The sixteen
+ * message words of a block are loaded from the four lanes and transposed
+ * four at a time.
+ *
+ * This file is built with -mfpu=neon and must only be called between
+ * kernel_neon_begin() and kernel_neon_end(). It does not include any kernel
+ * header, see arch/arm/crypto/sha_mb_glue.c for the prototypes.
+ */
+
+#include <arm_neon.h>
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define vrol32q(x, n)	vsliq_n_u32(vshrq_n_u32(x, 32 - (n)), x, n)
+#define vror32q(x, n)	vsliq_n_u32(vshrq_n_u32(x, n), x, 32 - (n))
+
+#define vadd3(x, y, z)	vaddq_u32(vaddq_u32(x, y), z)
+#define veor3(x, y, z)	veorq_u32(veorq_u32(x, y), z)
+
+/* (x & y) ^ (~x & z) */
+#define vCh(x, y, z)	veorq_u32(z, vandq_u32(x, veorq_u32(y, z)))
+/* (x & y) | (z & (x | y)) */
+#define vMaj(x, y, z)	vorrq_u32(vandq_u32(x, y), vandq_u32(z, vorrq_u32(x, y)))
+
+static inline uint32x4_t load_be32(const uint8_t *p)
+{
+	return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)));
+}
+
+/* Load words 4 * j .. 4 * j + 3 of the current block of every lane */
+static inline void load_words(uint32x4_t *w, const uint8_t *data[4], int j)
+{
+	uint32x4x2_t t0, t1;
+
+	t0 = vtrnq_u32(load_be32(data[0] + 16 * j),
+		       load_be32(data[1] + 16 * j));
+	t1 = vtrnq_u32(load_be32(data[2] + 16 * j),
+		       load_be32(data[3] + 16 * j));
+
+	w[0] = vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0]));
+	w[1] = vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1]));
+	w[2] = vcombine_u32(vget_high_u32(t0.val[0]), vget_high_u32(t1.val[0]));
+	w[3] = vcombine_u32(vget_high_u32(t0.val[1]), vget_high_u32(t1.val[1]));
+}
+
+static inline void load_block(uint32x4_t *w, const uint8_t *data[4])
+{
+	int j;
+
+	for (j = 0; j < 4; j++)
+		load_words(w + 4 * j, data, j);
+}
+
+/*
+ * Hash blocks 64 byte blocks of each of the four lanes. data[] can have
+ * any alignment and is advanced past the data, blocks must not be zero.
+ */
+void sha1_mb_neon_blocks(uint32_t state[5][4], const uint8_t *data[4],
+			 unsigned int blocks)
+{
+	uint32x4_t a, b, c, d, e, f, k, t;
+	uint32x4_t w[16];
+	int i, j;
+
+	do {
+		load_block(w, data);
+		for (j = 0; j < 4; j++)
+			data[j] += 64;
+
+		a = vld1q_u32(state[0]);
+		b = vld1q_u32(state[1]);
+		c = vld1q_u32(state[2]);
+		d = vld1q_u32(state[3]);
+		e = vld1q_u32(state[4]);
+
+		for (i = 0; i < 80; i++) {
+			if (i >= 16)
+				w[i & 15] = vrol32q(veorq_u32(veor3(w[(i + 13) & 15],
+								    w[(i + 8) & 15],
+								    w[(i + 2) & 15]),
+							      w[i & 15]), 1);
+
+			if (i < 20) {
+				f = vCh(b, c, d);
+				k = vdupq_n_u32(0x5a827999);
+			} else if (i < 40) {
+				f = veor3(b, c, d);
+				k = vdupq_n_u32(0x6ed9eba1);
+			} else if (i < 60) {
+				f = vMaj(b, c, d);
+				k = vdupq_n_u32(0x8f1bbcdc);
+			} else {
+				f = veor3(b, c, d);
+				k = vdupq_n_u32(0xca62c1d6);
+			}
+
+			t = vaddq_u32(vadd3(vrol32q(a, 5), f, e),
+				      vaddq_u32(k, w[i & 15]));
+			e = d;
+			d = c;
+			c = vrol32q(b, 30);
+			b = a;
+			a = t;
+		}
+
+		vst1q_u32(state[0], vaddq_u32(vld1q_u32(state[0]), a));
+		vst1q_u32(state[1], vaddq_u32(vld1q_u32(state[1]), b));
+		vst1q_u32(state[2], vaddq_u32(vld1q_u32(state[2]), c));
+		vst1q_u32(state[3], vaddq_u32(vld1q_u32(state[3]), d));
+		vst1q_u32(state[4], vaddq_u32(vld1q_u32(state[4]), e));
+	} while (--blocks);
+}
+
+static inline uint32x4_t s0(uint32x4_t x)
+{
+	return veor3(vror32q(x, 7), vror32q(x, 18), vshrq_n_u32(x, 3));
+}
+
+static inline uint32x4_t s1(uint32x4_t x)
+{
+	return veor3(vror32q(x, 17), vror32q(x, 19), vshrq_n_u32(x, 10));
+}
+
+static inline uint32x4_t e0(uint32x4_t x)
+{
+	return veor3(vror32q(x, 2), vror32q(x, 13), vror32q(x, 22));
+}
+
+static inline uint32x4_t e1(uint32x4_t x)
+{
+	return veor3(vror32q(x, 6), vror32q(x, 11), vror32q(x, 25));
+}
+
+/* see sha1_mb_neon_blocks() */
+void sha256_mb_neon_blocks(uint32_t state[8][4], const uint8_t *data[4],
+			   unsigned int blocks)
+{
+	uint32x4_t s[8], t1, t2;
+	uint32x4_t w[16];
+	int i, j;
+
+	do {
+		load_block(w, data);
+		for (j = 0; j < 4; j++)
+			data[j] += 64;
+
+		for (j = 0; j < 8; j++)
+			s[j] = vld1q_u32(state[j]);
+
+		for (i = 0; i < 64; i++) {
+			if (i >= 16)
+				w[i & 15] = vaddq_u32(vadd3(w[i & 15],
+							    s0(w[(i + 1) & 15]),
+							    w[(i + 9) & 15]),
+						      s1(w[(i + 14) & 15]));
+
+			/* s[] rotates by one each round, a is s[(8 - i) & 7] */
+#define S(n)	s[((n) - i) & 7]
+			t1 = vaddq_u32(vadd3(S(7), e1(S(4)),
+					     vCh(S(4), S(5), S(6))),
+				       vaddq_u32(vdupq_n_u32(sha256_k[i]),
+						 w[i & 15]));
+			t2 = vaddq_u32(e0(S(0)), vMaj(S(0), S(1), S(2)));
+			S(3) = vaddq_u32(S(3), t1);
+			S(7) = vaddq_u32(t1, t2);
+#undef S
+		}
+
+		for (j = 0; j < 8; j++)
+			vst1q_u32(state[j], vaddq_u32(vld1q_u32(state[j]), s[j]));
+	} while (--blocks);
+}
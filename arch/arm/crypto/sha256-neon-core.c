@@ -0,0 +1,135 @@
+/*
+ * linux/arch/arm/crypto/sha256-neon-core.c
+ *
+ * SHA-256 block transform using NEON for the message schedule
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The message schedule is computed four words at a time in quad registers
+ * and the round constants are added there too, so the compression rounds,
+ * which run on the integer pipeline, only need one load per round. The
+ * sixteen schedule words for the next sixteen rounds are produced before
+ * those rounds are run, which lets the NEON unit work ahead of the
+ * integer core.
+ *
+ * This file is built with -mfpu=neon and must only be called between
+ * kernel_neon_begin() and kernel_neon_end(). It does not include any kernel
+ * header, see arch/arm/crypto/sha256_neon_glue.c for the prototype.
+ */
+
+#include <arm_neon.h>
+
+static const uint32_t sha256_k[64] __attribute__((aligned(16))) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ror32(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+#define vror32q(x, n)	vsliq_n_u32(vshrq_n_u32(x, n), x, 32 - (n))
+#define vror32(x, n)	vsli_n_u32(vshr_n_u32(x, n), x, 32 - (n))
+
+#define Ch(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define Maj(x, y, z)	(((x) & (y)) | ((z) & ((x) | (y))))
+#define e0(x)		(ror32(x, 2) ^ ror32(x, 13) ^ ror32(x, 22))
+#define e1(x)		(ror32(x, 6) ^ ror32(x, 11) ^ ror32(x, 25))
+
+#define ROUND(a, b, c, d, e, f, g, h, wk) do {				\
+	uint32_t __t1 = h + e1(e) + Ch(e, f, g) + (wk);			\
+	uint32_t __t2 = e0(a) + Maj(a, b, c);				\
+	d += __t1;							\
+	h = __t1 + __t2;						\
+} while (0)
+
+static inline uint32x4_t s0(uint32x4_t x)
+{
+	return veorq_u32(veorq_u32(vror32q(x, 7), vror32q(x, 18)),
+			 vshrq_n_u32(x, 3));
+}
+
+static inline uint32x2_t s1(uint32x2_t x)
+{
+	return veor_u32(veor_u32(vror32(x, 17), vror32(x, 19)),
+			vshr_n_u32(x, 10));
+}
+
+/*
+ * Given w0..w3 holding W[i-16..i-1], return W[i..i+3]. The last two of
+ * these depend on the first two through sigma1, so each half is done with
+ * a double register.
+ */
+static inline uint32x4_t schedule(uint32x4_t w0, uint32x4_t w1,
+				  uint32x4_t w2, uint32x4_t w3)
+{
+	uint32x4_t t = vaddq_u32(vaddq_u32(w0, s0(vextq_u32(w0, w1, 1))),
+				 vextq_u32(w2, w3, 1));
+	uint32x2_t lo = vadd_u32(vget_low_u32(t), s1(vget_high_u32(w3)));
+	uint32x2_t hi = vadd_u32(vget_high_u32(t), s1(lo));
+
+	return vcombine_u32(lo, hi);
+}
+
+static inline uint32x4_t load_be32(const uint8_t *p)
+{
+	return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)));
+}
+
+/* data can have any alignment, blocks must not be zero */
+void sha256_transform_neon(uint32_t *state, const uint8_t *data,
+			   unsigned int blocks)
+{
+	uint32_t a, b, c, d, e, f, g, h;
+	uint32_t wk[16] __attribute__((aligned(16)));
+	uint32x4_t w[4];
+	int i, j;
+
+	do {
+		for (j = 0; j < 4; j++)
+			w[j] = load_be32(data + 16 * j);
+		data += 64;
+
+		a = state[0];	b = state[1];	c = state[2];	d = state[3];
+		e = state[4];	f = state[5];	g = state[6];	h = state[7];
+
+		for (i = 0; i < 64; i += 16) {
+			for (j = 0; j < 4; j++) {
+				vst1q_u32(wk + 4 * j,
+					  vaddq_u32(w[j],
+						    vld1q_u32(sha256_k + i + 4 * j)));
+				if (i < 48)
+					w[j] = schedule(w[j], w[(j + 1) & 3],
+							w[(j + 2) & 3],
+							w[(j + 3) & 3]);
+			}
+
+			for (j = 0; j < 16; j += 8) {
+				ROUND(a, b, c, d, e, f, g, h, wk[j]);
+				ROUND(h, a, b, c, d, e, f, g, wk[j + 1]);
+				ROUND(g, h, a, b, c, d, e, f, wk[j + 2]);
+				ROUND(f, g, h, a, b, c, d, e, wk[j + 3]);
+				ROUND(e, f, g, h, a, b, c, d, wk[j + 4]);
+				ROUND(d, e, f, g, h, a, b, c, wk[j + 5]);
+				ROUND(c, d, e, f, g, h, a, b, wk[j + 6]);
+				ROUND(b, c, d, e, f, g, h, a, wk[j + 7]);
+			}
+		}
+
+		state[0] += a;	state[1] += b;	state[2] += c;	state[3] += d;
+		state[4] += e;	state[5] += f;	state[6] += g;	state[7] += h;
+	} while (--blocks);
+}
@@ -0,0 +1,172 @@
+/*
+ * linux/arch/arm/crypto/sha512-neon-core.c
+ *
+ * SHA-512 block transform for ARM NEON
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The integer core has no 64-bit registers, so the generic C code spends
+ * most of its time pairing up 32-bit operations and spilling them. Here
+ * the eight working variables each live in a NEON double register and the
+ * rounds are done with 64-bit vector shifts and logic. The message
+ * schedule is computed two words at a time in quad registers, the round
+ * constants are added there and the halves are fed straight to the rounds.
+ *
+ * This file is built with -mfpu=neon and must only be called between
+ * kernel_neon_begin() and kernel_neon_end(). It does not include any kernel
+ * header, see arch/arm/crypto/sha512_neon_glue.c for the prototype.
+ */
+
+#include <arm_neon.h>
+
+static const uint64_t sha512_k[80] __attribute__((aligned(16))) = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+	0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+	0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+	0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+	0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+	0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+	0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+	0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+	0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+	0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+	0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+	0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+	0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+	0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+	0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+	0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+	0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+	0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+	0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+	0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+	0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+#define vror64q(x, n)	vsliq_n_u64(vshrq_n_u64(x, n), x, 64 - (n))
+#define vror64(x, n)	vsli_n_u64(vshr_n_u64(x, n), x, 64 - (n))
+
+static inline uint64x1_t e0(uint64x1_t x)
+{
+	return veor_u64(veor_u64(vror64(x, 28), vror64(x, 34)), vror64(x, 39));
+}
+
+static inline uint64x1_t e1(uint64x1_t x)
+{
+	return veor_u64(veor_u64(vror64(x, 14), vror64(x, 18)), vror64(x, 41));
+}
+
+static inline uint64x2_t s0(uint64x2_t x)
+{
+	return veorq_u64(veorq_u64(vror64q(x, 1), vror64q(x, 8)),
+			 vshrq_n_u64(x, 7));
+}
+
+static inline uint64x2_t s1(uint64x2_t x)
+{
+	return veorq_u64(veorq_u64(vror64q(x, 19), vror64q(x, 61)),
+			 vshrq_n_u64(x, 6));
+}
+
+/* Ch(e, f, g) and Maj(a, b, c) are both a bit select */
+#define ROUND(a, b, c, d, e, f, g, h, wk) do {				\
+	uint64x1_t __t1 = vadd_u64(vadd_u64(h, e1(e)),			\
+				   vadd_u64(vbsl_u64(e, f, g), wk));	\
+	uint64x1_t __t2 = vadd_u64(e0(a),				\
+				   vbsl_u64(veor_u64(a, b), c, b));	\
+	d = vadd_u64(d, __t1);						\
+	h = vadd_u64(__t1, __t2);					\
+} while (0)
+
+/*
+ * Given w[0..7] holding W[i-16..i-1], return W[i..i+1]. Both words only
+ * depend on W[i-2] and older through sigma1, so there is no dependency
+ * between the two lanes.
+ */
+static inline uint64x2_t schedule(const uint64x2_t w[8], int j)
+{
+	uint64x2_t w0 = w[j], w1 = w[(j + 1) & 7];
+	uint64x2_t w4 = w[(j + 4) & 7], w5 = w[(j + 5) & 7];
+	uint64x2_t w7 = w[(j + 7) & 7];
+
+	return vaddq_u64(vaddq_u64(w0, s0(vextq_u64(w0, w1, 1))),
+			 vaddq_u64(vextq_u64(w4, w5, 1), s1(w7)));
+}
+
+static inline uint64x2_t load_be64(const uint8_t *p)
+{
+	return vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(p)));
+}
+
+/* data can have any alignment, blocks must not be zero */
+void sha512_transform_neon(uint64_t *state, const uint8_t *data,
+			   unsigned int blocks)
+{
+	uint64x1_t a, b, c, d, e, f, g, h;
+	uint64x2_t w[8], wk;
+	int i, j;
+
+	a = vld1_u64(state + 0);	b = vld1_u64(state + 1);
+	c = vld1_u64(state + 2);	d = vld1_u64(state + 3);
+	e = vld1_u64(state + 4);	f = vld1_u64(state + 5);
+	g = vld1_u64(state + 6);	h = vld1_u64(state + 7);
+
+	do {
+		for (j = 0; j < 8; j++)
+			w[j] = load_be64(data + 16 * j);
+		data += 128;
+
+		for (i = 0; i < 80; i += 16) {
+			for (j = 0; j < 8; j += 4) {
+				wk = vaddq_u64(w[j], vld1q_u64(sha512_k + i + 2 * j));
+				if (i < 64)
+					w[j] = schedule(w, j);
+				ROUND(a, b, c, d, e, f, g, h, vget_low_u64(wk));
+				ROUND(h, a, b, c, d, e, f, g, vget_high_u64(wk));
+
+				wk = vaddq_u64(w[j + 1],
+					       vld1q_u64(sha512_k + i + 2 * j + 2));
+				if (i < 64)
+					w[j + 1] = schedule(w, j + 1);
+				ROUND(g, h, a, b, c, d, e, f, vget_low_u64(wk));
+				ROUND(f, g, h, a, b, c, d, e, vget_high_u64(wk));
+
+				wk = vaddq_u64(w[j + 2],
+					       vld1q_u64(sha512_k + i + 2 * j + 4));
+				if (i < 64)
+					w[j + 2] = schedule(w, j + 2);
+				ROUND(e, f, g, h, a, b, c, d, vget_low_u64(wk));
+				ROUND(d, e, f, g, h, a, b, c, vget_high_u64(wk));
+
+				wk = vaddq_u64(w[j + 3],
+					       vld1q_u64(sha512_k + i + 2 * j + 6));
+				if (i < 64)
+					w[j + 3] = schedule(w, j + 3);
+				ROUND(c, d, e, f, g, h, a, b, vget_low_u64(wk));
+				ROUND(b, c, d, e, f, g, h, a, vget_high_u64(wk));
+			}
+		}
+
+		a = vadd_u64(a, vld1_u64(state + 0));
+		b = vadd_u64(b, vld1_u64(state + 1));
+		c = vadd_u64(c, vld1_u64(state + 2));
+		d = vadd_u64(d, vld1_u64(state + 3));
+		e = vadd_u64(e, vld1_u64(state + 4));
+		f = vadd_u64(f, vld1_u64(state + 5));
+		g = vadd_u64(g, vld1_u64(state + 6));
+		h = vadd_u64(h, vld1_u64(state + 7));
+
+		vst1_u64(state + 0, a);	vst1_u64(state + 1, b);
+		vst1_u64(state + 2, c);	vst1_u64(state + 3, d);
+		vst1_u64(state + 4, e);	vst1_u64(state + 5, f);
+		vst1_u64(state + 6, g);	vst1_u64(state + 7, h);
+	} while (--blocks);
+}
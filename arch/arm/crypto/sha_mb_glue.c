@@ -0,0 +1,561 @@
+/*
+ * Cryptographic API.
+ *
+ * Multi-buffer SHA-1 and SHA-256 using the ARM NEON unit.
+ *
+ * A single SHA transform is a chain of dependent integer operations, so
+ * it cannot use the NEON unit well. Independent messages can: the four
+ * lane transforms in sha-mb-neon-core.c hash four messages at once at
+ * about the cost of one. This is only a win when enough requests arrive
+ * at the same time, IPsec or AF_ALG users on several sockets for
+ * example.
+ *
+ * digest() requests are queued on a per-CPU lane manager and hashed by a
+ * worker. The worker is started at once when there are enough requests
+ * to fill the lanes, otherwise when an hrtimer fires after flush_us
+ * microseconds, and it refills
+ * lanes as they finish until the queue is empty. Lanes without a request
+ * hash a block of zeroes.
+ *
+ * Incremental hashing depends on the state left by the previous step and
+ * cannot be batched, init, update, final, finup, export and import go to
+ * the best synchronous implementation instead.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/internal/hash.h>
+#include <crypto/scatterwalk.h>
+#include <crypto/sha.h>
+#include <linux/highmem.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/interrupt.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/workqueue.h>
+#include <asm/neon.h>
+#include <asm/unaligned.h>
+
+#define SHA_MB_LANES		4
+#define SHA_MB_BLOCK_SIZE	64
+
+/* blocks per call, bounds the time spent with preemption disabled */
+#define SHA_MB_MAX_BLOCKS	16
+
+#define SHA_MB_MAX_QLEN		1000
+
+/* sha-mb-neon-core.c, data[] can have any alignment and is advanced */
+asmlinkage void sha1_mb_neon_blocks(u32 state[][SHA_MB_LANES],
+				    const u8 *data[SHA_MB_LANES],
+				    unsigned int blocks);
+asmlinkage void sha256_mb_neon_blocks(u32 state[][SHA_MB_LANES],
+				      const u8 *data[SHA_MB_LANES],
+				      unsigned int blocks);
+
+static unsigned int flush_us = 500;
+module_param(flush_us, uint, 0444);
+MODULE_PARM_DESC(flush_us, "Microseconds to wait for the lanes to fill "
+			   "before hashing what is queued");
+
+static ktime_t sha_mb_flush_delay;
+static struct workqueue_struct *sha_mb_wq;
+
+/* what idle lanes hash */
+static const u8 sha_mb_zero[SHA_MB_MAX_BLOCKS * SHA_MB_BLOCK_SIZE];
+
+struct sha_mb_alg;
+
+struct sha_mb_mgr {
+	spinlock_t lock;
+	struct crypto_queue queue;
+
+	/*
+	 * A jiffy based delayed work would round flush_us up to a whole
+	 * tick, 10ms at HZ=100, for every lone digest.
+	 */
+	struct work_struct flush_work;
+	struct hrtimer timer;
+	struct sha_mb_alg *alg;
+	int cpu;
+
+	/* only used by the worker */
+	struct ahash_request *lane[SHA_MB_LANES];
+	u32 state[SHA256_DIGEST_SIZE / 4][SHA_MB_LANES] __aligned(16);
+};
+
+struct sha_mb_alg {
+	void (*blocks)(u32 state[][SHA_MB_LANES],
+		       const u8 *data[SHA_MB_LANES], unsigned int blocks);
+	const u32 *iv;
+	unsigned int words;
+	struct sha_mb_mgr __percpu *mgr;
+	struct ahash_alg alg;
+};
+
+struct sha_mb_ctx {
+	struct crypto_shash *fallback;
+};
+
+struct sha_mb_reqctx {
+	/* where the whole blocks of req->src continue */
+	struct scatterlist *sg;
+	unsigned int offset;
+	unsigned int done;
+	unsigned int left;
+
+	/* the last partial block and the padding, one or two blocks */
+	unsigned int tail_len;
+	unsigned int tail_off;
+	u8 tail[2 * SHA_MB_BLOCK_SIZE];
+
+	/* for a block that straddles a page or scatterlist entry */
+	u8 bounce[SHA_MB_BLOCK_SIZE];
+
+	/* incremental hashing, must be last */
+	struct shash_desc desc;
+};
+
+static inline struct sha_mb_alg *sha_mb_alg(struct crypto_ahash *tfm)
+{
+	return container_of(crypto_hash_alg_common(tfm), struct sha_mb_alg,
+			    alg.halg);
+}
+
+/*
+ * Point *data at the next whole blocks of the lane's request and return
+ * how many there are, mapping the page into *vaddr when needed.
+ */
+static unsigned int sha_mb_map(struct ahash_request *req, const u8 **data,
+			       void **vaddr)
+{
+	struct sha_mb_reqctx *rctx = ahash_request_ctx(req);
+	struct scatterlist *sg = rctx->sg;
+	unsigned int pos, len;
+	struct page *page;
+
+	*vaddr = NULL;
+
+	if (!rctx->left) {
+		*data = rctx->tail + rctx->tail_off;
+		return (rctx->tail_len - rctx->tail_off) / SHA_MB_BLOCK_SIZE;
+	}
+
+	pos = sg->offset + rctx->offset;
+	page = nth_page(sg_page(sg), pos >> PAGE_SHIFT);
+	pos = offset_in_page(pos);
+	len = min3(sg->length - rctx->offset, (unsigned int)PAGE_SIZE - pos,
+		   rctx->left);
+
+	if (len >= SHA_MB_BLOCK_SIZE) {
+		*vaddr = kmap_atomic(page);
+		*data = *vaddr + pos;
+		return len / SHA_MB_BLOCK_SIZE;
+	}
+
+	scatterwalk_map_and_copy(rctx->bounce, req->src, rctx->done,
+				 SHA_MB_BLOCK_SIZE, 0);
+	*data = rctx->bounce;
+	return 1;
+}
+
+/* Account for blocks hashed, return true when the request is done */
+static bool sha_mb_advance(struct ahash_request *req, unsigned int blocks)
+{
+	struct sha_mb_reqctx *rctx = ahash_request_ctx(req);
+	unsigned int bytes = blocks * SHA_MB_BLOCK_SIZE;
+
+	if (!rctx->left) {
+		rctx->tail_off += bytes;
+		return rctx->tail_off == rctx->tail_len;
+	}
+
+	rctx->left -= bytes;
+	rctx->done += bytes;
+	rctx->offset += bytes;
+	while (rctx->left && rctx->offset >= rctx->sg->length) {
+		rctx->offset -= rctx->sg->length;
+		rctx->sg = scatterwalk_sg_next(rctx->sg);
+	}
+
+	return false;
+}
+
+static void sha_mb_finish(struct sha_mb_mgr *mgr, unsigned int i)
+{
+	struct ahash_request *req = mgr->lane[i];
+	unsigned int j, words;
+
+	mgr->lane[i] = NULL;
+
+	words = crypto_ahash_digestsize(crypto_ahash_reqtfm(req)) / 4;
+	for (j = 0; j < words; j++)
+		put_unaligned_be32(mgr->state[j][i], req->result + 4 * j);
+
+	local_bh_disable();
+	req->base.complete(&req->base, 0);
+	local_bh_enable();
+}
+
+/* Give idle lanes a queued request, return the number of busy lanes */
+static unsigned int sha_mb_fill(struct sha_mb_mgr *mgr)
+{
+	struct crypto_async_request *req, *backlog;
+	unsigned int i, j, busy = 0;
+
+	for (i = 0; i < SHA_MB_LANES; i++) {
+		if (!mgr->lane[i]) {
+			spin_lock_bh(&mgr->lock);
+			backlog = crypto_get_backlog(&mgr->queue);
+			req = crypto_dequeue_request(&mgr->queue);
+			spin_unlock_bh(&mgr->lock);
+
+			if (!req)
+				continue;
+
+			if (backlog) {
+				local_bh_disable();
+				backlog->complete(backlog, -EINPROGRESS);
+				local_bh_enable();
+			}
+
+			mgr->lane[i] = ahash_request_cast(req);
+			for (j = 0; j < mgr->alg->words; j++)
+				mgr->state[j][i] = mgr->alg->iv[j];
+		}
+		busy++;
+	}
+
+	return busy;
+}
+
+static void sha_mb_flush(struct sha_mb_mgr *mgr)
+{
+	const u8 *data[SHA_MB_LANES];
+	void *vaddr[SHA_MB_LANES];
+	unsigned int i, blocks;
+
+	while (sha_mb_fill(mgr)) {
+		blocks = SHA_MB_MAX_BLOCKS;
+		for (i = 0; i < SHA_MB_LANES; i++) {
+			vaddr[i] = NULL;
+			data[i] = sha_mb_zero;
+			if (mgr->lane[i])
+				blocks = min(blocks, sha_mb_map(mgr->lane[i],
+								&data[i],
+								&vaddr[i]));
+		}
+
+		kernel_neon_begin();
+		mgr->alg->blocks(mgr->state, data, blocks);
+		kernel_neon_end();
+
+		/* kmap_atomic() mappings nest */
+		for (i = SHA_MB_LANES; i-- > 0; )
+			if (vaddr[i])
+				kunmap_atomic(vaddr[i]);
+
+		for (i = 0; i < SHA_MB_LANES; i++)
+			if (mgr->lane[i] && sha_mb_advance(mgr->lane[i], blocks))
+				sha_mb_finish(mgr, i);
+
+		cond_resched();
+	}
+}
+
+static void sha_mb_flush_work(struct work_struct *work)
+{
+	sha_mb_flush(container_of(work, struct sha_mb_mgr, flush_work));
+}
+
+static enum hrtimer_restart sha_mb_timeout(struct hrtimer *timer)
+{
+	struct sha_mb_mgr *mgr = container_of(timer, struct sha_mb_mgr, timer);
+
+	queue_work_on(mgr->cpu, sha_mb_wq, &mgr->flush_work);
+	return HRTIMER_NORESTART;
+}
+
+static int sha_mb_digest(struct ahash_request *req)
+{
+	struct sha_mb_alg *alg = sha_mb_alg(crypto_ahash_reqtfm(req));
+	struct sha_mb_reqctx *rctx = ahash_request_ctx(req);
+	unsigned int partial = req->nbytes % SHA_MB_BLOCK_SIZE;
+	__be64 bits = cpu_to_be64((u64)req->nbytes << 3);
+	struct sha_mb_mgr *mgr;
+	unsigned int qlen;
+	int cpu, err;
+
+	rctx->sg = req->src;
+	rctx->offset = 0;
+	rctx->done = 0;
+	rctx->left = req->nbytes - partial;
+
+	/* Pad out to 56 mod 64 and append length */
+	memset(rctx->tail, 0, sizeof(rctx->tail));
+	scatterwalk_map_and_copy(rctx->tail, req->src, rctx->left, partial, 0);
+	rctx->tail[partial] = 0x80;
+	rctx->tail_len = partial < 56 ? SHA_MB_BLOCK_SIZE :
+					2 * SHA_MB_BLOCK_SIZE;
+	rctx->tail_off = 0;
+	memcpy(rctx->tail + rctx->tail_len - sizeof(bits), &bits,
+	       sizeof(bits));
+
+	cpu = get_cpu();
+	mgr = per_cpu_ptr(alg->mgr, cpu);
+
+	spin_lock_bh(&mgr->lock);
+	err = crypto_enqueue_request(&mgr->queue, &req->base);
+	qlen = mgr->queue.qlen;
+	if (qlen < SHA_MB_LANES && !hrtimer_active(&mgr->timer))
+		hrtimer_start(&mgr->timer, sha_mb_flush_delay,
+			      HRTIMER_MODE_REL_PINNED);
+	spin_unlock_bh(&mgr->lock);
+
+	if (qlen >= SHA_MB_LANES)
+		queue_work_on(cpu, sha_mb_wq, &mgr->flush_work);
+	put_cpu();
+
+	return err;
+}
+
+static int sha_mb_init(struct ahash_request *req)
+{
+	struct sha_mb_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct sha_mb_reqctx *rctx = ahash_request_ctx(req);
+
+	rctx->desc.tfm = ctx->fallback;
+	rctx->desc.flags = req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	return crypto_shash_init(&rctx->desc);
+}
+
+static int sha_mb_update(struct ahash_request *req)
+{
+	struct sha_mb_reqctx *rctx = ahash_request_ctx(req);
+
+	return shash_ahash_update(req, &rctx->desc);
+}
+
+static int sha_mb_final(struct ahash_request *req)
+{
+	struct sha_mb_reqctx *rctx = ahash_request_ctx(req);
+
+	return crypto_shash_final(&rctx->desc, req->result);
+}
+
+static int sha_mb_finup(struct ahash_request *req)
+{
+	struct sha_mb_reqctx *rctx = ahash_request_ctx(req);
+
+	return shash_ahash_finup(req, &rctx->desc);
+}
+
+static int sha_mb_export(struct ahash_request *req, void *out)
+{
+	struct sha_mb_reqctx *rctx = ahash_request_ctx(req);
+
+	return crypto_shash_export(&rctx->desc, out);
+}
+
+static int sha_mb_import(struct ahash_request *req, const void *in)
+{
+	struct sha_mb_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct sha_mb_reqctx *rctx = ahash_request_ctx(req);
+
+	rctx->desc.tfm = ctx->fallback;
+	rctx->desc.flags = req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	return crypto_shash_import(&rctx->desc, in);
+}
+
+static int sha_mb_cra_init(struct crypto_tfm *tfm)
+{
+	struct sha_mb_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_shash *fallback;
+
+	fallback = crypto_alloc_shash(crypto_tfm_alg_name(tfm), 0, 0);
+	if (IS_ERR(fallback))
+		return PTR_ERR(fallback);
+
+	ctx->fallback = fallback;
+	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
+				 sizeof(struct sha_mb_reqctx) +
+				 crypto_shash_descsize(fallback));
+
+	return 0;
+}
+
+static void sha_mb_cra_exit(struct crypto_tfm *tfm)
+{
+	struct sha_mb_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_shash(ctx->fallback);
+}
+
+static const u32 sha1_mb_iv[] = {
+	SHA1_H0, SHA1_H1, SHA1_H2, SHA1_H3, SHA1_H4,
+};
+
+static const u32 sha256_mb_iv[] = {
+	SHA256_H0, SHA256_H1, SHA256_H2, SHA256_H3,
+	SHA256_H4, SHA256_H5, SHA256_H6, SHA256_H7,
+};
+
+static struct sha_mb_alg algs[] = { {
+	.blocks	= sha1_mb_neon_blocks,
+	.iv	= sha1_mb_iv,
+	.words	= ARRAY_SIZE(sha1_mb_iv),
+	.alg	= {
+		.init		=	sha_mb_init,
+		.update		=	sha_mb_update,
+		.final		=	sha_mb_final,
+		.finup		=	sha_mb_finup,
+		.digest		=	sha_mb_digest,
+		.export		=	sha_mb_export,
+		.import		=	sha_mb_import,
+		.halg.digestsize =	SHA1_DIGEST_SIZE,
+		.halg.statesize	=	sizeof(struct sha1_state),
+		.halg.base	=	{
+			.cra_name	=	"sha1",
+			.cra_driver_name=	"sha1-mb-neon",
+			.cra_priority	=	300,
+			.cra_flags	=	CRYPTO_ALG_TYPE_AHASH |
+						CRYPTO_ALG_ASYNC,
+			.cra_blocksize	=	SHA_MB_BLOCK_SIZE,
+			.cra_ctxsize	=	sizeof(struct sha_mb_ctx),
+			.cra_type	=	&crypto_ahash_type,
+			.cra_init	=	sha_mb_cra_init,
+			.cra_exit	=	sha_mb_cra_exit,
+			.cra_module	=	THIS_MODULE,
+		}
+	}
+}, {
+	.blocks	= sha256_mb_neon_blocks,
+	.iv	= sha256_mb_iv,
+	.words	= ARRAY_SIZE(sha256_mb_iv),
+	.alg	= {
+		.init		=	sha_mb_init,
+		.update		=	sha_mb_update,
+		.final		=	sha_mb_final,
+		.finup		=	sha_mb_finup,
+		.digest		=	sha_mb_digest,
+		.export		=	sha_mb_export,
+		.import		=	sha_mb_import,
+		.halg.digestsize =	SHA256_DIGEST_SIZE,
+		.halg.statesize	=	sizeof(struct sha256_state),
+		.halg.base	=	{
+			.cra_name	=	"sha256",
+			.cra_driver_name=	"sha256-mb-neon",
+			.cra_priority	=	300,
+			.cra_flags	=	CRYPTO_ALG_TYPE_AHASH |
+						CRYPTO_ALG_ASYNC,
+			.cra_blocksize	=	SHA_MB_BLOCK_SIZE,
+			.cra_ctxsize	=	sizeof(struct sha_mb_ctx),
+			.cra_type	=	&crypto_ahash_type,
+			.cra_init	=	sha_mb_cra_init,
+			.cra_exit	=	sha_mb_cra_exit,
+			.cra_module	=	THIS_MODULE,
+		}
+	}
+} };
+
+static void sha_mb_free_mgrs(struct sha_mb_alg *alg)
+{
+	struct sha_mb_mgr *mgr;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		mgr = per_cpu_ptr(alg->mgr, cpu);
+		hrtimer_cancel(&mgr->timer);
+		cancel_work_sync(&mgr->flush_work);
+	}
+
+	free_percpu(alg->mgr);
+}
+
+static int sha_mb_register(struct sha_mb_alg *alg)
+{
+	struct sha_mb_mgr *mgr;
+	int cpu, ret;
+
+	alg->mgr = alloc_percpu(struct sha_mb_mgr);
+	if (!alg->mgr)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		mgr = per_cpu_ptr(alg->mgr, cpu);
+		spin_lock_init(&mgr->lock);
+		crypto_init_queue(&mgr->queue, SHA_MB_MAX_QLEN);
+		INIT_WORK(&mgr->flush_work, sha_mb_flush_work);
+		hrtimer_init(&mgr->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		mgr->timer.function = sha_mb_timeout;
+		mgr->alg = alg;
+		mgr->cpu = cpu;
+	}
+
+	ret = crypto_register_ahash(&alg->alg);
+	if (ret)
+		free_percpu(alg->mgr);
+
+	return ret;
+}
+
+static void sha_mb_unregister(struct sha_mb_alg *alg)
+{
+	crypto_unregister_ahash(&alg->alg);
+	sha_mb_free_mgrs(alg);
+}
+
+static int __init sha_mb_mod_init(void)
+{
+	int i, ret;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	sha_mb_flush_delay = ns_to_ktime((u64)flush_us * NSEC_PER_USEC);
+
+	sha_mb_wq = alloc_workqueue("sha_mb", WQ_MEM_RECLAIM |
+					      WQ_CPU_INTENSIVE, 1);
+	if (!sha_mb_wq)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(algs); i++) {
+		ret = sha_mb_register(&algs[i]);
+		if (ret)
+			goto err_unregister;
+	}
+
+	return 0;
+
+err_unregister:
+	while (i--)
+		sha_mb_unregister(&algs[i]);
+	destroy_workqueue(sha_mb_wq);
+	return ret;
+}
+
+static void __exit sha_mb_mod_fini(void)
+{
+	int i;
+
+	/* no tfm is left, so nothing is queued */
+	for (i = ARRAY_SIZE(algs); i--; )
+		sha_mb_unregister(&algs[i]);
+	destroy_workqueue(sha_mb_wq);
+}
+
+module_init(sha_mb_mod_init);
+module_exit(sha_mb_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Multi-buffer SHA-1 and SHA-256 Secure Hash Algorithms, NEON accelerated");
+MODULE_ALIAS("sha1");
+MODULE_ALIAS("sha256");
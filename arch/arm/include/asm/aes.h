@@ -0,0 +1,11 @@
+#ifndef ASM_ARM_AES_H
+#define ASM_ARM_AES_H
+
+#include <linux/crypto.h>
+#include <crypto/aes.h>
+
+void crypto_aes_encrypt_arm(struct crypto_aes_ctx *ctx, u8 *dst,
+			    const u8 *src);
+void crypto_aes_decrypt_arm(struct crypto_aes_ctx *ctx, u8 *dst,
+			    const u8 *src);
+#endif
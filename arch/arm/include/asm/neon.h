@@ -0,0 +1,25 @@
+/*
+ * linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * kernel_neon_begin() saves the user NEON/VFP state and disables preemption
+ * until the matching kernel_neon_end(). It may not be called from interrupt
+ * context. Code using NEON must live in a separate compilation unit built
+ * with -mfpu=neon, so that the compiler cannot move NEON instructions
+ * outside of the begin/end pair.
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+
+#endif /* __ASM_ARM_NEON_H */
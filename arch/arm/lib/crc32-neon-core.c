@@ -0,0 +1,133 @@
+/*
+ * linux/arch/arm/lib/crc32-neon-core.c
+ *
+ * CRC32 and CRC32C folding using NEON polynomial multiplies
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The bit reflected CRC of a message only depends on the message modulo
+ * the CRC polynomial, so 128 bit chunks can be folded into the chunk that
+ * is 64 (four lanes) or 16 (one lane) bytes further along by carry-less
+ * multiplying their halves by x^(512+32) and x^(512-32) mod P, or by
+ * x^(128+32) and x^(128-32) mod P respectively. The last 16 bytes left by
+ * the folding have the same CRC as the whole input and are finished off
+ * with the table driven code.
+ *
+ * NEON only has an 8x8 bit carry-less multiply, the 64x64 bit one is built
+ * from it by multiplying rotated copies of the operands, which takes eight
+ * vmull.p8 and keeps all lanes busy.
+ *
+ * Only byte lanes are used so the result does not depend on the endianness.
+ * This file is built with -mfpu=neon and must only be called between
+ * kernel_neon_begin() and kernel_neon_end(). It does not include any kernel
+ * header, see arch/arm/lib/crc32.c for the prototype.
+ */
+
+#include <arm_neon.h>
+
+static inline uint8x16_t vmull8(uint8x8_t a, uint8x8_t b)
+{
+	return vreinterpretq_u8_p16(vmull_p8(vreinterpret_p8_u8(a),
+					     vreinterpret_p8_u8(b)));
+}
+
+/*
+ * Sum the partial products of byte i of one operand with byte i + n of
+ * the other, each one lands n bytes up from a plain vmull.p8 lane. The
+ * products that were rotated around the end of the 64-bit operand are
+ * in the top n bytes of the high half and belong to the low half.
+ */
+static inline uint8x16_t pmull64_part(uint8x8_t a, uint8x8_t b, int n,
+				      uint8x8_t mask)
+{
+	uint8x16_t t;
+	uint8x8_t lo, hi;
+
+	switch (n) {
+	case 1:
+		t = veorq_u8(vmull8(vext_u8(a, a, 1), b),
+			     vmull8(a, vext_u8(b, b, 1)));
+		break;
+	case 2:
+		t = veorq_u8(vmull8(vext_u8(a, a, 2), b),
+			     vmull8(a, vext_u8(b, b, 2)));
+		break;
+	case 3:
+		t = veorq_u8(vmull8(vext_u8(a, a, 3), b),
+			     vmull8(a, vext_u8(b, b, 3)));
+		break;
+	default:
+		t = vmull8(a, vext_u8(b, b, 4));
+		break;
+	}
+
+	lo = vget_low_u8(t);
+	hi = vget_high_u8(t);
+	lo = veor_u8(lo, hi);
+	hi = vand_u8(hi, mask);
+	lo = veor_u8(lo, hi);
+	t = vcombine_u8(lo, hi);
+
+	return vextq_u8(t, t, 16 - n);
+}
+
+/* 64x64 -> 128 bit carry-less multiply */
+static inline uint8x16_t pmull64(uint8x8_t a, uint8x8_t b)
+{
+	static const uint64_t masks[4] = {
+		0x0000ffffffffffffULL, 0x00000000ffffffffULL,
+		0x000000000000ffffULL, 0,
+	};
+	uint8x16_t r;
+
+	r = veorq_u8(vmull8(a, b),
+		     pmull64_part(a, b, 1, vcreate_u8(masks[0])));
+	r = veorq_u8(r, pmull64_part(a, b, 2, vcreate_u8(masks[1])));
+	r = veorq_u8(r, pmull64_part(a, b, 3, vcreate_u8(masks[2])));
+	return veorq_u8(r, pmull64_part(a, b, 4, vcreate_u8(masks[3])));
+}
+
+static inline uint8x16_t fold(uint8x16_t x, uint8x8_t klo, uint8x8_t khi,
+			      uint8x16_t next)
+{
+	return veorq_u8(veorq_u8(pmull64(vget_low_u8(x), klo),
+				 pmull64(vget_high_u8(x), khi)), next);
+}
+
+/*
+ * Fold blocks * 64 bytes of data, with crc as the initial value, into the
+ * 16 bytes at rem. k holds the 64 and 16 byte folding constants for the
+ * low and high halves. data can have any alignment, blocks must not be
+ * zero.
+ */
+void crc32_neon_fold(uint8_t *rem, const uint8_t *data, unsigned int blocks,
+		     uint32_t crc, const uint64_t *k)
+{
+	uint8_t init[16] __attribute__((aligned(16))) = {
+		crc, crc >> 8, crc >> 16, crc >> 24,
+	};
+	uint8x8_t k64lo = vcreate_u8(k[0]), k64hi = vcreate_u8(k[1]);
+	uint8x8_t k16lo = vcreate_u8(k[2]), k16hi = vcreate_u8(k[3]);
+	uint8x16_t x0, x1, x2, x3;
+
+	x0 = veorq_u8(vld1q_u8(data), vld1q_u8(init));
+	x1 = vld1q_u8(data + 16);
+	x2 = vld1q_u8(data + 32);
+	x3 = vld1q_u8(data + 48);
+
+	while (--blocks) {
+		data += 64;
+		x0 = fold(x0, k64lo, k64hi, vld1q_u8(data));
+		x1 = fold(x1, k64lo, k64hi, vld1q_u8(data + 16));
+		x2 = fold(x2, k64lo, k64hi, vld1q_u8(data + 32));
+		x3 = fold(x3, k64lo, k64hi, vld1q_u8(data + 48));
+	}
+
+	x0 = fold(x0, k16lo, k16hi, x1);
+	x0 = fold(x0, k16lo, k16hi, x2);
+	x0 = fold(x0, k16lo, k16hi, x3);
+
+	vst1q_u8(rem, x0);
+}
@@ -0,0 +1,232 @@
+/*
+ *  linux/arch/arm/lib/crc32.c
+ *
+ * CRC32 and CRC32C for ARM, using the ARMv8 CRC32 instructions or NEON
+ * folding when the CPU has them.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * These override the weak crc32_le() and __crc32c_le() from lib/crc32.c,
+ * which are exported from there. Until the boot time selection has run,
+ * and whenever nothing beats it, they call the table driven code. Every
+ * candidate is checked against the table driven code over a range of
+ * lengths and alignments first, and then the one that checksums a page
+ * the most times in a jiffy is used, the same way crypto/xor.c picks its
+ * template.
+ */
+
+#include <linux/crc32.h>
+#include <linux/gfp.h>
+#include <linux/hardirq.h>
+#include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/kernel.h>
+#include <linux/random.h>
+#include <asm/cputype.h>
+#include <asm/neon.h>
+#include <asm/system_info.h>
+
+/* crc32-armv8.S, p can have any alignment */
+asmlinkage u32 crc32_armv8_le(u32 crc, unsigned char const *p, size_t len);
+asmlinkage u32 crc32c_armv8_le(u32 crc, unsigned char const *p, size_t len);
+
+struct crc32_impl {
+	const char	*name;
+	u32		(*crc32_le)(u32 crc, unsigned char const *p, size_t len);
+	u32		(*crc32c_le)(u32 crc, unsigned char const *p, size_t len);
+	bool		(*usable)(void);
+};
+
+static u32 (*crc32_le_fn)(u32, unsigned char const *, size_t) __read_mostly =
+	crc32_le_base;
+static u32 (*crc32c_le_fn)(u32, unsigned char const *, size_t) __read_mostly =
+	__crc32c_le_base;
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_fn(crc, p, len);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32c_le_fn(crc, p, len);
+}
+
+static bool __init crc32_armv8_usable(void)
+{
+	/* ID_ISAR5 only exists with the new CPUID scheme */
+	if (cpu_architecture() < CPU_ARCH_ARMv7)
+		return false;
+	return ((read_cpuid_ext(CPUID_EXT_ISAR5) >> 16) & 0xf) != 0;
+}
+
+#ifdef CONFIG_KERNEL_MODE_NEON
+
+/* crc32-neon-core.c, p can have any alignment, blocks must not be zero */
+void crc32_neon_fold(u8 *rem, const u8 *p, unsigned int blocks, u32 crc,
+		     const u64 *k);
+
+/* see crc32-neon-core.c, { x^544, x^480, x^160, x^96 } mod P, reflected */
+static const u64 crc32_neon_k[] = {
+	0x154442bd4ULL, 0x1c6e41596ULL, 0x1751997d0ULL, 0x0ccaa009eULL,
+};
+
+static const u64 crc32c_neon_k[] = {
+	0x0740eef02ULL, 0x09e4addf8ULL, 0x0f20c0dfeULL, 0x14cd00bd6ULL,
+};
+
+/* not worth saving the VFP state for less */
+#define CRC32_NEON_MIN_LEN	256
+
+static inline u32 __crc32_neon_le(u32 crc, unsigned char const *p,
+				  size_t len, const u64 *k,
+				  u32 (*base)(u32, unsigned char const *,
+					      size_t))
+{
+	u8 rem[16];
+
+	if (len >= CRC32_NEON_MIN_LEN && !in_interrupt()) {
+		unsigned int blocks = len / 64;
+
+		kernel_neon_begin();
+		crc32_neon_fold(rem, p, blocks, crc, k);
+		kernel_neon_end();
+
+		crc = base(0, rem, sizeof(rem));
+		p += blocks * 64;
+		len %= 64;
+	}
+	return base(crc, p, len);
+}
+
+static u32 crc32_neon_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return __crc32_neon_le(crc, p, len, crc32_neon_k, crc32_le_base);
+}
+
+static u32 crc32c_neon_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return __crc32_neon_le(crc, p, len, crc32c_neon_k, __crc32c_le_base);
+}
+
+static bool __init crc32_neon_usable(void)
+{
+	return cpu_has_neon();
+}
+
+#endif /* CONFIG_KERNEL_MODE_NEON */
+
+static struct crc32_impl crc32_impls[] __initdata = {
+	{
+		.name		= "table",
+		.crc32_le	= crc32_le_base,
+		.crc32c_le	= __crc32c_le_base,
+	}, {
+		.name		= "armv8",
+		.crc32_le	= crc32_armv8_le,
+		.crc32c_le	= crc32c_armv8_le,
+		.usable		= crc32_armv8_usable,
+	},
+#ifdef CONFIG_KERNEL_MODE_NEON
+	{
+		.name		= "neon",
+		.crc32_le	= crc32_neon_le,
+		.crc32c_le	= crc32c_neon_le,
+		.usable		= crc32_neon_usable,
+	},
+#endif
+};
+
+#define CRC32_BENCH_SIZE	PAGE_SIZE
+
+/* buf holds CRC32_BENCH_SIZE + 3 random bytes */
+static bool __init crc32_impl_ok(const struct crc32_impl *impl, const u8 *buf)
+{
+	static const unsigned int lens[] __initconst = {
+		0, 1, 3, 4, 7, 8, 15, 16, 31, 63, 64, 65, 255, 256, 257,
+		319, 511, 1000, 1024, 1500, CRC32_BENCH_SIZE,
+	};
+	unsigned int i, off;
+	u32 seed;
+
+	for (i = 0; i < ARRAY_SIZE(lens); i++) {
+		for (off = 0; off < 4; off++) {
+			seed = (~0U << off) ^ lens[i];
+			if (impl->crc32_le(seed, buf + off, lens[i]) !=
+			    crc32_le_base(seed, buf + off, lens[i]))
+				return false;
+			if (impl->crc32c_le(seed, buf + off, lens[i]) !=
+			    __crc32c_le_base(seed, buf + off, lens[i]))
+				return false;
+		}
+	}
+	return true;
+}
+
+static unsigned int __init crc32_impl_speed(const struct crc32_impl *impl,
+					    const u8 *buf)
+{
+	unsigned long now;
+	unsigned int i, count, max = 0;
+	u32 crc = 0;
+
+	for (i = 0; i < 3; i++) {
+		now = jiffies;
+		count = 0;
+		while (jiffies == now) {
+			crc = impl->crc32_le(crc, buf, CRC32_BENCH_SIZE);
+			barrier();
+			count++;
+		}
+		if (count > max)
+			max = count;
+	}
+
+	/* MB/s */
+	return max * HZ / (1024 * 1024 / CRC32_BENCH_SIZE);
+}
+
+static int __init crc32_arm_select(void)
+{
+	const struct crc32_impl *impl, *fastest = &crc32_impls[0];
+	unsigned int i, speed, best = 0;
+	u8 *buf;
+
+	buf = (u8 *)__get_free_pages(GFP_KERNEL, 1);
+	if (!buf)
+		return -ENOMEM;
+	get_random_bytes(buf, CRC32_BENCH_SIZE + 3);
+
+	pr_info("crc32: measuring checksum speed\n");
+
+	for (i = 0; i < ARRAY_SIZE(crc32_impls); i++) {
+		impl = &crc32_impls[i];
+		if (impl->usable && !impl->usable())
+			continue;
+
+		if (!crc32_impl_ok(impl, buf)) {
+			pr_err("crc32: %s implementation failed the self test\n",
+			       impl->name);
+			continue;
+		}
+
+		speed = crc32_impl_speed(impl, buf);
+		pr_info("   %-10s: %5u MB/sec\n", impl->name, speed);
+		if (speed > best) {
+			best = speed;
+			fastest = impl;
+		}
+	}
+
+	free_pages((unsigned long)buf, 1);
+
+	pr_info("crc32: using %s implementation\n", fastest->name);
+	crc32_le_fn = fastest->crc32_le;
+	crc32c_le_fn = fastest->crc32c_le;
+	return 0;
+}
+
+/* arch/arm/vfp links first, so this runs after vfp_init() sets HWCAP_NEON */
+core_initcall(crc32_arm_select);
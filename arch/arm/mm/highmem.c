@@ -48,15 +48,15 @@ void *kmap_atomic(struct page *page)
 	if (!PageHighMem(page))
 		return page_address(page);
 
-#ifdef CONFIG_DEBUG_HIGHMEM
 	/*
-	 * There is no cache coherency issue when non VIVT, so force the
-	 * dedicated kmap usage for better debugging purposes in that case.
+	 * There is no cache coherency issue when non VIVT, so use the
+	 * dedicated kmap then: reusing the pkmap entry of the page would
+	 * take kmap_lock with irqs off, which costs more than setting up
+	 * a per-cpu fixmap slot.
 	 */
 	if (!cache_is_vivt())
 		kmap = NULL;
 	else
-#endif
 		kmap = kmap_high_get(page);
 	if (kmap)
 		return kmap;
@@ -14,6 +14,7 @@
 
 #include <linux/atomic.h>
 #include <crypto/if_alg.h>
+#include <crypto/scatterwalk.h>
 #include <linux/crypto.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
@@ -365,6 +366,7 @@ int af_alg_make_sg(struct af_alg_sgl *sgl, void __user *addr, int len,
 
 	err = 0;
 
+	sgl->npages = npages;
 	sg_init_table(sgl->sg, npages);
 
 	for (i = 0; i < npages; i++) {
@@ -386,13 +388,19 @@ void af_alg_free_sg(struct af_alg_sgl *sgl)
 {
 	int i;
 
-	i = 0;
-	do {
+	for (i = 0; i < sgl->npages; i++)
 		put_page(sgl->pages[i]);
-	} while (!sg_is_last(sgl->sg + (i++)));
 }
 EXPORT_SYMBOL_GPL(af_alg_free_sg);
 
+/* Continue the scatterlist of sgl_prev with that of sgl_new */
+void af_alg_link_sg(struct af_alg_sgl *sgl_prev, struct af_alg_sgl *sgl_new)
+{
+	sgl_prev->sg[sgl_prev->npages - 1].page_link &= ~0x02;
+	scatterwalk_sg_chain(sgl_prev->sg, sgl_prev->npages + 1, sgl_new->sg);
+}
+EXPORT_SYMBOL_GPL(af_alg_link_sg);
+
 int af_alg_cmsg_send(struct msghdr *msg, struct af_alg_control *con)
 {
 	struct cmsghdr *cmsg;
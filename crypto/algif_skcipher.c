@@ -15,12 +15,15 @@
 #include <crypto/scatterwalk.h>
 #include <crypto/skcipher.h>
 #include <crypto/if_alg.h>
+#include <linux/aio.h>
 #include <linux/init.h>
 #include <linux/list.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/net.h>
+#include <linux/pipe_fs_i.h>
+#include <linux/splice.h>
 #include <net/sock.h>
 
 struct skcipher_sg_list {
@@ -49,6 +52,34 @@ struct skcipher_ctx {
 	struct ablkcipher_request req;
 };
 
+/*
+ * An AIO read submits a request of its own, so several of them can be in
+ * flight on one socket. Each one owns the pages of the data it consumed
+ * and of the user buffers it writes to, and takes a copy of the IV: like
+ * separate sendmsg() calls with ALG_SET_IV, the requests are independent
+ * and the IV is not chained from one to the next.
+ */
+struct skcipher_async_rsgl {
+	struct af_alg_sgl sgl;
+	struct list_head list;
+};
+
+struct skcipher_async_req {
+	struct kiocb *iocb;
+	struct sock *sk;
+
+	struct skcipher_async_rsgl first_sgl;
+	struct list_head list;
+
+	struct scatterlist *tsg;
+	unsigned int tsg_nents;
+
+	unsigned int len;
+
+	/* followed by the request context and the IV */
+	struct ablkcipher_request req;
+};
+
 #define MAX_SGL_ENTS ((PAGE_SIZE - sizeof(struct skcipher_sg_list)) / \
 		      sizeof(struct scatterlist) - 1)
 
@@ -415,7 +446,212 @@ unlock:
 	return err ?: size;
 }
 
-static int skcipher_recvmsg(struct kiocb *unused, struct socket *sock,
+/* Take references to the first used bytes of the queued data */
+static int skcipher_take_sgl(struct sock *sk, struct skcipher_async_req *areq,
+			     unsigned int used)
+{
+	struct alg_sock *ask = alg_sk(sk);
+	struct skcipher_ctx *ctx = ask->private;
+	struct skcipher_sg_list *sgl;
+	struct scatterlist *sg;
+	unsigned int len, plen, n, i;
+
+	n = 0;
+	len = used;
+	list_for_each_entry(sgl, &ctx->tsgl, list) {
+		for (i = 0; i < sgl->cur && len; i++) {
+			if (!sgl->sg[i].length)
+				continue;
+			len -= min(len, sgl->sg[i].length);
+			n++;
+		}
+		if (!len)
+			break;
+	}
+
+	areq->tsg = sock_kmalloc(sk, n * sizeof(*areq->tsg), GFP_KERNEL);
+	if (!areq->tsg)
+		return -ENOMEM;
+
+	sg_init_table(areq->tsg, n);
+	areq->tsg_nents = n;
+
+	n = 0;
+	len = used;
+	list_for_each_entry(sgl, &ctx->tsgl, list) {
+		for (i = 0; i < sgl->cur && len; i++) {
+			sg = sgl->sg + i;
+			if (!sg->length)
+				continue;
+
+			plen = min(len, sg->length);
+			get_page(sg_page(sg));
+			sg_set_page(areq->tsg + n++, sg_page(sg), plen,
+				    sg->offset);
+			len -= plen;
+		}
+		if (!len)
+			break;
+	}
+
+	skcipher_pull_sgl(sk, used);
+
+	return 0;
+}
+
+static void skcipher_free_async_req(struct skcipher_async_req *areq)
+{
+	struct sock *sk = areq->sk;
+	struct skcipher_async_rsgl *rsgl, *tmp;
+	unsigned int i;
+
+	list_for_each_entry_safe(rsgl, tmp, &areq->list, list) {
+		af_alg_free_sg(&rsgl->sgl);
+		if (rsgl != &areq->first_sgl)
+			sock_kfree_s(sk, rsgl, sizeof(*rsgl));
+	}
+
+	if (areq->tsg) {
+		for (i = 0; i < areq->tsg_nents; i++)
+			put_page(sg_page(areq->tsg + i));
+		sock_kfree_s(sk, areq->tsg,
+			     areq->tsg_nents * sizeof(*areq->tsg));
+	}
+
+	sock_kfree_s(sk, areq, areq->len);
+}
+
+static void skcipher_async_cb(struct crypto_async_request *req, int err)
+{
+	struct skcipher_async_req *areq = req->data;
+	struct kiocb *iocb = areq->iocb;
+	struct sock *sk = areq->sk;
+	unsigned int len = areq->req.nbytes;
+
+	if (err == -EINPROGRESS)
+		return;
+
+	skcipher_free_async_req(areq);
+	aio_complete(iocb, err ?: len, 0);
+	sock_put(sk);
+}
+
+static int skcipher_recvmsg_async(struct kiocb *iocb, struct socket *sock,
+				  struct msghdr *msg, int flags)
+{
+	struct sock *sk = sock->sk;
+	struct alg_sock *ask = alg_sk(sk);
+	struct skcipher_ctx *ctx = ask->private;
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(&ctx->req);
+	unsigned int reqsize = crypto_ablkcipher_reqsize(tfm);
+	unsigned int ivsize = crypto_ablkcipher_ivsize(tfm);
+	unsigned bs = crypto_ablkcipher_blocksize(tfm);
+	struct skcipher_async_rsgl *rsgl, *last_rsgl = NULL;
+	struct skcipher_async_req *areq;
+	unsigned long iovlen;
+	struct iovec *iov;
+	unsigned int len;
+	int used = 0;
+	u8 *iv;
+	int err;
+
+	lock_sock(sk);
+	if (!ctx->used) {
+		err = skcipher_wait_for_data(sk, flags);
+		if (err)
+			goto unlock;
+	}
+
+	len = sizeof(*areq) + reqsize + ivsize;
+	err = -ENOMEM;
+	areq = sock_kmalloc(sk, len, GFP_KERNEL);
+	if (!areq)
+		goto unlock;
+
+	memset(areq, 0, sizeof(*areq));
+	areq->len = len;
+	areq->iocb = iocb;
+	areq->sk = sk;
+	INIT_LIST_HEAD(&areq->list);
+
+	iv = (u8 *)areq + sizeof(*areq) + reqsize;
+	memcpy(iv, ctx->iv, ivsize);
+
+	/* Pin the user buffers, up to what is queued */
+	for (iov = msg->msg_iov, iovlen = msg->msg_iovlen; iovlen > 0;
+	     iovlen--, iov++) {
+		unsigned long seglen = iov->iov_len;
+		char __user *from = iov->iov_base;
+
+		while (seglen && used < ctx->used) {
+			int n = min_t(unsigned long, seglen, ctx->used - used);
+
+			if (list_empty(&areq->list)) {
+				rsgl = &areq->first_sgl;
+			} else {
+				err = -ENOMEM;
+				rsgl = sock_kmalloc(sk, sizeof(*rsgl),
+						    GFP_KERNEL);
+				if (!rsgl)
+					goto free;
+			}
+
+			n = af_alg_make_sg(&rsgl->sgl, from, n, 1);
+			if (n < 0) {
+				err = n;
+				if (rsgl != &areq->first_sgl)
+					sock_kfree_s(sk, rsgl, sizeof(*rsgl));
+				goto free;
+			}
+
+			list_add_tail(&rsgl->list, &areq->list);
+			if (last_rsgl)
+				af_alg_link_sg(&last_rsgl->sgl, &rsgl->sgl);
+			last_rsgl = rsgl;
+
+			used += n;
+			from += n;
+			seglen -= n;
+		}
+	}
+
+	if (ctx->more || used < ctx->used)
+		used -= used % bs;
+
+	err = -EINVAL;
+	if (!used)
+		goto free;
+
+	err = skcipher_take_sgl(sk, areq, used);
+	if (err)
+		goto free;
+
+	ablkcipher_request_set_tfm(&areq->req, tfm);
+	ablkcipher_request_set_callback(&areq->req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					skcipher_async_cb, areq);
+	ablkcipher_request_set_crypt(&areq->req, areq->tsg,
+				     areq->first_sgl.sgl.sg, used, iv);
+
+	/* dropped by skcipher_async_cb(), which may already have run */
+	sock_hold(sk);
+	err = ctx->enc ? crypto_ablkcipher_encrypt(&areq->req) :
+			 crypto_ablkcipher_decrypt(&areq->req);
+	if (err == -EINPROGRESS || err == -EBUSY) {
+		err = -EIOCBQUEUED;
+		goto unlock;
+	}
+	sock_put(sk);
+
+free:
+	skcipher_free_async_req(areq);
+unlock:
+	skcipher_wmem_wakeup(sk);
+	release_sock(sk);
+
+	return err ?: used;
+}
+
+static int skcipher_recvmsg(struct kiocb *iocb, struct socket *sock,
 			    struct msghdr *msg, size_t ignored, int flags)
 {
 	struct sock *sk = sock->sk;
@@ -431,6 +667,9 @@ static int skcipher_recvmsg(struct kiocb *unused, struct socket *sock,
 	int used;
 	long copied = 0;
 
+	if (!is_sync_kiocb(iocb))
+		return skcipher_recvmsg_async(iocb, sock, msg, flags);
+
 	lock_sock(sk);
 	for (iov = msg->msg_iov, iovlen = msg->msg_iovlen; iovlen > 0;
 	     iovlen--, iov++) {
@@ -499,6 +738,127 @@ unlock:
 }
 
 
+static void skcipher_spd_release(struct splice_pipe_desc *spd, unsigned int i)
+{
+	put_page(spd->pages[i]);
+}
+
+/* The pages are allocated here and given to the pipe */
+static const struct pipe_buf_operations skcipher_pipe_buf_ops = {
+	.can_merge = 0,
+	.map = generic_pipe_buf_map,
+	.unmap = generic_pipe_buf_unmap,
+	.confirm = generic_pipe_buf_confirm,
+	.release = generic_pipe_buf_release,
+	.steal = generic_pipe_buf_steal,
+	.get = generic_pipe_buf_get,
+};
+
+/*
+ * Process queued data into fresh pages and move those into the pipe, so
+ * the result can be spliced on to a file or socket without a copy. The
+ * input is never written to, it may be page cache or user memory that
+ * was spliced in.
+ */
+static ssize_t skcipher_splice_read(struct socket *sock, loff_t *ppos,
+				    struct pipe_inode_info *pipe, size_t len,
+				    unsigned int flags)
+{
+	struct sock *sk = sock->sk;
+	struct alg_sock *ask = alg_sk(sk);
+	struct skcipher_ctx *ctx = ask->private;
+	unsigned bs = crypto_ablkcipher_blocksize(crypto_ablkcipher_reqtfm(
+		&ctx->req));
+	struct page *pages[PIPE_DEF_BUFFERS];
+	struct partial_page partial[PIPE_DEF_BUFFERS];
+	struct scatterlist sg[PIPE_DEF_BUFFERS];
+	struct splice_pipe_desc spd = {
+		.pages = pages,
+		.partial = partial,
+		.flags = flags,
+		.ops = &skcipher_pipe_buf_ops,
+		.spd_release = skcipher_spd_release,
+	};
+	struct skcipher_sg_list *sgl;
+	struct scatterlist *tsg;
+	unsigned int npages, i;
+	size_t used;
+	int err;
+
+	len = min_t(size_t, len, PIPE_DEF_BUFFERS * PAGE_SIZE);
+
+	/* Data taken off the socket must not be dropped for lack of room */
+	if (flags & SPLICE_F_NONBLOCK) {
+		pipe_lock(pipe);
+		npages = pipe->buffers - pipe->nrbufs;
+		pipe_unlock(pipe);
+
+		if (!npages)
+			return -EAGAIN;
+		len = min_t(size_t, len, npages * PAGE_SIZE);
+	}
+
+	lock_sock(sk);
+	if (!ctx->used) {
+		err = skcipher_wait_for_data(sk, flags & SPLICE_F_NONBLOCK ?
+						 MSG_DONTWAIT : 0);
+		if (err)
+			goto unlock;
+	}
+
+	used = min_t(size_t, len, ctx->used);
+	if (ctx->more || used < ctx->used)
+		used -= used % bs;
+
+	err = -EINVAL;
+	if (!used)
+		goto unlock;
+
+	npages = DIV_ROUND_UP(used, PAGE_SIZE);
+	sg_init_table(sg, npages);
+	for (i = 0; i < npages; i++) {
+		pages[i] = alloc_page(GFP_KERNEL);
+		err = -ENOMEM;
+		if (!pages[i])
+			goto free;
+
+		partial[i].offset = 0;
+		partial[i].len = min_t(size_t, used - i * PAGE_SIZE,
+				       PAGE_SIZE);
+		sg_set_page(sg + i, pages[i], partial[i].len, 0);
+	}
+
+	sgl = list_first_entry(&ctx->tsgl, struct skcipher_sg_list, list);
+	tsg = sgl->sg;
+	while (!tsg->length)
+		tsg++;
+
+	ablkcipher_request_set_crypt(&ctx->req, tsg, sg, used, ctx->iv);
+
+	err = af_alg_wait_for_completion(
+		ctx->enc ? crypto_ablkcipher_encrypt(&ctx->req) :
+			   crypto_ablkcipher_decrypt(&ctx->req),
+		&ctx->completion);
+	if (err)
+		goto free;
+
+	skcipher_pull_sgl(sk, used);
+	skcipher_wmem_wakeup(sk);
+	release_sock(sk);
+
+	spd.nr_pages = npages;
+	return splice_to_pipe(pipe, &spd);
+
+free:
+	while (i--)
+		put_page(pages[i]);
+unlock:
+	skcipher_wmem_wakeup(sk);
+	release_sock(sk);
+
+	return err;
+}
+
 static unsigned int skcipher_poll(struct file *file, struct socket *sock,
 				  poll_table *wait)
 {
@@ -538,6 +898,7 @@ static struct proto_ops algif_skcipher_ops = {
 	.sendmsg	=	skcipher_sendmsg,
 	.sendpage	=	skcipher_sendpage,
 	.recvmsg	=	skcipher_recvmsg,
+	.splice_read	=	skcipher_splice_read,
 	.poll		=	skcipher_poll,
 };
 
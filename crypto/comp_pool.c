@@ -0,0 +1,208 @@
+/*
+ * Cryptographic API.
+ *
+ * Per-CPU pools of compression transforms.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/compress.h>
+#include <crypto/scatterwalk.h>
+#include <linux/crypto.h>
+#include <linux/err.h>
+#include <linux/highmem.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+struct comp_pool_cpu {
+	struct crypto_comp *tfm;
+
+	/* linear copies of scatterlists, scratch_size bytes each */
+	u8 *src;
+	u8 *dst;
+};
+
+struct crypto_comp_pool {
+	struct comp_pool_cpu __percpu *cpu;
+	unsigned int scratch_size;
+};
+
+void crypto_free_comp_pool(struct crypto_comp_pool *pool)
+{
+	struct comp_pool_cpu *pc;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(pool->cpu, cpu);
+		if (pc->tfm)
+			crypto_free_comp(pc->tfm);
+		vfree(pc->src);
+		vfree(pc->dst);
+	}
+
+	free_percpu(pool->cpu);
+	kfree(pool);
+}
+EXPORT_SYMBOL_GPL(crypto_free_comp_pool);
+
+struct crypto_comp_pool *crypto_alloc_comp_pool(const char *alg_name,
+						u32 type, u32 mask,
+						unsigned int scratch_size)
+{
+	struct crypto_comp_pool *pool;
+	struct comp_pool_cpu *pc;
+	struct crypto_comp *tfm;
+	int cpu;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return ERR_PTR(-ENOMEM);
+
+	pool->scratch_size = scratch_size;
+	pool->cpu = alloc_percpu(struct comp_pool_cpu);
+	if (!pool->cpu) {
+		kfree(pool);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(pool->cpu, cpu);
+
+		tfm = crypto_alloc_comp(alg_name, type, mask);
+		if (IS_ERR(tfm)) {
+			crypto_free_comp_pool(pool);
+			return ERR_CAST(tfm);
+		}
+		pc->tfm = tfm;
+
+		if (!scratch_size)
+			continue;
+
+		pc->src = vmalloc_node(scratch_size, cpu_to_node(cpu));
+		pc->dst = vmalloc_node(scratch_size, cpu_to_node(cpu));
+		if (!pc->src || !pc->dst) {
+			crypto_free_comp_pool(pool);
+			return ERR_PTR(-ENOMEM);
+		}
+	}
+
+	return pool;
+}
+EXPORT_SYMBOL_GPL(crypto_alloc_comp_pool);
+
+static int comp_pool_op(struct crypto_comp *tfm, int compress,
+			const u8 *src, unsigned int slen,
+			u8 *dst, unsigned int *dlen)
+{
+	return compress ? crypto_comp_compress(tfm, src, slen, dst, dlen) :
+			  crypto_comp_decompress(tfm, src, slen, dst, dlen);
+}
+
+int crypto_comp_pool_compress(struct crypto_comp_pool *pool,
+			      const u8 *src, unsigned int slen,
+			      u8 *dst, unsigned int *dlen)
+{
+	struct comp_pool_cpu *pc = get_cpu_ptr(pool->cpu);
+	int err;
+
+	err = comp_pool_op(pc->tfm, 1, src, slen, dst, dlen);
+	put_cpu_ptr(pool->cpu);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(crypto_comp_pool_compress);
+
+int crypto_comp_pool_decompress(struct crypto_comp_pool *pool,
+				const u8 *src, unsigned int slen,
+				u8 *dst, unsigned int *dlen)
+{
+	struct comp_pool_cpu *pc = get_cpu_ptr(pool->cpu);
+	int err;
+
+	err = comp_pool_op(pc->tfm, 0, src, slen, dst, dlen);
+	put_cpu_ptr(pool->cpu);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(crypto_comp_pool_decompress);
+
+/* Whether the first len bytes of sg can be mapped with kmap_atomic() */
+static inline bool comp_pool_sg_direct(struct scatterlist *sg, unsigned int len)
+{
+	return sg->length >= len && sg->offset + len <= PAGE_SIZE;
+}
+
+static int comp_pool_op_sg(struct crypto_comp_pool *pool, int compress,
+			   struct scatterlist *src, unsigned int slen,
+			   struct scatterlist *dst, unsigned int *dlen)
+{
+	bool src_direct = comp_pool_sg_direct(src, slen);
+	bool dst_direct = comp_pool_sg_direct(dst, *dlen);
+	struct comp_pool_cpu *pc;
+	u8 *vsrc, *vdst;
+	int err;
+
+	if (!src_direct && slen > pool->scratch_size)
+		return -EINVAL;
+
+	/* the output is bounded by the scratch buffer, like any other */
+	if (!dst_direct && !pool->scratch_size)
+		return -EINVAL;
+	if (!dst_direct)
+		*dlen = min(*dlen, pool->scratch_size);
+
+	pc = get_cpu_ptr(pool->cpu);
+
+	if (src_direct) {
+		vsrc = kmap_atomic(sg_page(src)) + src->offset;
+	} else {
+		vsrc = pc->src;
+		scatterwalk_map_and_copy(vsrc, src, 0, slen, 0);
+	}
+
+	if (dst_direct)
+		vdst = kmap_atomic(sg_page(dst)) + dst->offset;
+	else
+		vdst = pc->dst;
+
+	err = comp_pool_op(pc->tfm, compress, vsrc, slen, vdst, dlen);
+
+	if (dst_direct)
+		kunmap_atomic(vdst);
+	else if (!err)
+		scatterwalk_map_and_copy(vdst, dst, 0, *dlen, 1);
+
+	if (src_direct)
+		kunmap_atomic(vsrc);
+
+	put_cpu_ptr(pool->cpu);
+
+	return err;
+}
+
+int crypto_comp_pool_compress_sg(struct crypto_comp_pool *pool,
+				 struct scatterlist *src, unsigned int slen,
+				 struct scatterlist *dst, unsigned int *dlen)
+{
+	return comp_pool_op_sg(pool, 1, src, slen, dst, dlen);
+}
+EXPORT_SYMBOL_GPL(crypto_comp_pool_compress_sg);
+
+int crypto_comp_pool_decompress_sg(struct crypto_comp_pool *pool,
+				   struct scatterlist *src, unsigned int slen,
+				   struct scatterlist *dst, unsigned int *dlen)
+{
+	return comp_pool_op_sg(pool, 0, src, slen, dst, dlen);
+}
+EXPORT_SYMBOL_GPL(crypto_comp_pool_decompress_sg);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Per-CPU compression transform pools");
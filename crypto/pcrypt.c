@@ -20,6 +20,8 @@
 
 #include <crypto/algapi.h>
 #include <crypto/internal/aead.h>
+#include <crypto/internal/hash.h>
+#include <crypto/internal/skcipher.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/module.h>
@@ -27,6 +29,7 @@
 #include <linux/notifier.h>
 #include <linux/kobject.h>
 #include <linux/cpu.h>
+#include <linux/workqueue.h>
 #include <crypto/pcrypt.h>
 
 struct padata_pcrypt {
@@ -53,15 +56,51 @@ struct padata_pcrypt {
 		cpumask_var_t mask;
 	} *cb_cpumask;
 	struct notifier_block nblock;
+
+	/*
+	 * Requests of MAY_BACKLOG callers that found the padata queues
+	 * full, in submission order. backlog_work hands them to padata as
+	 * the requests in flight complete, and later requests queue up
+	 * behind them so that completions stay in order. backlog_lock
+	 * also protects inflight, the number of requests given to padata
+	 * and not yet serialized.
+	 */
+	spinlock_t backlog_lock;
+	struct list_head backlog;
+	unsigned int inflight;
+	struct delayed_work backlog_work;
 };
 
 static struct padata_pcrypt pencrypt;
 static struct padata_pcrypt pdecrypt;
 static struct kset           *pcrypt_kset;
 
+/*
+ * All instances share the pencrypt and pdecrypt padata instances until a
+ * cpumask is written to /sys/kernel/pcrypt/<driver name>/cpumask. The
+ * instance then gets a pair of its own, restricted to those CPUs, which
+ * show up as pencrypt and pdecrypt below that directory and can be tuned
+ * further like the shared ones. Writing 0 goes back to the shared pair.
+ * Hashes only use the encryption side.
+ */
 struct pcrypt_instance_ctx {
-	struct crypto_spawn spawn;
+	union {
+		struct crypto_spawn spawn;
+		struct crypto_skcipher_spawn skcipher_spawn;
+		struct crypto_ahash_spawn ahash_spawn;
+	};
 	unsigned int tfm_count;
+
+	struct padata_pcrypt *penc;
+	struct padata_pcrypt *pdec;
+
+	/* serializes binding, the kobject release frees the instance */
+	struct mutex lock;
+	struct kobject kobj;
+	void *mem;
+	bool bound;
+	struct padata_pcrypt bound_enc;
+	struct padata_pcrypt bound_dec;
 };
 
 struct pcrypt_aead_ctx {
@@ -69,13 +108,70 @@ struct pcrypt_aead_ctx {
 	unsigned int cb_cpu;
 };
 
-static int pcrypt_do_parallel(struct padata_priv *padata, unsigned int *cb_cpu,
-			      struct padata_pcrypt *pcrypt)
+struct pcrypt_ablkcipher_ctx {
+	struct crypto_ablkcipher *child;
+	unsigned int cb_cpu;
+};
+
+struct pcrypt_ahash_ctx {
+	struct crypto_ahash *child;
+	unsigned int cb_cpu;
+};
+
+static inline struct pcrypt_instance_ctx *pcrypt_tfm_ictx(
+	struct crypto_tfm *tfm)
 {
-	unsigned int cpu_index, cpu, i;
-	struct pcrypt_cpumask *cpumask;
+	return crypto_instance_ctx(crypto_tfm_alg_instance(tfm));
+}
+
+/*
+ * The padata instance an algorithm dispatches to. Binding only ever
+ * switches between the shared and the instance's own pair, both of which
+ * outlive any tfm, so requests already queued are not affected.
+ */
+static inline struct padata_pcrypt *pcrypt_penc(struct crypto_tfm *tfm)
+{
+	return ACCESS_ONCE(pcrypt_tfm_ictx(tfm)->penc);
+}
+
+static inline struct padata_pcrypt *pcrypt_pdec(struct crypto_tfm *tfm)
+{
+	return ACCESS_ONCE(pcrypt_tfm_ictx(tfm)->pdec);
+}
+
+/*
+ * Whether the child completes the request later through its callback.
+ * The child keeps MAY_BACKLOG, so -EBUSY can mean it was queued.
+ */
+static inline bool pcrypt_child_pending(int err, u32 flags)
+{
+	return err == -EINPROGRESS ||
+	       (err == -EBUSY && (flags & CRYPTO_TFM_REQ_MAY_BACKLOG));
+}
+
+/* Spread the callbacks of the tfms of an instance over the online CPUs */
+static unsigned int pcrypt_cb_cpu(struct pcrypt_instance_ctx *ictx)
+{
+	unsigned int cb_cpu;
+	int cpu, cpu_index;
+
+	ictx->tfm_count++;
+
+	cpu_index = ictx->tfm_count % cpumask_weight(cpu_online_mask);
 
-	cpu = *cb_cpu;
+	cb_cpu = cpumask_first(cpu_online_mask);
+	for (cpu = 0; cpu < cpu_index; cpu++)
+		cb_cpu = cpumask_next(cb_cpu, cpu_online_mask);
+
+	return cb_cpu;
+}
+
+/* Map @cpu to a callback CPU of @pcrypt */
+static unsigned int pcrypt_valid_cb_cpu(struct padata_pcrypt *pcrypt,
+					unsigned int cpu)
+{
+	unsigned int cpu_index, i;
+	struct pcrypt_cpumask *cpumask;
 
 	rcu_read_lock_bh();
 	cpumask = rcu_dereference(pcrypt->cb_cpumask);
@@ -91,11 +187,124 @@ static int pcrypt_do_parallel(struct padata_priv *padata, unsigned int *cb_cpu,
 	for (i = 0; i < cpu_index; i++)
 		cpu = cpumask_next(cpu, cpumask->mask);
 
-	*cb_cpu = cpu;
-
 out:
 	rcu_read_unlock_bh();
-	return padata_do_parallel(pcrypt->pinst, padata, cpu);
+	return cpu;
+}
+
+/* The request being served, the child request's callback data */
+static struct crypto_async_request *pcrypt_padata_areq(
+	struct padata_priv *padata)
+{
+	struct crypto_async_request *creq;
+
+	creq = pcrypt_request_ctx(pcrypt_padata_request(padata));
+	return creq->data;
+}
+
+/* Called with backlog_lock held */
+static int pcrypt_submit(struct padata_pcrypt *pcrypt,
+			 struct padata_priv *padata, unsigned int cb_cpu)
+{
+	int err;
+
+	err = padata_do_parallel(pcrypt->pinst, padata, cb_cpu);
+	if (!err)
+		pcrypt->inflight++;
+
+	return err;
+}
+
+static int pcrypt_do_parallel(struct padata_priv *padata, unsigned int *cb_cpu,
+			      struct padata_pcrypt *pcrypt, u32 flags)
+{
+	unsigned int cpu;
+	int err = -EBUSY;
+
+	cpu = *cb_cpu = pcrypt_valid_cb_cpu(pcrypt, *cb_cpu);
+	pcrypt_padata_request(padata)->pcrypt = pcrypt;
+
+	spin_lock_bh(&pcrypt->backlog_lock);
+	if (list_empty(&pcrypt->backlog))
+		err = pcrypt_submit(pcrypt, padata, cpu);
+
+	if (err == -EBUSY && (flags & CRYPTO_TFM_REQ_MAY_BACKLOG)) {
+		/* -EBUSY until the caller is told it left the backlog */
+		padata->info = -EBUSY;
+		padata->cb_cpu = cpu;
+		list_add_tail(&padata->list, &pcrypt->backlog);
+
+		/* nothing completes to run the backlog, e.g. during a reset */
+		if (!pcrypt->inflight)
+			queue_delayed_work(system_nrt_wq,
+					   &pcrypt->backlog_work, 1);
+	}
+	spin_unlock_bh(&pcrypt->backlog_lock);
+
+	return err;
+}
+
+static void pcrypt_backlog_work(struct work_struct *work)
+{
+	struct padata_pcrypt *pcrypt = container_of(work, struct padata_pcrypt,
+						    backlog_work.work);
+	struct crypto_async_request *areq;
+	struct padata_priv *padata;
+	unsigned int cpu;
+	int err;
+
+	/*
+	 * system_nrt_wq runs this on one CPU at a time, so only we remove
+	 * requests and the first one stays first while the lock is dropped.
+	 */
+	spin_lock_bh(&pcrypt->backlog_lock);
+	while (!list_empty(&pcrypt->backlog)) {
+		padata = list_first_entry(&pcrypt->backlog,
+					  struct padata_priv, list);
+		areq = pcrypt_padata_areq(padata);
+
+		/* before it is handed on and can complete */
+		if (padata->info == -EBUSY) {
+			padata->info = -EINPROGRESS;
+			spin_unlock(&pcrypt->backlog_lock);
+			areq->complete(areq, -EINPROGRESS);
+			spin_lock(&pcrypt->backlog_lock);
+		}
+
+		/* padata_do_parallel() queues it through padata->list */
+		list_del(&padata->list);
+		cpu = pcrypt_valid_cb_cpu(pcrypt, padata->cb_cpu);
+		err = pcrypt_submit(pcrypt, padata, cpu);
+		if (err == -EBUSY) {
+			list_add(&padata->list, &pcrypt->backlog);
+			if (!pcrypt->inflight)
+				queue_delayed_work(system_nrt_wq,
+						   &pcrypt->backlog_work, 1);
+			break;
+		}
+
+		if (err) {
+			spin_unlock(&pcrypt->backlog_lock);
+			areq->complete(areq, err);
+			spin_lock(&pcrypt->backlog_lock);
+		}
+	}
+	spin_unlock_bh(&pcrypt->backlog_lock);
+}
+
+/*
+ * Called from the serial callbacks before the request is completed, a
+ * place in the padata queues is about to become free.
+ */
+static void pcrypt_serial_done(struct padata_priv *padata)
+{
+	struct padata_pcrypt *pcrypt = pcrypt_padata_request(padata)->pcrypt;
+
+	spin_lock(&pcrypt->backlog_lock);
+	pcrypt->inflight--;
+	if (!list_empty(&pcrypt->backlog))
+		queue_delayed_work(system_nrt_wq, &pcrypt->backlog_work, 0);
+	spin_unlock(&pcrypt->backlog_lock);
 }
 
 static int pcrypt_aead_setkey(struct crypto_aead *parent,
@@ -119,6 +328,7 @@ static void pcrypt_aead_serial(struct padata_priv *padata)
 	struct pcrypt_request *preq = pcrypt_padata_request(padata);
 	struct aead_request *req = pcrypt_request_ctx(preq);
 
+	pcrypt_serial_done(padata);
 	aead_request_complete(req->base.data, padata->info);
 }
 
@@ -127,6 +337,7 @@ static void pcrypt_aead_giv_serial(struct padata_priv *padata)
 	struct pcrypt_request *preq = pcrypt_padata_request(padata);
 	struct aead_givcrypt_request *req = pcrypt_request_ctx(preq);
 
+	pcrypt_serial_done(padata);
 	aead_request_complete(req->areq.base.data, padata->info);
 }
 
@@ -177,7 +388,8 @@ static int pcrypt_aead_encrypt(struct aead_request *req)
 			       req->cryptlen, req->iv);
 	aead_request_set_assoc(creq, req->assoc, req->assoclen);
 
-	err = pcrypt_do_parallel(padata, &ctx->cb_cpu, &pencrypt);
+	err = pcrypt_do_parallel(padata, &ctx->cb_cpu,
+				 pcrypt_penc(crypto_aead_tfm(aead)), flags);
 	if (!err)
 		return -EINPROGRESS;
 
@@ -219,7 +431,8 @@ static int pcrypt_aead_decrypt(struct aead_request *req)
 			       req->cryptlen, req->iv);
 	aead_request_set_assoc(creq, req->assoc, req->assoclen);
 
-	err = pcrypt_do_parallel(padata, &ctx->cb_cpu, &pdecrypt);
+	err = pcrypt_do_parallel(padata, &ctx->cb_cpu,
+				 pcrypt_pdec(crypto_aead_tfm(aead)), flags);
 	if (!err)
 		return -EINPROGRESS;
 
@@ -263,7 +476,8 @@ static int pcrypt_aead_givencrypt(struct aead_givcrypt_request *req)
 	aead_givcrypt_set_assoc(creq, areq->assoc, areq->assoclen);
 	aead_givcrypt_set_giv(creq, req->giv, req->seq);
 
-	err = pcrypt_do_parallel(padata, &ctx->cb_cpu, &pencrypt);
+	err = pcrypt_do_parallel(padata, &ctx->cb_cpu,
+				 pcrypt_penc(crypto_aead_tfm(aead)), flags);
 	if (!err)
 		return -EINPROGRESS;
 
@@ -272,19 +486,12 @@ static int pcrypt_aead_givencrypt(struct aead_givcrypt_request *req)
 
 static int pcrypt_aead_init_tfm(struct crypto_tfm *tfm)
 {
-	int cpu, cpu_index;
 	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
 	struct pcrypt_instance_ctx *ictx = crypto_instance_ctx(inst);
 	struct pcrypt_aead_ctx *ctx = crypto_tfm_ctx(tfm);
 	struct crypto_aead *cipher;
 
-	ictx->tfm_count++;
-
-	cpu_index = ictx->tfm_count % cpumask_weight(cpu_online_mask);
-
-	ctx->cb_cpu = cpumask_first(cpu_online_mask);
-	for (cpu = 0; cpu < cpu_index; cpu++)
-		ctx->cb_cpu = cpumask_next(ctx->cb_cpu, cpu_online_mask);
+	ctx->cb_cpu = pcrypt_cb_cpu(ictx);
 
 	cipher = crypto_spawn_aead(crypto_instance_ctx(inst));
 
@@ -306,58 +513,562 @@ static void pcrypt_aead_exit_tfm(struct crypto_tfm *tfm)
 	crypto_free_aead(ctx->child);
 }
 
-static struct crypto_instance *pcrypt_alloc_instance(struct crypto_alg *alg)
+static int pcrypt_ablkcipher_setkey(struct crypto_ablkcipher *parent,
+				    const u8 *key, unsigned int keylen)
+{
+	struct pcrypt_ablkcipher_ctx *ctx = crypto_ablkcipher_ctx(parent);
+	struct crypto_ablkcipher *child = ctx->child;
+	int err;
+
+	crypto_ablkcipher_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+	crypto_ablkcipher_set_flags(child, crypto_ablkcipher_get_flags(parent) &
+					   CRYPTO_TFM_REQ_MASK);
+	err = crypto_ablkcipher_setkey(child, key, keylen);
+	crypto_ablkcipher_set_flags(parent, crypto_ablkcipher_get_flags(child) &
+					    CRYPTO_TFM_RES_MASK);
+	return err;
+}
+
+static void pcrypt_ablkcipher_serial(struct padata_priv *padata)
+{
+	struct pcrypt_request *preq = pcrypt_padata_request(padata);
+	struct ablkcipher_request *req = pcrypt_request_ctx(preq);
+
+	pcrypt_serial_done(padata);
+	ablkcipher_request_complete(req->base.data, padata->info);
+}
+
+static void pcrypt_ablkcipher_done(struct crypto_async_request *areq, int err)
+{
+	struct ablkcipher_request *req = areq->data;
+	struct pcrypt_request *preq = ablkcipher_request_ctx(req);
+	struct padata_priv *padata = pcrypt_request_padata(preq);
+
+	/* taken off the child's backlog, the real completion follows */
+	if (err == -EINPROGRESS)
+		return;
+
+	padata->info = err;
+	req->base.flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	padata_do_serial(padata);
+}
+
+static void pcrypt_ablkcipher_enc(struct padata_priv *padata)
+{
+	struct pcrypt_request *preq = pcrypt_padata_request(padata);
+	struct ablkcipher_request *req = pcrypt_request_ctx(preq);
+
+	padata->info = crypto_ablkcipher_encrypt(req);
+
+	if (pcrypt_child_pending(padata->info, req->base.flags))
+		return;
+
+	padata_do_serial(padata);
+}
+
+static void pcrypt_ablkcipher_dec(struct padata_priv *padata)
+{
+	struct pcrypt_request *preq = pcrypt_padata_request(padata);
+	struct ablkcipher_request *req = pcrypt_request_ctx(preq);
+
+	padata->info = crypto_ablkcipher_decrypt(req);
+
+	if (pcrypt_child_pending(padata->info, req->base.flags))
+		return;
+
+	padata_do_serial(padata);
+}
+
+static int pcrypt_ablkcipher_crypt(struct ablkcipher_request *req, int enc)
+{
+	int err;
+	struct pcrypt_request *preq = ablkcipher_request_ctx(req);
+	struct ablkcipher_request *creq = pcrypt_request_ctx(preq);
+	struct padata_priv *padata = pcrypt_request_padata(preq);
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+	struct pcrypt_ablkcipher_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+	u32 flags = ablkcipher_request_flags(req);
+
+	memset(padata, 0, sizeof(struct padata_priv));
+
+	padata->parallel = enc ? pcrypt_ablkcipher_enc : pcrypt_ablkcipher_dec;
+	padata->serial = pcrypt_ablkcipher_serial;
+
+	ablkcipher_request_set_tfm(creq, ctx->child);
+	ablkcipher_request_set_callback(creq, flags & ~CRYPTO_TFM_REQ_MAY_SLEEP,
+					pcrypt_ablkcipher_done, req);
+	ablkcipher_request_set_crypt(creq, req->src, req->dst,
+				     req->nbytes, req->info);
+
+	err = pcrypt_do_parallel(padata, &ctx->cb_cpu,
+				 enc ? pcrypt_penc(crypto_ablkcipher_tfm(tfm)) :
+				       pcrypt_pdec(crypto_ablkcipher_tfm(tfm)),
+				 flags);
+	if (!err)
+		return -EINPROGRESS;
+
+	return err;
+}
+
+static int pcrypt_ablkcipher_encrypt(struct ablkcipher_request *req)
+{
+	return pcrypt_ablkcipher_crypt(req, 1);
+}
+
+static int pcrypt_ablkcipher_decrypt(struct ablkcipher_request *req)
+{
+	return pcrypt_ablkcipher_crypt(req, 0);
+}
+
+static int pcrypt_ablkcipher_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct pcrypt_instance_ctx *ictx = crypto_instance_ctx(inst);
+	struct pcrypt_ablkcipher_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_ablkcipher *cipher;
+
+	ctx->cb_cpu = pcrypt_cb_cpu(ictx);
+
+	cipher = crypto_spawn_skcipher(&ictx->skcipher_spawn);
+	if (IS_ERR(cipher))
+		return PTR_ERR(cipher);
+
+	ctx->child = cipher;
+	tfm->crt_ablkcipher.reqsize = sizeof(struct pcrypt_request)
+		+ sizeof(struct ablkcipher_request)
+		+ crypto_ablkcipher_reqsize(cipher);
+
+	return 0;
+}
+
+static void pcrypt_ablkcipher_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct pcrypt_ablkcipher_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_ablkcipher(ctx->child);
+}
+
+static int pcrypt_ahash_setkey(struct crypto_ahash *parent,
+			       const u8 *key, unsigned int keylen)
+{
+	struct pcrypt_ahash_ctx *ctx = crypto_ahash_ctx(parent);
+	struct crypto_ahash *child = ctx->child;
+	int err;
+
+	crypto_ahash_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+	crypto_ahash_set_flags(child, crypto_ahash_get_flags(parent) &
+				      CRYPTO_TFM_REQ_MASK);
+	err = crypto_ahash_setkey(child, key, keylen);
+	crypto_ahash_set_flags(parent, crypto_ahash_get_flags(child) &
+				       CRYPTO_TFM_RES_MASK);
+	return err;
+}
+
+/*
+ * The steps of an incremental hash are cheap or depend on the state left
+ * by the previous one, they are passed straight to the child with the
+ * caller's completion. Only digest and finup are run in parallel.
+ */
+static struct ahash_request *pcrypt_ahash_child_request(
+	struct ahash_request *req)
+{
+	struct pcrypt_request *preq = ahash_request_ctx(req);
+	struct ahash_request *creq = pcrypt_request_ctx(preq);
+	struct pcrypt_ahash_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+
+	ahash_request_set_tfm(creq, ctx->child);
+	ahash_request_set_callback(creq, req->base.flags, req->base.complete,
+				   req->base.data);
+	ahash_request_set_crypt(creq, req->src, req->result, req->nbytes);
+
+	return creq;
+}
+
+static int pcrypt_ahash_init(struct ahash_request *req)
+{
+	return crypto_ahash_init(pcrypt_ahash_child_request(req));
+}
+
+static int pcrypt_ahash_update(struct ahash_request *req)
+{
+	return crypto_ahash_update(pcrypt_ahash_child_request(req));
+}
+
+static int pcrypt_ahash_final(struct ahash_request *req)
+{
+	return crypto_ahash_final(pcrypt_ahash_child_request(req));
+}
+
+static int pcrypt_ahash_export(struct ahash_request *req, void *out)
+{
+	return crypto_ahash_export(pcrypt_ahash_child_request(req), out);
+}
+
+static int pcrypt_ahash_import(struct ahash_request *req, const void *in)
+{
+	return crypto_ahash_import(pcrypt_ahash_child_request(req), in);
+}
+
+static void pcrypt_ahash_serial(struct padata_priv *padata)
+{
+	struct pcrypt_request *preq = pcrypt_padata_request(padata);
+	struct ahash_request *creq = pcrypt_request_ctx(preq);
+	struct ahash_request *req = creq->base.data;
+
+	pcrypt_serial_done(padata);
+	req->base.complete(&req->base, padata->info);
+}
+
+static void pcrypt_ahash_done(struct crypto_async_request *areq, int err)
+{
+	struct ahash_request *req = areq->data;
+	struct pcrypt_request *preq = ahash_request_ctx(req);
+	struct padata_priv *padata = pcrypt_request_padata(preq);
+
+	if (err == -EINPROGRESS)
+		return;
+
+	padata->info = err;
+	req->base.flags &= ~CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	padata_do_serial(padata);
+}
+
+static void pcrypt_ahash_digest_parallel(struct padata_priv *padata)
+{
+	struct pcrypt_request *preq = pcrypt_padata_request(padata);
+	struct ahash_request *req = pcrypt_request_ctx(preq);
+
+	padata->info = crypto_ahash_digest(req);
+
+	if (pcrypt_child_pending(padata->info, req->base.flags))
+		return;
+
+	padata_do_serial(padata);
+}
+
+static void pcrypt_ahash_finup_parallel(struct padata_priv *padata)
+{
+	struct pcrypt_request *preq = pcrypt_padata_request(padata);
+	struct ahash_request *req = pcrypt_request_ctx(preq);
+
+	padata->info = crypto_ahash_finup(req);
+
+	if (pcrypt_child_pending(padata->info, req->base.flags))
+		return;
+
+	padata_do_serial(padata);
+}
+
+static int pcrypt_ahash_enqueue(struct ahash_request *req,
+				void (*parallel)(struct padata_priv *))
+{
+	int err;
+	struct pcrypt_request *preq = ahash_request_ctx(req);
+	struct ahash_request *creq = pcrypt_request_ctx(preq);
+	struct padata_priv *padata = pcrypt_request_padata(preq);
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct pcrypt_ahash_ctx *ctx = crypto_ahash_ctx(tfm);
+	u32 flags = req->base.flags;
+
+	memset(padata, 0, sizeof(struct padata_priv));
+
+	padata->parallel = parallel;
+	padata->serial = pcrypt_ahash_serial;
+
+	ahash_request_set_tfm(creq, ctx->child);
+	ahash_request_set_callback(creq, flags & ~CRYPTO_TFM_REQ_MAY_SLEEP,
+				   pcrypt_ahash_done, req);
+	ahash_request_set_crypt(creq, req->src, req->result, req->nbytes);
+
+	err = pcrypt_do_parallel(padata, &ctx->cb_cpu,
+				 pcrypt_penc(crypto_ahash_tfm(tfm)), flags);
+	if (!err)
+		return -EINPROGRESS;
+
+	return err;
+}
+
+static int pcrypt_ahash_digest(struct ahash_request *req)
+{
+	return pcrypt_ahash_enqueue(req, pcrypt_ahash_digest_parallel);
+}
+
+static int pcrypt_ahash_finup(struct ahash_request *req)
+{
+	return pcrypt_ahash_enqueue(req, pcrypt_ahash_finup_parallel);
+}
+
+static int pcrypt_ahash_init_tfm(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = crypto_tfm_alg_instance(tfm);
+	struct pcrypt_instance_ctx *ictx = crypto_instance_ctx(inst);
+	struct pcrypt_ahash_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_ahash *hash;
+
+	ctx->cb_cpu = pcrypt_cb_cpu(ictx);
+
+	hash = crypto_spawn_ahash(&ictx->ahash_spawn);
+	if (IS_ERR(hash))
+		return PTR_ERR(hash);
+
+	ctx->child = hash;
+	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
+				 sizeof(struct pcrypt_request) +
+				 sizeof(struct ahash_request) +
+				 crypto_ahash_reqsize(hash));
+
+	return 0;
+}
+
+static void pcrypt_ahash_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct pcrypt_ahash_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_ahash(ctx->child);
+}
+
+static int pcrypt_init_padata(struct padata_pcrypt *pcrypt,
+			      const char *name, struct kobject *parent);
+static void pcrypt_fini_padata(struct padata_pcrypt *pcrypt);
+
+static ssize_t pcrypt_cpumask_show(struct kobject *kobj,
+				   struct attribute *attr, char *buf)
+{
+	struct pcrypt_instance_ctx *ctx;
+	struct padata_instance *pinst;
+	int len;
+
+	ctx = container_of(kobj, struct pcrypt_instance_ctx, kobj);
+
+	mutex_lock(&ctx->lock);
+	pinst = ctx->penc->pinst;
+	mutex_lock(&pinst->lock);
+	len = cpumask_scnprintf(buf, PAGE_SIZE, pinst->cpumask.pcpu);
+	mutex_unlock(&pinst->lock);
+	mutex_unlock(&ctx->lock);
+
+	if (PAGE_SIZE - len < 2)
+		return -EINVAL;
+
+	return len + sprintf(buf + len, "\n");
+}
+
+static int pcrypt_bind(struct pcrypt_instance_ctx *ctx, struct cpumask *mask)
+{
+	cpumask_var_t old_pcpu, old_cbcpu;
+	struct padata_instance *pinst;
+	int err = -ENOMEM;
+
+	if (!alloc_cpumask_var(&old_pcpu, GFP_KERNEL))
+		return err;
+	if (!alloc_cpumask_var(&old_cbcpu, GFP_KERNEL))
+		goto out_free_pcpu;
+
+	if (!ctx->bound) {
+		err = pcrypt_init_padata(&ctx->bound_enc, "pencrypt",
+					 &ctx->kobj);
+		if (err)
+			goto out;
+
+		err = pcrypt_init_padata(&ctx->bound_dec, "pdecrypt",
+					 &ctx->kobj);
+		if (err) {
+			pcrypt_fini_padata(&ctx->bound_enc);
+			goto out;
+		}
+
+		padata_start(ctx->bound_enc.pinst);
+		padata_start(ctx->bound_dec.pinst);
+		ctx->bound = true;
+	}
+
+	pinst = ctx->bound_enc.pinst;
+	mutex_lock(&pinst->lock);
+	cpumask_copy(old_pcpu, pinst->cpumask.pcpu);
+	cpumask_copy(old_cbcpu, pinst->cpumask.cbcpu);
+	mutex_unlock(&pinst->lock);
+
+	err = padata_set_cpumasks(pinst, mask, mask);
+	if (err)
+		goto out;
+
+	/* do not leave the two directions on different CPUs */
+	err = padata_set_cpumasks(ctx->bound_dec.pinst, mask, mask);
+	if (err) {
+		padata_set_cpumasks(pinst, old_pcpu, old_cbcpu);
+		goto out;
+	}
+
+	ACCESS_ONCE(ctx->penc) = &ctx->bound_enc;
+	ACCESS_ONCE(ctx->pdec) = &ctx->bound_dec;
+
+out:
+	free_cpumask_var(old_cbcpu);
+out_free_pcpu:
+	free_cpumask_var(old_pcpu);
+	return err;
+}
+
+static ssize_t pcrypt_cpumask_store(struct kobject *kobj,
+				    struct attribute *attr,
+				    const char *buf, size_t count)
 {
-	struct crypto_instance *inst;
 	struct pcrypt_instance_ctx *ctx;
+	cpumask_var_t new_cpumask;
 	int err;
 
-	inst = kzalloc(sizeof(*inst) + sizeof(*ctx), GFP_KERNEL);
-	if (!inst) {
-		inst = ERR_PTR(-ENOMEM);
+	ctx = container_of(kobj, struct pcrypt_instance_ctx, kobj);
+
+	if (!alloc_cpumask_var(&new_cpumask, GFP_KERNEL))
+		return -ENOMEM;
+
+	err = bitmap_parse(buf, count, cpumask_bits(new_cpumask),
+			   nr_cpumask_bits);
+	if (err)
 		goto out;
+
+	mutex_lock(&ctx->lock);
+	if (cpumask_empty(new_cpumask)) {
+		ACCESS_ONCE(ctx->penc) = &pencrypt;
+		ACCESS_ONCE(ctx->pdec) = &pdecrypt;
+	} else if (!cpumask_intersects(new_cpumask, cpu_online_mask)) {
+		err = -EINVAL;
+	} else {
+		err = pcrypt_bind(ctx, new_cpumask);
 	}
+	mutex_unlock(&ctx->lock);
+
+out:
+	free_cpumask_var(new_cpumask);
+	return err ? err : count;
+}
+
+/* cpumask is the only attribute */
+static const struct sysfs_ops pcrypt_instance_sysfs_ops = {
+	.show = pcrypt_cpumask_show,
+	.store = pcrypt_cpumask_store,
+};
+
+static struct attribute pcrypt_cpumask_attr = {
+	.name = "cpumask",
+	.mode = S_IRUGO | S_IWUSR,
+};
+
+static struct attribute *pcrypt_instance_attrs[] = {
+	&pcrypt_cpumask_attr,
+	NULL,
+};
+
+static void pcrypt_instance_release(struct kobject *kobj)
+{
+	struct pcrypt_instance_ctx *ctx;
+
+	ctx = container_of(kobj, struct pcrypt_instance_ctx, kobj);
+	kfree(ctx->mem);
+}
+
+static struct kobj_type pcrypt_instance_ktype = {
+	.sysfs_ops = &pcrypt_instance_sysfs_ops,
+	.default_attrs = pcrypt_instance_attrs,
+	.release = pcrypt_instance_release,
+};
+
+/*
+ * Allocate an instance with head bytes in front of it, see
+ * ahash_instance_headroom(). Once this succeeded the memory is freed by
+ * dropping the instance kobject.
+ */
+static void *pcrypt_alloc_instance(unsigned int head)
+{
+	struct pcrypt_instance_ctx *ctx;
+	struct crypto_instance *inst;
+	char *p;
+
+	p = kzalloc(head + sizeof(*inst) + sizeof(*ctx), GFP_KERNEL);
+	if (!p)
+		return ERR_PTR(-ENOMEM);
 
-	err = -ENAMETOOLONG;
+	inst = (void *)(p + head);
+	ctx = crypto_instance_ctx(inst);
+
+	ctx->mem = p;
+	ctx->penc = &pencrypt;
+	ctx->pdec = &pdecrypt;
+	mutex_init(&ctx->lock);
+	kobject_init(&ctx->kobj, &pcrypt_instance_ktype);
+
+	return p;
+}
+
+static void pcrypt_put_instance(struct crypto_instance *inst)
+{
+	struct pcrypt_instance_ctx *ctx = crypto_instance_ctx(inst);
+
+	kobject_put(&ctx->kobj);
+}
+
+static int pcrypt_init_instance(struct crypto_instance *inst,
+				struct crypto_alg *alg)
+{
 	if (snprintf(inst->alg.cra_driver_name, CRYPTO_MAX_ALG_NAME,
 		     "pcrypt(%s)", alg->cra_driver_name) >= CRYPTO_MAX_ALG_NAME)
-		goto out_free_inst;
+		return -ENAMETOOLONG;
 
 	memcpy(inst->alg.cra_name, alg->cra_name, CRYPTO_MAX_ALG_NAME);
 
-	ctx = crypto_instance_ctx(inst);
-	err = crypto_init_spawn(&ctx->spawn, alg, inst,
-				CRYPTO_ALG_TYPE_MASK);
-	if (err)
-		goto out_free_inst;
-
 	inst->alg.cra_priority = alg->cra_priority + 100;
 	inst->alg.cra_blocksize = alg->cra_blocksize;
 	inst->alg.cra_alignmask = alg->cra_alignmask;
 
-out:
-	return inst;
+	return 0;
+}
 
-out_free_inst:
-	kfree(inst);
-	inst = ERR_PTR(err);
-	goto out;
+/*
+ * Called once the instance is registered. A duplicate instance fails to
+ * register and must not have tried to take the same sysfs name first.
+ */
+static void pcrypt_add_instance_kobj(struct crypto_instance *inst)
+{
+	struct pcrypt_instance_ctx *ctx = crypto_instance_ctx(inst);
+
+	/* not fatal, the instance just can not be bound to other CPUs */
+	ctx->kobj.kset = pcrypt_kset;
+	if (kobject_add(&ctx->kobj, NULL, "%s", inst->alg.cra_driver_name))
+		pr_warn("pcrypt: no sysfs directory for %s\n",
+			inst->alg.cra_driver_name);
+	else
+		kobject_uevent(&ctx->kobj, KOBJ_ADD);
 }
 
-static struct crypto_instance *pcrypt_alloc_aead(struct rtattr **tb,
-						 u32 type, u32 mask)
+static int pcrypt_create_aead(struct crypto_template *tmpl,
+			      struct rtattr **tb, u32 type, u32 mask)
 {
+	struct pcrypt_instance_ctx *ctx;
 	struct crypto_instance *inst;
 	struct crypto_alg *alg;
+	int err;
 
 	alg = crypto_get_attr_alg(tb, type, (mask & CRYPTO_ALG_TYPE_MASK));
 	if (IS_ERR(alg))
-		return ERR_CAST(alg);
+		return PTR_ERR(alg);
 
-	inst = pcrypt_alloc_instance(alg);
+	inst = pcrypt_alloc_instance(0);
+	err = PTR_ERR(inst);
 	if (IS_ERR(inst))
 		goto out_put_alg;
 
+	ctx = crypto_instance_ctx(inst);
+	err = crypto_init_spawn(&ctx->spawn, alg, inst,
+				CRYPTO_ALG_TYPE_MASK);
+	if (err)
+		goto out_free_inst;
+
+	err = pcrypt_init_instance(inst, alg);
+	if (err)
+		goto out_drop_spawn;
+
 	inst->alg.cra_flags = CRYPTO_ALG_TYPE_AEAD | CRYPTO_ALG_ASYNC;
 	inst->alg.cra_type = &crypto_aead_type;
 
@@ -376,33 +1087,197 @@ static struct crypto_instance *pcrypt_alloc_aead(struct rtattr **tb,
 	inst->alg.cra_aead.decrypt = pcrypt_aead_decrypt;
 	inst->alg.cra_aead.givencrypt = pcrypt_aead_givencrypt;
 
+	err = crypto_register_instance(tmpl, inst);
+	if (err)
+		goto out_drop_spawn;
+
+	pcrypt_add_instance_kobj(inst);
+	crypto_mod_put(alg);
+	return 0;
+
+out_drop_spawn:
+	crypto_drop_spawn(&ctx->spawn);
+out_free_inst:
+	pcrypt_put_instance(inst);
+out_put_alg:
+	crypto_mod_put(alg);
+	return err;
+}
+
+static int pcrypt_create_ablkcipher(struct crypto_template *tmpl,
+				    struct rtattr **tb, u32 type, u32 mask)
+{
+	struct pcrypt_instance_ctx *ctx;
+	struct crypto_instance *inst;
+	struct crypto_alg *alg;
+	const char *name;
+	int err;
+
+	name = crypto_attr_alg_name(tb[1]);
+	if (IS_ERR(name))
+		return PTR_ERR(name);
+
+	inst = pcrypt_alloc_instance(0);
+	if (IS_ERR(inst))
+		return PTR_ERR(inst);
+
+	ctx = crypto_instance_ctx(inst);
+	crypto_set_skcipher_spawn(&ctx->skcipher_spawn, inst);
+	err = crypto_grab_skcipher(&ctx->skcipher_spawn, name, 0,
+				   crypto_requires_sync(type, mask));
+	if (err)
+		goto out_free_inst;
+
+	alg = crypto_skcipher_spawn_alg(&ctx->skcipher_spawn);
+	err = pcrypt_init_instance(inst, alg);
+	if (err)
+		goto out_drop_spawn;
+
+	inst->alg.cra_flags = CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC;
+	inst->alg.cra_type = &crypto_ablkcipher_type;
+
+	if ((alg->cra_flags & CRYPTO_ALG_TYPE_MASK) ==
+	    CRYPTO_ALG_TYPE_BLKCIPHER) {
+		inst->alg.cra_ablkcipher.ivsize = alg->cra_blkcipher.ivsize;
+		inst->alg.cra_ablkcipher.min_keysize =
+			alg->cra_blkcipher.min_keysize;
+		inst->alg.cra_ablkcipher.max_keysize =
+			alg->cra_blkcipher.max_keysize;
+		inst->alg.cra_ablkcipher.geniv = alg->cra_blkcipher.geniv;
+	} else {
+		inst->alg.cra_ablkcipher.ivsize = alg->cra_ablkcipher.ivsize;
+		inst->alg.cra_ablkcipher.min_keysize =
+			alg->cra_ablkcipher.min_keysize;
+		inst->alg.cra_ablkcipher.max_keysize =
+			alg->cra_ablkcipher.max_keysize;
+		inst->alg.cra_ablkcipher.geniv = alg->cra_ablkcipher.geniv;
+	}
+
+	inst->alg.cra_ctxsize = sizeof(struct pcrypt_ablkcipher_ctx);
+
+	inst->alg.cra_init = pcrypt_ablkcipher_init_tfm;
+	inst->alg.cra_exit = pcrypt_ablkcipher_exit_tfm;
+
+	inst->alg.cra_ablkcipher.setkey = pcrypt_ablkcipher_setkey;
+	inst->alg.cra_ablkcipher.encrypt = pcrypt_ablkcipher_encrypt;
+	inst->alg.cra_ablkcipher.decrypt = pcrypt_ablkcipher_decrypt;
+
+	err = crypto_register_instance(tmpl, inst);
+	if (err)
+		goto out_drop_spawn;
+
+	pcrypt_add_instance_kobj(inst);
+	return 0;
+
+out_drop_spawn:
+	crypto_drop_skcipher(&ctx->skcipher_spawn);
+out_free_inst:
+	pcrypt_put_instance(inst);
+	return err;
+}
+
+static int pcrypt_create_ahash(struct crypto_template *tmpl,
+			       struct rtattr **tb)
+{
+	struct pcrypt_instance_ctx *ctx;
+	struct ahash_instance *inst;
+	struct hash_alg_common *halg;
+	struct crypto_alg *alg;
+	int err;
+
+	halg = ahash_attr_alg(tb[1], 0, 0);
+	if (IS_ERR(halg))
+		return PTR_ERR(halg);
+
+	alg = &halg->base;
+	inst = pcrypt_alloc_instance(ahash_instance_headroom());
+	err = PTR_ERR(inst);
+	if (IS_ERR(inst))
+		goto out_put_alg;
+
+	ctx = ahash_instance_ctx(inst);
+	err = crypto_init_ahash_spawn(&ctx->ahash_spawn, halg,
+				      ahash_crypto_instance(inst));
+	if (err)
+		goto out_free_inst;
+
+	err = pcrypt_init_instance(ahash_crypto_instance(inst), alg);
+	if (err)
+		goto out_drop_spawn;
+
+	inst->alg.halg.base.cra_flags = CRYPTO_ALG_ASYNC;
+
+	inst->alg.halg.digestsize = halg->digestsize;
+	inst->alg.halg.statesize = halg->statesize;
+	inst->alg.halg.base.cra_ctxsize = sizeof(struct pcrypt_ahash_ctx);
+
+	inst->alg.halg.base.cra_init = pcrypt_ahash_init_tfm;
+	inst->alg.halg.base.cra_exit = pcrypt_ahash_exit_tfm;
+
+	inst->alg.init   = pcrypt_ahash_init;
+	inst->alg.update = pcrypt_ahash_update;
+	inst->alg.final  = pcrypt_ahash_final;
+	inst->alg.finup  = pcrypt_ahash_finup;
+	inst->alg.digest = pcrypt_ahash_digest;
+	inst->alg.export = pcrypt_ahash_export;
+	inst->alg.import = pcrypt_ahash_import;
+	inst->alg.setkey = pcrypt_ahash_setkey;
+
+	err = ahash_register_instance(tmpl, inst);
+	if (err)
+		goto out_drop_spawn;
+
+	pcrypt_add_instance_kobj(ahash_crypto_instance(inst));
+	crypto_mod_put(alg);
+	return 0;
+
+out_drop_spawn:
+	crypto_drop_ahash(&ctx->ahash_spawn);
+out_free_inst:
+	pcrypt_put_instance(ahash_crypto_instance(inst));
 out_put_alg:
 	crypto_mod_put(alg);
-	return inst;
+	return err;
 }
 
-static struct crypto_instance *pcrypt_alloc(struct rtattr **tb)
+static int pcrypt_create(struct crypto_template *tmpl, struct rtattr **tb)
 {
 	struct crypto_attr_type *algt;
 
 	algt = crypto_get_attr_type(tb);
 	if (IS_ERR(algt))
-		return ERR_CAST(algt);
+		return PTR_ERR(algt);
 
 	switch (algt->type & algt->mask & CRYPTO_ALG_TYPE_MASK) {
 	case CRYPTO_ALG_TYPE_AEAD:
-		return pcrypt_alloc_aead(tb, algt->type, algt->mask);
+		return pcrypt_create_aead(tmpl, tb, algt->type, algt->mask);
+	case CRYPTO_ALG_TYPE_BLKCIPHER:
+		return pcrypt_create_ablkcipher(tmpl, tb, algt->type,
+						algt->mask);
+	case CRYPTO_ALG_TYPE_DIGEST:
+		return pcrypt_create_ahash(tmpl, tb);
 	}
 
-	return ERR_PTR(-EINVAL);
+	return -EINVAL;
 }
 
 static void pcrypt_free(struct crypto_instance *inst)
 {
 	struct pcrypt_instance_ctx *ctx = crypto_instance_ctx(inst);
 
+	/* waits for a cpumask store that is still running */
+	if (ctx->kobj.state_in_sysfs)
+		kobject_del(&ctx->kobj);
+
 	crypto_drop_spawn(&ctx->spawn);
-	kfree(inst);
+
+	/* no tfms are left, so nothing is queued on these */
+	if (ctx->bound) {
+		pcrypt_fini_padata(&ctx->bound_enc);
+		pcrypt_fini_padata(&ctx->bound_dec);
+	}
+
+	pcrypt_put_instance(inst);
 }
 
 static int pcrypt_cpumask_change_notify(struct notifier_block *self,
@@ -435,12 +1310,15 @@ static int pcrypt_cpumask_change_notify(struct notifier_block *self,
 	return 0;
 }
 
-static int pcrypt_sysfs_add(struct padata_instance *pinst, const char *name)
+/* parent is NULL for the global instances, they go into pcrypt_kset */
+static int pcrypt_sysfs_add(struct padata_instance *pinst, const char *name,
+			    struct kobject *parent)
 {
 	int ret;
 
-	pinst->kobj.kset = pcrypt_kset;
-	ret = kobject_add(&pinst->kobj, NULL, name);
+	if (!parent)
+		pinst->kobj.kset = pcrypt_kset;
+	ret = kobject_add(&pinst->kobj, parent, name);
 	if (!ret)
 		kobject_uevent(&pinst->kobj, KOBJ_ADD);
 
@@ -448,11 +1326,16 @@ static int pcrypt_sysfs_add(struct padata_instance *pinst, const char *name)
 }
 
 static int pcrypt_init_padata(struct padata_pcrypt *pcrypt,
-			      const char *name)
+			      const char *name, struct kobject *parent)
 {
 	int ret = -ENOMEM;
 	struct pcrypt_cpumask *mask;
 
+	spin_lock_init(&pcrypt->backlog_lock);
+	INIT_LIST_HEAD(&pcrypt->backlog);
+	pcrypt->inflight = 0;
+	INIT_DELAYED_WORK(&pcrypt->backlog_work, pcrypt_backlog_work);
+
 	get_online_cpus();
 
 	pcrypt->wq = alloc_workqueue(name,
@@ -480,7 +1363,7 @@ static int pcrypt_init_padata(struct padata_pcrypt *pcrypt,
 	if (ret)
 		goto err_free_cpumask;
 
-	ret = pcrypt_sysfs_add(pcrypt->pinst, name);
+	ret = pcrypt_sysfs_add(pcrypt->pinst, name, parent);
 	if (ret)
 		goto err_unregister_notifier;
 
@@ -509,6 +1392,8 @@ static void pcrypt_fini_padata(struct padata_pcrypt *pcrypt)
 	kfree(pcrypt->cb_cpumask);
 
 	padata_stop(pcrypt->pinst);
+	/* no tfms are left, so nothing is backlogged */
+	cancel_delayed_work_sync(&pcrypt->backlog_work);
 	padata_unregister_cpumask_notifier(pcrypt->pinst, &pcrypt->nblock);
 	destroy_workqueue(pcrypt->wq);
 	padata_free(pcrypt->pinst);
@@ -516,7 +1401,7 @@ static void pcrypt_fini_padata(struct padata_pcrypt *pcrypt)
 
 static struct crypto_template pcrypt_tmpl = {
 	.name = "pcrypt",
-	.alloc = pcrypt_alloc,
+	.create = pcrypt_create,
 	.free = pcrypt_free,
 	.module = THIS_MODULE,
 };
@@ -529,11 +1414,11 @@ static int __init pcrypt_init(void)
 	if (!pcrypt_kset)
 		goto err;
 
-	err = pcrypt_init_padata(&pencrypt, "pencrypt");
+	err = pcrypt_init_padata(&pencrypt, "pencrypt", NULL);
 	if (err)
 		goto err_unreg_kset;
 
-	err = pcrypt_init_padata(&pdecrypt, "pdecrypt");
+	err = pcrypt_init_padata(&pdecrypt, "pdecrypt", NULL);
 	if (err)
 		goto err_deinit_pencrypt;
 
@@ -22,12 +22,14 @@
  *
  */
 
+#include <crypto/compress.h>
 #include <crypto/hash.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/gfp.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/moduleparam.h>
 #include <linux/jiffies.h>
@@ -57,6 +59,7 @@ static u32 type;
 static u32 mask;
 static int mode;
 static char *tvmem[TVMEMSIZE];
+static unsigned int num_mb = 8;
 
 static char *check[] = {
 	"des", "md5", "des3_ede", "rot13", "sha1", "sha224", "sha256",
@@ -64,7 +67,7 @@ static char *check[] = {
 	"cast6", "arc4", "michael_mic", "deflate", "crc32c", "tea", "xtea",
 	"khazad", "wp512", "wp384", "wp256", "tnepres", "xeta",  "fcrypt",
 	"camellia", "seed", "salsa20", "rmd128", "rmd160", "rmd256", "rmd320",
-	"lzo", "cts", "zlib", NULL
+	"lzo", "cts", "zlib", "lz4", NULL
 };
 
 static int test_cipher_jiffies(struct blkcipher_desc *desc, int enc,
@@ -920,6 +923,473 @@ out:
 	crypto_free_ablkcipher(tfm);
 }
 
+/*
+ * Multi-buffer speed tests: num_mb requests, each on its own buffer, are
+ * started back to back and waited for as a batch. With an asynchronous
+ * implementation such as pcrypt(...) they run on several CPUs at once,
+ * so comparing a batch size of 1 with a larger one shows the scaling.
+ */
+#define TCRYPT_MB_BUFSIZE	8192
+
+struct tcrypt_mb_result {
+	struct completion completion;
+	atomic_t pending;
+	int err;
+};
+
+static void tcrypt_mb_put(struct tcrypt_mb_result *res, int err)
+{
+	if (err)
+		res->err = err;
+	if (atomic_dec_and_test(&res->pending))
+		complete(&res->completion);
+}
+
+static void tcrypt_mb_complete(struct crypto_async_request *req, int err)
+{
+	if (err == -EINPROGRESS)
+		return;
+
+	tcrypt_mb_put(req->data, err);
+}
+
+/* account for a request that was just started */
+static void tcrypt_mb_started(struct tcrypt_mb_result *res, int ret)
+{
+	/* requests are sent with MAY_BACKLOG, -EBUSY means queued */
+	if (ret == -EINPROGRESS || ret == -EBUSY)
+		return;
+
+	tcrypt_mb_put(res, ret);
+}
+
+static void tcrypt_mb_init(struct tcrypt_mb_result *res, unsigned int n)
+{
+	INIT_COMPLETION(res->completion);
+	atomic_set(&res->pending, n);
+	res->err = 0;
+}
+
+static int tcrypt_mb_wait(struct tcrypt_mb_result *res)
+{
+	/* not interruptible, the requests use memory owned by the caller */
+	wait_for_completion(&res->completion);
+	return res->err;
+}
+
+struct test_mb_acipher_data {
+	struct ablkcipher_request *req;
+	struct scatterlist sg;
+	char *buf;
+	char iv[128];
+};
+
+static int do_mb_acipher_op(struct test_mb_acipher_data *data, int enc,
+			    unsigned int n, struct tcrypt_mb_result *res)
+{
+	unsigned int i;
+
+	tcrypt_mb_init(res, n);
+
+	for (i = 0; i < n; i++) {
+		if (enc)
+			tcrypt_mb_started(res,
+				crypto_ablkcipher_encrypt(data[i].req));
+		else
+			tcrypt_mb_started(res,
+				crypto_ablkcipher_decrypt(data[i].req));
+	}
+
+	return tcrypt_mb_wait(res);
+}
+
+static int test_mb_acipher_jiffies(struct test_mb_acipher_data *data, int enc,
+				   unsigned int n, int blen, int sec,
+				   struct tcrypt_mb_result *res)
+{
+	unsigned long start, end;
+	int bcount;
+	int ret;
+
+	for (start = jiffies, end = start + sec * HZ, bcount = 0;
+	     time_before(jiffies, end); bcount++) {
+		ret = do_mb_acipher_op(data, enc, n, res);
+		if (ret)
+			return ret;
+	}
+
+	pr_cont("%u operations in %d seconds (%ld bytes)\n",
+		bcount * n, sec, (long)bcount * n * blen);
+	return 0;
+}
+
+static void test_mb_acipher_speed(const char *algo, int enc, unsigned int sec,
+				  u8 *keysize, unsigned int n)
+{
+	struct test_mb_acipher_data *data;
+	struct tcrypt_mb_result res;
+	struct crypto_ablkcipher *tfm;
+	unsigned int i, j, iv_len;
+	const char *e;
+	u32 *b_size;
+	int ret;
+
+	if (enc == ENCRYPT)
+		e = "encryption";
+	else
+		e = "decryption";
+
+	/* the cycle counter is per CPU, always measure in wall time */
+	if (!sec)
+		sec = 1;
+
+	pr_info("\ntesting speed of multibuffer %s %s, %u in flight\n",
+		algo, e, n);
+
+	if (!n)
+		return;
+
+	data = kcalloc(n, sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return;
+
+	tfm = crypto_alloc_ablkcipher(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		goto out_free_data;
+	}
+
+	init_completion(&res.completion);
+
+	for (i = 0; i < n; i++) {
+		data[i].buf = kmalloc(TCRYPT_MB_BUFSIZE, GFP_KERNEL);
+		data[i].req = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+		if (!data[i].buf || !data[i].req) {
+			pr_err("tcrypt: skcipher: Failed to allocate request for %s\n",
+			       algo);
+			goto out_free_req;
+		}
+
+		ablkcipher_request_set_callback(data[i].req,
+						CRYPTO_TFM_REQ_MAY_BACKLOG,
+						tcrypt_mb_complete, &res);
+		memset(data[i].buf, 0xff, TCRYPT_MB_BUFSIZE);
+	}
+
+	iv_len = crypto_ablkcipher_ivsize(tfm);
+	if (iv_len > sizeof(data[0].iv)) {
+		pr_err("ivsize(%u) > iv buffer(%zu)\n", iv_len,
+		       sizeof(data[0].iv));
+		goto out_free_req;
+	}
+
+	i = 0;
+	do {
+		b_size = block_sizes;
+
+		do {
+			if (*b_size > TCRYPT_MB_BUFSIZE) {
+				pr_err("template (%u) too big for buffer (%u)\n",
+				       *b_size, TCRYPT_MB_BUFSIZE);
+				goto out_free_req;
+			}
+
+			pr_info("test %u (%d bit key, %d byte blocks): ", i,
+				*keysize * 8, *b_size);
+
+			memset(tvmem[0], 0xff, PAGE_SIZE);
+			crypto_ablkcipher_clear_flags(tfm, ~0);
+
+			ret = crypto_ablkcipher_setkey(tfm, tvmem[0], *keysize);
+			if (ret) {
+				pr_err("setkey() failed flags=%x\n",
+					crypto_ablkcipher_get_flags(tfm));
+				goto out_free_req;
+			}
+
+			for (j = 0; j < n; j++) {
+				sg_init_one(&data[j].sg, data[j].buf, *b_size);
+				memset(data[j].iv, 0xff, iv_len);
+				ablkcipher_request_set_crypt(data[j].req,
+							     &data[j].sg,
+							     &data[j].sg,
+							     *b_size,
+							     data[j].iv);
+			}
+
+			ret = test_mb_acipher_jiffies(data, enc, n, *b_size,
+						      sec, &res);
+			if (ret) {
+				pr_err("%s() failed flags=%x\n", e,
+					crypto_ablkcipher_get_flags(tfm));
+				goto out_free_req;
+			}
+			b_size++;
+			i++;
+		} while (*b_size);
+		keysize++;
+	} while (*keysize);
+
+out_free_req:
+	for (i = 0; i < n; i++) {
+		ablkcipher_request_free(data[i].req);
+		kfree(data[i].buf);
+	}
+	crypto_free_ablkcipher(tfm);
+out_free_data:
+	kfree(data);
+}
+
+struct test_mb_ahash_data {
+	struct ahash_request *req;
+	struct scatterlist sg;
+	char *buf;
+	char result[64];
+};
+
+static int do_mb_ahash_op(struct test_mb_ahash_data *data, unsigned int n,
+			  struct tcrypt_mb_result *res)
+{
+	unsigned int i;
+
+	tcrypt_mb_init(res, n);
+
+	for (i = 0; i < n; i++)
+		tcrypt_mb_started(res, crypto_ahash_digest(data[i].req));
+
+	return tcrypt_mb_wait(res);
+}
+
+/*
+ * n requests are kept in flight. The time a batch takes is also printed,
+ * with n = 1 that is the latency of a single request.
+ */
+static void test_mb_ahash_speed(const char *algo, unsigned int sec,
+				unsigned int n)
+{
+	struct test_mb_ahash_data *data;
+	struct tcrypt_mb_result res;
+	struct crypto_ahash *tfm;
+	unsigned long start, end;
+	unsigned int i, j;
+	int bcount;
+	int ret;
+
+	if (!sec)
+		sec = 1;
+
+	pr_info("\ntesting speed of multibuffer %s, %u in flight\n",
+		algo, n);
+
+	if (!n)
+		return;
+
+	data = kcalloc(n, sizeof(*data), GFP_KERNEL);
+	if (!data)
+		return;
+
+	tfm = crypto_alloc_ahash(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n",
+		       algo, PTR_ERR(tfm));
+		goto out_free_data;
+	}
+
+	if (crypto_ahash_digestsize(tfm) > sizeof(data[0].result)) {
+		pr_err("digestsize(%u) > outputbuffer(%zu)\n",
+		       crypto_ahash_digestsize(tfm), sizeof(data[0].result));
+		goto out_free_req;
+	}
+
+	init_completion(&res.completion);
+
+	for (i = 0; i < n; i++) {
+		data[i].buf = kmalloc(TCRYPT_MB_BUFSIZE, GFP_KERNEL);
+		data[i].req = ahash_request_alloc(tfm, GFP_KERNEL);
+		if (!data[i].buf || !data[i].req) {
+			pr_err("ahash request allocation failure\n");
+			goto out_free_req;
+		}
+
+		ahash_request_set_callback(data[i].req,
+					   CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   tcrypt_mb_complete, &res);
+		memset(data[i].buf, 0xff, TCRYPT_MB_BUFSIZE);
+	}
+
+	for (i = 0; block_sizes[i]; i++) {
+		if (block_sizes[i] > TCRYPT_MB_BUFSIZE)
+			break;
+
+		pr_info("test%3u (%5u byte blocks): ", i, block_sizes[i]);
+
+		for (j = 0; j < n; j++) {
+			sg_init_one(&data[j].sg, data[j].buf, block_sizes[i]);
+			ahash_request_set_crypt(data[j].req, &data[j].sg,
+						data[j].result, block_sizes[i]);
+		}
+
+		for (start = jiffies, end = start + sec * HZ, bcount = 0;
+		     time_before(jiffies, end); bcount++) {
+			ret = do_mb_ahash_op(data, n, &res);
+			if (ret) {
+				pr_err("hashing failed ret=%d\n", ret);
+				goto out_free_req;
+			}
+		}
+
+		pr_cont("%6u opers/sec, %9lu bytes/sec, %6lu usecs per batch\n",
+			bcount * n / sec,
+			(long)bcount * n * block_sizes[i] / sec,
+			bcount ? (long)sec * USEC_PER_SEC / bcount : 0);
+	}
+
+out_free_req:
+	for (i = 0; i < n; i++) {
+		ahash_request_free(data[i].req);
+		kfree(data[i].buf);
+	}
+	crypto_free_ahash(tfm);
+out_free_data:
+	kfree(data);
+}
+
+#define TCRYPT_COMP_BUFSIZE	65536
+
+static u32 comp_block_sizes[] = { 4096, 16384, 65536, 0 };
+
+/* Text-like data: a small vocabulary in pseudo-random order */
+static void tcrypt_comp_fill(u8 *buf, unsigned int len)
+{
+	static const char * const words[] = {
+		"the ", "page ", "swap ", "cache ", "block ", "of ", "and ",
+		"compressed ", "memory ", "zero ", "data ", "\n",
+	};
+	const char *w;
+	unsigned int n;
+	u32 seed = 1;
+
+	while (len) {
+		seed = seed * 1103515245 + 12345;
+		w = words[(seed >> 16) % ARRAY_SIZE(words)];
+		n = min_t(unsigned int, len, strlen(w));
+		memcpy(buf, w, n);
+		buf += n;
+		len -= n;
+	}
+}
+
+static void test_comp_speed(const char *algo, unsigned int sec)
+{
+	struct scatterlist sg[DIV_ROUND_UP(TCRYPT_COMP_BUFSIZE, PAGE_SIZE)];
+	struct scatterlist dsg;
+	struct crypto_comp_pool *pool;
+	unsigned long start, end;
+	unsigned int blen, clen, dlen, i, j;
+	u8 *src, *dst, *out;
+	int bcount;
+	int ret;
+
+	if (!sec)
+		sec = 1;
+
+	pr_info("\ntesting speed of %s compression\n", algo);
+
+	pool = crypto_alloc_comp_pool(algo, 0, 0, TCRYPT_COMP_BUFSIZE);
+	if (IS_ERR(pool)) {
+		pr_err("failed to load transform for %s: %ld\n",
+		       algo, PTR_ERR(pool));
+		return;
+	}
+
+	/* room for the worst case expansion of any of the algorithms */
+	src = kmalloc(TCRYPT_COMP_BUFSIZE, GFP_KERNEL);
+	dst = kmalloc(2 * TCRYPT_COMP_BUFSIZE, GFP_KERNEL);
+	out = kmalloc(TCRYPT_COMP_BUFSIZE, GFP_KERNEL);
+	if (!src || !dst || !out) {
+		pr_err("compression buffer allocation failure\n");
+		goto out;
+	}
+
+	tcrypt_comp_fill(src, TCRYPT_COMP_BUFSIZE);
+
+	for (i = 0; comp_block_sizes[i]; i++) {
+		blen = comp_block_sizes[i];
+
+		clen = 2 * TCRYPT_COMP_BUFSIZE;
+		ret = crypto_comp_pool_compress(pool, src, blen, dst, &clen);
+		if (ret) {
+			pr_err("compression failed ret=%d\n", ret);
+			goto out;
+		}
+
+		dlen = blen;
+		ret = crypto_comp_pool_decompress(pool, dst, clen, out, &dlen);
+		if (ret || dlen != blen || memcmp(src, out, blen)) {
+			pr_err("decompression failed ret=%d\n", ret);
+			goto out;
+		}
+
+		pr_info("test%3u (%5u byte blocks, compressed to %u%%)\n",
+			i, blen, clen * 100 / blen);
+
+		pr_info("compress:      ");
+		for (start = jiffies, end = start + sec * HZ, bcount = 0;
+		     time_before(jiffies, end); bcount++) {
+			dlen = 2 * TCRYPT_COMP_BUFSIZE;
+			ret = crypto_comp_pool_compress(pool, src, blen,
+							dst, &dlen);
+			if (ret)
+				goto out_err;
+		}
+		pr_cont("%6u opers/sec, %9lu bytes/sec\n",
+			bcount / sec, (long)bcount * blen / sec);
+
+		/* the same input as a list of pages, linearised by the pool */
+		sg_init_table(sg, DIV_ROUND_UP(blen, PAGE_SIZE));
+		for (j = 0; j * PAGE_SIZE < blen; j++)
+			sg_set_buf(sg + j, src + j * PAGE_SIZE,
+				   min_t(unsigned int, blen - j * PAGE_SIZE,
+					 PAGE_SIZE));
+		sg_init_one(&dsg, dst, 2 * TCRYPT_COMP_BUFSIZE);
+
+		pr_info("compress (sg): ");
+		for (start = jiffies, end = start + sec * HZ, bcount = 0;
+		     time_before(jiffies, end); bcount++) {
+			dlen = 2 * TCRYPT_COMP_BUFSIZE;
+			ret = crypto_comp_pool_compress_sg(pool, sg, blen,
+							   &dsg, &dlen);
+			if (ret)
+				goto out_err;
+		}
+		pr_cont("%6u opers/sec, %9lu bytes/sec\n",
+			bcount / sec, (long)bcount * blen / sec);
+
+		pr_info("decompress:    ");
+		for (start = jiffies, end = start + sec * HZ, bcount = 0;
+		     time_before(jiffies, end); bcount++) {
+			dlen = blen;
+			ret = crypto_comp_pool_decompress(pool, dst, clen,
+							  out, &dlen);
+			if (ret)
+				goto out_err;
+		}
+		pr_cont("%6u opers/sec, %9lu bytes/sec\n",
+			bcount / sec, (long)bcount * blen / sec);
+	}
+
+	goto out;
+
+out_err:
+	pr_cont("failed ret=%d\n", ret);
+out:
+	kfree(out);
+	kfree(dst);
+	kfree(src);
+	crypto_free_comp_pool(pool);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -1153,6 +1623,10 @@ static int do_test(int m)
 		ret += tcrypt_test("rfc4309(ccm(aes))");
 		break;
 
+	case 46:
+		ret += tcrypt_test("lz4");
+		break;
+
 	case 100:
 		ret += tcrypt_test("hmac(md5)");
 		break;
@@ -1339,6 +1813,38 @@ static int do_test(int m)
 				  speed_template_32_64);
 		break;
 
+	case 208:
+		/* compare the AES implementations, missing ones are skipped */
+		test_cipher_speed("cbc(aes-generic)", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("cbc(aes-generic)", DECRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("cbc(aes-asm)", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("cbc(aes-asm)", DECRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("cbc-aes-neonbs", DECRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("ctr(aes-generic)", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("ctr(aes-asm)", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("ctr-aes-neonbs", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("xts(aes-generic)", ENCRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		test_cipher_speed("xts(aes-generic)", DECRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		test_cipher_speed("xts(aes-asm)", ENCRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		test_cipher_speed("xts(aes-asm)", DECRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		test_cipher_speed("xts-aes-neonbs", ENCRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		test_cipher_speed("xts-aes-neonbs", DECRYPT, sec, NULL, 0,
+				speed_template_32_48_64);
+		break;
+
 	case 300:
 		/* fall through */
 
@@ -1414,6 +1920,21 @@ static int do_test(int m)
 		test_hash_speed("ghash-generic", sec, hash_speed_template_16);
 		if (mode > 300 && mode < 400) break;
 
+	case 319:
+		test_hash_speed("sha1-generic", sec, hash_speed_template_4k);
+		test_hash_speed("sha1-asm", sec, hash_speed_template_4k);
+		if (mode > 300 && mode < 400) break;
+
+	case 320:
+		test_hash_speed("sha256-generic", sec, hash_speed_template_4k);
+		test_hash_speed("sha256-neon", sec, hash_speed_template_4k);
+		if (mode > 300 && mode < 400) break;
+
+	case 321:
+		test_hash_speed("sha512-generic", sec, hash_speed_template_4k);
+		test_hash_speed("sha512-neon", sec, hash_speed_template_4k);
+		if (mode > 300 && mode < 400) break;
+
 	case 399:
 		break;
 
@@ -1563,6 +2084,67 @@ static int do_test(int m)
 				   speed_template_32_64);
 		break;
 
+	case 600:
+		test_mb_acipher_speed("cbc(aes)", ENCRYPT, sec,
+				      speed_template_16_32, num_mb);
+		test_mb_acipher_speed("cbc(aes)", DECRYPT, sec,
+				      speed_template_16_32, num_mb);
+		test_mb_acipher_speed("ctr(aes)", ENCRYPT, sec,
+				      speed_template_16_32, num_mb);
+		test_mb_acipher_speed("xts(aes)", ENCRYPT, sec,
+				      speed_template_32_64, num_mb);
+		break;
+
+	case 601:
+		test_mb_acipher_speed("pcrypt(cbc(aes))", ENCRYPT, sec,
+				      speed_template_16_32, num_mb);
+		test_mb_acipher_speed("pcrypt(cbc(aes))", DECRYPT, sec,
+				      speed_template_16_32, num_mb);
+		test_mb_acipher_speed("pcrypt(ctr(aes))", ENCRYPT, sec,
+				      speed_template_16_32, num_mb);
+		test_mb_acipher_speed("pcrypt(xts(aes))", ENCRYPT, sec,
+				      speed_template_32_64, num_mb);
+		break;
+
+	case 602:
+		test_mb_ahash_speed("sha1", sec, num_mb);
+		test_mb_ahash_speed("sha256", sec, num_mb);
+		break;
+
+	case 603:
+		test_mb_ahash_speed("pcrypt(sha1)", sec, num_mb);
+		test_mb_ahash_speed("pcrypt(sha256)", sec, num_mb);
+		break;
+
+	case 605:
+		/*
+		 * More requests than padata takes at once (MAX_OBJ_NUM), the
+		 * rest go through the pcrypt backlog.
+		 */
+		test_mb_acipher_speed("pcrypt(cbc(aes))", ENCRYPT, sec,
+				      speed_template_16_32, 1024);
+		test_mb_acipher_speed("pcrypt(cbc(aes))", DECRYPT, sec,
+				      speed_template_16_32, 1024);
+		test_mb_ahash_speed("pcrypt(sha1)", sec, 1024);
+		break;
+
+	case 604:
+		/*
+		 * Fill the lanes of multi-buffer implementations one by one,
+		 * the single request run shows how long a lone request waits.
+		 */
+		for (i = 1; i <= 8; i++) {
+			test_mb_ahash_speed("sha1", sec, i);
+			test_mb_ahash_speed("sha256", sec, i);
+		}
+		break;
+
+	case 700:
+		test_comp_speed("deflate", sec);
+		test_comp_speed("lzo", sec);
+		test_comp_speed("lz4", sec);
+		break;
+
 	case 1000:
 		test_available();
 		break;
@@ -1631,6 +2213,9 @@ module_param(mode, int, 0);
 module_param(sec, uint, 0);
 MODULE_PARM_DESC(sec, "Length in seconds of speed tests "
 		      "(defaults to zero which uses CPU cycles instead)");
+module_param(num_mb, uint, 0);
+MODULE_PARM_DESC(num_mb, "Number of requests in flight in the multibuffer "
+			 "speed tests (defaults to 8)");
 
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("Quick & dirty crypto testing module");
@@ -86,6 +86,19 @@ static struct hash_speed generic_hash_speed_template[] = {
 	{  .blen = 0,	.plen = 0, }
 };
 
+/*
+ * dm-verity hashes one 4096 byte data or hash block per digest, tvmem
+ * limits the largest run to 16KB.
+ */
+static struct hash_speed hash_speed_template_4k[] = {
+	{ .blen = 4096,	.plen = 512, },
+	{ .blen = 4096,	.plen = 4096, },
+	{ .blen = 16384, .plen = 4096, },
+
+	/* End marker */
+	{  .blen = 0,	.plen = 0, }
+};
+
 static struct hash_speed hash_speed_template_16[] = {
 	{ .blen = 16,	.plen = 16,	.klen = 16, },
 	{ .blen = 64,	.plen = 16,	.klen = 16, },
@@ -6109,14 +6109,14 @@ static struct cipher_testvec cast6_dec_tv_template[] = {
  */
 #define AES_ENC_TEST_VECTORS 3
 #define AES_DEC_TEST_VECTORS 3
-#define AES_CBC_ENC_TEST_VECTORS 4
-#define AES_CBC_DEC_TEST_VECTORS 4
+#define AES_CBC_ENC_TEST_VECTORS 5
+#define AES_CBC_DEC_TEST_VECTORS 5
 #define AES_LRW_ENC_TEST_VECTORS 8
 #define AES_LRW_DEC_TEST_VECTORS 8
-#define AES_XTS_ENC_TEST_VECTORS 5
-#define AES_XTS_DEC_TEST_VECTORS 5
-#define AES_CTR_ENC_TEST_VECTORS 3
-#define AES_CTR_DEC_TEST_VECTORS 3
+#define AES_XTS_ENC_TEST_VECTORS 6
+#define AES_XTS_DEC_TEST_VECTORS 6
+#define AES_CTR_ENC_TEST_VECTORS 4
+#define AES_CTR_DEC_TEST_VECTORS 4
 #define AES_OFB_ENC_TEST_VECTORS 1
 #define AES_OFB_DEC_TEST_VECTORS 1
 #define AES_CTR_3686_ENC_TEST_VECTORS 7
@@ -6283,6 +6283,52 @@ static struct cipher_testvec aes_cbc_enc_tv_template[] = {
 			  "\xb2\xeb\x05\xe2\xc3\x9b\xe9\xfc"
 			  "\xda\x6c\x19\x07\x8c\x6a\x9d\x1b",
 		.rlen	= 64,
+	}, { /* Generated with OpenSSL, covers 8-way code paths */
+		.key	= "\x11\x2e\x4b\x69\x87\xa5\xc3\xe2"
+			  "\x01\x20\x3f\x5f\x7f\x9f\xbf\xe0",
+		.klen	= 16,
+		.iv	= "\x70\x8d\xaa\xc8\xe6\x04\x22\x41"
+			  "\x60\x7f\x9e\xbe\xde\xfe\x1e\x3f",
+		.input	= "\x05\x22\x3f\x5d\x7b\x99\xb7\xd6"
+			  "\xf5\x14\x33\x53\x73\x93\xb3\xd4"
+			  "\xf5\x16\x37\x59\x7b\x9d\xbf\xe2"
+			  "\x05\x28\x4b\x6f\x93\xb7\xdb\x00"
+			  "\x25\x4a\x6f\x95\xbb\xe1\x07\x2e"
+			  "\x55\x7c\xa3\xcb\xf3\x1b\x43\x6c"
+			  "\x95\xbe\xe7\x11\x3b\x65\x8f\xba"
+			  "\xe5\x10\x3b\x67\x93\xbf\xeb\x18"
+			  "\x45\x72\x9f\xcd\xfb\x29\x57\x86"
+			  "\xb5\xe4\x13\x43\x73\xa3\xd3\x04"
+			  "\x35\x66\x97\xc9\xfb\x2d\x5f\x92"
+			  "\xc5\xf8\x2b\x5f\x93\xc7\xfb\x30"
+			  "\x65\x9a\xcf\x05\x3b\x71\xa7\xde"
+			  "\x15\x4c\x83\xbb\xf3\x2b\x63\x9c"
+			  "\xd5\x0e\x47\x81\xbb\xf5\x2f\x6a"
+			  "\xa5\xe0\x1b\x57\x93\xcf\x0b\x48"
+			  "\x85\xc2\xff\x3d\x7b\xb9\xf7\x36"
+			  "\x75\xb4\xf3\x33\x73\xb3\xf3\x34",
+		.ilen	= 144,
+		.result	= "\xf7\x38\xde\x85\xf9\x2e\x28\x48"
+			  "\x4e\xc1\x40\xb3\x26\xb6\x10\x0d"
+			  "\xb2\x5f\xf4\xcd\x41\x60\x21\x28"
+			  "\x77\x13\x55\xe9\x03\x3d\xcb\x50"
+			  "\x6b\xf1\x24\x21\xc3\xfe\xb6\x1d"
+			  "\xb1\x25\x34\x1a\xc8\xdd\x09\xcd"
+			  "\xf7\x55\x6e\x63\x18\x75\x88\xb4"
+			  "\xb0\x16\x4a\x29\xed\xda\x6d\x63"
+			  "\x67\x8d\x18\x31\x62\x5f\xba\x44"
+			  "\x57\x96\x7a\xc1\x58\x86\xe6\x53"
+			  "\xf4\xf2\xc5\x62\xbb\xdb\xac\x5a"
+			  "\x53\xc5\xa9\xa5\xdb\x84\xea\x15"
+			  "\x10\x4d\x98\x75\xf0\xb4\x12\x44"
+			  "\x71\x3d\x1c\xa0\x31\x31\xc1\x1d"
+			  "\xfe\x65\x88\x18\x36\x44\xf6\x9a"
+			  "\x48\xa5\xf4\xd9\x01\xa8\x74\x10"
+			  "\x54\xd2\x44\xc7\x40\xb2\xbe\xbd"
+			  "\x01\x03\xf9\xdf\x13\xdb\x19\x32",
+		.rlen	= 144,
+		.np	= 3,
+		.tap	= { 96, 32, 16 },
 	},
 };
 
@@ -6365,6 +6411,52 @@ static struct cipher_testvec aes_cbc_dec_tv_template[] = {
 			  "\xf6\x9f\x24\x45\xdf\x4f\x9b\x17"
 			  "\xad\x2b\x41\x7b\xe6\x6c\x37\x10",
 		.rlen	= 64,
+	}, { /* Generated with OpenSSL, covers 8-way code paths */
+		.key	= "\x11\x2e\x4b\x69\x87\xa5\xc3\xe2"
+			  "\x01\x20\x3f\x5f\x7f\x9f\xbf\xe0",
+		.klen	= 16,
+		.iv	= "\x70\x8d\xaa\xc8\xe6\x04\x22\x41"
+			  "\x60\x7f\x9e\xbe\xde\xfe\x1e\x3f",
+		.input	= "\xf7\x38\xde\x85\xf9\x2e\x28\x48"
+			  "\x4e\xc1\x40\xb3\x26\xb6\x10\x0d"
+			  "\xb2\x5f\xf4\xcd\x41\x60\x21\x28"
+			  "\x77\x13\x55\xe9\x03\x3d\xcb\x50"
+			  "\x6b\xf1\x24\x21\xc3\xfe\xb6\x1d"
+			  "\xb1\x25\x34\x1a\xc8\xdd\x09\xcd"
+			  "\xf7\x55\x6e\x63\x18\x75\x88\xb4"
+			  "\xb0\x16\x4a\x29\xed\xda\x6d\x63"
+			  "\x67\x8d\x18\x31\x62\x5f\xba\x44"
+			  "\x57\x96\x7a\xc1\x58\x86\xe6\x53"
+			  "\xf4\xf2\xc5\x62\xbb\xdb\xac\x5a"
+			  "\x53\xc5\xa9\xa5\xdb\x84\xea\x15"
+			  "\x10\x4d\x98\x75\xf0\xb4\x12\x44"
+			  "\x71\x3d\x1c\xa0\x31\x31\xc1\x1d"
+			  "\xfe\x65\x88\x18\x36\x44\xf6\x9a"
+			  "\x48\xa5\xf4\xd9\x01\xa8\x74\x10"
+			  "\x54\xd2\x44\xc7\x40\xb2\xbe\xbd"
+			  "\x01\x03\xf9\xdf\x13\xdb\x19\x32",
+		.ilen	= 144,
+		.result	= "\x05\x22\x3f\x5d\x7b\x99\xb7\xd6"
+			  "\xf5\x14\x33\x53\x73\x93\xb3\xd4"
+			  "\xf5\x16\x37\x59\x7b\x9d\xbf\xe2"
+			  "\x05\x28\x4b\x6f\x93\xb7\xdb\x00"
+			  "\x25\x4a\x6f\x95\xbb\xe1\x07\x2e"
+			  "\x55\x7c\xa3\xcb\xf3\x1b\x43\x6c"
+			  "\x95\xbe\xe7\x11\x3b\x65\x8f\xba"
+			  "\xe5\x10\x3b\x67\x93\xbf\xeb\x18"
+			  "\x45\x72\x9f\xcd\xfb\x29\x57\x86"
+			  "\xb5\xe4\x13\x43\x73\xa3\xd3\x04"
+			  "\x35\x66\x97\xc9\xfb\x2d\x5f\x92"
+			  "\xc5\xf8\x2b\x5f\x93\xc7\xfb\x30"
+			  "\x65\x9a\xcf\x05\x3b\x71\xa7\xde"
+			  "\x15\x4c\x83\xbb\xf3\x2b\x63\x9c"
+			  "\xd5\x0e\x47\x81\xbb\xf5\x2f\x6a"
+			  "\xa5\xe0\x1b\x57\x93\xcf\x0b\x48"
+			  "\x85\xc2\xff\x3d\x7b\xb9\xf7\x36"
+			  "\x75\xb4\xf3\x33\x73\xb3\xf3\x34",
+		.rlen	= 144,
+		.np	= 3,
+		.tap	= { 96, 32, 16 },
 	},
 };
 
@@ -7207,7 +7299,59 @@ static struct cipher_testvec aes_xts_enc_tv_template[] = {
 			  "\xc4\xf3\x6f\xfd\xa9\xfc\xea\x70"
 			  "\xb9\xc6\xe6\x93\xe1\x48\xc1\x51",
 		.rlen	= 512,
-	}
+	}, { /* Generated with OpenSSL, covers 8-way code paths */
+		.key	= "\x37\x54\x71\x8f\xad\xcb\xe9\x08"
+			  "\x27\x46\x65\x85\xa5\xc5\xe5\x06"
+			  "\x27\x48\x69\x8b\xad\xcf\xf1\x14"
+			  "\x37\x5a\x7d\xa1\xc5\xe9\x0d\x32"
+			  "\x57\x7c\xa1\xc7\xed\x13\x39\x60"
+			  "\x87\xae\xd5\xfd\x25\x4d\x75\x9e"
+			  "\xc7\xf0\x19\x43\x6d\x97\xc1\xec"
+			  "\x17\x42\x6d\x99\xc5\xf1\x1d\x4a",
+		.klen	= 64,
+		.iv	= "\x12\x34\x56\x78\x9a\x00\x00\x00"
+			  "\x00\x00\x00\x00\x00\x00\x00\x00",
+		.input	= "\x99\xb6\xd3\xf1\x0f\x2d\x4b\x6a"
+			  "\x89\xa8\xc7\xe7\x07\x27\x47\x68"
+			  "\x89\xaa\xcb\xed\x0f\x31\x53\x76"
+			  "\x99\xbc\xdf\x03\x27\x4b\x6f\x94"
+			  "\xb9\xde\x03\x29\x4f\x75\x9b\xc2"
+			  "\xe9\x10\x37\x5f\x87\xaf\xd7\x00"
+			  "\x29\x52\x7b\xa5\xcf\xf9\x23\x4e"
+			  "\x79\xa4\xcf\xfb\x27\x53\x7f\xac"
+			  "\xd9\x06\x33\x61\x8f\xbd\xeb\x1a"
+			  "\x49\x78\xa7\xd7\x07\x37\x67\x98"
+			  "\xc9\xfa\x2b\x5d\x8f\xc1\xf3\x26"
+			  "\x59\x8c\xbf\xf3\x27\x5b\x8f\xc4"
+			  "\xf9\x2e\x63\x99\xcf\x05\x3b\x72"
+			  "\xa9\xe0\x17\x4f\x87\xbf\xf7\x30"
+			  "\x69\xa2\xdb\x15\x4f\x89\xc3\xfe"
+			  "\x39\x74\xaf\xeb\x27\x63\x9f\xdc"
+			  "\x19\x56\x93\xd1\x0f\x4d\x8b\xca"
+			  "\x09\x48\x87\xc7\x07\x47\x87\xc8",
+		.ilen	= 144,
+		.result	= "\x9c\x66\x5c\x1c\x88\x4b\x37\x92"
+			  "\x62\xcd\x3f\x72\x41\x53\xff\xcc"
+			  "\xc7\x19\x05\x14\x8a\x0a\x08\xca"
+			  "\xf9\x5b\xba\x82\x82\xad\x0e\x1e"
+			  "\xc9\x7a\xa9\x1a\xb9\xbd\xf8\x23"
+			  "\xae\xb0\xc3\x92\x18\xcf\xb9\xc5"
+			  "\xde\x6f\xaa\xfe\x02\xbb\xae\xd5"
+			  "\x9f\xaa\xe7\xf5\x27\x0c\xa2\x59"
+			  "\xc5\xa5\x09\x86\xd0\xa5\xcb\x4d"
+			  "\xcc\x91\xa0\xec\x35\x95\x73\x84"
+			  "\xf7\x2d\xc1\x6b\x47\x7e\x6c\x95"
+			  "\x7b\x3e\x9f\x58\x63\xa4\x8f\x80"
+			  "\x53\xcd\x24\xdd\x3b\x07\xed\xcc"
+			  "\xf2\xac\x2e\x07\x44\x59\x80\x6d"
+			  "\xb7\x57\x16\x40\xf1\x90\x5b\xf2"
+			  "\x76\x7f\x1b\x20\xc1\x04\x41\x0b"
+			  "\x77\x95\x6e\x44\x0c\x04\x55\xb3"
+			  "\xea\x35\x6d\x16\x0a\x80\x21\xc3",
+		.rlen	= 144,
+		.np	= 3,
+		.tap	= { 96, 32, 16 },
+	},
 };
 
 static struct cipher_testvec aes_xts_dec_tv_template[] = {
@@ -7549,7 +7693,59 @@ static struct cipher_testvec aes_xts_dec_tv_template[] = {
 			  "\xf8\xf9\xfa\xfb\xfc\xfd\xfe\xff",
 		.rlen	= 512,
 
-	}
+	}, { /* Generated with OpenSSL, covers 8-way code paths */
+		.key	= "\x37\x54\x71\x8f\xad\xcb\xe9\x08"
+			  "\x27\x46\x65\x85\xa5\xc5\xe5\x06"
+			  "\x27\x48\x69\x8b\xad\xcf\xf1\x14"
+			  "\x37\x5a\x7d\xa1\xc5\xe9\x0d\x32"
+			  "\x57\x7c\xa1\xc7\xed\x13\x39\x60"
+			  "\x87\xae\xd5\xfd\x25\x4d\x75\x9e"
+			  "\xc7\xf0\x19\x43\x6d\x97\xc1\xec"
+			  "\x17\x42\x6d\x99\xc5\xf1\x1d\x4a",
+		.klen	= 64,
+		.iv	= "\x12\x34\x56\x78\x9a\x00\x00\x00"
+			  "\x00\x00\x00\x00\x00\x00\x00\x00",
+		.input	= "\x9c\x66\x5c\x1c\x88\x4b\x37\x92"
+			  "\x62\xcd\x3f\x72\x41\x53\xff\xcc"
+			  "\xc7\x19\x05\x14\x8a\x0a\x08\xca"
+			  "\xf9\x5b\xba\x82\x82\xad\x0e\x1e"
+			  "\xc9\x7a\xa9\x1a\xb9\xbd\xf8\x23"
+			  "\xae\xb0\xc3\x92\x18\xcf\xb9\xc5"
+			  "\xde\x6f\xaa\xfe\x02\xbb\xae\xd5"
+			  "\x9f\xaa\xe7\xf5\x27\x0c\xa2\x59"
+			  "\xc5\xa5\x09\x86\xd0\xa5\xcb\x4d"
+			  "\xcc\x91\xa0\xec\x35\x95\x73\x84"
+			  "\xf7\x2d\xc1\x6b\x47\x7e\x6c\x95"
+			  "\x7b\x3e\x9f\x58\x63\xa4\x8f\x80"
+			  "\x53\xcd\x24\xdd\x3b\x07\xed\xcc"
+			  "\xf2\xac\x2e\x07\x44\x59\x80\x6d"
+			  "\xb7\x57\x16\x40\xf1\x90\x5b\xf2"
+			  "\x76\x7f\x1b\x20\xc1\x04\x41\x0b"
+			  "\x77\x95\x6e\x44\x0c\x04\x55\xb3"
+			  "\xea\x35\x6d\x16\x0a\x80\x21\xc3",
+		.ilen	= 144,
+		.result	= "\x99\xb6\xd3\xf1\x0f\x2d\x4b\x6a"
+			  "\x89\xa8\xc7\xe7\x07\x27\x47\x68"
+			  "\x89\xaa\xcb\xed\x0f\x31\x53\x76"
+			  "\x99\xbc\xdf\x03\x27\x4b\x6f\x94"
+			  "\xb9\xde\x03\x29\x4f\x75\x9b\xc2"
+			  "\xe9\x10\x37\x5f\x87\xaf\xd7\x00"
+			  "\x29\x52\x7b\xa5\xcf\xf9\x23\x4e"
+			  "\x79\xa4\xcf\xfb\x27\x53\x7f\xac"
+			  "\xd9\x06\x33\x61\x8f\xbd\xeb\x1a"
+			  "\x49\x78\xa7\xd7\x07\x37\x67\x98"
+			  "\xc9\xfa\x2b\x5d\x8f\xc1\xf3\x26"
+			  "\x59\x8c\xbf\xf3\x27\x5b\x8f\xc4"
+			  "\xf9\x2e\x63\x99\xcf\x05\x3b\x72"
+			  "\xa9\xe0\x17\x4f\x87\xbf\xf7\x30"
+			  "\x69\xa2\xdb\x15\x4f\x89\xc3\xfe"
+			  "\x39\x74\xaf\xeb\x27\x63\x9f\xdc"
+			  "\x19\x56\x93\xd1\x0f\x4d\x8b\xca"
+			  "\x09\x48\x87\xc7\x07\x47\x87\xc8",
+		.rlen	= 144,
+		.np	= 3,
+		.tap	= { 96, 32, 16 },
+	},
 };
 
 
@@ -7629,7 +7825,56 @@ static struct cipher_testvec aes_ctr_enc_tv_template[] = {
 			  "\xdf\xc9\xc5\x8d\xb6\x7a\xad\xa6"
 			  "\x13\xc2\xdd\x08\x45\x79\x41\xa6",
 		.rlen	= 64,
-	}
+	}, { /* Generated with OpenSSL, counter wraps, partial block */
+		.key	= "\x23\x40\x5d\x7b\x99\xb7\xd5\xf4"
+			  "\x13\x32\x51\x71\x91\xb1\xd1\xf2"
+			  "\x13\x34\x55\x77\x99\xbb\xdd\x00",
+		.klen	= 24,
+		.iv	= "\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7"
+			  "\xf8\xf9\xfa\xfb\xff\xff\xff\xfa",
+		.input	= "\x40\x5d\x7a\x98\xb6\xd4\xf2\x11"
+			  "\x30\x4f\x6e\x8e\xae\xce\xee\x0f"
+			  "\x30\x51\x72\x94\xb6\xd8\xfa\x1d"
+			  "\x40\x63\x86\xaa\xce\xf2\x16\x3b"
+			  "\x60\x85\xaa\xd0\xf6\x1c\x42\x69"
+			  "\x90\xb7\xde\x06\x2e\x56\x7e\xa7"
+			  "\xd0\xf9\x22\x4c\x76\xa0\xca\xf5"
+			  "\x20\x4b\x76\xa2\xce\xfa\x26\x53"
+			  "\x80\xad\xda\x08\x36\x64\x92\xc1"
+			  "\xf0\x1f\x4e\x7e\xae\xde\x0e\x3f"
+			  "\x70\xa1\xd2\x04\x36\x68\x9a\xcd"
+			  "\x00\x33\x66\x9a\xce\x02\x36\x6b"
+			  "\xa0\xd5\x0a\x40\x76\xac\xe2\x19"
+			  "\x50\x87\xbe\xf6\x2e\x66\x9e\xd7"
+			  "\x10\x49\x82\xbc\xf6\x30\x6a\xa5"
+			  "\xe0\x1b\x56\x92\xce\x0a\x46\x83"
+			  "\xc0\xfd\x3a\x78\xb6\xf4\x32\x71"
+			  "\xb0\xef\x2e\x6e\xae\xee\x2e\x6f"
+			  "\xb0\xf1\x32",
+		.ilen	= 147,
+		.result	= "\xb1\xe1\xb2\xaa\x7f\x0f\x0e\x12"
+			  "\x92\x56\xc5\x00\xaf\x00\x76\x96"
+			  "\x79\xbb\x48\x1b\xc2\x59\x5a\xe8"
+			  "\x4c\xf3\xd7\x9c\x16\xea\x01\x09"
+			  "\x7d\x90\x0d\x4d\x8d\x2f\x1c\xac"
+			  "\x65\x23\x38\x67\x2a\xc9\xb8\x5e"
+			  "\x70\x3b\xe9\x46\x61\x94\x91\xed"
+			  "\xe5\xff\xbd\xdf\x8c\x25\xd2\x08"
+			  "\xcd\x34\x0a\x27\xb0\x10\xb5\xc3"
+			  "\x3c\xb0\xa0\x45\x93\xa0\xfe\x37"
+			  "\xb7\x74\x77\xbf\x16\x49\xba\xd3"
+			  "\xd7\x1a\x96\x77\xa9\xf5\x2e\x9e"
+			  "\x5d\x9b\xc1\x05\x3d\x3d\x85\xf5"
+			  "\x2f\xe4\xff\xa3\x2e\x39\x29\x29"
+			  "\xd6\xbd\x12\x80\x24\x9c\x59\x6d"
+			  "\x75\xf4\x0b\x63\xc9\x3b\x96\x2a"
+			  "\xc3\x10\xc1\x1d\xfb\xda\x02\x78"
+			  "\x33\xc5\x2b\x3c\x90\x88\x76\x78"
+			  "\xd4\x2c\x33",
+		.rlen	= 147,
+		.np	= 3,
+		.tap	= { 80, 64, 3 },
+	},
 };
 
 static struct cipher_testvec aes_ctr_dec_tv_template[] = {
@@ -7708,7 +7953,56 @@ static struct cipher_testvec aes_ctr_dec_tv_template[] = {
 			  "\xf6\x9f\x24\x45\xdf\x4f\x9b\x17"
 			  "\xad\x2b\x41\x7b\xe6\x6c\x37\x10",
 		.rlen	= 64,
-	}
+	}, { /* Generated with OpenSSL, counter wraps, partial block */
+		.key	= "\x23\x40\x5d\x7b\x99\xb7\xd5\xf4"
+			  "\x13\x32\x51\x71\x91\xb1\xd1\xf2"
+			  "\x13\x34\x55\x77\x99\xbb\xdd\x00",
+		.klen	= 24,
+		.iv	= "\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7"
+			  "\xf8\xf9\xfa\xfb\xff\xff\xff\xfa",
+		.input	= "\xb1\xe1\xb2\xaa\x7f\x0f\x0e\x12"
+			  "\x92\x56\xc5\x00\xaf\x00\x76\x96"
+			  "\x79\xbb\x48\x1b\xc2\x59\x5a\xe8"
+			  "\x4c\xf3\xd7\x9c\x16\xea\x01\x09"
+			  "\x7d\x90\x0d\x4d\x8d\x2f\x1c\xac"
+			  "\x65\x23\x38\x67\x2a\xc9\xb8\x5e"
+			  "\x70\x3b\xe9\x46\x61\x94\x91\xed"
+			  "\xe5\xff\xbd\xdf\x8c\x25\xd2\x08"
+			  "\xcd\x34\x0a\x27\xb0\x10\xb5\xc3"
+			  "\x3c\xb0\xa0\x45\x93\xa0\xfe\x37"
+			  "\xb7\x74\x77\xbf\x16\x49\xba\xd3"
+			  "\xd7\x1a\x96\x77\xa9\xf5\x2e\x9e"
+			  "\x5d\x9b\xc1\x05\x3d\x3d\x85\xf5"
+			  "\x2f\xe4\xff\xa3\x2e\x39\x29\x29"
+			  "\xd6\xbd\x12\x80\x24\x9c\x59\x6d"
+			  "\x75\xf4\x0b\x63\xc9\x3b\x96\x2a"
+			  "\xc3\x10\xc1\x1d\xfb\xda\x02\x78"
+			  "\x33\xc5\x2b\x3c\x90\x88\x76\x78"
+			  "\xd4\x2c\x33",
+		.ilen	= 147,
+		.result	= "\x40\x5d\x7a\x98\xb6\xd4\xf2\x11"
+			  "\x30\x4f\x6e\x8e\xae\xce\xee\x0f"
+			  "\x30\x51\x72\x94\xb6\xd8\xfa\x1d"
+			  "\x40\x63\x86\xaa\xce\xf2\x16\x3b"
+			  "\x60\x85\xaa\xd0\xf6\x1c\x42\x69"
+			  "\x90\xb7\xde\x06\x2e\x56\x7e\xa7"
+			  "\xd0\xf9\x22\x4c\x76\xa0\xca\xf5"
+			  "\x20\x4b\x76\xa2\xce\xfa\x26\x53"
+			  "\x80\xad\xda\x08\x36\x64\x92\xc1"
+			  "\xf0\x1f\x4e\x7e\xae\xde\x0e\x3f"
+			  "\x70\xa1\xd2\x04\x36\x68\x9a\xcd"
+			  "\x00\x33\x66\x9a\xce\x02\x36\x6b"
+			  "\xa0\xd5\x0a\x40\x76\xac\xe2\x19"
+			  "\x50\x87\xbe\xf6\x2e\x66\x9e\xd7"
+			  "\x10\x49\x82\xbc\xf6\x30\x6a\xa5"
+			  "\xe0\x1b\x56\x92\xce\x0a\x46\x83"
+			  "\xc0\xfd\x3a\x78\xb6\xf4\x32\x71"
+			  "\xb0\xef\x2e\x6e\xae\xee\x2e\x6f"
+			  "\xb0\xf1\x32",
+		.rlen	= 147,
+		.np	= 3,
+		.tap	= { 80, 64, 3 },
+	},
 };
 
 static struct cipher_testvec aes_ctr_rfc3686_enc_tv_template[] = {
@@ -14549,6 +14843,86 @@ static struct pcomp_testvec zlib_decomp_tv_template[] = {
 	},
 };
 
+/*
+ * LZ4 test vectors (null-terminated strings).
+ */
+#define LZ4_COMP_TEST_VECTORS 2
+#define LZ4_DECOMP_TEST_VECTORS 2
+
+static struct comp_testvec lz4_comp_tv_template[] = {
+	{
+		.inlen	= 70,
+		.outlen	= 45,
+		.input	= "Join us now and share the software "
+			"Join us now and share the software ",
+		.output	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+	}, {
+		.inlen	= 159,
+		.outlen	= 125,
+		.input	= "This document describes a compression method based on the LZO "
+			"compression algorithm.  This document defines the application of "
+			"the LZO algorithm used in UBIFS.",
+		.output	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x4f\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x56\x00\x21\x6f\x66\x13\x00"
+			  "\x00\x49\x00\x05\x3d\x00\x20\x20"
+			  "\x75\x63\x00\x90\x69\x6e\x20\x55"
+			  "\x42\x49\x46\x53\x2e",
+	},
+};
+
+static struct comp_testvec lz4_decomp_tv_template[] = {
+	{
+		.inlen	= 125,
+		.outlen	= 159,
+		.input	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x4f\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x56\x00\x21\x6f\x66\x13\x00"
+			  "\x00\x49\x00\x05\x3d\x00\x20\x20"
+			  "\x75\x63\x00\x90\x69\x6e\x20\x55"
+			  "\x42\x49\x46\x53\x2e",
+		.output	= "This document describes a compression method based on the LZO "
+			"compression algorithm.  This document defines the application of "
+			"the LZO algorithm used in UBIFS.",
+	}, {
+		.inlen	= 45,
+		.outlen	= 70,
+		.input	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+		.output	= "Join us now and share the software "
+			"Join us now and share the software ",
+	},
+};
+
 /*
  * LZO test vectors (null-terminated strings).
  */
@@ -37,16 +37,28 @@
 #include <linux/swap.h>
 #include <linux/mm_types.h>
 #include <linux/dma-contiguous.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
 #include <trace/events/kmem.h>
 
 #ifndef SZ_1M
 #define SZ_1M (1 << 20)
 #endif
 
+/* Allocation latency histogram buckets: <1ms, <2ms, <4ms ... >=1024ms */
+#define CMA_LATENCY_BUCKETS	12
+
 struct cma {
 	unsigned long	base_pfn;
 	unsigned long	count;
 	unsigned long	*bitmap;
+
+	/* Statistics, protected by cma_mutex */
+	unsigned long	nr_allocs;
+	unsigned long	nr_fails;
+	unsigned long	nr_retries;
+	unsigned long	latency[CMA_LATENCY_BUCKETS];
 };
 
 static DEFINE_MUTEX(cma_mutex);
@@ -177,7 +189,7 @@ static __init struct cma *cma_create_area(unsigned long base_pfn,
 
 	pr_debug("%s(base %08lx, count %lx)\n", __func__, base_pfn, count);
 
-	cma = kmalloc(sizeof *cma, GFP_KERNEL);
+	cma = kzalloc(sizeof *cma, GFP_KERNEL);
 	if (!cma)
 		return ERR_PTR(-ENOMEM);
 
@@ -465,14 +477,28 @@ phys_addr_t cma_get_base(struct device *dev)
  * global one. Requires architecture specific get_dev_cma_area() helper
  * function.
  */
+static void cma_account(struct cma *cma, ktime_t start, bool success)
+{
+	unsigned long ms = ktime_to_ms(ktime_sub(ktime_get(), start));
+	int bucket = ms ? min(fls_long(ms), CMA_LATENCY_BUCKETS - 1) : 0;
+
+	if (success)
+		cma->nr_allocs++;
+	else
+		cma->nr_fails++;
+	cma->latency[bucket]++;
+}
+
 struct page *dma_alloc_from_contiguous(struct device *dev, int count,
 				       unsigned int align)
 {
-	unsigned long mask, pfn, pageno, start = 0;
+	unsigned long mask, pfn, pageno, start, step;
 	struct cma *cma = dev_get_cma_area(dev);
 	struct page *page = NULL;
-	int ret;
+	ktime_t alloc_start = ktime_get();
+	int ret = -EBUSY;
 	int tries = 0;
+	int pass;
 
 	if (!cma || !cma->count)
 		return NULL;
@@ -490,30 +516,43 @@ struct page *dma_alloc_from_contiguous(struct device *dev, int count,
 
 	mutex_lock(&cma_mutex);
 
-	for (;;) {
-		pageno = bitmap_find_next_zero_area(cma->bitmap, cma->count,
-						    start, count, mask);
-		if (pageno >= cma->count)
-			break;
-
-		pfn = cma->base_pfn + pageno;
-		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA);
-		if (ret == 0) {
-			bitmap_set(cma->bitmap, pageno, count);
-			page = pfn_to_page(pfn);
-			break;
-		} else if (ret != -EBUSY) {
-			break;
+	/*
+	 * A busy page usually stays busy for the duration of the call, so
+	 * the first pass only tries ranges that do not overlap one found
+	 * busy. The second pass goes over the area again in steps of the
+	 * alignment, retrying the ranges of the first pass as well.
+	 */
+	for (pass = 0; pass < 2 && ret == -EBUSY; pass++) {
+		step = pass ? mask + 1 : ALIGN(count, mask + 1);
+		start = 0;
+
+		for (;;) {
+			pageno = bitmap_find_next_zero_area(cma->bitmap,
+						cma->count, start, count, mask);
+			if (pageno >= cma->count)
+				break;
+
+			pfn = cma->base_pfn + pageno;
+			ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA);
+			if (ret == 0) {
+				bitmap_set(cma->bitmap, pageno, count);
+				page = pfn_to_page(pfn);
+				break;
+			} else if (ret != -EBUSY) {
+				break;
+			}
+			tries++;
+			cma->nr_retries++;
+			trace_dma_alloc_contiguous_retry(tries);
+
+			pr_debug("%s(): memory range at %p is busy, retrying\n",
+				 __func__, pfn_to_page(pfn));
+			/* try again with a different memory target */
+			start = pageno + step;
 		}
-		tries++;
-		trace_dma_alloc_contiguous_retry(tries);
-
-		pr_debug("%s(): memory range at %p is busy, retrying\n",
-			 __func__, pfn_to_page(pfn));
-		/* try again with a bit different memory target */
-		start = pageno + mask + 1;
 	}
 
+	cma_account(cma, alloc_start, page != NULL);
 	mutex_unlock(&cma_mutex);
 	pr_debug("%s(): returned %p\n", __func__, page);
 	return page;
@@ -554,3 +593,81 @@ bool dma_release_from_contiguous(struct device *dev, struct page *pages,
 
 	return true;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int cma_latency_show(struct seq_file *m, void *v)
+{
+	struct cma *cma = m->private;
+	int i;
+
+	mutex_lock(&cma_mutex);
+	seq_printf(m, "allocs: %lu\nfails: %lu\nretries: %lu\n",
+		   cma->nr_allocs, cma->nr_fails, cma->nr_retries);
+	for (i = 0; i < CMA_LATENCY_BUCKETS - 1; i++)
+		seq_printf(m, "<%ums: %lu\n", 1 << i, cma->latency[i]);
+	seq_printf(m, ">=%ums: %lu\n", 1 << (i - 1), cma->latency[i]);
+	mutex_unlock(&cma_mutex);
+
+	return 0;
+}
+
+static int cma_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cma_latency_show, inode->i_private);
+}
+
+/* Writing anything clears the statistics */
+static ssize_t cma_latency_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct cma *cma = ((struct seq_file *)file->private_data)->private;
+
+	mutex_lock(&cma_mutex);
+	cma->nr_allocs = 0;
+	cma->nr_fails = 0;
+	cma->nr_retries = 0;
+	memset(cma->latency, 0, sizeof(cma->latency));
+	mutex_unlock(&cma_mutex);
+
+	return count;
+}
+
+static const struct file_operations cma_latency_fops = {
+	.open		= cma_latency_open,
+	.read		= seq_read,
+	.write		= cma_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init cma_debugfs_init(void)
+{
+	struct dentry *root, *dir;
+	char name[16];
+	int i;
+
+	root = debugfs_create_dir("cma", NULL);
+	if (IS_ERR_OR_NULL(root))
+		return 0;
+
+	for (i = 0; i < cma_area_count; i++) {
+		if (!cma_areas[i].cma)
+			continue;
+
+		if (cma_areas[i].name)
+			strlcpy(name, cma_areas[i].name, sizeof(name));
+		else
+			snprintf(name, sizeof(name), "cma%d", i);
+
+		dir = debugfs_create_dir(name, root);
+		if (IS_ERR_OR_NULL(dir))
+			continue;
+
+		debugfs_create_file("latency", 0644, dir, cma_areas[i].cma,
+				    &cma_latency_fops);
+	}
+
+	return 0;
+}
+late_initcall(cma_debugfs_init);
+#endif
@@ -29,6 +29,7 @@
 #include <linux/completion.h>
 #include <linux/mutex.h>
 #include <linux/syscore_ops.h>
+#include <linux/sched.h>
 
 #include <trace/events/power.h>
 
@@ -252,6 +253,32 @@ static inline void adjust_jiffies(unsigned long val, struct cpufreq_freqs *ci)
 #endif
 
 
+/*
+ * Current frequency of every CPU relative to the highest frequency of the
+ * CPU, scaled to SCHED_POWER_SCALE. The scheduler uses it to make its
+ * utilization tracking frequency invariant, so that running at 300MHz
+ * does not count as much as running at the top frequency.
+ */
+static DEFINE_PER_CPU(unsigned long, cpufreq_freq_scale) = SCHED_POWER_SCALE;
+
+static void cpufreq_set_freq_scale(unsigned int cpu, unsigned int cur,
+				   unsigned int max)
+{
+	if (!cur || !max)
+		return;
+
+	per_cpu(cpufreq_freq_scale, cpu) =
+		min_t(unsigned long,
+		      ((unsigned long)cur << SCHED_POWER_SHIFT) / max,
+		      SCHED_POWER_SCALE);
+}
+
+unsigned long cpufreq_scale_freq_capacity(int cpu)
+{
+	return per_cpu(cpufreq_freq_scale, cpu);
+}
+EXPORT_SYMBOL_GPL(cpufreq_scale_freq_capacity);
+
 /**
  * cpufreq_notify_transition - call notifier chain and adjust_jiffies
  * on frequency transition.
@@ -300,6 +327,9 @@ void cpufreq_notify_transition(struct cpufreq_freqs *freqs, unsigned int state)
 		trace_cpu_frequency(freqs->new, freqs->cpu);
 		srcu_notifier_call_chain(&cpufreq_transition_notifier_list,
 				CPUFREQ_POSTCHANGE, freqs);
+		if (likely(policy))
+			cpufreq_set_freq_scale(freqs->cpu, freqs->new,
+					       policy->cpuinfo.max_freq);
 		if (likely(policy) && likely(policy->cpu == freqs->cpu)) {
 			policy->cur = freqs->new;
 			sysfs_notify(&policy->kobj, NULL, "scaling_cur_freq");
@@ -1013,6 +1043,10 @@ static int cpufreq_add_dev(struct device *dev, struct subsys_interface *sif)
 	policy->user_policy.min = policy->min;
 	policy->user_policy.max = policy->max;
 
+	for_each_cpu(j, policy->cpus)
+		cpufreq_set_freq_scale(j, policy->cur,
+				       policy->cpuinfo.max_freq);
+
 	blocking_notifier_call_chain(&cpufreq_policy_notifier_list,
 				     CPUFREQ_START, policy);
 
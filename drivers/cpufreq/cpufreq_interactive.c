@@ -123,6 +123,15 @@ static int timer_slack_val = DEFAULT_TIMER_SLACK;
 
 static bool io_is_busy;
 
+/*
+ * Use the busy time the scheduler accounts in windows of timer_rate
+ * instead of the idle time sampled by the timer. The busy time of a task
+ * moves with it when it migrates, so the destination cpu sees the load at
+ * its next sample instead of ramping up from idle.
+ */
+static bool use_sched_load;
+static DEFINE_MUTEX(sched_window_lock);
+
 /*
  * If the max load among other CPUs is higher than up_threshold_any_cpu_load
  * and if the highest frequency among the other CPUs is higher than
@@ -411,6 +420,12 @@ static void cpufreq_interactive_timer(unsigned long data)
 	cputime_speedadj = pcpu->cputime_speedadj;
 	spin_unlock_irqrestore(&pcpu->load_lock, flags);
 
+	if (use_sched_load) {
+		delta_time = timer_rate;
+		cputime_speedadj = (u64)sched_get_busy(data) *
+				   pcpu->policy->cur;
+	}
+
 	if (WARN_ON_ONCE(!delta_time))
 		goto rearm;
 
@@ -981,7 +996,17 @@ static ssize_t store_timer_rate(struct kobject *kobj,
 	ret = strict_strtoul(buf, 0, &val);
 	if (ret < 0)
 		return ret;
+
+	mutex_lock(&sched_window_lock);
+	if (use_sched_load) {
+		ret = sched_set_window(sched_clock(), val * NSEC_PER_USEC);
+		if (ret) {
+			mutex_unlock(&sched_window_lock);
+			return ret;
+		}
+	}
 	timer_rate = val;
+	mutex_unlock(&sched_window_lock);
 	return count;
 }
 
@@ -1105,6 +1130,39 @@ static ssize_t store_io_is_busy(struct kobject *kobj,
 static struct global_attr io_is_busy_attr = __ATTR(io_is_busy, 0644,
 		show_io_is_busy, store_io_is_busy);
 
+static ssize_t show_use_sched_load(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", use_sched_load);
+}
+
+static ssize_t store_use_sched_load(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&sched_window_lock);
+	if (val && !use_sched_load) {
+		ret = sched_set_window(sched_clock(),
+				       timer_rate * NSEC_PER_USEC);
+		if (ret) {
+			mutex_unlock(&sched_window_lock);
+			return ret;
+		}
+	}
+	use_sched_load = val;
+	mutex_unlock(&sched_window_lock);
+	return count;
+}
+
+static struct global_attr use_sched_load_attr = __ATTR(use_sched_load, 0644,
+		show_use_sched_load, store_use_sched_load);
+
 static ssize_t show_sync_freq(struct kobject *kobj,
 			struct attribute *attr, char *buf)
 {
@@ -1187,6 +1245,7 @@ static struct attribute *interactive_attributes[] = {
 	&boostpulse.attr,
 	&boostpulse_duration.attr,
 	&io_is_busy_attr.attr,
+	&use_sched_load_attr.attr,
 	&sampling_down_factor_attr.attr,
 	&sync_freq_attr.attr,
 	&up_threshold_any_cpu_load_attr.attr,
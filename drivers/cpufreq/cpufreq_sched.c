@@ -0,0 +1,464 @@
+/*
+ * drivers/cpufreq/cpufreq_sched.c
+ *
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Scheduler-driven cpufreq governor. Instead of sampling the idle time
+ * of every cpu from a timer, the governor is handed the utilization of a
+ * cpu by the scheduler each time a task is enqueued or dequeued there and
+ * on every tick, see cpufreq_set_update_util_data(). The frequency
+ * request follows the highest utilization of the cpus sharing a policy,
+ * and is changed from a real-time kthread as the scheduler callback runs
+ * with the runqueue lock held. The scheduler wakes the kthread up when
+ * it drops the lock, see cpufreq_update_util_wake().
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/cpufreq.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/rwsem.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/cpufreq_sched.h>
+
+static int active_count;
+
+struct cpufreq_sched_cpuinfo {
+	struct update_util_data update_util;
+	struct cpufreq_policy *policy;
+	/* last utilization reported for this cpu, protected by update_lock */
+	unsigned long util;
+	unsigned long max;
+	u64 last_update;
+	/*
+	 * The fields below are only used in the entry of policy->cpu, which
+	 * holds the state of the whole policy.
+	 */
+	raw_spinlock_t update_lock;
+	unsigned int target_freq;
+	u64 last_freq_update_time;
+	struct rw_semaphore enable_sem;
+	int governor_enabled;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_sched_cpuinfo, cpuinfo);
+
+/* realtime thread handles frequency scaling */
+static struct task_struct *speedchange_task;
+static cpumask_t speedchange_cpumask;
+static spinlock_t speedchange_cpumask_lock;
+static struct mutex gov_lock;
+
+/* Target load. Lower values result in higher CPU speeds. */
+#define DEFAULT_TARGET_LOAD 80
+static unsigned long target_load = DEFAULT_TARGET_LOAD;
+
+/* Minimum time since the last change before raising the frequency. */
+#define DEFAULT_UP_RATE_LIMIT_US 1000
+static unsigned long up_rate_limit_us = DEFAULT_UP_RATE_LIMIT_US;
+
+/* Minimum time since the last change before lowering the frequency. */
+#define DEFAULT_DOWN_RATE_LIMIT_US 20000
+static unsigned long down_rate_limit_us = DEFAULT_DOWN_RATE_LIMIT_US;
+
+/*
+ * A cpu that has not reported for this long is idle without a tick and
+ * does not contribute to the frequency of its policy anymore.
+ */
+#define STALE_UTIL_NS	(2 * TICK_NSEC)
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+static
+#endif
+struct cpufreq_governor cpufreq_gov_sched = {
+	.name = "sched",
+	.governor = cpufreq_governor_sched,
+	.max_transition_latency = 10000000,
+	.owner = THIS_MODULE,
+};
+
+/*
+ * Frequency at which @util out of @max would make the policy run at
+ * target_load percent of its capacity. The scheduler scales utilization
+ * by the current frequency, so it is relative to the highest frequency
+ * and the right speed is reached in one step rather than by ramping.
+ */
+static unsigned int choose_freq(struct cpufreq_policy *policy,
+				unsigned long util, unsigned long max)
+{
+	struct cpufreq_frequency_table *freq_table;
+	unsigned int freq;
+	unsigned int index;
+
+	freq = div64_u64((u64)policy->cpuinfo.max_freq * util * 100,
+			 (u64)max * target_load);
+
+	freq_table = cpufreq_frequency_get_table(policy->cpu);
+	if (!freq_table)
+		return clamp(freq, policy->min, policy->max);
+
+	if (cpufreq_frequency_table_target(policy, freq_table, freq,
+					   CPUFREQ_RELATION_L, &index))
+		return policy->cur;
+
+	return freq_table[index].frequency;
+}
+
+static void cpufreq_sched_update_util(struct update_util_data *data,
+		u64 time, unsigned long util, unsigned long max)
+{
+	struct cpufreq_sched_cpuinfo *pcpu =
+		container_of(data, struct cpufreq_sched_cpuinfo, update_util);
+	struct cpufreq_policy *policy = pcpu->policy;
+	struct cpufreq_sched_cpuinfo *ppol = &per_cpu(cpuinfo, policy->cpu);
+	unsigned long max_util = 0, max_max = 1;
+	unsigned int new_freq;
+	unsigned long flags;
+	u64 delta;
+	unsigned int j;
+
+	raw_spin_lock(&ppol->update_lock);
+
+	pcpu->util = util;
+	pcpu->max = max;
+	pcpu->last_update = time;
+
+	if (!ppol->governor_enabled)
+		goto out;
+
+	for_each_cpu(j, policy->cpus) {
+		struct cpufreq_sched_cpuinfo *pjcpu = &per_cpu(cpuinfo, j);
+
+		if (pjcpu != pcpu &&
+		    (s64)(time - pjcpu->last_update) > STALE_UTIL_NS)
+			continue;
+
+		if (pjcpu->util * max_max > max_util * pjcpu->max) {
+			max_util = pjcpu->util;
+			max_max = pjcpu->max;
+		}
+	}
+
+	new_freq = choose_freq(policy, max_util, max_max);
+	trace_cpufreq_sched_request(policy->cpu, max_util, max_max,
+				    ppol->target_freq, new_freq);
+
+	if (new_freq == ppol->target_freq)
+		goto out;
+
+	delta = time - ppol->last_freq_update_time;
+	if (new_freq > ppol->target_freq) {
+		if (delta < up_rate_limit_us * NSEC_PER_USEC)
+			goto out;
+	} else {
+		if (delta < down_rate_limit_us * NSEC_PER_USEC)
+			goto out;
+	}
+
+	ppol->target_freq = new_freq;
+	ppol->last_freq_update_time = time;
+
+	spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+	cpumask_set_cpu(policy->cpu, &speedchange_cpumask);
+	spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+	/* the rq lock is held, defer the wake-up */
+	cpufreq_update_util_wake(speedchange_task);
+out:
+	raw_spin_unlock(&ppol->update_lock);
+}
+
+static int cpufreq_sched_speedchange_task(void *data)
+{
+	unsigned int cpu;
+	cpumask_t tmp_mask;
+	unsigned long flags;
+	struct cpufreq_sched_cpuinfo *ppol;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+
+		if (cpumask_empty(&speedchange_cpumask)) {
+			spin_unlock_irqrestore(&speedchange_cpumask_lock,
+					       flags);
+			schedule();
+
+			if (kthread_should_stop())
+				break;
+
+			spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+		}
+
+		set_current_state(TASK_RUNNING);
+		tmp_mask = speedchange_cpumask;
+		cpumask_clear(&speedchange_cpumask);
+		spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+		for_each_cpu(cpu, &tmp_mask) {
+			unsigned int target_freq;
+
+			ppol = &per_cpu(cpuinfo, cpu);
+			if (!down_read_trylock(&ppol->enable_sem))
+				continue;
+			if (!ppol->governor_enabled) {
+				up_read(&ppol->enable_sem);
+				continue;
+			}
+
+			target_freq = ACCESS_ONCE(ppol->target_freq);
+			if (target_freq != ppol->policy->cur)
+				__cpufreq_driver_target(ppol->policy,
+							target_freq,
+							CPUFREQ_RELATION_L);
+			trace_cpufreq_sched_setspeed(cpu, target_freq,
+						     ppol->policy->cur);
+
+			up_read(&ppol->enable_sem);
+		}
+	}
+
+	return 0;
+}
+
+static ssize_t show_target_load(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", target_load);
+}
+
+static ssize_t store_target_load(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	if (!val || val > 100)
+		return -EINVAL;
+	target_load = val;
+	return count;
+}
+
+static struct global_attr target_load_attr = __ATTR(target_load, 0644,
+		show_target_load, store_target_load);
+
+static ssize_t show_up_rate_limit_us(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", up_rate_limit_us);
+}
+
+static ssize_t store_up_rate_limit_us(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	up_rate_limit_us = val;
+	return count;
+}
+
+static struct global_attr up_rate_limit_us_attr = __ATTR(up_rate_limit_us,
+		0644, show_up_rate_limit_us, store_up_rate_limit_us);
+
+static ssize_t show_down_rate_limit_us(struct kobject *kobj,
+			struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", down_rate_limit_us);
+}
+
+static ssize_t store_down_rate_limit_us(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	down_rate_limit_us = val;
+	return count;
+}
+
+static struct global_attr down_rate_limit_us_attr = __ATTR(down_rate_limit_us,
+		0644, show_down_rate_limit_us, store_down_rate_limit_us);
+
+static struct attribute *sched_attributes[] = {
+	&target_load_attr.attr,
+	&up_rate_limit_us_attr.attr,
+	&down_rate_limit_us_attr.attr,
+	NULL,
+};
+
+static struct attribute_group sched_attr_group = {
+	.attrs = sched_attributes,
+	.name = "sched",
+};
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	int rc;
+	unsigned int j;
+	unsigned long flags;
+	struct cpufreq_sched_cpuinfo *pcpu;
+	struct cpufreq_sched_cpuinfo *ppol = &per_cpu(cpuinfo, policy->cpu);
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if (!cpu_online(policy->cpu))
+			return -EINVAL;
+
+		mutex_lock(&gov_lock);
+
+		/*
+		 * Create the sysfs entries before enabling the first
+		 * policy so that a failure leaves nothing to undo.
+		 */
+		if (!active_count) {
+			rc = sysfs_create_group(cpufreq_global_kobject,
+					&sched_attr_group);
+			if (rc) {
+				mutex_unlock(&gov_lock);
+				return rc;
+			}
+		}
+		active_count++;
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->policy = policy;
+			pcpu->util = 0;
+			pcpu->max = SCHED_POWER_SCALE;
+			pcpu->last_update = 0;
+		}
+
+		down_write(&ppol->enable_sem);
+		ppol->target_freq = policy->cur;
+		ppol->last_freq_update_time = 0;
+		ppol->governor_enabled = 1;
+		up_write(&ppol->enable_sem);
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			cpufreq_set_update_util_data(j, &pcpu->update_util);
+		}
+
+		mutex_unlock(&gov_lock);
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		mutex_lock(&gov_lock);
+
+		for_each_cpu(j, policy->cpus)
+			cpufreq_set_update_util_data(j, NULL);
+		synchronize_sched();
+
+		down_write(&ppol->enable_sem);
+		ppol->governor_enabled = 0;
+		up_write(&ppol->enable_sem);
+
+		if (--active_count == 0)
+			sysfs_remove_group(cpufreq_global_kobject,
+					&sched_attr_group);
+
+		mutex_unlock(&gov_lock);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		if (policy->max < policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->min, CPUFREQ_RELATION_L);
+
+		raw_spin_lock_irqsave(&ppol->update_lock, flags);
+		if (policy->max < ppol->target_freq)
+			ppol->target_freq = policy->max;
+		else if (policy->min > ppol->target_freq)
+			ppol->target_freq = policy->min;
+		raw_spin_unlock_irqrestore(&ppol->update_lock, flags);
+		break;
+	}
+	return 0;
+}
+
+static int __init cpufreq_sched_init(void)
+{
+	unsigned int i;
+	int ret;
+	struct cpufreq_sched_cpuinfo *pcpu;
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO-1 };
+
+	for_each_possible_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+		pcpu->update_util.func = cpufreq_sched_update_util;
+		raw_spin_lock_init(&pcpu->update_lock);
+		init_rwsem(&pcpu->enable_sem);
+	}
+
+	spin_lock_init(&speedchange_cpumask_lock);
+	mutex_init(&gov_lock);
+	speedchange_task =
+		kthread_create(cpufreq_sched_speedchange_task, NULL,
+			       "cfsched");
+	if (IS_ERR(speedchange_task))
+		return PTR_ERR(speedchange_task);
+
+	sched_setscheduler_nocheck(speedchange_task, SCHED_FIFO, &param);
+	get_task_struct(speedchange_task);
+
+	/* NB: wake up so the thread does not look hung to the freezer */
+	wake_up_process(speedchange_task);
+
+	ret = cpufreq_register_governor(&cpufreq_gov_sched);
+	if (ret) {
+		kthread_stop(speedchange_task);
+		put_task_struct(speedchange_task);
+	}
+
+	return ret;
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+fs_initcall(cpufreq_sched_init);
+#else
+module_init(cpufreq_sched_init);
+#endif
+
+static void __exit cpufreq_sched_exit(void)
+{
+	cpufreq_unregister_governor(&cpufreq_gov_sched);
+	cpufreq_update_util_cancel_wake(speedchange_task);
+	kthread_stop(speedchange_task);
+	put_task_struct(speedchange_task);
+}
+
+module_exit(cpufreq_sched_exit);
+
+MODULE_DESCRIPTION("'cpufreq_sched' - A cpufreq governor driven by "
+	"scheduler utilization updates");
+MODULE_LICENSE("GPL v2");
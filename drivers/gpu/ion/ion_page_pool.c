@@ -29,10 +29,23 @@ struct ion_page_pool_item {
 	struct list_head list;
 };
 
+/* Number of pages removed from a pool at once by the shrinker */
+#define ION_PAGE_POOL_BATCH 32
+
+static void ion_page_pool_sync_page(struct ion_page_pool *pool,
+				    struct page *page)
+{
+	struct scatterlist sg;
+
+	sg_init_table(&sg, 1);
+	sg_set_page(&sg, page, PAGE_SIZE << pool->order, 0);
+	sg_dma_address(&sg) = sg_phys(&sg);
+	dma_sync_sg_for_device(NULL, &sg, 1, DMA_BIDIRECTIONAL);
+}
+
 static void *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
 {
 	struct page *page;
-	struct scatterlist sg;
 
 	page = alloc_pages(pool->gfp_mask & ~__GFP_ZERO, pool->order);
 
@@ -44,10 +57,7 @@ static void *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
 				page, pool->order, pool->should_invalidate))
 			goto error_free_pages;
 
-	sg_init_table(&sg, 1);
-	sg_set_page(&sg, page, PAGE_SIZE << pool->order, 0);
-	sg_dma_address(&sg) = sg_phys(&sg);
-	dma_sync_sg_for_device(NULL, &sg, 1, DMA_BIDIRECTIONAL);
+	ion_page_pool_sync_page(pool, page);
 
 	return page;
 error_free_pages:
@@ -61,6 +71,20 @@ static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 	__free_pages(page, pool->order);
 }
 
+static void ion_page_pool_free_pages_bulk(struct ion_page_pool *pool,
+					  struct page **pages, int nr_pages)
+{
+	int i;
+
+	if (!pool->order) {
+		free_pages_bulk(pages, nr_pages);
+		return;
+	}
+
+	for (i = 0; i < nr_pages; i++)
+		ion_page_pool_free_pages(pool, pages[i]);
+}
+
 static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 {
 	struct ion_page_pool_item *item;
@@ -124,6 +148,52 @@ void *ion_page_pool_alloc(struct ion_page_pool *pool)
 	return page;
 }
 
+/**
+ * ion_page_pool_alloc_bulk - allocate several pages from an order-0 pool
+ * @pool:		the pool
+ * @pages:		array the pages are stored in
+ * @nr_pages:		number of pages to allocate
+ *
+ * Pages are taken from the pool first, under a single hold of its mutex.
+ * The rest are allocated from the page allocator in bulk and zeroed with
+ * a single vmap.
+ *
+ * returns the number of pages stored in @pages
+ */
+int ion_page_pool_alloc_bulk(struct ion_page_pool *pool, struct page **pages,
+			     int nr_pages)
+{
+	int nr = 0, nr_new, i;
+
+	BUG_ON(!pool || pool->order);
+
+	mutex_lock(&pool->mutex);
+	while (nr < nr_pages && pool->high_count)
+		pages[nr++] = ion_page_pool_remove(pool, true);
+	while (nr < nr_pages && pool->low_count)
+		pages[nr++] = ion_page_pool_remove(pool, false);
+	mutex_unlock(&pool->mutex);
+
+	if (nr == nr_pages)
+		return nr;
+
+	nr_new = alloc_pages_bulk(pool->gfp_mask & ~__GFP_ZERO,
+				  nr_pages - nr, &pages[nr]);
+	if (!nr_new)
+		return nr;
+
+	if ((pool->gfp_mask & __GFP_ZERO) &&
+	    ion_heap_pages_zero(&pages[nr], nr_new, pool->should_invalidate)) {
+		free_pages_bulk(&pages[nr], nr_new);
+		return nr;
+	}
+
+	for (i = nr; i < nr + nr_new; i++)
+		ion_page_pool_sync_page(pool, pages[i]);
+
+	return nr + nr_new;
+}
+
 void ion_page_pool_free(struct ion_page_pool *pool, struct page* page)
 {
 	int ret;
@@ -147,7 +217,7 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 				int nr_to_scan)
 {
 	int nr_freed = 0;
-	int i;
+	int i, n;
 	bool high;
 
 	high = gfp_mask & __GFP_HIGHMEM;
@@ -155,21 +225,24 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, high);
 
-	for (i = 0; i < nr_to_scan; i++) {
-		struct page *page;
+	for (i = 0; i < nr_to_scan; i += n) {
+		struct page *pages[ION_PAGE_POOL_BATCH];
 
 		mutex_lock(&pool->mutex);
-		if (high && pool->high_count) {
-			page = ion_page_pool_remove(pool, true);
-		} else if (pool->low_count) {
-			page = ion_page_pool_remove(pool, false);
-		} else {
-			mutex_unlock(&pool->mutex);
-			break;
+		for (n = 0; n < ION_PAGE_POOL_BATCH && i + n < nr_to_scan;
+		     n++) {
+			if (high && pool->high_count)
+				pages[n] = ion_page_pool_remove(pool, true);
+			else if (pool->low_count)
+				pages[n] = ion_page_pool_remove(pool, false);
+			else
+				break;
 		}
 		mutex_unlock(&pool->mutex);
-		ion_page_pool_free_pages(pool, page);
-		nr_freed += (1 << pool->order);
+		if (!n)
+			break;
+		ion_page_pool_free_pages_bulk(pool, pages, n);
+		nr_freed += n << pool->order;
 	}
 
 	return nr_freed;
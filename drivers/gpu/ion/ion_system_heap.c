@@ -140,6 +140,55 @@ static struct page_info *alloc_largest_available(struct ion_system_heap *heap,
 	return NULL;
 }
 
+/* Number of order-0 pages allocated or freed in one batch */
+#define ION_SYSTEM_HEAP_BATCH 32
+
+/*
+ * Allocate the 4K pages at the end of a buffer from the order-0 pool in
+ * batches, see ion_page_pool_alloc_bulk(). Returns the number of pages
+ * added to @pages_list.
+ */
+static unsigned long alloc_order0_bulk(struct ion_system_heap *heap,
+				       struct ion_buffer *buffer,
+				       unsigned long nr_pages,
+				       struct list_head *pages_list)
+{
+	struct page *pages[ION_SYSTEM_HEAP_BATCH];
+	struct ion_page_pool *pool;
+	struct page_info *info;
+	unsigned long nr = 0;
+	int n, got, i;
+
+	if (ion_buffer_cached(buffer))
+		pool = heap->cached_pools[order_to_index(0)];
+	else
+		pool = heap->uncached_pools[order_to_index(0)];
+
+	while (nr < nr_pages) {
+		n = min_t(unsigned long, nr_pages - nr, ARRAY_SIZE(pages));
+		got = ion_page_pool_alloc_bulk(pool, pages, n);
+
+		for (i = 0; i < got; i++) {
+			info = kmalloc(sizeof(struct page_info), GFP_KERNEL);
+			if (!info) {
+				for (; i < got; i++)
+					free_buffer_page(heap, buffer,
+							 pages[i], 0);
+				return nr;
+			}
+			info->page = pages[i];
+			info->order = 0;
+			list_add_tail(&info->list, pages_list);
+			nr++;
+		}
+
+		if (got < n)
+			break;
+	}
+
+	return nr;
+}
+
 static int ion_system_heap_allocate(struct ion_heap *heap,
 				     struct ion_buffer *buffer,
 				     unsigned long size, unsigned long align,
@@ -160,6 +209,20 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 
 	INIT_LIST_HEAD(&pages);
 	while (size_remaining > 0) {
+		/* Only 4K pages left to allocate: get them in bulk */
+		if (max_order == 0 ||
+		    size_remaining < order_to_size(orders[num_orders - 2])) {
+			unsigned long nr_pages = size_remaining >> PAGE_SHIFT;
+			unsigned long nr;
+
+			nr = alloc_order0_bulk(sys_heap, buffer, nr_pages,
+					       &pages);
+			i += nr;
+			if (nr < nr_pages)
+				goto err;
+			break;
+		}
+
 		info = alloc_largest_available(sys_heap, buffer, size_remaining, max_order);
 		if (!info)
 			goto err;
@@ -219,15 +282,29 @@ void ion_system_heap_free(struct ion_buffer *buffer)
 							heap);
 	struct sg_table *table = buffer->sg_table;
 	struct scatterlist *sg;
-	LIST_HEAD(pages);
-	int i;
+	struct page *batch[ION_SYSTEM_HEAP_BATCH];
+	bool from_shrinker = buffer->flags & ION_FLAG_FREED_FROM_SHRINKER;
+	int i, nr = 0;
 
-	if (!(buffer->flags & ION_FLAG_FREED_FROM_SHRINKER))
+	if (!from_shrinker)
 		ion_heap_buffer_zero(buffer);
 
-	for_each_sg(table->sgl, sg, table->nents, i)
-		free_buffer_page(sys_heap, buffer, sg_page(sg),
-				get_order(sg_dma_len(sg)));
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		unsigned int order = get_order(sg_dma_len(sg));
+
+		/* 4K pages bypassing the pools go back in batches */
+		if (from_shrinker && !order) {
+			batch[nr++] = sg_page(sg);
+			if (nr == ION_SYSTEM_HEAP_BATCH) {
+				free_pages_bulk(batch, nr);
+				nr = 0;
+			}
+			continue;
+		}
+		free_buffer_page(sys_heap, buffer, sg_page(sg), order);
+	}
+	if (nr)
+		free_pages_bulk(batch, nr);
 	sg_free_table(table);
 	kfree(table);
 }
@@ -393,11 +393,16 @@ static int kgsl_page_alloc_vmflags(struct kgsl_memdesc *memdesc)
 	return VM_RESERVED | VM_DONTEXPAND;
 }
 
+/* Number of 4K pages handed back to the page allocator at once */
+#define KGSL_FREE_BATCH 32
+
 static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 {
 	int i = 0;
 	struct scatterlist *sg;
 	int sglen = memdesc->sglen;
+	struct page *batch[KGSL_FREE_BATCH];
+	int nr = 0;
 
 	kgsl_driver.stats.page_alloc -= memdesc->size;
 
@@ -406,8 +411,19 @@ static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 		kgsl_driver.stats.vmalloc -= memdesc->size;
 	}
 	if (memdesc->sg)
-		for_each_sg(memdesc->sg, sg, sglen, i)
-			__free_pages(sg_page(sg), get_order(sg->length));
+		for_each_sg(memdesc->sg, sg, sglen, i) {
+			if (sg->length != PAGE_SIZE) {
+				__free_pages(sg_page(sg), get_order(sg->length));
+				continue;
+			}
+			batch[nr++] = sg_page(sg);
+			if (nr == KGSL_FREE_BATCH) {
+				free_pages_bulk(batch, nr);
+				nr = 0;
+			}
+		}
+	if (nr)
+		free_pages_bulk(batch, nr);
 }
 
 static int kgsl_contiguous_vmflags(struct kgsl_memdesc *memdesc)
@@ -646,6 +662,29 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 		else
 			gfp_mask |= GFP_KERNEL;
 
+		/* Get all the remaining 4K pages in one go */
+		if (page_size == PAGE_SIZE) {
+			int npages = len >> PAGE_SHIFT;
+			int nr = alloc_pages_bulk(gfp_mask, npages,
+						  &pages[pcount]);
+
+			for (j = 0; j < nr; j++)
+				sg_set_page(&memdesc->sg[sglen++],
+					    pages[pcount + j], PAGE_SIZE, 0);
+			pcount += nr;
+			len -= nr << PAGE_SHIFT;
+
+			if (nr < npages) {
+				KGSL_CORE_ERR(
+					"Out of memory: only allocated %dKB of %dKB requested\n",
+					(size - len) >> 10, size >> 10);
+
+				ret = -ENOMEM;
+				goto done;
+			}
+			continue;
+		}
+
 		page = alloc_pages(gfp_mask, get_order(page_size));
 
 		if (page == NULL) {
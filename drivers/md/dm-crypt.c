@@ -17,6 +17,8 @@
 #include <linux/slab.h>
 #include <linux/crypto.h>
 #include <linux/workqueue.h>
+#include <linux/kthread.h>
+#include <linux/rbtree.h>
 #include <linux/backing-dev.h>
 #include <linux/percpu.h>
 #include <linux/atomic.h>
@@ -31,19 +33,24 @@
 
 #define DM_MSG_PREFIX "crypt"
 
+struct dm_crypt_io;
+
 /*
  * context holding the current state of a multi-part conversion
  */
 struct convert_context {
 	struct completion restart;
+	struct dm_crypt_io *io;
 	struct bio *bio_in;
 	struct bio *bio_out;
 	unsigned int offset_in;
 	unsigned int offset_out;
 	unsigned int idx_in;
 	unsigned int idx_out;
+	unsigned int nr_sectors;
 	sector_t sector;
 	atomic_t pending;
+	struct ablkcipher_request *req;
 };
 
 /*
@@ -60,6 +67,17 @@ struct dm_crypt_io {
 	int error;
 	sector_t sector;
 	struct dm_crypt_io *base_io;
+
+	struct rb_node rb_node;
+};
+
+/*
+ * A part of a large bio converted by kcryptd on another cpu, it holds
+ * a reference on the pending count of io->ctx until it is finished.
+ */
+struct dm_crypt_chunk {
+	struct work_struct work;
+	struct convert_context ctx;
 };
 
 struct dm_crypt_request {
@@ -102,13 +120,13 @@ struct iv_lmk_private {
  * Crypt: maps a linear range of a block device
  * and encrypts / decrypts at the same time.
  */
-enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID };
+enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID,
+	     DM_CRYPT_NO_READ_WORKQUEUE };
 
 /*
  * Duplicated per-CPU state for cipher.
  */
 struct crypt_cpu {
-	struct ablkcipher_request *req;
 	/* ESSIV: struct crypto_cipher *essiv_tfm */
 	void *iv_private;
 	struct crypto_ablkcipher *tfms[0];
@@ -134,6 +152,12 @@ struct crypt_config {
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
 
+	/* encrypted writes waiting for dmcrypt_write, sorted by sector */
+	struct task_struct *write_thread;
+	wait_queue_head_t write_thread_wait;
+	spinlock_t write_thread_lock;
+	struct rb_root write_tree;
+
 	char *cipher;
 	char *cipher_string;
 
@@ -177,6 +201,9 @@ struct crypt_config {
 #define MIN_IOS        16
 #define MIN_POOL_PAGES 32
 
+/* smallest part of a bio worth handing to kcryptd on another cpu */
+#define MIN_CHUNK_SECTORS 64
+
 static struct kmem_cache *_crypt_io_pool;
 
 static void clone_init(struct dm_crypt_io *, struct bio *);
@@ -745,19 +772,108 @@ static int crypt_convert_block(struct crypt_config *cc,
 static void kcryptd_async_done(struct crypto_async_request *async_req,
 			       int error);
 
+/*
+ * The request belongs to the conversion context rather than to the cpu,
+ * several contexts can be converted on one cpu at the same time.
+ * Reads decrypted from bio completion must not sleep, they come here
+ * with a request already allocated and only use synchronous ciphers.
+ */
 static void crypt_alloc_req(struct crypt_config *cc,
 			    struct convert_context *ctx)
 {
 	struct crypt_cpu *this_cc = this_crypt_config(cc);
 	unsigned key_index = ctx->sector & (cc->tfms_count - 1);
+	u32 flags = CRYPTO_TFM_REQ_MAY_BACKLOG;
+
+	if (!in_interrupt())
+		flags |= CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	if (!ctx->req)
+		ctx->req = mempool_alloc(cc->req_pool, GFP_NOIO);
+
+	ablkcipher_request_set_tfm(ctx->req, this_cc->tfms[key_index]);
+	ablkcipher_request_set_callback(ctx->req, flags,
+	    kcryptd_async_done, dmreq_of_req(cc, ctx->req));
+}
+
+static void crypt_bio_skip(struct bio *bio, unsigned int *idx,
+			   unsigned int *offset, unsigned int bytes)
+{
+	struct bio_vec *bv;
+	unsigned int len;
+
+	while (bytes) {
+		bv = bio_iovec_idx(bio, *idx);
+		len = min(bytes, bv->bv_len - *offset);
+
+		bytes -= len;
+		*offset += len;
+		if (*offset >= bv->bv_len) {
+			*offset = 0;
+			(*idx)++;
+		}
+	}
+}
+
+/*
+ * Move a conversion context forward without converting anything, in the
+ * same steps crypt_convert_block() takes.
+ */
+static void crypt_convert_skip(struct convert_context *ctx,
+			       unsigned int sectors)
+{
+	crypt_bio_skip(ctx->bio_in, &ctx->idx_in, &ctx->offset_in,
+		       sectors << SECTOR_SHIFT);
+	crypt_bio_skip(ctx->bio_out, &ctx->idx_out, &ctx->offset_out,
+		       sectors << SECTOR_SHIFT);
+	ctx->sector += sectors;
+	ctx->nr_sectors -= sectors;
+}
+
+static void kcryptd_crypt_chunk(struct work_struct *work);
+
+/*
+ * Spread a large conversion over the online cpus: the leading parts are
+ * handed to kcryptd on the other cpus and ctx keeps the last one, so it
+ * still ends up at the end of the bios, which the write path relies on.
+ * Must be called with a reference held on ctx->pending. Nothing here
+ * sleeps, if a chunk cannot be allocated the rest is converted in place.
+ */
+static void crypt_convert_split(struct crypt_config *cc,
+				struct convert_context *ctx)
+{
+	struct dm_crypt_chunk *chunk;
+	unsigned int chunks, chunk_sectors;
+	int cpu;
+
+	chunks = min(num_online_cpus(), ctx->nr_sectors / MIN_CHUNK_SECTORS);
+	if (chunks < 2)
+		return;
+
+	chunk_sectors = round_down(ctx->nr_sectors / chunks,
+				   PAGE_SIZE >> SECTOR_SHIFT);
+	cpu = raw_smp_processor_id();
+
+	while (--chunks) {
+		chunk = kmalloc(sizeof(*chunk), GFP_NOWAIT | __GFP_NOWARN);
+		if (!chunk)
+			break;
 
-	if (!this_cc->req)
-		this_cc->req = mempool_alloc(cc->req_pool, GFP_NOIO);
+		chunk->ctx = *ctx;
+		init_completion(&chunk->ctx.restart);
+		chunk->ctx.nr_sectors = chunk_sectors;
+		chunk->ctx.req = NULL;
 
-	ablkcipher_request_set_tfm(this_cc->req, this_cc->tfms[key_index]);
-	ablkcipher_request_set_callback(this_cc->req,
-	    CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
-	    kcryptd_async_done, dmreq_of_req(cc, this_cc->req));
+		crypt_convert_skip(ctx, chunk_sectors);
+		atomic_inc(&ctx->pending);
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+
+		INIT_WORK(&chunk->work, kcryptd_crypt_chunk);
+		queue_work_on(cpu, cc->crypt_queue, &chunk->work);
+	}
 }
 
 /*
@@ -766,19 +882,22 @@ static void crypt_alloc_req(struct crypt_config *cc,
 static int crypt_convert(struct crypt_config *cc,
 			 struct convert_context *ctx)
 {
-	struct crypt_cpu *this_cc = this_crypt_config(cc);
 	int r;
 
 	atomic_set(&ctx->pending, 1);
 
-	while(ctx->idx_in < ctx->bio_in->bi_vcnt &&
+	if (ctx == &ctx->io->ctx)
+		crypt_convert_split(cc, ctx);
+
+	while(ctx->nr_sectors &&
+	      ctx->idx_in < ctx->bio_in->bi_vcnt &&
 	      ctx->idx_out < ctx->bio_out->bi_vcnt) {
 
 		crypt_alloc_req(cc, ctx);
 
 		atomic_inc(&ctx->pending);
 
-		r = crypt_convert_block(cc, ctx, this_cc->req);
+		r = crypt_convert_block(cc, ctx, ctx->req);
 
 		switch (r) {
 		/* async */
@@ -787,25 +906,34 @@ static int crypt_convert(struct crypt_config *cc,
 			INIT_COMPLETION(ctx->restart);
 			/* fall through*/
 		case -EINPROGRESS:
-			this_cc->req = NULL;
+			ctx->req = NULL;
 			ctx->sector++;
+			ctx->nr_sectors--;
 			continue;
 
 		/* sync */
 		case 0:
 			atomic_dec(&ctx->pending);
 			ctx->sector++;
-			cond_resched();
+			ctx->nr_sectors--;
+			if (!in_interrupt())
+				cond_resched();
 			continue;
 
 		/* error */
 		default:
 			atomic_dec(&ctx->pending);
-			return r;
+			goto out;
 		}
 	}
+	r = 0;
 
-	return 0;
+out:
+	if (ctx->req) {
+		mempool_free(ctx->req, cc->req_pool);
+		ctx->req = NULL;
+	}
+	return r;
 }
 
 static void dm_crypt_bio_destructor(struct bio *bio)
@@ -896,6 +1024,8 @@ static struct dm_crypt_io *crypt_io_alloc(struct dm_target *ti,
 	io->sector = sector;
 	io->error = 0;
 	io->base_io = NULL;
+	io->ctx.io = io;
+	io->ctx.req = NULL;
 	atomic_set(&io->pending, 0);
 
 	return io;
@@ -938,9 +1068,12 @@ static void crypt_dec_pending(struct dm_crypt_io *io)
  * Needed because it would be very unwise to do decryption in an
  * interrupt context.
  *
- * kcryptd performs the actual encryption or decryption.
+ * kcryptd performs the actual encryption or decryption. Large bios
+ * are split into chunks that are converted by kcryptd on several cpus.
  *
- * kcryptd_io performs the IO submission.
+ * kcryptd_io performs the read IO submission. Encrypted writes are
+ * submitted by the dmcrypt_write thread in sector order, since the
+ * chunks and bios encrypted in parallel finish in any order.
  *
  * They must be separated as otherwise the final stages could be
  * starved by new requests which can block in the first stages due
@@ -949,6 +1082,30 @@ static void crypt_dec_pending(struct dm_crypt_io *io)
  * The work is done per CPU global for all dm-crypt instances.
  * They should not depend on each other and do not block.
  */
+static void kcryptd_crypt_read_convert(struct dm_crypt_io *io);
+
+/*
+ * With no_read_workqueue and a synchronous cipher, decrypt reads right
+ * in the completion of the clone, unless that runs in hard interrupt
+ * context. This saves a context switch and the kcryptd queueing latency
+ * on every read.
+ */
+static bool kcryptd_crypt_read_inline(struct dm_crypt_io *io)
+{
+	struct crypt_config *cc = io->target->private;
+
+	if (!test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags) ||
+	    in_irq() || irqs_disabled())
+		return false;
+
+	io->ctx.req = mempool_alloc(cc->req_pool, GFP_ATOMIC);
+	if (!io->ctx.req)
+		return false;
+
+	kcryptd_crypt_read_convert(io);
+	return true;
+}
+
 static void crypt_endio(struct bio *clone, int error)
 {
 	struct dm_crypt_io *io = clone->bi_private;
@@ -967,7 +1124,8 @@ static void crypt_endio(struct bio *clone, int error)
 	bio_put(clone);
 
 	if (rw == READ && !error) {
-		kcryptd_queue_crypt(io);
+		if (!kcryptd_crypt_read_inline(io))
+			kcryptd_queue_crypt(io);
 		return;
 	}
 
@@ -1027,13 +1185,10 @@ static void kcryptd_io(struct work_struct *work)
 {
 	struct dm_crypt_io *io = container_of(work, struct dm_crypt_io, work);
 
-	if (bio_data_dir(io->base_bio) == READ) {
-		crypt_inc_pending(io);
-		if (kcryptd_io_read(io, GFP_NOIO))
-			io->error = -ENOMEM;
-		crypt_dec_pending(io);
-	} else
-		kcryptd_io_write(io);
+	crypt_inc_pending(io);
+	if (kcryptd_io_read(io, GFP_NOIO))
+		io->error = -ENOMEM;
+	crypt_dec_pending(io);
 }
 
 static void kcryptd_queue_io(struct dm_crypt_io *io)
@@ -1044,10 +1199,47 @@ static void kcryptd_queue_io(struct dm_crypt_io *io)
 	queue_work(cc->io_queue, &io->work);
 }
 
-static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
+/*
+ * Submit all encrypted writes queued so far, lowest sector first, so that
+ * the device sees sequential writes in order even though they were
+ * encrypted in parallel.
+ */
+static int dmcrypt_write(void *data)
+{
+	struct crypt_config *cc = data;
+	struct dm_crypt_io *io;
+	struct rb_root write_tree;
+	struct rb_node *node;
+	struct blk_plug plug;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(cc->write_thread_wait,
+					 !RB_EMPTY_ROOT(&cc->write_tree) ||
+					 kthread_should_stop());
+
+		spin_lock_irq(&cc->write_thread_lock);
+		write_tree = cc->write_tree;
+		cc->write_tree = RB_ROOT;
+		spin_unlock_irq(&cc->write_thread_lock);
+
+		blk_start_plug(&plug);
+		while ((node = rb_first(&write_tree))) {
+			io = rb_entry(node, struct dm_crypt_io, rb_node);
+			rb_erase(node, &write_tree);
+			kcryptd_io_write(io);
+		}
+		blk_finish_plug(&plug);
+	}
+
+	return 0;
+}
+
+static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io)
 {
 	struct bio *clone = io->ctx.bio_out;
 	struct crypt_config *cc = io->target->private;
+	struct rb_node **rbp, *parent;
+	unsigned long flags;
 
 	if (unlikely(io->error < 0)) {
 		crypt_free_buffer_pages(cc, clone);
@@ -1061,10 +1253,22 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 
 	clone->bi_sector = cc->start + io->sector;
 
-	if (async)
-		kcryptd_queue_io(io);
-	else
-		generic_make_request(clone);
+	spin_lock_irqsave(&cc->write_thread_lock, flags);
+	rbp = &cc->write_tree.rb_node;
+	parent = NULL;
+	while (*rbp) {
+		parent = *rbp;
+		if (io->sector < rb_entry(parent, struct dm_crypt_io,
+					  rb_node)->sector)
+			rbp = &parent->rb_left;
+		else
+			rbp = &parent->rb_right;
+	}
+	rb_link_node(&io->rb_node, parent, rbp);
+	rb_insert_color(&io->rb_node, &cc->write_tree);
+	spin_unlock_irqrestore(&cc->write_thread_lock, flags);
+
+	wake_up(&cc->write_thread_wait);
 }
 
 static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
@@ -1097,6 +1301,7 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 
 		io->ctx.bio_out = clone;
 		io->ctx.idx_out = 0;
+		io->ctx.nr_sectors = bio_sectors(clone);
 
 		remaining -= clone->bi_size;
 		sector += bio_sectors(clone);
@@ -1111,7 +1316,7 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 
 		/* Encryption was already finished, submit io now */
 		if (crypt_finished) {
-			kcryptd_crypt_write_io_submit(io, 0);
+			kcryptd_crypt_write_io_submit(io);
 
 			/*
 			 * If there was an error, do not try next fragments.
@@ -1119,8 +1324,6 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 			 */
 			if (unlikely(r < 0))
 				break;
-
-			io->sector = sector;
 		}
 
 		/*
@@ -1131,10 +1334,11 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 			congestion_wait(BLK_RW_ASYNC, HZ/100);
 
 		/*
-		 * With async crypto it is unsafe to share the crypto context
-		 * between fragments, so switch to a new dm_crypt_io structure.
+		 * A submitted fragment waits in the write tree and an async
+		 * or split one is still being converted, so the next fragment
+		 * always gets a new dm_crypt_io structure.
 		 */
-		if (unlikely(!crypt_finished && remaining)) {
+		if (unlikely(remaining)) {
 			new_io = crypt_io_alloc(io->target, io->base_bio,
 						sector);
 			crypt_inc_pending(new_io);
@@ -1176,6 +1380,7 @@ static void kcryptd_crypt_read_convert(struct dm_crypt_io *io)
 
 	crypt_convert_init(cc, &io->ctx, io->base_bio, io->base_bio,
 			   io->sector);
+	io->ctx.nr_sectors = bio_sectors(io->base_bio);
 
 	r = crypt_convert(cc, &io->ctx);
 	if (r < 0)
@@ -1187,12 +1392,46 @@ static void kcryptd_crypt_read_convert(struct dm_crypt_io *io)
 	crypt_dec_pending(io);
 }
 
+/*
+ * The last request of ctx has finished. A chunk drops its reference on
+ * the context of its io, which is finished when that was the last one.
+ */
+static void kcryptd_crypt_ctx_done(struct convert_context *ctx)
+{
+	struct dm_crypt_io *io = ctx->io;
+
+	if (ctx != &io->ctx) {
+		kfree(container_of(ctx, struct dm_crypt_chunk, ctx));
+		if (!atomic_dec_and_test(&io->ctx.pending))
+			return;
+	}
+
+	if (bio_data_dir(io->base_bio) == READ)
+		kcryptd_crypt_read_done(io);
+	else
+		kcryptd_crypt_write_io_submit(io);
+}
+
+static void kcryptd_crypt_chunk(struct work_struct *work)
+{
+	struct dm_crypt_chunk *chunk = container_of(work, struct dm_crypt_chunk,
+						    work);
+	struct convert_context *ctx = &chunk->ctx;
+	struct dm_crypt_io *io = ctx->io;
+
+	if (crypt_convert(io->target->private, ctx) < 0)
+		io->error = -EIO;
+
+	if (atomic_dec_and_test(&ctx->pending))
+		kcryptd_crypt_ctx_done(ctx);
+}
+
 static void kcryptd_async_done(struct crypto_async_request *async_req,
 			       int error)
 {
 	struct dm_crypt_request *dmreq = async_req->data;
 	struct convert_context *ctx = dmreq->ctx;
-	struct dm_crypt_io *io = container_of(ctx, struct dm_crypt_io, ctx);
+	struct dm_crypt_io *io = ctx->io;
 	struct crypt_config *cc = io->target->private;
 
 	if (error == -EINPROGRESS) {
@@ -1211,10 +1450,7 @@ static void kcryptd_async_done(struct crypto_async_request *async_req,
 	if (!atomic_dec_and_test(&ctx->pending))
 		return;
 
-	if (bio_data_dir(io->base_bio) == READ)
-		kcryptd_crypt_read_done(io);
-	else
-		kcryptd_crypt_write_io_submit(io, 1);
+	kcryptd_crypt_ctx_done(ctx);
 }
 
 static void kcryptd_crypt(struct work_struct *work)
@@ -1369,6 +1605,9 @@ static void crypt_dtr(struct dm_target *ti)
 	if (!cc)
 		return;
 
+	if (cc->write_thread)
+		kthread_stop(cc->write_thread);
+
 	if (cc->io_queue)
 		destroy_workqueue(cc->io_queue);
 	if (cc->crypt_queue)
@@ -1377,8 +1616,6 @@ static void crypt_dtr(struct dm_target *ti)
 	if (cc->cpu)
 		for_each_possible_cpu(cpu) {
 			cpu_cc = per_cpu_ptr(cc->cpu, cpu);
-			if (cpu_cc->req)
-				mempool_free(cpu_cc->req, cc->req_pool);
 			crypt_free_tfms(cc, cpu);
 		}
 
@@ -1578,6 +1815,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 {
 	struct crypt_config *cc;
 	unsigned int key_size, opt_params;
+	bool no_read_workqueue = false;
 	unsigned long long tmpll;
 	int ret;
 	struct dm_arg_set as;
@@ -1585,7 +1823,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	char dummy;
 
 	static struct dm_arg _args[] = {
-		{0, 1, "Invalid number of feature args"},
+		{0, 2, "Invalid number of feature args"},
 	};
 
 	if (argc < 5) {
@@ -1669,18 +1907,39 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		if (ret)
 			goto bad;
 
-		opt_string = dm_shift_arg(&as);
+		while (opt_params--) {
+			opt_string = dm_shift_arg(&as);
+			if (!opt_string) {
+				ti->error = "Not enough feature arguments";
+				ret = -EINVAL;
+				goto bad;
+			}
 
-		if (opt_params == 1 && opt_string &&
-		    !strcasecmp(opt_string, "allow_discards"))
-			ti->num_discard_requests = 1;
-		else if (opt_params) {
-			ret = -EINVAL;
-			ti->error = "Invalid feature arguments";
-			goto bad;
+			if (!strcasecmp(opt_string, "allow_discards"))
+				ti->num_discard_requests = 1;
+			else if (!strcasecmp(opt_string, "no_read_workqueue"))
+				no_read_workqueue = true;
+			else {
+				ti->error = "Invalid feature arguments";
+				ret = -EINVAL;
+				goto bad;
+			}
 		}
 	}
 
+	/*
+	 * Reads can only be decrypted in the bio completion if the cipher
+	 * finishes synchronously, an async one would complete from yet
+	 * another context anyway.
+	 */
+	if (no_read_workqueue) {
+		if (crypto_ablkcipher_tfm(any_tfm(cc))->__crt_alg->cra_flags &
+		    CRYPTO_ALG_ASYNC)
+			DMWARN("Cipher is asynchronous, ignoring no_read_workqueue");
+		else
+			set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
+	}
+
 	ret = -ENOMEM;
 #if 1
 	cc->io_queue = create_singlethread_workqueue("kcryptd_io");
@@ -1694,20 +1953,30 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		ti->error = "Couldn't create kcryptd io queue";
 		goto bad;
 	}
-#if 1
-	cc->crypt_queue = create_singlethread_workqueue("kcryptd");
-#else
+	/* per cpu, so that the chunks of one bio are converted in parallel */
 	cc->crypt_queue = alloc_workqueue("kcryptd",
 					  WQ_NON_REENTRANT|
 					  WQ_CPU_INTENSIVE|
 					  WQ_MEM_RECLAIM,
 					  1);
-#endif
 	if (!cc->crypt_queue) {
 		ti->error = "Couldn't create kcryptd queue";
 		goto bad;
 	}
 
+	spin_lock_init(&cc->write_thread_lock);
+	init_waitqueue_head(&cc->write_thread_wait);
+	cc->write_tree = RB_ROOT;
+
+	cc->write_thread = kthread_create(dmcrypt_write, cc, "dmcrypt_write");
+	if (IS_ERR(cc->write_thread)) {
+		ret = PTR_ERR(cc->write_thread);
+		cc->write_thread = NULL;
+		ti->error = "Couldn't spawn write thread";
+		goto bad;
+	}
+	wake_up_process(cc->write_thread);
+
 	ti->num_flush_requests = 1;
 	ti->discard_zeroes_data_unsupported = 1;
 
@@ -1753,6 +2022,7 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 {
 	struct crypt_config *cc = ti->private;
 	unsigned int sz = 0;
+	int num_feature_args;
 
 	switch (type) {
 	case STATUSTYPE_INFO:
@@ -1777,8 +2047,15 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 		DMEMIT(" %llu %s %llu", (unsigned long long)cc->iv_offset,
 				cc->dev->name, (unsigned long long)cc->start);
 
-		if (ti->num_discard_requests)
-			DMEMIT(" 1 allow_discards");
+		num_feature_args = !!ti->num_discard_requests +
+			test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
+		if (num_feature_args) {
+			DMEMIT(" %d", num_feature_args);
+			if (ti->num_discard_requests)
+				DMEMIT(" allow_discards");
+			if (test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags))
+				DMEMIT(" no_read_workqueue");
+		}
 
 		break;
 	}
@@ -1876,7 +2153,7 @@ static int crypt_iterate_devices(struct dm_target *ti,
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 11, 0},
+	.version = {1, 12, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
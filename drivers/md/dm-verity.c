@@ -18,6 +18,7 @@
 
 #include <linux/module.h>
 #include <linux/device-mapper.h>
+#include <linux/vmalloc.h>
 #include <crypto/hash.h>
 
 #define DM_MSG_PREFIX			"verity"
@@ -28,6 +29,8 @@
 
 #define DM_VERITY_MAX_LEVELS		63
 
+#define DM_VERITY_OPT_AT_MOST_ONCE	"check_at_most_once"
+
 static unsigned dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE;
 
 module_param_named(prefetch_cluster, dm_verity_prefetch_cluster, uint, S_IRUGO | S_IWUSR);
@@ -54,6 +57,19 @@ struct dm_verity {
 	unsigned digest_size;	/* digest size for the current hash algorithm */
 	unsigned shash_descsize;/* the size of temporary space for crypto */
 	int hash_failed;	/* set to 1 if hash of any block failed */
+	u8 *initial_state;	/* exported hash state after the leading salt */
+
+	/*
+	 * With check_at_most_once, a bit is set here for every data block
+	 * and every hash block once its hash has been verified.
+	 */
+	unsigned long *verified_data;
+	unsigned long *verified_hash;
+
+	atomic64_t data_hashed;	/* data blocks hashed */
+	atomic64_t data_skipped;	/* data blocks found in verified_data */
+	atomic64_t hash_hashed;	/* hash blocks hashed */
+	atomic64_t hash_skipped;	/* hash blocks already verified */
 
 	mempool_t *io_mempool;	/* mempool of struct dm_verity_io */
 	mempool_t *vec_mempool;	/* mempool of bio vector */
@@ -110,6 +126,23 @@ static u8 *io_want_digest(struct dm_verity *v, struct dm_verity_io *io)
 	return (u8 *)(io + 1) + v->shash_descsize + v->digest_size;
 }
 
+/*
+ * Start hashing a block. The state after hashing the leading salt (if any)
+ * is computed once in the constructor and only imported here.
+ */
+static int verity_hash_init(struct dm_verity *v, struct shash_desc *desc)
+{
+	int r;
+
+	desc->tfm = v->tfm;
+	desc->flags = CRYPTO_TFM_REQ_MAY_SLEEP;
+	r = crypto_shash_import(desc, v->initial_state);
+	if (unlikely(r < 0))
+		DMERR("crypto_shash_import failed: %d", r);
+
+	return r;
+}
+
 /*
  * Auxiliary structure appended to each dm-bufio buffer. If the value
  * hash_verified is nonzero, hash of the block has been verified.
@@ -204,6 +237,11 @@ static int verity_verify_level(struct dm_verity_io *io, sector_t block,
 
 	aux = dm_bufio_get_aux_data(buf);
 
+	/* the buffer may have been evicted and read again since */
+	if (!aux->hash_verified && v->verified_hash &&
+	    test_bit(hash_block - v->hash_start, v->verified_hash))
+		aux->hash_verified = 1;
+
 	if (!aux->hash_verified) {
 		struct shash_desc *desc;
 		u8 *result;
@@ -214,21 +252,9 @@ static int verity_verify_level(struct dm_verity_io *io, sector_t block,
 		}
 
 		desc = io_hash_desc(v, io);
-		desc->tfm = v->tfm;
-		desc->flags = CRYPTO_TFM_REQ_MAY_SLEEP;
-		r = crypto_shash_init(desc);
-		if (r < 0) {
-			DMERR("crypto_shash_init failed: %d", r);
+		r = verity_hash_init(v, desc);
+		if (r < 0)
 			goto release_ret_r;
-		}
-
-		if (likely(v->version >= 1)) {
-			r = crypto_shash_update(desc, v->salt, v->salt_size);
-			if (r < 0) {
-				DMERR("crypto_shash_update failed: %d", r);
-				goto release_ret_r;
-			}
-		}
 
 		r = crypto_shash_update(desc, data, 1 << v->hash_dev_block_bits);
 		if (r < 0) {
@@ -256,9 +282,15 @@ static int verity_verify_level(struct dm_verity_io *io, sector_t block,
 			v->hash_failed = 1;
 			r = -EIO;
 			goto release_ret_r;
-		} else
+		} else {
 			aux->hash_verified = 1;
-	}
+			if (v->verified_hash)
+				set_bit(hash_block - v->hash_start,
+					v->verified_hash);
+		}
+		atomic64_inc(&v->hash_hashed);
+	} else
+		atomic64_inc(&v->hash_skipped);
 
 	data += offset;
 
@@ -273,23 +305,75 @@ release_ret_r:
 	return r;
 }
 
+/*
+ * Move past one data block in the saved bio vector without hashing it.
+ */
+static void verity_skip_block(struct dm_verity_io *io, unsigned *vector,
+			      unsigned *offset)
+{
+	unsigned todo = 1 << io->v->data_dev_block_bits;
+
+	do {
+		struct bio_vec *bv;
+		unsigned len;
+
+		BUG_ON(*vector >= io->io_vec_size);
+		bv = &io->io_vec[*vector];
+		len = min(bv->bv_len - *offset, todo);
+		*offset += len;
+		if (likely(*offset == bv->bv_len)) {
+			*offset = 0;
+			(*vector)++;
+		}
+		todo -= len;
+	} while (todo);
+}
+
 /*
  * Verify one "dm_verity_io" structure.
+ *
+ * All blocks of the bio are hashed here, on the cpu that runs the work.
+ * Consecutive data blocks mostly share the lowest-level hash block, so
+ * once that block is verified it is kept referenced and the wanted digests
+ * of the following blocks are taken from it directly.
  */
 static int verity_verify_io(struct dm_verity_io *io)
 {
 	struct dm_verity *v = io->v;
+	struct dm_buffer *hash_buf = NULL;
+	sector_t hash_buf_block = 0;
+	u8 *hash_data = NULL;
 	unsigned b;
-	int i;
+	int i, r = 0;
 	unsigned vector = 0, offset = 0;
 
 	for (b = 0; b < io->n_blocks; b++) {
 		struct shash_desc *desc;
 		u8 *result;
-		int r;
 		unsigned todo;
+		sector_t hash_block = 0;
+		unsigned hash_offset = 0;
+
+		if (v->verified_data &&
+		    test_bit(io->block + b, v->verified_data)) {
+			verity_skip_block(io, &vector, &offset);
+			atomic64_inc(&v->data_skipped);
+			continue;
+		}
 
 		if (likely(v->levels)) {
+			verity_hash_at_level(v, io->block + b, 0, &hash_block,
+					     &hash_offset);
+			if (hash_buf && hash_buf_block == hash_block) {
+				memcpy(io_want_digest(v, io),
+				       hash_data + hash_offset, v->digest_size);
+				goto test_block_hash;
+			}
+			if (hash_buf) {
+				dm_bufio_release(hash_buf);
+				hash_buf = NULL;
+			}
+
 			/*
 			 * First, we try to get the requested hash for
 			 * the current block. If the hash block itself is
@@ -297,38 +381,37 @@ static int verity_verify_io(struct dm_verity_io *io)
 			 * function returns 0 and we fall back to whole
 			 * chain verification.
 			 */
-			int r = verity_verify_level(io, io->block + b, 0, true);
+			r = verity_verify_level(io, io->block + b, 0, true);
 			if (likely(!r))
-				goto test_block_hash;
+				goto hold_hash_block;
 			if (r < 0)
-				return r;
+				goto out;
 		}
 
 		memcpy(io_want_digest(v, io), v->root_digest, v->digest_size);
 
 		for (i = v->levels - 1; i >= 0; i--) {
-			int r = verity_verify_level(io, io->block + b, i, false);
+			r = verity_verify_level(io, io->block + b, i, false);
 			if (unlikely(r))
-				return r;
+				goto out;
 		}
 
-test_block_hash:
-		desc = io_hash_desc(v, io);
-		desc->tfm = v->tfm;
-		desc->flags = CRYPTO_TFM_REQ_MAY_SLEEP;
-		r = crypto_shash_init(desc);
-		if (r < 0) {
-			DMERR("crypto_shash_init failed: %d", r);
-			return r;
+hold_hash_block:
+		/* verified now; a cache miss only costs the shortcut */
+		if (likely(v->levels)) {
+			hash_data = dm_bufio_get(v->bufio, hash_block,
+						 &hash_buf);
+			if (IS_ERR_OR_NULL(hash_data))
+				hash_buf = NULL;
+			else
+				hash_buf_block = hash_block;
 		}
 
-		if (likely(v->version >= 1)) {
-			r = crypto_shash_update(desc, v->salt, v->salt_size);
-			if (r < 0) {
-				DMERR("crypto_shash_update failed: %d", r);
-				return r;
-			}
-		}
+test_block_hash:
+		desc = io_hash_desc(v, io);
+		r = verity_hash_init(v, desc);
+		if (r < 0)
+			goto out;
 
 		todo = 1 << v->data_dev_block_bits;
 		do {
@@ -347,7 +430,7 @@ test_block_hash:
 			kunmap_atomic(page);
 			if (r < 0) {
 				DMERR("crypto_shash_update failed: %d", r);
-				return r;
+				goto out;
 			}
 			offset += len;
 			if (likely(offset == bv->bv_len)) {
@@ -361,7 +444,7 @@ test_block_hash:
 			r = crypto_shash_update(desc, v->salt, v->salt_size);
 			if (r < 0) {
 				DMERR("crypto_shash_update failed: %d", r);
-				return r;
+				goto out;
 			}
 		}
 
@@ -369,19 +452,27 @@ test_block_hash:
 		r = crypto_shash_final(desc, result);
 		if (r < 0) {
 			DMERR("crypto_shash_final failed: %d", r);
-			return r;
+			goto out;
 		}
 		if (unlikely(memcmp(result, io_want_digest(v, io), v->digest_size))) {
 			DMERR_LIMIT("data block %llu is corrupted",
 				(unsigned long long)(io->block + b));
 			v->hash_failed = 1;
-			return -EIO;
+			r = -EIO;
+			goto out;
 		}
+		atomic64_inc(&v->data_hashed);
+		if (v->verified_data)
+			set_bit(io->block + b, v->verified_data);
 	}
 	BUG_ON(vector != io->io_vec_size);
 	BUG_ON(offset);
 
-	return 0;
+out:
+	if (hash_buf)
+		dm_bufio_release(hash_buf);
+
+	return r;
 }
 
 /*
@@ -512,7 +603,9 @@ static int verity_map(struct dm_target *ti, struct bio *bio,
 }
 
 /*
- * Status: V (valid) or C (corruption found)
+ * Status: V (valid) or C (corruption found), followed by the number of data
+ * blocks hashed, data blocks skipped as verified before, hash blocks hashed
+ * and hash blocks found already verified.
  */
 static int verity_status(struct dm_target *ti, status_type_t type,
 			 char *result, unsigned maxlen)
@@ -523,7 +616,11 @@ static int verity_status(struct dm_target *ti, status_type_t type,
 
 	switch (type) {
 	case STATUSTYPE_INFO:
-		DMEMIT("%c", v->hash_failed ? 'C' : 'V');
+		DMEMIT("%c %llu %llu %llu %llu", v->hash_failed ? 'C' : 'V',
+		       (unsigned long long)atomic64_read(&v->data_hashed),
+		       (unsigned long long)atomic64_read(&v->data_skipped),
+		       (unsigned long long)atomic64_read(&v->hash_hashed),
+		       (unsigned long long)atomic64_read(&v->hash_skipped));
 		break;
 	case STATUSTYPE_TABLE:
 		DMEMIT("%u %s %s %u %u %llu %llu %s ",
@@ -544,6 +641,8 @@ static int verity_status(struct dm_target *ti, status_type_t type,
 		else
 			for (x = 0; x < v->salt_size; x++)
 				DMEMIT("%02x", v->salt[x]);
+		if (v->verified_data)
+			DMEMIT(" 1 " DM_VERITY_OPT_AT_MOST_ONCE);
 		break;
 	}
 
@@ -616,6 +715,9 @@ static void verity_dtr(struct dm_target *ti)
 	if (v->bufio)
 		dm_bufio_client_destroy(v->bufio);
 
+	vfree(v->verified_data);
+	vfree(v->verified_hash);
+	kfree(v->initial_state);
 	kfree(v->salt);
 	kfree(v->root_digest);
 
@@ -646,6 +748,10 @@ static void verity_dtr(struct dm_target *ti)
  *	<algorithm>
  *	<digest>
  *	<salt>		Hex string or "-" if no salt.
+ *
+ * Optional parameters:
+ *	<#opt_params> <opt_params>
+ *	check_at_most_once	Verify each block only the first time it is read.
  */
 static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 {
@@ -656,6 +762,15 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 	int i;
 	sector_t hash_position;
 	char dummy;
+	struct dm_arg_set as;
+	unsigned opt_params;
+	const char *opt_string;
+	struct shash_desc *desc;
+	bool at_most_once = false;
+
+	static struct dm_arg _args[] = {
+		{0, 1, "Invalid number of feature args"},
+	};
 
 	v = kzalloc(sizeof(struct dm_verity), GFP_KERNEL);
 	if (!v) {
@@ -671,8 +786,8 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		goto bad;
 	}
 
-	if (argc != 10) {
-		ti->error = "Invalid argument count: exactly 10 arguments required";
+	if (argc < 10) {
+		ti->error = "Invalid argument count: at least 10 arguments required";
 		r = -EINVAL;
 		goto bad;
 	}
@@ -793,6 +908,57 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		}
 	}
 
+	v->initial_state = kmalloc(crypto_shash_statesize(v->tfm), GFP_KERNEL);
+	desc = kmalloc(v->shash_descsize, GFP_KERNEL);
+	if (!v->initial_state || !desc) {
+		kfree(desc);
+		ti->error = "Cannot allocate initial hash state";
+		r = -ENOMEM;
+		goto bad;
+	}
+	desc->tfm = v->tfm;
+	desc->flags = 0;
+	r = crypto_shash_init(desc);
+	if (!r && v->version >= 1)
+		r = crypto_shash_update(desc, v->salt, v->salt_size);
+	if (!r)
+		r = crypto_shash_export(desc, v->initial_state);
+	kfree(desc);
+	if (r < 0) {
+		ti->error = "Cannot compute initial hash state";
+		goto bad;
+	}
+
+	argv += 10;
+	argc -= 10;
+
+	/* Optional parameters */
+	if (argc) {
+		as.argc = argc;
+		as.argv = argv;
+
+		r = dm_read_arg_group(_args, &as, &opt_params, &ti->error);
+		if (r)
+			goto bad;
+
+		while (opt_params--) {
+			opt_string = dm_shift_arg(&as);
+			if (!opt_string) {
+				ti->error = "Not enough feature arguments";
+				r = -EINVAL;
+				goto bad;
+			}
+
+			if (!strcasecmp(opt_string, DM_VERITY_OPT_AT_MOST_ONCE))
+				at_most_once = true;
+			else {
+				ti->error = "Invalid feature arguments";
+				r = -EINVAL;
+				goto bad;
+			}
+		}
+	}
+
 	v->hash_per_block_bits =
 		fls((1 << v->hash_dev_block_bits) / v->digest_size) - 1;
 
@@ -825,6 +991,19 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 	}
 	v->hash_blocks = hash_position;
 
+	if (at_most_once) {
+		v->verified_data = vzalloc(BITS_TO_LONGS(v->data_blocks) *
+					   sizeof(unsigned long));
+		v->verified_hash = vzalloc(BITS_TO_LONGS(v->hash_blocks -
+							 v->hash_start) *
+					   sizeof(unsigned long));
+		if (!v->verified_data || !v->verified_hash) {
+			ti->error = "Cannot allocate verified block bitmaps";
+			r = -ENOMEM;
+			goto bad;
+		}
+	}
+
 	v->bufio = dm_bufio_client_create(v->hash_dev->bdev,
 		1 << v->hash_dev_block_bits, 1, sizeof(struct buffer_aux),
 		dm_bufio_alloc_callback, NULL);
@@ -875,7 +1054,7 @@ bad:
 
 static struct target_type verity_target = {
 	.name		= "verity",
-	.version	= {1, 0, 0},
+	.version	= {1, 1, 0},
 	.module		= THIS_MODULE,
 	.ctr		= verity_ctr,
 	.dtr		= verity_dtr,
@@ -237,13 +237,18 @@ void tune_lmk_param(int *other_free, int *other_file, struct shrink_control *sc)
 	classzone_idx = zone_idx(preferred_zone);
 	use_cma_pages = can_use_cma_pages(gfp_mask);
 
-	balance_gap = min(low_wmark_pages(preferred_zone),
+	/*
+	 * Not low/high_wmark_pages(): a watermark boost only makes kswapd
+	 * reclaim further and must not make us kill earlier than minfree.
+	 */
+	balance_gap = min(preferred_zone->watermark[WMARK_LOW],
 			  (preferred_zone->present_pages +
 			   KSWAPD_ZONE_BALANCE_GAP_RATIO-1) /
 			   KSWAPD_ZONE_BALANCE_GAP_RATIO);
 
 	if (likely(current_is_kswapd() && zone_watermark_ok(preferred_zone, 0,
-			  high_wmark_pages(preferred_zone) + SWAP_CLUSTER_MAX +
+			  preferred_zone->watermark[WMARK_HIGH] +
+			  SWAP_CLUSTER_MAX +
 			  balance_gap, 0, 0))) {
 		if (lmk_fast_run)
 			tune_lmk_zone_param(zonelist, classzone_idx, other_free,
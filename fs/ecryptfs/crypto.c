@@ -34,20 +34,11 @@
 #include <linux/file.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/ktime.h>
 #include <asm/unaligned.h>
 #include "ecryptfs_kernel.h"
 
-static int
-ecryptfs_decrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv);
-static int
-ecryptfs_encrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv);
-
 /**
  * ecryptfs_to_hex
  * @dst: Buffer to take hex character representation of contents of
@@ -243,7 +234,7 @@ void ecryptfs_destroy_crypt_stat(struct ecryptfs_crypt_stat *crypt_stat)
 	struct ecryptfs_key_sig *key_sig, *key_sig_tmp;
 
 	if (crypt_stat->tfm)
-		crypto_free_blkcipher(crypt_stat->tfm);
+		crypto_free_ablkcipher(crypt_stat->tfm);
 	if (crypt_stat->hash_tfm)
 		crypto_free_hash(crypt_stat->hash_tfm);
 	list_for_each_entry_safe(key_sig, key_sig_tmp,
@@ -324,53 +315,204 @@ int virt_to_scatterlist(const void *addr, int size, struct scatterlist *sg,
 }
 
 /**
- * encrypt_scatterlist
- * @crypt_stat: Pointer to the crypt_stat struct to initialize.
- * @dest_sg: Destination of encrypted data
- * @src_sg: Data to be encrypted
- * @size: Length of data to be encrypted
- * @iv: iv to use during encryption
+ * ecryptfs_set_key
+ * @crypt_stat: The cryptographic context
+ *
+ * Set the file key on the tfm the first time it is used. After that the
+ * tfm is only used for encryption and decryption, which does not modify
+ * it, so any number of requests can be in flight on it without holding
+ * cs_tfm_mutex.
  *
- * Returns the number of bytes encrypted; negative value on error
+ * Returns zero on success; non-zero on error
  */
-static int encrypt_scatterlist(struct ecryptfs_crypt_stat *crypt_stat,
-			       struct scatterlist *dest_sg,
-			       struct scatterlist *src_sg, int size,
-			       unsigned char *iv)
+static int ecryptfs_set_key(struct ecryptfs_crypt_stat *crypt_stat)
 {
-	struct blkcipher_desc desc = {
-		.tfm = crypt_stat->tfm,
-		.info = iv,
-		.flags = CRYPTO_TFM_REQ_MAY_SLEEP
-	};
 	int rc = 0;
 
 	BUG_ON(!crypt_stat || !crypt_stat->tfm
 	       || !(crypt_stat->flags & ECRYPTFS_STRUCT_INITIALIZED));
+	if (likely(crypt_stat->flags & ECRYPTFS_KEY_SET))
+		return 0;
 	if (unlikely(ecryptfs_verbosity > 0)) {
 		ecryptfs_printk(KERN_DEBUG, "Key size [%zd]; key:\n",
 				crypt_stat->key_size);
 		ecryptfs_dump_hex(crypt_stat->key,
 				  crypt_stat->key_size);
 	}
-	/* Consider doing this once, when the file is opened */
 	mutex_lock(&crypt_stat->cs_tfm_mutex);
 	if (!(crypt_stat->flags & ECRYPTFS_KEY_SET)) {
-		rc = crypto_blkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
-					     crypt_stat->key_size);
-		crypt_stat->flags |= ECRYPTFS_KEY_SET;
-	}
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error setting key; rc = [%d]\n",
-				rc);
-		mutex_unlock(&crypt_stat->cs_tfm_mutex);
-		rc = -EINVAL;
-		goto out;
+		rc = crypto_ablkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
+					      crypt_stat->key_size);
+		if (rc) {
+			ecryptfs_printk(KERN_ERR, "Error setting key; "
+					"rc = [%d]\n", rc);
+			rc = -EINVAL;
+		} else
+			crypt_stat->flags |= ECRYPTFS_KEY_SET;
 	}
-	ecryptfs_printk(KERN_DEBUG, "Encrypting [%d] bytes.\n", size);
-	crypto_blkcipher_encrypt_iv(&desc, dest_sg, src_sg, size);
 	mutex_unlock(&crypt_stat->cs_tfm_mutex);
-out:
+	return rc;
+}
+
+/*
+ * A batch of extents handed to the cipher together. CBC restarts with a
+ * new IV on every extent, so each extent still needs a request of its
+ * own, but none of them is waited for until the whole batch is queued.
+ * An asynchronous cipher can work on all of them at once.
+ */
+struct ecryptfs_crypt_batch {
+	struct completion completion;
+	atomic_t pending;
+	int rc;
+};
+
+struct ecryptfs_extent_req {
+	struct ecryptfs_crypt_batch *batch;
+	struct scatterlist src_sg;
+	struct scatterlist dst_sg;
+	char iv[ECRYPTFS_MAX_IV_BYTES];
+	/* followed by the private context of the cipher */
+	struct ablkcipher_request req;
+};
+
+static void ecryptfs_extent_req_done(struct ecryptfs_extent_req *extent_req,
+				     int rc)
+{
+	struct ecryptfs_crypt_batch *batch = extent_req->batch;
+
+	if (rc)
+		batch->rc = rc;
+	kfree(extent_req);
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->completion);
+}
+
+static void ecryptfs_extent_crypt_complete(struct crypto_async_request *req,
+					   int rc)
+{
+	/* a backlogged request has just been started */
+	if (rc == -EINPROGRESS)
+		return;
+	ecryptfs_extent_req_done(req->data, rc);
+}
+
+/**
+ * ecryptfs_crypt_pages
+ * @crypt_stat: The cryptographic context
+ * @dst_pages: Pages to write the result into
+ * @src_pages: Pages to read from; may be the same as @dst_pages
+ * @index: Upper page index of the first page, used to derive the IVs
+ * @nr_pages: Number of pages in @dst_pages and @src_pages
+ * @op: ENCRYPT or DECRYPT
+ *
+ * Encrypts or decrypts every extent of @nr_pages consecutive pages,
+ * with all of the extents in flight on the cipher at the same time.
+ *
+ * Returns zero on success; non-zero on error
+ */
+static int ecryptfs_crypt_pages(struct ecryptfs_crypt_stat *crypt_stat,
+				struct page **dst_pages,
+				struct page **src_pages, pgoff_t index,
+				unsigned int nr_pages, int op)
+{
+	struct ecryptfs_mount_stats *stats =
+		&crypt_stat->mount_crypt_stat->stats;
+	unsigned long extents_per_page =
+		(PAGE_CACHE_SIZE / crypt_stat->extent_size);
+	struct ecryptfs_crypt_batch batch;
+	struct ecryptfs_extent_req *extent_req;
+	unsigned long extent_offset;
+	unsigned int i;
+	loff_t extent;
+	ktime_t start;
+	int rc;
+
+	rc = ecryptfs_set_key(crypt_stat);
+	if (rc)
+		return rc;
+	init_completion(&batch.completion);
+	atomic_set(&batch.pending, 1);
+	batch.rc = 0;
+	start = ktime_get();
+	for (i = 0; i < nr_pages; i++) {
+		for (extent_offset = 0; extent_offset < extents_per_page;
+		     extent_offset++) {
+			extent = ((((loff_t)index + i) * extents_per_page)
+				  + extent_offset);
+			extent_req = kmalloc(sizeof(*extent_req)
+				+ crypto_ablkcipher_reqsize(crypt_stat->tfm),
+				GFP_NOFS);
+			if (!extent_req) {
+				rc = -ENOMEM;
+				goto out_wait;
+			}
+			rc = ecryptfs_derive_iv(extent_req->iv, crypt_stat,
+						extent);
+			if (rc) {
+				ecryptfs_printk(KERN_ERR, "Error attempting "
+					"to derive IV for extent "
+					"[0x%.16llx]; rc = [%d]\n",
+					(unsigned long long)extent, rc);
+				kfree(extent_req);
+				goto out_wait;
+			}
+			extent_req->batch = &batch;
+			sg_init_table(&extent_req->src_sg, 1);
+			sg_set_page(&extent_req->src_sg, src_pages[i],
+				    crypt_stat->extent_size,
+				    extent_offset * crypt_stat->extent_size);
+			sg_init_table(&extent_req->dst_sg, 1);
+			sg_set_page(&extent_req->dst_sg, dst_pages[i],
+				    crypt_stat->extent_size,
+				    extent_offset * crypt_stat->extent_size);
+			ablkcipher_request_set_tfm(&extent_req->req,
+						   crypt_stat->tfm);
+			ablkcipher_request_set_callback(&extent_req->req,
+				CRYPTO_TFM_REQ_MAY_BACKLOG |
+				CRYPTO_TFM_REQ_MAY_SLEEP,
+				ecryptfs_extent_crypt_complete, extent_req);
+			ablkcipher_request_set_crypt(&extent_req->req,
+						     &extent_req->src_sg,
+						     &extent_req->dst_sg,
+						     crypt_stat->extent_size,
+						     extent_req->iv);
+			atomic_inc(&batch.pending);
+			rc = (op == ENCRYPT)
+				? crypto_ablkcipher_encrypt(&extent_req->req)
+				: crypto_ablkcipher_decrypt(&extent_req->req);
+			if (rc == -EINPROGRESS || rc == -EBUSY) {
+				atomic64_inc(&stats->async_requests);
+				continue;
+			}
+			ecryptfs_extent_req_done(extent_req, rc);
+			if (rc) {
+				printk(KERN_ERR "%s: Error attempting to "
+				       "%scrypt extent [0x%.16llx]; "
+				       "rc = [%d]\n", __func__,
+				       (op == ENCRYPT) ? "en" : "de",
+				       (unsigned long long)extent, rc);
+				goto out_wait;
+			}
+		}
+	}
+	rc = 0;
+out_wait:
+	if (!atomic_dec_and_test(&batch.pending))
+		wait_for_completion(&batch.completion);
+	if (!rc)
+		rc = batch.rc;
+	if (!rc) {
+		u64 bytes = (u64)nr_pages << PAGE_CACHE_SHIFT;
+		s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		if (op == ENCRYPT) {
+			atomic64_add(bytes, &stats->bytes_encrypted);
+			atomic64_add(ns, &stats->encrypt_ns);
+		} else {
+			atomic64_add(bytes, &stats->bytes_decrypted);
+			atomic64_add(ns, &stats->decrypt_ns);
+		}
+	}
 	return rc;
 }
 
@@ -386,51 +528,90 @@ static void ecryptfs_lower_offset_for_extent(loff_t *offset, loff_t extent_num,
 		    + (crypt_stat->extent_size * extent_num);
 }
 
+/*
+ * The extents of consecutive upper pages are also consecutive in the
+ * lower file, so a range of pages is a single range there.
+ */
+static loff_t ecryptfs_lower_offset_for_page(pgoff_t index,
+					struct ecryptfs_crypt_stat *crypt_stat)
+{
+	loff_t offset;
+
+	ecryptfs_lower_offset_for_extent(
+		&offset, (((loff_t)index)
+			  * (PAGE_CACHE_SIZE / crypt_stat->extent_size)),
+		crypt_stat);
+	return offset;
+}
+
 /**
- * ecryptfs_encrypt_extent
- * @enc_extent_page: Allocated page into which to encrypt the data in
- *                   @page
- * @crypt_stat: crypt_stat containing cryptographic context for the
- *              encryption operation
- * @page: Page containing plaintext data extent to encrypt
- * @extent_offset: Page extent offset for use in generating IV
+ * ecryptfs_encrypt_pages
+ * @pages: Pages mapped from the eCryptfs inode for the file, with
+ *         consecutive indices; contain decrypted content that needs
+ *         to be encrypted (to temporary pages; not in place) and
+ *         written out to the lower file
+ * @nr_pages: Number of pages, at most ECRYPTFS_MAX_BATCH_PAGES
  *
- * Encrypts one extent of data.
+ * Encrypt the pages, then write the whole range to the lower file with
+ * one call.
  *
- * Return zero on success; non-zero otherwise
+ * Returns zero on success; negative on error
  */
-static int ecryptfs_encrypt_extent(struct page *enc_extent_page,
-				   struct ecryptfs_crypt_stat *crypt_stat,
-				   struct page *page,
-				   unsigned long extent_offset)
+int ecryptfs_encrypt_pages(struct page **pages, unsigned int nr_pages)
 {
-	loff_t extent_base;
-	char extent_iv[ECRYPTFS_MAX_IV_BYTES];
-	int rc;
+	struct inode *ecryptfs_inode = pages[0]->mapping->host;
+	struct ecryptfs_crypt_stat *crypt_stat =
+		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
+	struct page *enc_pages[ECRYPTFS_MAX_BATCH_PAGES];
+	char *enc_virt;
+	unsigned int i;
+	int rc = 0;
 
-	extent_base = (((loff_t)page->index)
-		       * (PAGE_CACHE_SIZE / crypt_stat->extent_size));
-	rc = ecryptfs_derive_iv(extent_iv, crypt_stat,
-				(extent_base + extent_offset));
+	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
+	BUG_ON(nr_pages > ECRYPTFS_MAX_BATCH_PAGES);
+	for (i = 0; i < nr_pages; i++) {
+		enc_pages[i] = alloc_page(GFP_USER);
+		if (!enc_pages[i]) {
+			rc = -ENOMEM;
+			ecryptfs_printk(KERN_ERR, "Error allocating memory "
+					"for encrypted extent\n");
+			goto out;
+		}
+	}
+	rc = ecryptfs_crypt_pages(crypt_stat, enc_pages, pages,
+				  pages[0]->index, nr_pages, ENCRYPT);
 	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error attempting to derive IV for "
-			"extent [0x%.16llx]; rc = [%d]\n",
-			(unsigned long long)(extent_base + extent_offset), rc);
+		printk(KERN_ERR "%s: Error encrypting page with index "
+		       "[%ld]; rc = [%d]\n", __func__, pages[0]->index, rc);
+		goto out;
+	}
+	if (nr_pages == 1)
+		enc_virt = kmap(enc_pages[0]);
+	else
+		enc_virt = vmap(enc_pages, nr_pages, VM_MAP, PAGE_KERNEL);
+	if (!enc_virt) {
+		rc = -ENOMEM;
 		goto out;
 	}
-	rc = ecryptfs_encrypt_page_offset(crypt_stat, enc_extent_page, 0,
-					  page, (extent_offset
-						 * crypt_stat->extent_size),
-					  crypt_stat->extent_size, extent_iv);
+	rc = ecryptfs_write_lower(ecryptfs_inode, enc_virt,
+				  ecryptfs_lower_offset_for_page(
+					pages[0]->index, crypt_stat),
+				  (size_t)nr_pages << PAGE_CACHE_SHIFT);
+	if (nr_pages == 1)
+		kunmap(enc_pages[0]);
+	else
+		vunmap(enc_virt);
 	if (rc < 0) {
-		printk(KERN_ERR "%s: Error attempting to encrypt page with "
-		       "page->index = [%ld], extent_offset = [%ld]; "
-		       "rc = [%d]\n", __func__, page->index, extent_offset,
-		       rc);
+		ecryptfs_printk(KERN_ERR, "Error attempting "
+				"to write lower page; rc = [%d]"
+				"\n", rc);
 		goto out;
 	}
+	atomic64_inc(&crypt_stat->mount_crypt_stat->stats.lower_writes);
 	rc = 0;
 out:
+	while (i--)
+		__free_page(enc_pages[i]);
 	return rc;
 }
 
@@ -452,94 +633,63 @@ out:
  */
 int ecryptfs_encrypt_page(struct page *page)
 {
-	struct inode *ecryptfs_inode;
-	struct ecryptfs_crypt_stat *crypt_stat;
-	char *enc_extent_virt;
-	struct page *enc_extent_page = NULL;
-	loff_t extent_offset;
-	int rc = 0;
-
-	ecryptfs_inode = page->mapping->host;
-	crypt_stat =
-		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
-	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
-	enc_extent_page = alloc_page(GFP_USER);
-	if (!enc_extent_page) {
-		rc = -ENOMEM;
-		ecryptfs_printk(KERN_ERR, "Error allocating memory for "
-				"encrypted extent\n");
-		goto out;
-	}
-	enc_extent_virt = kmap(enc_extent_page);
-	for (extent_offset = 0;
-	     extent_offset < (PAGE_CACHE_SIZE / crypt_stat->extent_size);
-	     extent_offset++) {
-		loff_t offset;
-
-		rc = ecryptfs_encrypt_extent(enc_extent_page, crypt_stat, page,
-					     extent_offset);
-		if (rc) {
-			printk(KERN_ERR "%s: Error encrypting extent; "
-			       "rc = [%d]\n", __func__, rc);
-			goto out;
-		}
-		ecryptfs_lower_offset_for_extent(
-			&offset, ((((loff_t)page->index)
-				   * (PAGE_CACHE_SIZE
-				      / crypt_stat->extent_size))
-				  + extent_offset), crypt_stat);
-		rc = ecryptfs_write_lower(ecryptfs_inode, enc_extent_virt,
-					  offset, crypt_stat->extent_size);
-		if (rc < 0) {
-			ecryptfs_printk(KERN_ERR, "Error attempting "
-					"to write lower page; rc = [%d]"
-					"\n", rc);
-			goto out;
-		}
-	}
-	rc = 0;
-out:
-	if (enc_extent_page) {
-		kunmap(enc_extent_page);
-		__free_page(enc_extent_page);
-	}
-	return rc;
+	return ecryptfs_encrypt_pages(&page, 1);
 }
 
-static int ecryptfs_decrypt_extent(struct page *page,
-				   struct ecryptfs_crypt_stat *crypt_stat,
-				   struct page *enc_extent_page,
-				   unsigned long extent_offset)
+/**
+ * ecryptfs_decrypt_pages
+ * @pages: Pages mapped from the eCryptfs inode for the file, with
+ *         consecutive indices; data read and decrypted from the lower
+ *         file will be written into these pages
+ * @nr_pages: Number of pages, at most ECRYPTFS_MAX_BATCH_PAGES
+ *
+ * Read the whole range from the lower file with one call, then decrypt
+ * it in place.
+ *
+ * Returns zero on success; negative on error
+ */
+int ecryptfs_decrypt_pages(struct page **pages, unsigned int nr_pages)
 {
-	loff_t extent_base;
-	char extent_iv[ECRYPTFS_MAX_IV_BYTES];
+	struct inode *ecryptfs_inode = pages[0]->mapping->host;
+	struct ecryptfs_crypt_stat *crypt_stat =
+		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
+	char *virt;
+	unsigned int i;
 	int rc;
 
-	extent_base = (((loff_t)page->index)
-		       * (PAGE_CACHE_SIZE / crypt_stat->extent_size));
-	rc = ecryptfs_derive_iv(extent_iv, crypt_stat,
-				(extent_base + extent_offset));
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error attempting to derive IV for "
-			"extent [0x%.16llx]; rc = [%d]\n",
-			(unsigned long long)(extent_base + extent_offset), rc);
-		goto out;
-	}
-	rc = ecryptfs_decrypt_page_offset(crypt_stat, page,
-					  (extent_offset
-					   * crypt_stat->extent_size),
-					  enc_extent_page, 0,
-					  crypt_stat->extent_size, extent_iv);
+	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
+	BUG_ON(nr_pages > ECRYPTFS_MAX_BATCH_PAGES);
+	if (nr_pages == 1)
+		virt = kmap(pages[0]);
+	else
+		virt = vmap(pages, nr_pages, VM_MAP, PAGE_KERNEL);
+	if (!virt)
+		return -ENOMEM;
+	rc = ecryptfs_read_lower(virt, ecryptfs_lower_offset_for_page(
+					pages[0]->index, crypt_stat),
+				 (size_t)nr_pages << PAGE_CACHE_SHIFT,
+				 ecryptfs_inode);
+	if (nr_pages == 1)
+		kunmap(pages[0]);
+	else
+		vunmap(virt);
 	if (rc < 0) {
-		printk(KERN_ERR "%s: Error attempting to decrypt to page with "
-		       "page->index = [%ld], extent_offset = [%ld]; "
-		       "rc = [%d]\n", __func__, page->index, extent_offset,
-		       rc);
-		goto out;
+		ecryptfs_printk(KERN_ERR, "Error attempting "
+				"to read lower page; rc = [%d]"
+				"\n", rc);
+		return rc;
 	}
-	rc = 0;
-out:
-	return rc;
+	atomic64_inc(&crypt_stat->mount_crypt_stat->stats.lower_reads);
+	rc = ecryptfs_crypt_pages(crypt_stat, pages, pages, pages[0]->index,
+				  nr_pages, DECRYPT);
+	if (rc) {
+		printk(KERN_ERR "%s: Error decrypting page with index "
+		       "[%ld]; rc = [%d]\n", __func__, pages[0]->index, rc);
+		return rc;
+	}
+	for (i = 0; i < nr_pages; i++)
+		flush_dcache_page(pages[i]);
+	return 0;
 }
 
 /**
@@ -560,160 +710,7 @@ out:
  */
 int ecryptfs_decrypt_page(struct page *page)
 {
-	struct inode *ecryptfs_inode;
-	struct ecryptfs_crypt_stat *crypt_stat;
-	char *enc_extent_virt;
-	struct page *enc_extent_page = NULL;
-	unsigned long extent_offset;
-	int rc = 0;
-
-	ecryptfs_inode = page->mapping->host;
-	crypt_stat =
-		&(ecryptfs_inode_to_private(ecryptfs_inode)->crypt_stat);
-	BUG_ON(!(crypt_stat->flags & ECRYPTFS_ENCRYPTED));
-	enc_extent_page = alloc_page(GFP_USER);
-	if (!enc_extent_page) {
-		rc = -ENOMEM;
-		ecryptfs_printk(KERN_ERR, "Error allocating memory for "
-				"encrypted extent\n");
-		goto out;
-	}
-	enc_extent_virt = kmap(enc_extent_page);
-	for (extent_offset = 0;
-	     extent_offset < (PAGE_CACHE_SIZE / crypt_stat->extent_size);
-	     extent_offset++) {
-		loff_t offset;
-
-		ecryptfs_lower_offset_for_extent(
-			&offset, ((page->index * (PAGE_CACHE_SIZE
-						  / crypt_stat->extent_size))
-				  + extent_offset), crypt_stat);
-		rc = ecryptfs_read_lower(enc_extent_virt, offset,
-					 crypt_stat->extent_size,
-					 ecryptfs_inode);
-		if (rc < 0) {
-			ecryptfs_printk(KERN_ERR, "Error attempting "
-					"to read lower page; rc = [%d]"
-					"\n", rc);
-			goto out;
-		}
-		rc = ecryptfs_decrypt_extent(page, crypt_stat, enc_extent_page,
-					     extent_offset);
-		if (rc) {
-			printk(KERN_ERR "%s: Error encrypting extent; "
-			       "rc = [%d]\n", __func__, rc);
-			goto out;
-		}
-	}
-out:
-	if (enc_extent_page) {
-		kunmap(enc_extent_page);
-		__free_page(enc_extent_page);
-	}
-	return rc;
-}
-
-/**
- * decrypt_scatterlist
- * @crypt_stat: Cryptographic context
- * @dest_sg: The destination scatterlist to decrypt into
- * @src_sg: The source scatterlist to decrypt from
- * @size: The number of bytes to decrypt
- * @iv: The initialization vector to use for the decryption
- *
- * Returns the number of bytes decrypted; negative value on error
- */
-static int decrypt_scatterlist(struct ecryptfs_crypt_stat *crypt_stat,
-			       struct scatterlist *dest_sg,
-			       struct scatterlist *src_sg, int size,
-			       unsigned char *iv)
-{
-	struct blkcipher_desc desc = {
-		.tfm = crypt_stat->tfm,
-		.info = iv,
-		.flags = CRYPTO_TFM_REQ_MAY_SLEEP
-	};
-	int rc = 0;
-
-	/* Consider doing this once, when the file is opened */
-	mutex_lock(&crypt_stat->cs_tfm_mutex);
-	rc = crypto_blkcipher_setkey(crypt_stat->tfm, crypt_stat->key,
-				     crypt_stat->key_size);
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error setting key; rc = [%d]\n",
-				rc);
-		mutex_unlock(&crypt_stat->cs_tfm_mutex);
-		rc = -EINVAL;
-		goto out;
-	}
-	ecryptfs_printk(KERN_DEBUG, "Decrypting [%d] bytes.\n", size);
-	rc = crypto_blkcipher_decrypt_iv(&desc, dest_sg, src_sg, size);
-	mutex_unlock(&crypt_stat->cs_tfm_mutex);
-	if (rc) {
-		ecryptfs_printk(KERN_ERR, "Error decrypting; rc = [%d]\n",
-				rc);
-		goto out;
-	}
-	rc = size;
-out:
-	return rc;
-}
-
-/**
- * ecryptfs_encrypt_page_offset
- * @crypt_stat: The cryptographic context
- * @dst_page: The page to encrypt into
- * @dst_offset: The offset in the page to encrypt into
- * @src_page: The page to encrypt from
- * @src_offset: The offset in the page to encrypt from
- * @size: The number of bytes to encrypt
- * @iv: The initialization vector to use for the encryption
- *
- * Returns the number of bytes encrypted
- */
-static int
-ecryptfs_encrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv)
-{
-	struct scatterlist src_sg, dst_sg;
-
-	sg_init_table(&src_sg, 1);
-	sg_init_table(&dst_sg, 1);
-
-	sg_set_page(&src_sg, src_page, size, src_offset);
-	sg_set_page(&dst_sg, dst_page, size, dst_offset);
-	return encrypt_scatterlist(crypt_stat, &dst_sg, &src_sg, size, iv);
-}
-
-/**
- * ecryptfs_decrypt_page_offset
- * @crypt_stat: The cryptographic context
- * @dst_page: The page to decrypt into
- * @dst_offset: The offset in the page to decrypt into
- * @src_page: The page to decrypt from
- * @src_offset: The offset in the page to decrypt from
- * @size: The number of bytes to decrypt
- * @iv: The initialization vector to use for the decryption
- *
- * Returns the number of bytes decrypted
- */
-static int
-ecryptfs_decrypt_page_offset(struct ecryptfs_crypt_stat *crypt_stat,
-			     struct page *dst_page, int dst_offset,
-			     struct page *src_page, int src_offset, int size,
-			     unsigned char *iv)
-{
-	struct scatterlist src_sg, dst_sg;
-
-	sg_init_table(&src_sg, 1);
-	sg_set_page(&src_sg, src_page, size, src_offset);
-
-	sg_init_table(&dst_sg, 1);
-	sg_set_page(&dst_sg, dst_page, size, dst_offset);
-
-	return decrypt_scatterlist(crypt_stat, &dst_sg, &src_sg, size, iv);
+	return ecryptfs_decrypt_pages(&page, 1);
 }
 
 #define ECRYPTFS_MAX_SCATTERLIST_LEN 4
@@ -750,8 +747,7 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat)
 						    crypt_stat->cipher, "cbc");
 	if (rc)
 		goto out_unlock;
-	crypt_stat->tfm = crypto_alloc_blkcipher(full_alg_name, 0,
-						 CRYPTO_ALG_ASYNC);
+	crypt_stat->tfm = crypto_alloc_ablkcipher(full_alg_name, 0, 0);
 	kfree(full_alg_name);
 	if (IS_ERR(crypt_stat->tfm)) {
 		rc = PTR_ERR(crypt_stat->tfm);
@@ -761,7 +757,7 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat)
 				crypt_stat->cipher);
 		goto out_unlock;
 	}
-	crypto_blkcipher_set_flags(crypt_stat->tfm, CRYPTO_TFM_REQ_WEAK_KEY);
+	crypto_ablkcipher_set_flags(crypt_stat->tfm, CRYPTO_TFM_REQ_WEAK_KEY);
 	rc = 0;
 out_unlock:
 	mutex_unlock(&crypt_stat->cs_tfm_mutex);
@@ -40,6 +40,8 @@
 #include <linux/nsproxy.h>
 #include <linux/backing-dev.h>
 #include <linux/ecryptfs.h>
+#include <linux/crypto.h>
+#include <linux/atomic.h>
 
 #ifdef CONFIG_WTL_ENCRYPTION_FILTER
 #define ENC_NAME_FILTER_MAX_INSTANCE 5
@@ -57,6 +59,11 @@
 #define ECRYPTFS_DEFAULT_NUM_USERS 4
 #define ECRYPTFS_MAX_NUM_USERS 32768
 #define ECRYPTFS_XATTR_NAME "user.ecryptfs"
+/* pages encrypted or decrypted and passed to the lower file at once */
+#define ECRYPTFS_MAX_BATCH_PAGES 32
+
+#define ENCRYPT 1
+#define DECRYPT 0
 
 void ecryptfs_dump_auth_tok(struct ecryptfs_auth_tok *auth_tok);
 extern void ecryptfs_to_hex(char *dst, char *src, size_t src_size);
@@ -233,7 +240,7 @@ struct ecryptfs_crypt_stat {
 	size_t extent_shift;
 	unsigned int extent_mask;
 	struct ecryptfs_mount_crypt_stat *mount_crypt_stat;
-	struct crypto_blkcipher *tfm;
+	struct crypto_ablkcipher *tfm;
 	struct crypto_hash *hash_tfm; /* Crypto context for generating
 				       * the initialization vectors */
 	unsigned char cipher[ECRYPTFS_MAX_CIPHER_NAME_SIZE];
@@ -315,6 +322,21 @@ struct ecryptfs_key_tfm {
 
 extern struct mutex key_tfm_list_mutex;
 
+/*
+ * Data path counters of a mount, shown in /proc/<pid>/mountstats. The
+ * times are the wall clock time from queueing the first extent of a
+ * batch to the completion of the last one.
+ */
+struct ecryptfs_mount_stats {
+	atomic64_t bytes_encrypted;
+	atomic64_t bytes_decrypted;
+	atomic64_t encrypt_ns;
+	atomic64_t decrypt_ns;
+	atomic64_t async_requests;
+	atomic64_t lower_writes;
+	atomic64_t lower_reads;
+};
+
 /**
  * This struct is to enable a mount-wide passphrase/salt combo. This
  * is more or less a stopgap to provide similar functionality to other
@@ -352,7 +374,7 @@ struct ecryptfs_mount_crypt_stat {
 	char enc_filter_ext[ENC_EXT_FILTER_MAX_INSTANCE]
 				[ENC_EXT_FILTER_MAX_LEN + 1];
 #endif
-
+	struct ecryptfs_mount_stats stats;
 };
 
 /* superblock private data. */
@@ -620,6 +642,8 @@ int ecryptfs_init_crypt_ctx(struct ecryptfs_crypt_stat *crypt_stat);
 int ecryptfs_write_inode_size_to_metadata(struct inode *ecryptfs_inode);
 int ecryptfs_encrypt_page(struct page *page);
 int ecryptfs_decrypt_page(struct page *page);
+int ecryptfs_encrypt_pages(struct page **pages, unsigned int nr_pages);
+int ecryptfs_decrypt_pages(struct page **pages, unsigned int nr_pages);
 int ecryptfs_write_metadata(struct dentry *ecryptfs_dentry,
 			    struct inode *ecryptfs_inode);
 int ecryptfs_read_metadata(struct dentry *ecryptfs_dentry);
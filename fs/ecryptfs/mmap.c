@@ -108,6 +108,84 @@ out:
 	return rc;
 }
 
+/*
+ * Locked pages with consecutive indices collected by writepages or
+ * readpages, passed to the cipher and the lower file in one go.
+ */
+struct ecryptfs_page_batch {
+	struct page *pages[ECRYPTFS_MAX_BATCH_PAGES];
+	unsigned int nr_pages;
+};
+
+static int ecryptfs_flush_write_batch(struct ecryptfs_page_batch *batch)
+{
+	unsigned int i;
+	int rc;
+
+	if (!batch->nr_pages)
+		return 0;
+	rc = ecryptfs_encrypt_pages(batch->pages, batch->nr_pages);
+	if (rc)
+		ecryptfs_printk(KERN_WARNING, "Error encrypting pages (upper "
+				"index [0x%.16lx], [%u] pages)\n",
+				batch->pages[0]->index, batch->nr_pages);
+	for (i = 0; i < batch->nr_pages; i++) {
+		if (rc)
+			ClearPageUptodate(batch->pages[i]);
+		else
+			SetPageUptodate(batch->pages[i]);
+		unlock_page(batch->pages[i]);
+	}
+	batch->nr_pages = 0;
+	return rc;
+}
+
+static int ecryptfs_writepages_fill(struct page *page,
+				    struct writeback_control *wbc, void *data)
+{
+	struct ecryptfs_page_batch *batch = data;
+	int rc = 0;
+
+	if (batch->nr_pages == ECRYPTFS_MAX_BATCH_PAGES
+	    || (batch->nr_pages && batch->pages[batch->nr_pages - 1]->index
+				   + 1 != page->index))
+		rc = ecryptfs_flush_write_batch(batch);
+	if (rc) {
+		unlock_page(page);
+		return rc;
+	}
+	batch->pages[batch->nr_pages++] = page;
+	return 0;
+}
+
+/**
+ * ecryptfs_writepages
+ * @mapping: The eCryptfs object
+ * @wbc: The writeback control
+ *
+ * Encrypt runs of up to ECRYPTFS_MAX_BATCH_PAGES dirty pages with all
+ * of their extents in flight on the cipher, and write each run to the
+ * lower file with a single call.
+ *
+ * Returns zero on success; non-zero otherwise
+ */
+static int ecryptfs_writepages(struct address_space *mapping,
+			       struct writeback_control *wbc)
+{
+	struct ecryptfs_crypt_stat *crypt_stat =
+		&ecryptfs_inode_to_private(mapping->host)->crypt_stat;
+	struct ecryptfs_page_batch batch;
+	int rc, flush_rc;
+
+	if (!(crypt_stat->flags & ECRYPTFS_ENCRYPTED))
+		return generic_writepages(mapping, wbc);
+
+	batch.nr_pages = 0;
+	rc = write_cache_pages(mapping, wbc, ecryptfs_writepages_fill, &batch);
+	flush_rc = ecryptfs_flush_write_batch(&batch);
+	return rc ? rc : flush_rc;
+}
+
 static void strip_xattr_flag(char *page_virt,
 			     struct ecryptfs_crypt_stat *crypt_stat)
 {
@@ -272,6 +350,82 @@ out:
 	return rc;
 }
 
+static int ecryptfs_readpage_filler(void *data, struct page *page)
+{
+	return ecryptfs_readpage(data, page);
+}
+
+static void ecryptfs_flush_read_batch(struct ecryptfs_page_batch *batch)
+{
+	unsigned int i;
+	int rc;
+
+	if (!batch->nr_pages)
+		return;
+	rc = ecryptfs_decrypt_pages(batch->pages, batch->nr_pages);
+	if (rc)
+		ecryptfs_printk(KERN_ERR, "Error decrypting pages (upper "
+				"index [0x%.16lx], [%u] pages); rc = [%d]\n",
+				batch->pages[0]->index, batch->nr_pages, rc);
+	for (i = 0; i < batch->nr_pages; i++) {
+		if (rc)
+			ClearPageUptodate(batch->pages[i]);
+		else
+			SetPageUptodate(batch->pages[i]);
+		unlock_page(batch->pages[i]);
+		page_cache_release(batch->pages[i]);
+	}
+	batch->nr_pages = 0;
+}
+
+/**
+ * ecryptfs_readpages
+ * @file: An eCryptfs file
+ * @mapping: The eCryptfs object
+ * @pages: The readahead pages, not yet in the page cache
+ * @nr_pages: The number of pages on @pages
+ *
+ * Read runs of up to ECRYPTFS_MAX_BATCH_PAGES pages from the lower file
+ * with a single call and decrypt them in place, with all of their
+ * extents in flight on the cipher. Files that are not decrypted on the
+ * way up go through ecryptfs_readpage().
+ *
+ * Returns zero; errors are reported through the page flags.
+ */
+static int ecryptfs_readpages(struct file *file, struct address_space *mapping,
+			      struct list_head *pages, unsigned nr_pages)
+{
+	struct ecryptfs_crypt_stat *crypt_stat =
+		&ecryptfs_inode_to_private(mapping->host)->crypt_stat;
+	struct ecryptfs_page_batch batch;
+	struct page *page;
+	unsigned int page_idx;
+
+	if (!(crypt_stat->flags & ECRYPTFS_ENCRYPTED)
+	    || (crypt_stat->flags & ECRYPTFS_VIEW_AS_ENCRYPTED))
+		return read_cache_pages(mapping, pages,
+					ecryptfs_readpage_filler, file);
+
+	batch.nr_pages = 0;
+	for (page_idx = 0; page_idx < nr_pages; page_idx++) {
+		page = list_entry(pages->prev, struct page, lru);
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index,
+					  GFP_KERNEL)) {
+			page_cache_release(page);
+			continue;
+		}
+		if (batch.nr_pages == ECRYPTFS_MAX_BATCH_PAGES
+		    || (batch.nr_pages
+			&& batch.pages[batch.nr_pages - 1]->index + 1
+			   != page->index))
+			ecryptfs_flush_read_batch(&batch);
+		batch.pages[batch.nr_pages++] = page;
+	}
+	ecryptfs_flush_read_batch(&batch);
+	return 0;
+}
+
 /**
  * Called with lower inode mutex held.
  */
@@ -575,7 +729,9 @@ static sector_t ecryptfs_bmap(struct address_space *mapping, sector_t block)
 
 const struct address_space_operations ecryptfs_aops = {
 	.writepage = ecryptfs_writepage,
+	.writepages = ecryptfs_writepages,
 	.readpage = ecryptfs_readpage,
+	.readpages = ecryptfs_readpages,
 	.write_begin = ecryptfs_write_begin,
 	.write_end = ecryptfs_write_end,
 	.bmap = ecryptfs_bmap,
@@ -32,6 +32,7 @@
 #include <linux/crypto.h>
 #include <linux/statfs.h>
 #include <linux/magic.h>
+#include <linux/math64.h>
 #include "ecryptfs_kernel.h"
 
 struct kmem_cache *ecryptfs_inode_info_cache;
@@ -185,11 +186,50 @@ static int ecryptfs_show_options(struct seq_file *m, struct dentry *root)
 	return 0;
 }
 
+/* bytes per nanosecond in MB/s */
+static u64 ecryptfs_rate(u64 bytes, u64 ns)
+{
+	return ns ? div64_u64(bytes * 1000, ns) : 0;
+}
+
+/**
+ * ecryptfs_show_stats
+ *
+ * Prints the data path counters of the mount, with the average
+ * throughput of the cipher, in /proc/<pid>/mountstats.
+ * Returns zero; does not fail.
+ */
+static int ecryptfs_show_stats(struct seq_file *m, struct dentry *root)
+{
+	struct ecryptfs_mount_stats *stats =
+		&ecryptfs_superblock_to_private(root->d_sb)->mount_crypt_stat.stats;
+	u64 bytes_encrypted = atomic64_read(&stats->bytes_encrypted);
+	u64 bytes_decrypted = atomic64_read(&stats->bytes_decrypted);
+	u64 encrypt_ns = atomic64_read(&stats->encrypt_ns);
+	u64 decrypt_ns = atomic64_read(&stats->decrypt_ns);
+
+	seq_printf(m, "statvers=1.0");
+	seq_printf(m, "\n\tencrypt: %llu bytes %llu ns %llu MB/s",
+		   bytes_encrypted, encrypt_ns,
+		   ecryptfs_rate(bytes_encrypted, encrypt_ns));
+	seq_printf(m, "\n\tdecrypt: %llu bytes %llu ns %llu MB/s",
+		   bytes_decrypted, decrypt_ns,
+		   ecryptfs_rate(bytes_decrypted, decrypt_ns));
+	seq_printf(m, "\n\tasync requests: %llu",
+		   (u64)atomic64_read(&stats->async_requests));
+	seq_printf(m, "\n\tlower writes: %llu lower reads: %llu",
+		   (u64)atomic64_read(&stats->lower_writes),
+		   (u64)atomic64_read(&stats->lower_reads));
+
+	return 0;
+}
+
 const struct super_operations ecryptfs_sops = {
 	.alloc_inode = ecryptfs_alloc_inode,
 	.destroy_inode = ecryptfs_destroy_inode,
 	.statfs = ecryptfs_statfs,
 	.remount_fs = NULL,
 	.evict_inode = ecryptfs_evict_inode,
-	.show_options = ecryptfs_show_options
+	.show_options = ecryptfs_show_options,
+	.show_stats = ecryptfs_show_stats
 };
@@ -84,6 +84,8 @@
 #include <linux/fs_struct.h>
 #include <linux/slab.h>
 #include <linux/flex_array.h>
+#include <linux/ksm.h>
+#include <linux/delayacct.h>
 #ifdef CONFIG_HARDWALL
 #include <asm/hardwall.h>
 #endif
@@ -2970,6 +2972,43 @@ static int proc_pid_personality(struct seq_file *m, struct pid_namespace *ns,
 	return err;
 }
 
+#ifdef CONFIG_KSM
+static int proc_pid_ksm_stat(struct seq_file *m, struct pid_namespace *ns,
+			     struct pid *pid, struct task_struct *task)
+{
+	struct mm_struct *mm = get_task_mm(task);
+
+	if (mm) {
+		ksm_mm_stat(m, mm);
+		mmput(mm);
+	}
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_TASK_DELAY_ACCT
+static int proc_pid_reclaim_stall(struct seq_file *m, struct pid_namespace *ns,
+				  struct pid *pid, struct task_struct *task)
+{
+	u32 hist[DELAYACCT_HIST_BUCKETS];
+	u64 total, max;
+	u32 count;
+	int i;
+
+	if (!task->delays)
+		return 0;
+
+	__delayacct_freepages_hist(task, &total, &max, &count, hist);
+	seq_printf(m, "stalls %u\ntotal_us %llu\nmax_us %llu\n", count,
+		   div_u64(total, NSEC_PER_USEC), div_u64(max, NSEC_PER_USEC));
+	seq_printf(m, "<1ms %u\n", hist[0]);
+	for (i = 1; i < DELAYACCT_HIST_BUCKETS - 1; i++)
+		seq_printf(m, "<%ums %u\n", 1U << i, hist[i]);
+	seq_printf(m, ">=%ums %u\n", 1U << (i - 1), hist[i]);
+	return 0;
+}
+#endif
+
 /*
  * Thread groups
  */
@@ -2992,6 +3031,12 @@ static const struct pid_entry tgid_base_stuff[] = {
 	ONE("status",     S_IRUGO, proc_pid_status),
 	ONE("personality", S_IRUGO, proc_pid_personality),
 	INF("limits",	  S_IRUGO, proc_pid_limits),
+#ifdef CONFIG_KSM
+	ONE("ksm_stat",   S_IRUSR, proc_pid_ksm_stat),
+#endif
+#ifdef CONFIG_TASK_DELAY_ACCT
+	ONE("reclaim_stall", S_IRUGO, proc_pid_reclaim_stall),
+#endif
 #ifdef CONFIG_SCHED_DEBUG
 	REG("sched",      S_IRUGO|S_IWUSR, proc_pid_sched_operations),
 #endif
@@ -3354,6 +3399,9 @@ static const struct pid_entry tid_base_stuff[] = {
 	ONE("status",    S_IRUGO, proc_pid_status),
 	ONE("personality", S_IRUGO, proc_pid_personality),
 	INF("limits",	 S_IRUGO, proc_pid_limits),
+#ifdef CONFIG_TASK_DELAY_ACCT
+	ONE("reclaim_stall", S_IRUGO, proc_pid_reclaim_stall),
+#endif
 #ifdef CONFIG_SCHED_DEBUG
 	REG("sched",     S_IRUGO|S_IWUSR, proc_pid_sched_operations),
 #endif
@@ -22,6 +22,7 @@
 
 #include <linux/crypto.h>
 
+struct scatterlist;
 
 struct comp_request {
 	const void *next_in;		/* next input byte */
@@ -142,4 +143,36 @@ static inline int crypto_decompress_final(struct crypto_pcomp *tfm,
 	return crypto_pcomp_alg(tfm)->decompress_final(tfm, req);
 }
 
+/*
+ * A pool of "comp" transforms, one for each CPU, so that callers in any
+ * context can compress without allocating a transform or serialising on
+ * a shared one. The operations run with preemption disabled and must not
+ * be called from hard interrupt context.
+ *
+ * The scatterlist operations linearise their input and output through
+ * per-CPU buffers of scratch_size bytes, except when they fit in a single
+ * page which is mapped directly. A pool allocated with a scratch_size of
+ * zero only supports buffers and single page scatterlists.
+ */
+struct crypto_comp_pool;
+
+struct crypto_comp_pool *crypto_alloc_comp_pool(const char *alg_name,
+						u32 type, u32 mask,
+						unsigned int scratch_size);
+void crypto_free_comp_pool(struct crypto_comp_pool *pool);
+
+int crypto_comp_pool_compress(struct crypto_comp_pool *pool,
+			      const u8 *src, unsigned int slen,
+			      u8 *dst, unsigned int *dlen);
+int crypto_comp_pool_decompress(struct crypto_comp_pool *pool,
+				const u8 *src, unsigned int slen,
+				u8 *dst, unsigned int *dlen);
+
+int crypto_comp_pool_compress_sg(struct crypto_comp_pool *pool,
+				 struct scatterlist *src, unsigned int slen,
+				 struct scatterlist *dst, unsigned int *dlen);
+int crypto_comp_pool_decompress_sg(struct crypto_comp_pool *pool,
+				   struct scatterlist *src, unsigned int slen,
+				   struct scatterlist *dst, unsigned int *dlen);
+
 #endif	/* _CRYPTO_COMPRESS_H */
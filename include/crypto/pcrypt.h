@@ -25,8 +25,11 @@
 #include <linux/kernel.h>
 #include <linux/padata.h>
 
+struct padata_pcrypt;
+
 struct pcrypt_request {
 	struct padata_priv	padata;
+	struct padata_pcrypt	*pcrypt;
 	void			*data;
 	void			*__ctx[] CRYPTO_MINALIGN_ATTR;
 };
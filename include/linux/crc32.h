@@ -13,6 +13,10 @@ extern u32  crc32_be(u32 crc, unsigned char const *p, size_t len);
 
 extern u32  __crc32c_le(u32 crc, unsigned char const *p, size_t len);
 
+/* the table driven versions, for architecture code overriding the above */
+extern u32  crc32_le_base(u32 crc, unsigned char const *p, size_t len);
+extern u32  __crc32c_le_base(u32 crc, unsigned char const *p, size_t len);
+
 #define crc32(seed, data, length)  crc32_le(seed, (unsigned char const *)(data), length)
 
 /*
@@ -41,6 +41,8 @@ extern int __delayacct_add_tsk(struct taskstats *, struct task_struct *);
 extern __u64 __delayacct_blkio_ticks(struct task_struct *);
 extern void __delayacct_freepages_start(void);
 extern void __delayacct_freepages_end(void);
+extern void __delayacct_freepages_hist(struct task_struct *tsk, u64 *total,
+				       u64 *max, u32 *count, u32 *hist);
 
 static inline int delayacct_is_task_waiting_on_io(struct task_struct *p)
 {
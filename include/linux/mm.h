@@ -1471,6 +1471,11 @@ void page_cache_async_readahead(struct address_space *mapping,
 				struct page *pg,
 				pgoff_t offset,
 				unsigned long size);
+void page_cache_mmap_readaround(struct address_space *mapping,
+				struct file_ra_state *ra,
+				struct file *filp,
+				pgoff_t offset,
+				bool lotsamiss);
 
 unsigned long max_sane_readahead(unsigned long nr);
 unsigned long ra_submit(struct file_ra_state *ra,
@@ -70,6 +70,7 @@ enum {
 extern int *get_migratetype_fallbacks(int mtype);
 
 #ifdef CONFIG_CMA
+extern int sysctl_cma_movable_fallback;
 bool is_cma_pageblock(struct page *page);
 #  define is_migrate_cma(migratetype) unlikely((migratetype) == MIGRATE_CMA)
 #else
@@ -149,6 +150,8 @@ enum zone_stat_item {
 	NUMA_LOCAL,		/* allocation from local node */
 	NUMA_OTHER,		/* allocation from other node */
 #endif
+	WORKINGSET_REFAULT,	/* evicted file pages read back in */
+	WORKINGSET_ACTIVATE,	/* refaulted pages activated right away */
 	NR_ANON_TRANSPARENT_HUGEPAGES,
 	NR_FREE_CMA_PAGES,
 	NR_VM_ZONE_STAT_ITEMS };
@@ -224,8 +227,8 @@ enum zone_watermarks {
 };
 
 #define min_wmark_pages(z) (z->watermark[WMARK_MIN])
-#define low_wmark_pages(z) (z->watermark[WMARK_LOW])
-#define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
+#define low_wmark_pages(z) (z->watermark[WMARK_LOW] + z->watermark_boost)
+#define high_wmark_pages(z) (z->watermark[WMARK_HIGH] + z->watermark_boost)
 
 struct per_cpu_pages {
 	int count;		/* number of pages in the list */
@@ -339,6 +342,13 @@ struct zone {
 	/* zone watermarks, access with *_wmark_pages(zone) macros */
 	unsigned long watermark[NR_WMARK];
 
+	/*
+	 * Raised on the low and high watermarks when allocations enter
+	 * direct reclaim, so that kswapd reclaims further ahead of them.
+	 * See boost_watermarks() in mm/vmscan.c.
+	 */
+	unsigned long watermark_boost;
+
 	/*
 	 * When free pages are below this point, additional steps are taken
 	 * when reading the number of free pages to avoid per-cpu counter
@@ -431,6 +441,9 @@ struct zone {
 	 */
 	unsigned int inactive_ratio;
 
+	/* Evictions and activations on the file LRU, see mm/workingset.c */
+	atomic_long_t		inactive_age;
+
 
 	ZONE_PADDING(_pad2_)
 	/* Rarely used or read-mostly fields */
@@ -709,6 +722,12 @@ typedef struct pglist_data {
 	struct task_struct *kswapd;
 	int kswapd_max_order;
 	enum zone_type classzone_idx;
+#ifdef CONFIG_COMPACTION
+	int kcompactd_max_order;
+	enum zone_type kcompactd_classzone_idx;
+	wait_queue_head_t kcompactd_wait;
+	struct task_struct *kcompactd;
+#endif
 } pg_data_t;
 
 #define node_present_pages(nid)	(NODE_DATA(nid)->node_present_pages)
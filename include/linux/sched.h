@@ -145,6 +145,37 @@ extern unsigned long this_cpu_load(void);
 extern void sched_update_nr_prod(int cpu, unsigned long nr, bool inc);
 extern void sched_get_nr_running_avg(int *avg, int *iowait_avg);
 
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Utilization update callback for cpufreq governors, called by the
+ * scheduler with the rq lock of the cpu held, but not necessarily on
+ * that cpu. @util is the utilization of the cpu out of @max.
+ */
+struct update_util_data {
+	void (*func)(struct update_util_data *data, u64 time,
+		     unsigned long util, unsigned long max);
+};
+
+extern void cpufreq_set_update_util_data(int cpu,
+					 struct update_util_data *data);
+extern void cpufreq_update_util_wake(struct task_struct *p);
+extern void cpufreq_update_util_cancel_wake(struct task_struct *p);
+#endif
+
+#ifdef CONFIG_SCHED_FREQ_INPUT
+extern int sched_set_window(u64 window_start, unsigned int window_size);
+extern unsigned long sched_get_busy(int cpu);
+#else
+static inline int sched_set_window(u64 window_start, unsigned int window_size)
+{
+	return -EINVAL;
+}
+static inline unsigned long sched_get_busy(int cpu)
+{
+	return 0;
+}
+#endif
+
 extern void calc_global_load(unsigned long ticks);
 
 extern unsigned long get_parent_ip(unsigned long addr);
@@ -762,6 +793,8 @@ struct sched_info {
 #endif /* defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT) */
 
 #ifdef CONFIG_TASK_DELAY_ACCT
+#define DELAYACCT_HIST_BUCKETS	8
+
 struct task_delay_info {
 	spinlock_t	lock;
 	unsigned int	flags;	/* Private per-task flags */
@@ -792,6 +825,13 @@ struct task_delay_info {
 	struct timespec freepages_start, freepages_end;
 	u64 freepages_delay;	/* wait for memory reclaim */
 	u32 freepages_count;	/* total count of memory reclaim */
+	u64 freepages_max;	/* longest single memory reclaim */
+	/*
+	 * Memory reclaim count by duration: bucket 0 counts reclaims under
+	 * 1ms, bucket n the ones from 2^(n-1) up to 2^n ms, and the last
+	 * bucket everything longer.
+	 */
+	u32 freepages_hist[DELAYACCT_HIST_BUCKETS];
 };
 #endif	/* CONFIG_TASK_DELAY_ACCT */
 
@@ -1206,6 +1246,35 @@ struct sched_statistics {
 };
 #endif
 
+/*
+ * Per-entity load tracking: runnable_avg_sum and running_avg_sum are the
+ * geometrically decayed (y^32 = 1/2, one period is 1024us) amounts of time
+ * the entity was runnable and running, over the equally decayed
+ * runnable_avg_period. load_avg_contrib is the runnable average scaled by
+ * the entity's weight, util_avg the running average scaled to
+ * SCHED_POWER_SCALE.
+ */
+struct sched_avg {
+	u64			last_runnable_update;
+	u32			runnable_avg_sum;
+	u32			running_avg_sum;
+	u32			runnable_avg_period;
+	unsigned long		load_avg_contrib;
+	unsigned long		util_avg;
+};
+
+#ifdef CONFIG_SCHED_FREQ_INPUT
+/*
+ * Busy time of a task in the current and the previous window of the
+ * scheduler's window-based load tracking, in ns. mark_start is the time
+ * up to which the task has been accounted.
+ */
+struct ravg {
+	u64 mark_start;
+	u32 curr_window, prev_window;
+};
+#endif
+
 struct sched_entity {
 	struct load_weight	load;		/* for load-balancing */
 	struct rb_node		run_node;
@@ -1219,6 +1288,11 @@ struct sched_entity {
 
 	u64			nr_migrations;
 
+#ifdef CONFIG_SMP
+	/* Per-entity load tracking */
+	struct sched_avg	avg;
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_statistics statistics;
 #endif
@@ -1281,6 +1355,9 @@ struct task_struct {
 	const struct sched_class *sched_class;
 	struct sched_entity se;
 	struct sched_rt_entity rt;
+#ifdef CONFIG_SCHED_FREQ_INPUT
+	struct ravg ravg;
+#endif
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	/* list of struct preempt_notifier: */
@@ -2042,6 +2119,9 @@ extern unsigned int sysctl_sched_min_granularity;
 extern unsigned int sysctl_sched_wakeup_granularity;
 extern unsigned int sysctl_sched_child_runs_first;
 extern unsigned int sysctl_sched_wake_to_idle;
+#ifdef CONFIG_SCHED_ENERGY
+extern unsigned int sysctl_sched_small_task_pct;
+#endif
 
 enum sched_tunable_scaling {
 	SCHED_TUNABLESCALING_NONE,
@@ -0,0 +1,61 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_sched
+
+#if !defined(_TRACE_CPUFREQ_SCHED_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_SCHED_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(cpufreq_sched_request,
+	    TP_PROTO(unsigned int cpu_id, unsigned long util,
+		     unsigned long max, unsigned int curtarg,
+		     unsigned int newtarg),
+	    TP_ARGS(cpu_id, util, max, curtarg, newtarg),
+
+	    TP_STRUCT__entry(
+		    __field(unsigned int, cpu_id)
+		    __field(unsigned long, util)
+		    __field(unsigned long, max)
+		    __field(unsigned int, curtarg)
+		    __field(unsigned int, newtarg)
+	    ),
+
+	    TP_fast_assign(
+		    __entry->cpu_id = cpu_id;
+		    __entry->util = util;
+		    __entry->max = max;
+		    __entry->curtarg = curtarg;
+		    __entry->newtarg = newtarg;
+	    ),
+
+	    TP_printk("cpu=%u util=%lu max=%lu cur=%u targ=%u",
+		      __entry->cpu_id, __entry->util, __entry->max,
+		      __entry->curtarg, __entry->newtarg)
+);
+
+TRACE_EVENT(cpufreq_sched_setspeed,
+	    TP_PROTO(unsigned int cpu_id, unsigned int targfreq,
+		     unsigned int actualfreq),
+	    TP_ARGS(cpu_id, targfreq, actualfreq),
+
+	    TP_STRUCT__entry(
+		    __field(unsigned int, cpu_id)
+		    __field(unsigned int, targfreq)
+		    __field(unsigned int, actualfreq)
+	    ),
+
+	    TP_fast_assign(
+		    __entry->cpu_id = cpu_id;
+		    __entry->targfreq = targfreq;
+		    __entry->actualfreq = actualfreq;
+	    ),
+
+	    TP_printk("cpu=%u targ=%u actual=%u",
+		      __entry->cpu_id, __entry->targfreq,
+		      __entry->actualfreq)
+);
+
+#endif /* _TRACE_CPUFREQ_SCHED_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
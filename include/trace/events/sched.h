@@ -217,6 +217,71 @@ TRACE_EVENT(sched_migrate_task,
 		  __entry->orig_cpu, __entry->dest_cpu)
 );
 
+#ifdef CONFIG_SCHED_FREQ_INPUT
+/*
+ * Tracepoint for the window busy times of the cpus involved in the
+ * migration of a task, after the busy time of the task has moved:
+ */
+TRACE_EVENT(sched_migration_update_sum,
+
+	TP_PROTO(struct task_struct *p, int src_cpu, u64 src_cs, u64 src_ps,
+		 int dest_cpu, u64 dest_cs, u64 dest_ps),
+
+	TP_ARGS(p, src_cpu, src_cs, src_ps, dest_cpu, dest_cs, dest_ps),
+
+	TP_STRUCT__entry(
+		__field(	pid_t,	pid			)
+		__field(	u32,	curr_window		)
+		__field(	u32,	prev_window		)
+		__field(	int,	src_cpu			)
+		__field(	u64,	src_cs			)
+		__field(	u64,	src_ps			)
+		__field(	int,	dest_cpu		)
+		__field(	u64,	dest_cs			)
+		__field(	u64,	dest_ps			)
+	),
+
+	TP_fast_assign(
+		__entry->pid		= p->pid;
+		__entry->curr_window	= p->ravg.curr_window;
+		__entry->prev_window	= p->ravg.prev_window;
+		__entry->src_cpu	= src_cpu;
+		__entry->src_cs		= src_cs;
+		__entry->src_ps		= src_ps;
+		__entry->dest_cpu	= dest_cpu;
+		__entry->dest_cs	= dest_cs;
+		__entry->dest_ps	= dest_ps;
+	),
+
+	TP_printk("pid=%d curr_window=%u prev_window=%u src_cpu=%d src_cs=%llu src_ps=%llu dest_cpu=%d dest_cs=%llu dest_ps=%llu",
+		  __entry->pid, __entry->curr_window, __entry->prev_window,
+		  __entry->src_cpu, __entry->src_cs, __entry->src_ps,
+		  __entry->dest_cpu, __entry->dest_cs, __entry->dest_ps)
+);
+
+/*
+ * Tracepoint for a governor reading the busy time of a cpu:
+ */
+TRACE_EVENT(sched_get_busy,
+
+	TP_PROTO(int cpu, u64 busy),
+
+	TP_ARGS(cpu, busy),
+
+	TP_STRUCT__entry(
+		__field(	int,	cpu			)
+		__field(	u64,	busy			)
+	),
+
+	TP_fast_assign(
+		__entry->cpu		= cpu;
+		__entry->busy		= busy;
+	),
+
+	TP_printk("cpu=%d busy=%llu", __entry->cpu, __entry->busy)
+);
+#endif
+
 /*
  * Tracepoint for a CPU going offline/online:
  */
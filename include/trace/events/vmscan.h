@@ -179,6 +179,36 @@ DEFINE_EVENT(mm_vmscan_direct_reclaim_end_template, mm_vmscan_memcg_softlimit_re
 	TP_ARGS(nr_reclaimed)
 );
 
+TRACE_EVENT(mm_vmscan_direct_reclaim_stall,
+
+	TP_PROTO(int order, unsigned long nr_reclaimed, u64 delay),
+
+	TP_ARGS(order, nr_reclaimed, delay),
+
+	TP_STRUCT__entry(
+		__array(	char,	comm,	TASK_COMM_LEN	)
+		__field(	pid_t,	pid			)
+		__field(	int,	order			)
+		__field(	unsigned long,	nr_reclaimed	)
+		__field(	u64,	delay			)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, current->comm, TASK_COMM_LEN);
+		__entry->pid		= current->pid;
+		__entry->order		= order;
+		__entry->nr_reclaimed	= nr_reclaimed;
+		__entry->delay		= delay;
+	),
+
+	TP_printk("comm=%s pid=%d order=%d nr_reclaimed=%lu delay=%llu",
+		__entry->comm,
+		__entry->pid,
+		__entry->order,
+		__entry->nr_reclaimed,
+		(unsigned long long)__entry->delay)
+);
+
 TRACE_EVENT(mm_shrink_slab_start,
 	TP_PROTO(struct shrinker *shr, struct shrink_control *sc,
 		long nr_objects_to_shrink, unsigned long pgs_scanned,
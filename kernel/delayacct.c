@@ -178,9 +178,49 @@ void __delayacct_freepages_start(void)
 
 void __delayacct_freepages_end(void)
 {
-	delayacct_end(&current->delays->freepages_start,
-			&current->delays->freepages_end,
-			&current->delays->freepages_delay,
-			&current->delays->freepages_count);
+	struct task_delay_info *delays = current->delays;
+	struct timespec ts;
+	unsigned long flags;
+	u64 ms;
+	s64 ns;
+	int bucket;
+
+	do_posix_clock_monotonic_gettime(&delays->freepages_end);
+	ts = timespec_sub(delays->freepages_end, delays->freepages_start);
+	ns = timespec_to_ns(&ts);
+	if (ns < 0)
+		return;
+
+	ms = div_u64(ns, NSEC_PER_MSEC);
+	if (ms >= 1ULL << (DELAYACCT_HIST_BUCKETS - 2))
+		bucket = DELAYACCT_HIST_BUCKETS - 1;
+	else
+		bucket = fls(ms);
+
+	spin_lock_irqsave(&delays->lock, flags);
+	delays->freepages_delay += ns;
+	delays->freepages_count++;
+	delays->freepages_hist[bucket]++;
+	if (ns > delays->freepages_max)
+		delays->freepages_max = ns;
+	spin_unlock_irqrestore(&delays->lock, flags);
+}
+
+/*
+ * Memory reclaim stalls of @tsk: count, total and longest stall, and the
+ * number of stalls per duration bucket, see struct task_delay_info.
+ */
+void __delayacct_freepages_hist(struct task_struct *tsk, u64 *total,
+				u64 *max, u32 *count, u32 *hist)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&tsk->delays->lock, flags);
+	*total = tsk->delays->freepages_delay;
+	*max = tsk->delays->freepages_max;
+	*count = tsk->delays->freepages_count;
+	memcpy(hist, tsk->delays->freepages_hist,
+	       sizeof(tsk->delays->freepages_hist));
+	spin_unlock_irqrestore(&tsk->delays->lock, flags);
 }
 
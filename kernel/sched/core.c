@@ -742,6 +742,7 @@ static void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 	sched_info_queued(p);
 	p->sched_class->enqueue_task(rq, p, flags);
 	trace_sched_enq_deq_task(p, 1);
+	cpufreq_update_util(rq);
 }
 
 static void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
@@ -750,6 +751,7 @@ static void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
 	sched_info_dequeued(p);
 	p->sched_class->dequeue_task(rq, p, flags);
 	trace_sched_enq_deq_task(p, 0);
+	cpufreq_update_util(rq);
 }
 
 void activate_task(struct rq *rq, struct task_struct *p, int flags)
@@ -1107,6 +1109,256 @@ void check_preempt_curr(struct rq *rq, struct task_struct *p, int flags)
 		rq->skip_clock_update = 1;
 }
 
+#ifdef CONFIG_SCHED_FREQ_INPUT
+/*
+ * Window-based busy time accounting. A cpufreq governor sets up windows
+ * of a fixed size with sched_set_window(), aligned on all cpus, and reads
+ * the busy time of a cpu in the last complete window with
+ * sched_get_busy(). The time a task runs is charged both to the window
+ * sums of its runqueue and to the task itself, so that the busy time of
+ * the task can move with it when it migrates. Accounting is disabled
+ * until a window has been set.
+ */
+static unsigned int __read_mostly sched_ravg_window;
+
+#define MIN_SCHED_RAVG_WINDOW	(10 * NSEC_PER_MSEC)
+#define MAX_SCHED_RAVG_WINDOW	NSEC_PER_SEC
+
+/* Roll the windows of @rq forward to cover @wallclock */
+static void update_window_start(struct rq *rq, u64 wallclock)
+{
+	u64 delta, nr_windows;
+
+	delta = wallclock - rq->window_start;
+	if ((s64)delta < 0 || delta < sched_ravg_window)
+		return;
+
+	nr_windows = div64_u64(delta, sched_ravg_window);
+	rq->window_start += nr_windows * sched_ravg_window;
+	rq->prev_runnable_sum = nr_windows == 1 ? rq->curr_runnable_sum : 0;
+	rq->curr_runnable_sum = 0;
+}
+
+/*
+ * Account the time @p spent since it was last accounted, as busy time if
+ * @running, and roll its windows forward to the current window of @rq.
+ * The windows of @rq must have been updated to @wallclock.
+ */
+static void update_task_ravg(struct task_struct *p, struct rq *rq,
+			     u64 wallclock, int running)
+{
+	u64 window_start = rq->window_start;
+	u64 mark_start = p->ravg.mark_start;
+	u32 window = sched_ravg_window;
+
+	if (!mark_start || (s64)(wallclock - mark_start) < 0)
+		goto done;
+
+	if (!running || is_idle_task(p)) {
+		if (mark_start < window_start) {
+			p->ravg.prev_window = mark_start < window_start - window ?
+					      0 : p->ravg.curr_window;
+			p->ravg.curr_window = 0;
+		}
+		goto done;
+	}
+
+	if (mark_start >= window_start) {
+		/* still within the current window */
+		p->ravg.curr_window += wallclock - mark_start;
+		rq->curr_runnable_sum += wallclock - mark_start;
+	} else if (mark_start >= window_start - window) {
+		/* crossed one window boundary */
+		p->ravg.prev_window = p->ravg.curr_window +
+				      (window_start - mark_start);
+		p->ravg.curr_window = wallclock - window_start;
+		rq->prev_runnable_sum += window_start - mark_start;
+		rq->curr_runnable_sum += wallclock - window_start;
+	} else {
+		/* busy through the whole previous window */
+		p->ravg.prev_window = window;
+		p->ravg.curr_window = wallclock - window_start;
+		rq->prev_runnable_sum = window;
+		rq->curr_runnable_sum += wallclock - window_start;
+	}
+
+	rq->prev_runnable_sum = min_t(u64, rq->prev_runnable_sum, window);
+done:
+	p->ravg.mark_start = wallclock;
+}
+
+static inline void
+update_task_ravg_now(struct task_struct *p, struct rq *rq, int running)
+{
+	u64 wallclock;
+
+	if (!sched_ravg_window)
+		return;
+
+	wallclock = sched_clock();
+	update_window_start(rq, wallclock);
+	update_task_ravg(p, rq, wallclock, running);
+}
+
+static inline void
+update_ravg_switch(struct rq *rq, struct task_struct *prev,
+		   struct task_struct *next)
+{
+	u64 wallclock;
+
+	if (!sched_ravg_window)
+		return;
+
+	wallclock = sched_clock();
+	update_window_start(rq, wallclock);
+	update_task_ravg(prev, rq, wallclock, 1);
+	update_task_ravg(next, rq, wallclock, 0);
+}
+
+static inline void sub_busy(u64 *sum, u32 delta)
+{
+	*sum = *sum > delta ? *sum - delta : 0;
+}
+
+/*
+ * Move the busy time @p accumulated on its current cpu in the current
+ * and the previous window to @new_cpu. Runnable tasks are migrated with
+ * both runqueue locks held; waking tasks only hold p->pi_lock, so the
+ * locks are taken here.
+ */
+static void fixup_busy_time(struct task_struct *p, int new_cpu)
+{
+	struct rq *src_rq = task_rq(p);
+	struct rq *dest_rq = cpu_rq(new_cpu);
+	int waking = p->state == TASK_WAKING;
+	u64 wallclock;
+
+	if (!sched_ravg_window || !p->ravg.mark_start)
+		return;
+
+	if (!p->on_rq && !waking)
+		return;
+
+	if (waking)
+		double_rq_lock(src_rq, dest_rq);
+
+	wallclock = sched_clock();
+	update_window_start(src_rq, wallclock);
+	update_window_start(dest_rq, wallclock);
+	update_task_ravg(p, src_rq, wallclock, 0);
+
+	sub_busy(&src_rq->curr_runnable_sum, p->ravg.curr_window);
+	sub_busy(&src_rq->prev_runnable_sum, p->ravg.prev_window);
+	dest_rq->curr_runnable_sum += p->ravg.curr_window;
+	dest_rq->prev_runnable_sum = min_t(u64, sched_ravg_window,
+			dest_rq->prev_runnable_sum + p->ravg.prev_window);
+
+	trace_sched_migration_update_sum(p, cpu_of(src_rq),
+					 src_rq->curr_runnable_sum,
+					 src_rq->prev_runnable_sum, new_cpu,
+					 dest_rq->curr_runnable_sum,
+					 dest_rq->prev_runnable_sum);
+
+	if (waking)
+		double_rq_unlock(src_rq, dest_rq);
+}
+
+/**
+ * sched_set_window - set up window-based busy time accounting
+ * @window_start: start of a window, in sched_clock() time
+ * @window_size: size of the windows, in ns
+ *
+ * Windows on all cpus are aligned on @window_start, and the busy time
+ * accounted so far, on the runqueues and in the tasks, is discarded.
+ */
+int sched_set_window(u64 window_start, unsigned int window_size)
+{
+	u64 now = sched_clock();
+	struct task_struct *g, *p;
+	unsigned long flags;
+	int cpu;
+
+	if (window_size < MIN_SCHED_RAVG_WINDOW ||
+	    window_size > MAX_SCHED_RAVG_WINDOW)
+		return -EINVAL;
+
+	if ((s64)(now - window_start) < 0)
+		return -EINVAL;
+
+	window_start += div64_u64(now - window_start, window_size) *
+			window_size;
+
+	for_each_possible_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+
+		raw_spin_lock_irqsave(&rq->lock, flags);
+		rq->window_start = window_start;
+		rq->curr_runnable_sum = 0;
+		rq->prev_runnable_sum = 0;
+		raw_spin_unlock_irqrestore(&rq->lock, flags);
+	}
+
+	sched_ravg_window = window_size;
+
+	/*
+	 * The windows of the tasks were sized and aligned for the old
+	 * window, start them afresh with their next accounting event.
+	 */
+	read_lock_irqsave(&tasklist_lock, flags);
+	do_each_thread(g, p) {
+		struct rq *rq;
+
+		raw_spin_lock(&p->pi_lock);
+		rq = __task_rq_lock(p);
+		memset(&p->ravg, 0, sizeof(p->ravg));
+		__task_rq_unlock(rq);
+		raw_spin_unlock(&p->pi_lock);
+	} while_each_thread(g, p);
+	read_unlock_irqrestore(&tasklist_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sched_set_window);
+
+/**
+ * sched_get_busy - busy time of a cpu in the last complete window
+ * @cpu: the cpu
+ *
+ * Returns the time, in us, @cpu spent running tasks in the previous
+ * window, including the share of that window of the tasks that have
+ * migrated to @cpu since.
+ */
+unsigned long sched_get_busy(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	unsigned long flags;
+	u64 busy;
+
+	if (!sched_ravg_window)
+		return 0;
+
+	raw_spin_lock_irqsave(&rq->lock, flags);
+	update_task_ravg_now(rq->curr, rq, 1);
+	busy = rq->prev_runnable_sum;
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
+
+	busy = div64_u64(busy, NSEC_PER_USEC);
+	trace_sched_get_busy(cpu, busy);
+
+	return busy;
+}
+EXPORT_SYMBOL_GPL(sched_get_busy);
+#else
+static inline void
+update_task_ravg_now(struct task_struct *p, struct rq *rq, int running) { }
+
+static inline void
+update_ravg_switch(struct rq *rq, struct task_struct *prev,
+		   struct task_struct *next) { }
+
+static inline void fixup_busy_time(struct task_struct *p, int new_cpu) { }
+#endif /* CONFIG_SCHED_FREQ_INPUT */
+
 #ifdef CONFIG_SMP
 void set_task_cpu(struct task_struct *p, unsigned int new_cpu)
 {
@@ -1139,6 +1391,7 @@ void set_task_cpu(struct task_struct *p, unsigned int new_cpu)
 	if (task_cpu(p) != new_cpu) {
 		p->se.nr_migrations++;
 		perf_sw_event(PERF_COUNT_SW_CPU_MIGRATIONS, 1, NULL, 0);
+		fixup_busy_time(p, new_cpu);
 	}
 
 	__set_task_cpu(p, new_cpu);
@@ -1507,6 +1760,7 @@ static void sched_ttwu_pending(void)
 	}
 
 	raw_spin_unlock(&rq->lock);
+	cpufreq_update_util_wake_pending();
 }
 
 void scheduler_ipi(void)
@@ -1665,6 +1919,7 @@ stat:
 	ttwu_stat(p, cpu, wake_flags);
 out:
 	raw_spin_unlock_irqrestore(&p->pi_lock, flags);
+	cpufreq_update_util_wake_pending();
 
 	if (src_cpu != cpu && task_notify_on_migrate(p))
 		atomic_notifier_call_chain(&migration_notifier_head,
@@ -1748,6 +2003,14 @@ static void __sched_fork(struct task_struct *p)
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
 
+#ifdef CONFIG_SMP
+	memset(&p->se.avg, 0, sizeof(p->se.avg));
+#endif
+
+#ifdef CONFIG_SCHED_FREQ_INPUT
+	memset(&p->ravg, 0, sizeof(p->ravg));
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
@@ -1868,6 +2131,7 @@ void wake_up_new_task(struct task_struct *p)
 		p->sched_class->task_woken(rq, p);
 #endif
 	task_rq_unlock(rq, p, &flags);
+	cpufreq_update_util_wake_pending();
 }
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
@@ -3061,7 +3325,10 @@ void scheduler_tick(void)
 	update_rq_clock(rq);
 	update_cpu_load_active(rq);
 	curr->sched_class->task_tick(rq, curr, 0);
+	update_task_ravg_now(curr, rq, 1);
+	cpufreq_update_util(rq);
 	raw_spin_unlock(&rq->lock);
+	cpufreq_update_util_wake_pending();
 
 	perf_event_task_tick();
 
@@ -3261,6 +3528,7 @@ need_resched:
 	rq->skip_clock_update = 0;
 
 	if (likely(prev != next)) {
+		update_ravg_switch(rq, prev, next);
 		rq->nr_switches++;
 		rq->curr = next;
 		++*switch_count;
@@ -3281,6 +3549,7 @@ need_resched:
 		raw_spin_unlock_irq(&rq->lock);
 
 	post_schedule(rq);
+	cpufreq_update_util_wake_pending();
 
 	sched_preempt_enable_no_resched();
 	if (need_resched())
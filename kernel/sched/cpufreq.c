@@ -0,0 +1,75 @@
+/*
+ * Scheduler code and data structures related to cpufreq.
+ *
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/module.h>
+
+#include "sched.h"
+
+DEFINE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/**
+ * cpufreq_set_update_util_data - set the utilization update callback of a cpu
+ * @cpu: the cpu whose callback is set
+ * @data: the callback, or NULL to clear it
+ *
+ * Once set, @data->func is called by the scheduler with the utilization
+ * of @cpu on every enqueue, dequeue and tick of its runqueue. The caller
+ * has to wait for a synchronize_sched() grace period after clearing the
+ * callback before freeing @data.
+ */
+void cpufreq_set_update_util_data(int cpu, struct update_util_data *data)
+{
+	if (WARN_ON(data && !data->func))
+		return;
+
+	rcu_assign_pointer(per_cpu(cpufreq_update_util_data, cpu), data);
+}
+EXPORT_SYMBOL_GPL(cpufreq_set_update_util_data);
+
+DEFINE_PER_CPU(struct task_struct *, cpufreq_wake_task);
+
+/**
+ * cpufreq_update_util_wake - wake up a task once the rq lock is dropped
+ * @p: the task to wake up
+ *
+ * Called from an update_util_data callback, which runs with a rq lock
+ * held and so cannot wake up tasks itself. The wake-up is done by the
+ * scheduler on this cpu as soon as it has released the lock, see
+ * cpufreq_update_util_wake_pending().
+ */
+void cpufreq_update_util_wake(struct task_struct *p)
+{
+	__this_cpu_write(cpufreq_wake_task, p);
+}
+EXPORT_SYMBOL_GPL(cpufreq_update_util_wake);
+
+/**
+ * cpufreq_update_util_cancel_wake - drop the pending wake-ups of a task
+ * @p: the task
+ *
+ * Must be called after the callbacks that may ask to wake up @p are
+ * cleared, and before @p exits.
+ */
+void cpufreq_update_util_cancel_wake(struct task_struct *p)
+{
+	int cpu;
+
+	synchronize_sched();
+	for_each_possible_cpu(cpu)
+		cmpxchg(&per_cpu(cpufreq_wake_task, cpu), p, NULL);
+	/* wait for wake-ups that already took @p off the list */
+	synchronize_sched();
+}
+EXPORT_SYMBOL_GPL(cpufreq_update_util_cancel_wake);
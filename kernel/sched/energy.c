@@ -0,0 +1,236 @@
+/*
+ * Energy model for energy-aware task placement
+ *
+ * Each CPU is described by a table of operating points, every entry
+ * giving the frequency, the compute capacity (relative to
+ * SCHED_POWER_SCALE at the fastest operating point of the fastest CPU)
+ * and the power drawn while busy at that point. Two idle power figures
+ * complete the description: the power of the shallow idle state a CPU
+ * sits in between the bursts of its tasks, and the power of the deep
+ * idle state a CPU reaches when it has nothing to run at all.
+ *
+ * The tables are read from the device tree cpu nodes:
+ *
+ *	cpu@0 {
+ *		...
+ *		sched-energy-costs = <300000 140 84>, <960000 447 252>, ...;
+ *		sched-idle-power = <36 3>;
+ *	};
+ *
+ * Every CPU is assumed to have its own frequency domain, as is the case
+ * for Krait. The model is only used if every possible CPU has a table.
+ */
+
+#include <linux/slab.h>
+#include <linux/of.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "sched.h"
+
+DEFINE_PER_CPU(struct sched_energy *, sched_energy);
+bool sched_energy_present __read_mostly;
+
+/*
+ * Tasks whose estimated utilization is below this percentage of
+ * SCHED_POWER_SCALE are considered for packing.
+ */
+unsigned int __read_mostly sysctl_sched_small_task_pct = 20;
+
+/*
+ * Headroom kept when picking an operating point for a given utilization,
+ * and when deciding whether a task still fits on a CPU: util * 1.25 must
+ * not exceed the capacity.
+ */
+#define SCHED_ENERGY_MARGIN	1280
+
+static inline int energy_fits(unsigned long util, unsigned long cap)
+{
+	return util * SCHED_ENERGY_MARGIN <= cap * SCHED_POWER_SCALE;
+}
+
+/*
+ * sched_energy_fits - can @cpu run @util without running out of capacity
+ */
+int sched_energy_fits(int cpu, unsigned long util)
+{
+	struct sched_energy *se = per_cpu(sched_energy, cpu);
+
+	return energy_fits(util, se->cap_states[se->nr_cap_states - 1].cap);
+}
+
+/*
+ * sched_energy_cost - estimated power of @cpu running @util
+ *
+ * @util is expressed relative to SCHED_POWER_SCALE like the capacities.
+ * The CPU is assumed to run at the lowest operating point that leaves
+ * enough headroom for @util and to sit in its shallow idle state for the
+ * rest of the time. An idle CPU is charged its deep idle power.
+ *
+ * The result is in mW scaled by SCHED_POWER_SCALE.
+ */
+unsigned long sched_energy_cost(int cpu, unsigned long util)
+{
+	struct sched_energy *se = per_cpu(sched_energy, cpu);
+	struct sched_capacity_state *cs;
+	unsigned long busy;
+	int i;
+
+	if (!util)
+		return se->sleep_power * SCHED_POWER_SCALE;
+
+	for (i = 0; i < se->nr_cap_states - 1; i++) {
+		if (energy_fits(util, se->cap_states[i].cap))
+			break;
+	}
+	cs = &se->cap_states[i];
+
+	busy = min_t(unsigned long, util * SCHED_POWER_SCALE / cs->cap,
+		     SCHED_POWER_SCALE);
+
+	return cs->power * busy +
+		se->idle_power * (SCHED_POWER_SCALE - busy);
+}
+
+static struct device_node *sched_energy_cpu_node(int cpu)
+{
+	struct device_node *np = NULL;
+	const __be32 *reg;
+
+	while ((np = of_find_node_by_type(np, "cpu"))) {
+		reg = of_get_property(np, "reg", NULL);
+		if (reg && be32_to_cpup(reg) == cpu)
+			return np;
+	}
+
+	return NULL;
+}
+
+static struct sched_energy *sched_energy_parse(int cpu)
+{
+	struct device_node *np;
+	struct sched_energy *se = NULL;
+	const __be32 *prop;
+	int len, i;
+	u32 idle[2];
+
+	np = sched_energy_cpu_node(cpu);
+	if (!np)
+		return NULL;
+
+	prop = of_get_property(np, "sched-energy-costs", &len);
+	if (!prop || !len || len % (3 * sizeof(u32)))
+		goto out;
+
+	if (of_property_read_u32_array(np, "sched-idle-power", idle, 2))
+		goto out;
+
+	se = kzalloc(sizeof(*se), GFP_KERNEL);
+	if (!se)
+		goto out;
+
+	se->nr_cap_states = len / (3 * sizeof(u32));
+	se->cap_states = kcalloc(se->nr_cap_states, sizeof(*se->cap_states),
+				 GFP_KERNEL);
+	if (!se->cap_states)
+		goto err;
+
+	for (i = 0; i < se->nr_cap_states; i++) {
+		struct sched_capacity_state *cs = &se->cap_states[i];
+
+		cs->frequency = be32_to_cpup(prop++);
+		cs->cap = be32_to_cpup(prop++);
+		cs->power = be32_to_cpup(prop++);
+
+		if (!cs->cap || (i && cs->cap <= se->cap_states[i - 1].cap)) {
+			pr_err("sched-energy: cpu%d: capacities must be non-zero and ascending\n",
+			       cpu);
+			goto err;
+		}
+	}
+
+	se->idle_power = idle[0];
+	se->sleep_power = idle[1];
+	goto out;
+
+err:
+	kfree(se->cap_states);
+	kfree(se);
+	se = NULL;
+out:
+	of_node_put(np);
+	return se;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int sched_energy_show(struct seq_file *m, void *v)
+{
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		struct sched_energy *se = per_cpu(sched_energy, cpu);
+
+		seq_printf(m, "cpu%d idle %lu %lu\n", cpu,
+			   se->idle_power, se->sleep_power);
+		for (i = 0; i < se->nr_cap_states; i++)
+			seq_printf(m, "cpu%d state %lu %lu %lu\n", cpu,
+				   se->cap_states[i].frequency,
+				   se->cap_states[i].cap,
+				   se->cap_states[i].power);
+	}
+
+	return 0;
+}
+
+static int sched_energy_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sched_energy_show, NULL);
+}
+
+static const struct file_operations sched_energy_fops = {
+	.open		= sched_energy_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+static void __init sched_energy_free(void)
+{
+	struct sched_energy *se;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		se = per_cpu(sched_energy, cpu);
+		if (!se)
+			continue;
+
+		kfree(se->cap_states);
+		kfree(se);
+		per_cpu(sched_energy, cpu) = NULL;
+	}
+}
+
+static int __init sched_energy_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		per_cpu(sched_energy, cpu) = sched_energy_parse(cpu);
+		if (!per_cpu(sched_energy, cpu)) {
+			pr_info("sched-energy: no energy model for cpu%d, energy-aware placement disabled\n",
+				cpu);
+			sched_energy_free();
+			return 0;
+		}
+	}
+
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("sched_energy", 0444, NULL, NULL,
+			    &sched_energy_fops);
+#endif
+	sched_energy_present = true;
+
+	return 0;
+}
+late_initcall(sched_energy_init);
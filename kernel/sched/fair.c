@@ -26,6 +26,7 @@
 #include <linux/slab.h>
 #include <linux/profile.h>
 #include <linux/interrupt.h>
+#include <linux/cpufreq.h>
 
 #include <trace/events/sched.h>
 
@@ -979,6 +980,307 @@ static inline void update_entity_shares_tick(struct cfs_rq *cfs_rq)
 }
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
+#ifdef CONFIG_SMP
+/*
+ * Per-entity load tracking
+ *
+ * The time an entity is runnable (and running) is accounted in periods
+ * of 1024us, a period p periods ago contributing y^p of its value with
+ * y^32 = 1/2. The sums are kept together with the equally decayed total
+ * period, so their ratio is the runnable (running) fraction of the
+ * entity's recent history.
+ *
+ * rq->clock is used rather than rq->clock_task so that the averages of a
+ * task carry over migrations without per-cpu irq time offsets.
+ */
+#define LOAD_AVG_PERIOD 32
+#define LOAD_AVG_MAX 47742	/* maximum possible load avg */
+#define LOAD_AVG_MAX_N 345	/* number of full periods to produce LOAD_AVG_MAX */
+
+/* Precomputed fixed inverse multiplies for multiplication by y^n */
+static const u32 runnable_avg_yN_inv[] = {
+	0xffffffff, 0xfa83b2db, 0xf5257d15, 0xefe4b99b, 0xeac0c6e7, 0xe5b906e7,
+	0xe0ccdeec, 0xdbfbb797, 0xd744fcca, 0xd2a81d91, 0xce248c15, 0xc9b9bd86,
+	0xc5672a11, 0xc12c4cca, 0xbd08a39f, 0xb8fbaf47, 0xb504f333, 0xb123f581,
+	0xad583eea, 0xa9a15ab4, 0xa5fed6a9, 0xa2704303, 0x9ef53260, 0x9b8d39b9,
+	0x9837f051, 0x94f4efa8, 0x91c3d373, 0x8ea4398b, 0x8b95c1e3, 0x88980e80,
+	0x85aac367, 0x82cd8698,
+};
+
+/*
+ * Precomputed \Sum y^k { 1<=k<=n }.  These are floor(true_value) to prevent
+ * over-estimates when re-combining.
+ */
+static const u32 runnable_avg_yN_sum[] = {
+	    0, 1002, 1982, 2942, 3881, 4800, 5699, 6579, 7440, 8282, 9107,
+	 9914,10704,11476,12232,12972,13696,14405,15098,15777,16441,17091,
+	17726,18349,18957,19553,20136,20707,21265,21812,22346,22870,23382,
+};
+
+/*
+ * Approximate val * y^n, where y^32 ~= 0.5 (~1 scheduling period)
+ */
+static __always_inline u64 decay_load(u64 val, u64 n)
+{
+	unsigned int local_n;
+
+	if (!n)
+		return val;
+	else if (unlikely(n > LOAD_AVG_PERIOD * 63))
+		return 0;
+
+	/* after bounds checking we can collapse to 32-bit */
+	local_n = n;
+
+	/*
+	 * As y^PERIOD = 1/2, we can combine
+	 *    y^n = 1/2^(n/PERIOD) * y^(n%PERIOD)
+	 * With a look-up table which covers y^n (n<PERIOD)
+	 */
+	if (unlikely(local_n >= LOAD_AVG_PERIOD)) {
+		val >>= local_n / LOAD_AVG_PERIOD;
+		local_n %= LOAD_AVG_PERIOD;
+	}
+
+	val *= runnable_avg_yN_inv[local_n];
+	/* We don't use SRR here since we always want to round down. */
+	return val >> 32;
+}
+
+/*
+ * For updates fully spanning n periods, the contribution to runnable
+ * average will be: \Sum 1024*y^n
+ */
+static u32 __compute_runnable_contrib(u64 n)
+{
+	u32 contrib = 0;
+
+	if (likely(n <= LOAD_AVG_PERIOD))
+		return runnable_avg_yN_sum[n];
+	else if (unlikely(n >= LOAD_AVG_MAX_N))
+		return LOAD_AVG_MAX;
+
+	/* Compute \Sum k^n combining precomputed values for k^i, \Sum k^j */
+	do {
+		contrib /= 2; /* y^LOAD_AVG_PERIOD = 1/2 */
+		contrib += runnable_avg_yN_sum[LOAD_AVG_PERIOD];
+
+		n -= LOAD_AVG_PERIOD;
+	} while (n > LOAD_AVG_PERIOD);
+
+	contrib = decay_load(contrib, n);
+	return contrib + runnable_avg_yN_sum[n];
+}
+
+/*
+ * Current frequency of @cpu relative to its highest one. Running time is
+ * scaled by it so that utilization is frequency invariant: a task keeping
+ * a cpu busy at half its top frequency is accounted half the utilization,
+ * which is what it would need at the top frequency.
+ */
+static inline unsigned long freq_scale(int cpu)
+{
+#ifdef CONFIG_CPU_FREQ
+	if (sched_feat(FREQ_INVARIANT))
+		return cpufreq_scale_freq_capacity(cpu);
+#endif
+	return SCHED_POWER_SCALE;
+}
+
+static inline u32 scale_running(u32 delta, unsigned long scale)
+{
+	return (delta * scale) >> SCHED_POWER_SHIFT;
+}
+
+/*
+ * Account the time since the last update as runnable and/or running,
+ * decaying the history for every period boundary crossed. Running time
+ * is scaled by the current frequency of @cpu. Returns whether a period
+ * boundary was crossed.
+ */
+static __always_inline int __update_entity_runnable_avg(u64 now, int cpu,
+							struct sched_avg *sa,
+							int runnable,
+							int running)
+{
+	u64 delta, periods;
+	u32 runnable_contrib;
+	int delta_w, decayed = 0;
+	unsigned long scale = freq_scale(cpu);
+
+	delta = now - sa->last_runnable_update;
+	/*
+	 * This should only happen when time goes backwards, which it
+	 * unfortunately does during sched clock init when we swap over to TSC.
+	 */
+	if ((s64)delta < 0) {
+		sa->last_runnable_update = now;
+		return 0;
+	}
+
+	/*
+	 * Use 1024ns as the unit of measurement since it's a reasonable
+	 * approximation of 1us and fast to compute.
+	 */
+	delta >>= 10;
+	if (!delta)
+		return 0;
+	sa->last_runnable_update = now;
+
+	/* delta_w is the amount already accumulated against our next period */
+	delta_w = sa->runnable_avg_period % 1024;
+	if (delta + delta_w >= 1024) {
+		/* period roll-over */
+		decayed = 1;
+
+		/*
+		 * Now that we know we're crossing a period boundary, figure
+		 * out how much from delta we need to complete the current
+		 * period and accrue it.
+		 */
+		delta_w = 1024 - delta_w;
+		if (runnable)
+			sa->runnable_avg_sum += delta_w;
+		if (running)
+			sa->running_avg_sum += scale_running(delta_w, scale);
+		sa->runnable_avg_period += delta_w;
+
+		delta -= delta_w;
+
+		/* Figure out how many additional periods this update spans */
+		periods = delta / 1024;
+		delta %= 1024;
+
+		sa->runnable_avg_sum = decay_load(sa->runnable_avg_sum,
+						  periods + 1);
+		sa->running_avg_sum = decay_load(sa->running_avg_sum,
+						 periods + 1);
+		sa->runnable_avg_period = decay_load(sa->runnable_avg_period,
+						     periods + 1);
+
+		/* Efficiently calculate \sum (1..n_period) 1024*y^i */
+		runnable_contrib = __compute_runnable_contrib(periods);
+		if (runnable)
+			sa->runnable_avg_sum += runnable_contrib;
+		if (running)
+			sa->running_avg_sum += scale_running(runnable_contrib,
+							     scale);
+		sa->runnable_avg_period += runnable_contrib;
+	}
+
+	/* Remainder of delta accrued against u_0` */
+	if (runnable)
+		sa->runnable_avg_sum += delta;
+	if (running)
+		sa->running_avg_sum += scale_running(delta, scale);
+	sa->runnable_avg_period += delta;
+
+	return decayed;
+}
+
+static inline void __update_util_avg(struct sched_avg *sa)
+{
+	sa->util_avg = div_u64((u64)sa->running_avg_sum * SCHED_POWER_SCALE,
+			       sa->runnable_avg_period + 1);
+}
+
+/*
+ * Update the cfs_rq's own averages: runnable while it has queued
+ * entities, running while one of them is current.
+ */
+static void update_cfs_rq_runnable_avg(struct cfs_rq *cfs_rq)
+{
+	if (__update_entity_runnable_avg(rq_of(cfs_rq)->clock,
+					 cpu_of(rq_of(cfs_rq)), &cfs_rq->avg,
+					 cfs_rq->nr_running,
+					 cfs_rq->curr != NULL))
+		__update_util_avg(&cfs_rq->avg);
+}
+
+/*
+ * Recompute the contributions of @se and fold the change into the sums of
+ * its cfs_rq if it is queued there.
+ */
+static void __update_entity_load_avg_contrib(struct sched_entity *se)
+{
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+	long load_delta, util_delta;
+
+	load_delta = -se->avg.load_avg_contrib;
+	util_delta = -se->avg.util_avg;
+
+	se->avg.load_avg_contrib = div_u64((u64)se->avg.runnable_avg_sum *
+					   se->load.weight,
+					   se->avg.runnable_avg_period + 1);
+	__update_util_avg(&se->avg);
+
+	load_delta += se->avg.load_avg_contrib;
+	util_delta += se->avg.util_avg;
+
+	if (se->on_rq) {
+		cfs_rq->runnable_load_avg += load_delta;
+		cfs_rq->utilization_load_avg += util_delta;
+	}
+}
+
+static void update_entity_load_avg(struct sched_entity *se)
+{
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+
+	if (__update_entity_runnable_avg(rq_of(cfs_rq)->clock,
+					 cpu_of(rq_of(cfs_rq)), &se->avg,
+					 se->on_rq, cfs_rq->curr == se))
+		__update_entity_load_avg_contrib(se);
+}
+
+/* Add the contributions of an entity that is about to be enqueued */
+static inline void enqueue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se)
+{
+	/* accounts the time spent sleeping */
+	__update_entity_runnable_avg(rq_of(cfs_rq)->clock,
+				     cpu_of(rq_of(cfs_rq)), &se->avg, 0, 0);
+	__update_entity_load_avg_contrib(se);
+
+	cfs_rq->runnable_load_avg += se->avg.load_avg_contrib;
+	cfs_rq->utilization_load_avg += se->avg.util_avg;
+}
+
+/* Remove the contributions of an entity that is about to be dequeued */
+static inline void dequeue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se)
+{
+	update_entity_load_avg(se);
+
+	cfs_rq->runnable_load_avg -= se->avg.load_avg_contrib;
+	cfs_rq->utilization_load_avg -= se->avg.util_avg;
+}
+
+/*
+ * A new task starts out as runnable and running for a full slice, so that
+ * it is not mistaken for an idle task before it has built up a history.
+ */
+static inline void init_task_runnable_average(struct task_struct *p)
+{
+	u32 slice = sched_slice(task_cfs_rq(p), &p->se) >> 10;
+
+	p->se.avg.last_runnable_update = task_rq(p)->clock;
+	p->se.avg.runnable_avg_sum = slice;
+	p->se.avg.running_avg_sum = slice;
+	p->se.avg.runnable_avg_period = slice;
+	p->se.avg.load_avg_contrib = 0;
+	p->se.avg.util_avg = 0;
+}
+#else
+static inline void update_cfs_rq_runnable_avg(struct cfs_rq *cfs_rq) { }
+static inline void update_entity_load_avg(struct sched_entity *se) { }
+static inline void enqueue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se) { }
+static inline void dequeue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se) { }
+static inline void init_task_runnable_average(struct task_struct *p) { }
+#endif
+
 static void enqueue_sleeper(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
 #ifdef CONFIG_SCHEDSTATS
@@ -1104,6 +1406,8 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	update_cfs_rq_runnable_avg(cfs_rq);
+	enqueue_entity_load_avg(cfs_rq, se);
 	update_cfs_load(cfs_rq, 0);
 	account_entity_enqueue(cfs_rq, se);
 	update_cfs_shares(cfs_rq);
@@ -1179,6 +1483,8 @@ dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	update_cfs_rq_runnable_avg(cfs_rq);
+	dequeue_entity_load_avg(cfs_rq, se);
 
 	update_stats_dequeue(cfs_rq, se);
 	if (flags & DEQUEUE_SLEEP) {
@@ -1271,6 +1577,10 @@ set_next_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		__dequeue_entity(cfs_rq, se);
 	}
 
+	/* close the averages' waiting period before se starts running */
+	update_entity_load_avg(se);
+	update_cfs_rq_runnable_avg(cfs_rq);
+
 	update_stats_curr_start(cfs_rq, se);
 	cfs_rq->curr = se;
 #ifdef CONFIG_SCHEDSTATS
@@ -1349,6 +1659,8 @@ static void put_prev_entity(struct cfs_rq *cfs_rq, struct sched_entity *prev)
 		/* Put 'current' back into the tree. */
 		__enqueue_entity(cfs_rq, prev);
 	}
+	update_entity_load_avg(prev);
+	update_cfs_rq_runnable_avg(cfs_rq);
 	cfs_rq->curr = NULL;
 }
 
@@ -1360,6 +1672,12 @@ entity_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr, int queued)
 	 */
 	update_curr(cfs_rq);
 
+	/*
+	 * Update the load averages of the running entity and its cfs_rq.
+	 */
+	update_entity_load_avg(curr);
+	update_cfs_rq_runnable_avg(cfs_rq);
+
 	/*
 	 * Update share accounting for long-running entities.
 	 */
@@ -2692,6 +3010,53 @@ done:
 	return target;
 }
 
+#ifdef CONFIG_SCHED_ENERGY
+/*
+ * Pick the cpu on which a waking small task increases the estimated
+ * power the least. Idle cpus are charged for leaving their deep idle
+ * state, so small tasks get packed onto cpus that are already busy as
+ * long as these have capacity to spare. Returns -1 if the task should
+ * be placed by the regular path.
+ */
+static int energy_aware_wake_cpu(struct task_struct *p, int prev_cpu)
+{
+	unsigned long task_util = p->se.avg.util_avg;
+	long min_delta = LONG_MAX;
+	int target = -1;
+	int i;
+
+	if (!sched_feat(ENERGY_AWARE) || !sched_energy_present)
+		return -1;
+
+	if (task_util * 100 > sysctl_sched_small_task_pct * SCHED_POWER_SCALE)
+		return -1;
+
+	for_each_cpu_and(i, tsk_cpus_allowed(p), cpu_online_mask) {
+		unsigned long util = cpu_rq(i)->cfs.utilization_load_avg;
+		long delta;
+
+		if (!sched_energy_fits(i, util + task_util))
+			continue;
+
+		delta = sched_energy_cost(i, util + task_util) -
+			sched_energy_cost(i, util);
+
+		/* Ties go to the previous cpu, which may still be cache hot */
+		if (delta < min_delta || (delta == min_delta && i == prev_cpu)) {
+			min_delta = delta;
+			target = i;
+		}
+	}
+
+	return target;
+}
+#else
+static inline int energy_aware_wake_cpu(struct task_struct *p, int prev_cpu)
+{
+	return -1;
+}
+#endif
+
 /*
  * sched_balance_self: balance the current task (running on cpu) in domains
  * that have the 'flag' flag set. In practice, this is SD_BALANCE_FORK and
@@ -2718,6 +3083,10 @@ select_task_rq_fair(struct task_struct *p, int sd_flag, int wake_flags)
 		return prev_cpu;
 
 	if (sd_flag & SD_BALANCE_WAKE) {
+		new_cpu = energy_aware_wake_cpu(p, prev_cpu);
+		if (new_cpu >= 0)
+			return new_cpu;
+
 		if (cpumask_test_cpu(cpu, tsk_cpus_allowed(p)))
 			want_affine = 1;
 		new_cpu = prev_cpu;
@@ -5254,6 +5623,8 @@ static void task_fork_fair(struct task_struct *p)
 
 	se->vruntime -= cfs_rq->min_vruntime;
 
+	init_task_runnable_average(p);
+
 	raw_spin_unlock_irqrestore(&rq->lock, flags);
 }
 
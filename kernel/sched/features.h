@@ -69,3 +69,13 @@ SCHED_FEAT(TTWU_QUEUE, true)
 SCHED_FEAT(FORCE_SD_OVERLAP, false)
 SCHED_FEAT(RT_RUNTIME_SHARE, true)
 SCHED_FEAT(LB_MIN, false)
+
+/*
+ * Place small waking tasks using the energy model, if one was provided
+ */
+SCHED_FEAT(ENERGY_AWARE, true)
+
+/*
+ * Scale running time by the current cpu frequency in load tracking
+ */
+SCHED_FEAT(FREQ_INVARIANT, true)
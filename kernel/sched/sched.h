@@ -224,6 +224,16 @@ struct cfs_rq {
 	unsigned int nr_spread_over;
 #endif
 
+#ifdef CONFIG_SMP
+	/*
+	 * Per-entity load tracking: the load and utilization contributions
+	 * of the queued entities, and the cfs_rq's own runnable/running
+	 * averages, which keep decaying while its entities sleep.
+	 */
+	unsigned long runnable_load_avg, utilization_load_avg;
+	struct sched_avg avg;
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	struct rq *rq;	/* cpu runqueue to which this cfs_rq is attached */
 
@@ -422,6 +432,13 @@ struct rq {
 	u64 avg_idle;
 #endif
 
+#ifdef CONFIG_SCHED_FREQ_INPUT
+	/* busy time in the current and the previous window, in ns */
+	u64 window_start;
+	u64 curr_runnable_sum;
+	u64 prev_runnable_sum;
+#endif
+
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
 	u64 prev_irq_time;
 #endif
@@ -1160,6 +1177,77 @@ extern void init_rt_rq(struct rt_rq *rt_rq, struct rq *rq);
 
 extern void account_cfs_bandwidth_used(int enabled, int was_enabled);
 
+#ifdef CONFIG_CPU_FREQ
+DECLARE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/*
+ * cpufreq_update_util - pass the utilization of @rq to the cpufreq governor
+ * of its cpu, if it asked for it
+ *
+ * Called on enqueue, dequeue and tick with the rq lock held, so the
+ * callback must not sleep nor wake up tasks directly.
+ */
+static inline void cpufreq_update_util(struct rq *rq)
+{
+#ifdef CONFIG_SMP
+	struct update_util_data *data;
+	unsigned long util;
+
+	data = rcu_dereference_sched(per_cpu(cpufreq_update_util_data,
+					     cpu_of(rq)));
+	if (!data)
+		return;
+
+	util = min_t(unsigned long, rq->cfs.avg.util_avg, SCHED_POWER_SCALE);
+	data->func(data, rq->clock, util, SCHED_POWER_SCALE);
+#endif
+}
+
+DECLARE_PER_CPU(struct task_struct *, cpufreq_wake_task);
+
+/*
+ * Do the wake-up a governor asked for with cpufreq_update_util_wake().
+ * Called with no rq lock held after the paths that enqueue or dequeue
+ * tasks; others leave it to the next one of those on this cpu.
+ */
+static inline void cpufreq_update_util_wake_pending(void)
+{
+	struct task_struct *p;
+
+	preempt_disable();
+	p = __this_cpu_read(cpufreq_wake_task);
+	if (unlikely(p)) {
+		__this_cpu_write(cpufreq_wake_task, NULL);
+		wake_up_process(p);
+	}
+	preempt_enable();
+}
+#else
+static inline void cpufreq_update_util(struct rq *rq) { }
+static inline void cpufreq_update_util_wake_pending(void) { }
+#endif
+
+#ifdef CONFIG_SCHED_ENERGY
+struct sched_capacity_state {
+	unsigned long frequency;	/* kHz */
+	unsigned long cap;		/* relative to SCHED_POWER_SCALE */
+	unsigned long power;		/* mW while busy */
+};
+
+struct sched_energy {
+	int nr_cap_states;
+	struct sched_capacity_state *cap_states;
+	unsigned long idle_power;	/* mW in idle between bursts */
+	unsigned long sleep_power;	/* mW when the cpu has nothing to run */
+};
+
+DECLARE_PER_CPU(struct sched_energy *, sched_energy);
+extern bool sched_energy_present;
+
+extern int sched_energy_fits(int cpu, unsigned long util);
+extern unsigned long sched_energy_cost(int cpu, unsigned long util);
+#endif
+
 #ifdef CONFIG_NO_HZ
 enum rq_nohz_flag_bits {
 	NOHZ_TICK_STOPPED,
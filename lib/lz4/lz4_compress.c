@@ -0,0 +1,132 @@
+/*
+ * LZ4 - Fast LZ compression algorithm
+ *
+ * Greedy single pass compressor: each position is looked up in a hash
+ * table of the last position seen with the same four bytes, and a match
+ * is taken as soon as one is found.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+/* Emit the rest of a length that did not fit in its nibble */
+static inline u8 *lz4_put_length(u8 *op, size_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+
+	return op;
+}
+
+/* Bytes needed for a sequence, with the worst case for the match length */
+static inline size_t lz4_seq_size(size_t litlen, size_t matchlen)
+{
+	return 1 + litlen + litlen / 255 + 1 + 2 + matchlen / 255 + 1;
+}
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+		 unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	const u8 *ip = src, *anchor = src, *ref;
+	const u8 * const iend = src + src_len;
+	const u8 * const mflimit = iend - MFLIMIT;
+	const u8 * const matchlimit = iend - LASTLITERALS;
+	u8 *op = dst, *token;
+	u8 * const oend = dst + *dst_len;
+	u32 *hash_table = wrkmem;
+	size_t litlen, matchlen;
+	u32 h;
+
+	memset(hash_table, 0, LZ4_MEM_COMPRESS);
+
+	if (src_len < MFLIMIT + 1)
+		goto last_literals;
+
+	hash_table[LZ4_HASH_VALUE(ip)] = 0;
+	ip++;
+
+	while (ip <= mflimit) {
+		h = LZ4_HASH_VALUE(ip);
+		ref = src + hash_table[h];
+		hash_table[h] = ip - src;
+
+		if (ref >= ip || ip - ref > MAX_DISTANCE ||
+		    get_unaligned((const u32 *)ref) !=
+		    get_unaligned((const u32 *)ip)) {
+			ip++;
+			continue;
+		}
+
+		/* the match may start before the position that hashed */
+		while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+			ip--;
+			ref--;
+		}
+
+		matchlen = MINMATCH;
+		while (ip + matchlen < matchlimit &&
+		       ip[matchlen] == ref[matchlen])
+			matchlen++;
+
+		litlen = ip - anchor;
+		if (lz4_seq_size(litlen, matchlen) > (size_t)(oend - op))
+			return -1;
+
+		token = op++;
+		if (litlen >= RUN_MASK) {
+			*token = RUN_MASK << ML_BITS;
+			op = lz4_put_length(op, litlen - RUN_MASK);
+		} else {
+			*token = litlen << ML_BITS;
+		}
+		memcpy(op, anchor, litlen);
+		op += litlen;
+
+		put_unaligned_le16(ip - ref, op);
+		op += 2;
+
+		if (matchlen - MINMATCH >= ML_MASK) {
+			*token |= ML_MASK;
+			op = lz4_put_length(op, matchlen - MINMATCH - ML_MASK);
+		} else {
+			*token |= matchlen - MINMATCH;
+		}
+
+		ip += matchlen;
+		anchor = ip;
+
+		/* catch repeats starting inside the match just taken */
+		if (ip <= mflimit)
+			hash_table[LZ4_HASH_VALUE(ip - 2)] = ip - 2 - src;
+	}
+
+last_literals:
+	litlen = iend - anchor;
+	if (1 + litlen + litlen / 255 + 1 > (size_t)(oend - op))
+		return -1;
+
+	if (litlen >= RUN_MASK) {
+		*op++ = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, litlen - RUN_MASK);
+	} else {
+		*op++ = litlen << ML_BITS;
+	}
+	memcpy(op, anchor, litlen);
+	op += litlen;
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 compressor");
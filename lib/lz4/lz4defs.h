@@ -0,0 +1,35 @@
+/*
+ * lz4defs.h -- architecture specific defines
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * A sequence is a token byte, holding the literal length in its high
+ * nibble and the match length less MINMATCH in its low one, followed by
+ * any further literal length bytes, the literals, a 16-bit little endian
+ * offset and any further match length bytes. A nibble of 15 is extended
+ * by bytes that are added to it, up to and including the first one that
+ * is not 255. The last sequence of a block has no match, and its literals
+ * end the block.
+ */
+#define MINMATCH	4
+
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_BITS	(8 - ML_BITS)
+#define RUN_MASK	((1U << RUN_BITS) - 1)
+
+#define MAX_DISTANCE	65535
+
+/* The last match starts at least MFLIMIT bytes before the end of input */
+#define MFLIMIT		12
+/* and the last LASTLITERALS bytes are always literals */
+#define LASTLITERALS	5
+
+#define HASH_LOG	12
+
+#define LZ4_HASH_VALUE(p)	\
+	((get_unaligned_le32(p) * 2654435761U) >> (32 - HASH_LOG))
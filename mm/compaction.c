@@ -14,6 +14,8 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #ifdef CONFIG_COMPACTION
@@ -432,8 +434,8 @@ static bool too_many_isolated(struct zone *zone)
  * pending), otherwise PFN of the first page that was not scanned
  * (which may be both less, equal to or more then end_pfn).
  *
- * Assumes that cc->migratepages is empty and cc->nr_migratepages is
- * zero.
+ * Isolated pages are added to cc->migratepages, at most
+ * COMPACT_CLUSTER_MAX of them per call.
  *
  * Apart from cc->migratepages and cc->nr_migratetypes this function
  * does not modify any cc's fields, in particular it does not modify
@@ -583,7 +585,7 @@ isolate_migratepages_range(struct zone *zone, struct compact_control *cc,
 		nr_isolated++;
 
 		/* Avoid isolating too much */
-		if (cc->nr_migratepages == COMPACT_CLUSTER_MAX) {
+		if (nr_isolated == COMPACT_CLUSTER_MAX) {
 			++low_pfn;
 			break;
 		}
@@ -793,6 +795,48 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 	return ISOLATE_SUCCESS;
 }
 
+/*
+ * Tunables of the background compaction of kcompactd. When the
+ * fragmentation score of a zone for kcompactd_order exceeds
+ * kcompactd_frag_threshold, the zone is compacted until its score drops
+ * KCOMPACTD_SCORE_HYSTERESIS below the threshold. 0 disables proactive
+ * compaction; kcompactd then only runs when woken up by kswapd.
+ */
+int sysctl_kcompactd_frag_threshold = 80;
+int sysctl_kcompactd_order = PAGE_ALLOC_COSTLY_ORDER + 1;
+
+#define KCOMPACTD_SCORE_HYSTERESIS	10
+
+static inline unsigned int kcompactd_low_score(void)
+{
+	return max(sysctl_kcompactd_frag_threshold - KCOMPACTD_SCORE_HYSTERESIS,
+		   0);
+}
+
+/*
+ * The fragmentation score of a zone for @order is the percentage of its
+ * free memory that sits in blocks too small for an allocation of @order.
+ */
+static unsigned int fragmentation_score_zone(struct zone *zone,
+					     unsigned int order)
+{
+	unsigned long free = 0, unusable = 0;
+	unsigned int o;
+
+	for (o = 0; o < MAX_ORDER; o++) {
+		unsigned long pages = zone->free_area[o].nr_free << o;
+
+		free += pages;
+		if (o < order)
+			unusable += pages;
+	}
+
+	if (!free)
+		return 0;
+
+	return unusable * 100 / free;
+}
+
 static int compact_finished(struct zone *zone,
 			    struct compact_control *cc)
 {
@@ -802,6 +846,9 @@ static int compact_finished(struct zone *zone,
 	if (fatal_signal_pending(current))
 		return COMPACT_PARTIAL;
 
+	if (cc->kcompactd && kthread_should_stop())
+		return COMPACT_PARTIAL;
+
 	/* Compaction run completes if the migrate and free scanner meet */
 	if (cc->free_pfn <= cc->migrate_pfn) {
 		/*
@@ -816,6 +863,11 @@ static int compact_finished(struct zone *zone,
 		return COMPACT_COMPLETE;
 	}
 
+	/* Proactive compaction runs until the zone is defragmented enough */
+	if (cc->proactive)
+		return fragmentation_score_zone(zone, cc->order) >
+			kcompactd_low_score() ? COMPACT_CONTINUE : COMPACT_PARTIAL;
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -902,15 +954,27 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 	unsigned long start_pfn = zone->zone_start_pfn;
 	unsigned long end_pfn = zone->zone_start_pfn + zone->spanned_pages;
 
-	ret = compaction_suitable(zone, cc->order);
-	switch (ret) {
-	case COMPACT_PARTIAL:
-	case COMPACT_SKIPPED:
-		/* Compaction is likely to fail */
-		return ret;
-	case COMPACT_CONTINUE:
-		/* Fall through to compaction */
-		;
+	if (cc->proactive) {
+		/*
+		 * Pages of the requested order may well be available already,
+		 * only make sure there is enough free memory to migrate.
+		 */
+		unsigned long watermark = low_wmark_pages(zone) +
+					  (2UL << cc->order);
+
+		if (!zone_watermark_ok(zone, 0, watermark, 0, 0))
+			return COMPACT_SKIPPED;
+	} else {
+		ret = compaction_suitable(zone, cc->order);
+		switch (ret) {
+		case COMPACT_PARTIAL:
+		case COMPACT_SKIPPED:
+			/* Compaction is likely to fail */
+			return ret;
+		case COMPACT_CONTINUE:
+			/* Fall through to compaction */
+			;
+		}
 	}
 
 	/*
@@ -961,6 +1025,7 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 				cc->sync ? MIGRATE_SYNC_LIGHT : MIGRATE_ASYNC);
 		update_nr_listpages(cc);
 		nr_remaining = cc->nr_migratepages;
+		cc->nr_migrated += nr_migrate - nr_remaining;
 
 		trace_mm_compaction_migratepages(nr_migrate - nr_remaining,
 						nr_remaining);
@@ -1155,6 +1220,281 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * kcompactd compacts the zones of its node in the background, using
+ * asynchronous migration. It is woken up by kswapd when kswapd is done
+ * reclaiming for a high-order allocation that is still failing because of
+ * fragmentation, and it checks every KCOMPACTD_CHECK_INTERVAL_MSEC whether
+ * the fragmentation score of a zone exceeds kcompactd_frag_threshold.
+ */
+#define KCOMPACTD_CHECK_INTERVAL_MSEC	500
+/* Checks to skip after a proactive run that did not migrate anything */
+#define KCOMPACTD_PROACTIVE_DEFER	16
+
+static bool kcompactd_work_requested(pg_data_t *pgdat)
+{
+	return pgdat->kcompactd_max_order > 0 || kthread_should_stop();
+}
+
+static bool kcompactd_node_suitable(pg_data_t *pgdat, int order,
+				    int classzone_idx)
+{
+	int zoneid;
+	struct zone *zone;
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		if (compaction_suitable(zone, order) == COMPACT_CONTINUE)
+			return true;
+	}
+
+	return false;
+}
+
+static void kcompactd_compact_zone(struct zone *zone,
+				   struct compact_control *cc)
+{
+	cc->nr_freepages = 0;
+	cc->nr_migratepages = 0;
+	cc->zone = zone;
+	INIT_LIST_HEAD(&cc->freepages);
+	INIT_LIST_HEAD(&cc->migratepages);
+
+	compact_zone(zone, cc);
+
+	VM_BUG_ON(!list_empty(&cc->freepages));
+	VM_BUG_ON(!list_empty(&cc->migratepages));
+}
+
+/* Compact for the order kswapd asked for */
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	int classzone_idx = pgdat->kcompactd_classzone_idx;
+	struct compact_control cc = {
+		.order = pgdat->kcompactd_max_order,
+		.sync = false,
+		.kcompactd = true,
+	};
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = 0;
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		if (compaction_deferred(zone, cc.order))
+			continue;
+
+		if (compaction_suitable(zone, cc.order) != COMPACT_CONTINUE)
+			continue;
+
+		if (kthread_should_stop())
+			break;
+
+		kcompactd_compact_zone(zone, &cc);
+
+		if (zone_watermark_ok(zone, cc.order, low_wmark_pages(zone),
+				      0, 0) &&
+		    cc.order >= zone->compact_order_failed)
+			zone->compact_order_failed = cc.order + 1;
+	}
+
+	count_compact_events(KCOMPACTD_MIGRATED, cc.nr_migrated);
+}
+
+/*
+ * Compact the zones whose fragmentation score is above the threshold.
+ * Returns the number of pages migrated, or -1 if no zone needed it.
+ */
+static long kcompactd_proactive(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	bool ran = false;
+	struct compact_control cc = {
+		.order = sysctl_kcompactd_order,
+		.sync = false,
+		.kcompactd = true,
+		.proactive = true,
+	};
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		if (fragmentation_score_zone(zone, cc.order) <=
+		    sysctl_kcompactd_frag_threshold)
+			continue;
+
+		if (kthread_should_stop())
+			break;
+
+		kcompactd_compact_zone(zone, &cc);
+		ran = true;
+	}
+
+	if (!ran)
+		return -1;
+
+	count_compact_event(KCOMPACTD_PROACTIVE);
+	count_compact_events(KCOMPACTD_MIGRATED, cc.nr_migrated);
+
+	return cc.nr_migrated;
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+	unsigned int proactive_defer = 0;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+
+	set_freezable();
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = 0;
+
+	while (!kthread_should_stop()) {
+		long timeout = MAX_SCHEDULE_TIMEOUT;
+		unsigned long start;
+
+		if (sysctl_kcompactd_frag_threshold)
+			timeout = msecs_to_jiffies(KCOMPACTD_CHECK_INTERVAL_MSEC);
+
+		wait_event_freezable_timeout(pgdat->kcompactd_wait,
+				kcompactd_work_requested(pgdat), timeout);
+
+		if (kthread_should_stop())
+			break;
+
+		start = jiffies;
+		if (pgdat->kcompactd_max_order > 0) {
+			count_compact_event(KCOMPACTD_WAKE);
+			kcompactd_do_work(pgdat);
+		} else if (sysctl_kcompactd_frag_threshold) {
+			if (proactive_defer) {
+				proactive_defer--;
+				continue;
+			}
+			/* Back off if compaction does not help */
+			if (!kcompactd_proactive(pgdat))
+				proactive_defer = KCOMPACTD_PROACTIVE_DEFER;
+		} else {
+			continue;
+		}
+		count_compact_events(KCOMPACTD_MSECS,
+				     jiffies_to_msecs(jiffies - start));
+	}
+
+	return 0;
+}
+
+/**
+ * wakeup_kcompactd - ask kcompactd to compact for a high-order allocation
+ * @pgdat: the node to compact
+ * @order: the order that failed
+ * @classzone_idx: the highest zone the allocation can use
+ */
+void wakeup_kcompactd(pg_data_t *pgdat, int order, int classzone_idx)
+{
+	if (!order)
+		return;
+
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+
+	if (!kcompactd_node_suitable(pgdat, order, classzone_idx))
+		return;
+
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+	if (pgdat->kcompactd_classzone_idx < classzone_idx)
+		pgdat->kcompactd_classzone_idx = classzone_idx;
+
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/*
+ * This kcompactd start function will be called by init and node-hot-add.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int ret = 0;
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		pr_err("Failed to start kcompactd on node %d\n", nid);
+		ret = PTR_ERR(pgdat->kcompactd);
+		pgdat->kcompactd = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined.
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+/*
+ * Keep kcompactd on the cpus of its node, see the cpu_callback of kswapd.
+ */
+static int __devinit kcompactd_cpu_callback(struct notifier_block *nfb,
+					    unsigned long action, void *hcpu)
+{
+	int nid;
+
+	if (action == CPU_ONLINE || action == CPU_ONLINE_FROZEN) {
+		for_each_node_state(nid, N_HIGH_MEMORY) {
+			pg_data_t *pgdat = NODE_DATA(nid);
+			const struct cpumask *mask;
+
+			mask = cpumask_of_node(pgdat->node_id);
+
+			if (pgdat->kcompactd &&
+			    cpumask_any_and(cpu_online_mask, mask) < nr_cpu_ids)
+				/* One of our CPUs online: restore mask */
+				set_cpus_allowed_ptr(pgdat->kcompactd, mask);
+		}
+	}
+	return NOTIFY_OK;
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	hotcpu_notifier(kcompactd_cpu_callback, 0);
+	return 0;
+}
+module_init(kcompactd_init)
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct device *dev,
 			struct device_attribute *attr,
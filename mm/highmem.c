@@ -94,10 +94,66 @@ static DECLARE_WAIT_QUEUE_HEAD(pkmap_map_wait);
 		do { spin_unlock(&kmap_lock); (void)(flags); } while (0)
 #endif
 
-static void flush_all_zero_pkmaps(void)
+/*
+ * Per-cpu cache of the pkmap entries this cpu looked up or set up last.
+ * kmap() of pages that are mapped over and over, like the zram, ext4 and
+ * socket buffers of an I/O heavy workload, finds them here instead of
+ * in the page_address() hash. Entries are only hints: they are checked
+ * against pkmap_count[] and pkmap_page_table[] under kmap_lock, so stale
+ * ones need no invalidation.
+ */
+#define KMAP_CACHE_SIZE	8
+
+struct kmap_cache {
+	struct page *page[KMAP_CACHE_SIZE];
+	unsigned int nr[KMAP_CACHE_SIZE];
+	unsigned int next;
+};
+
+static DEFINE_PER_CPU(struct kmap_cache, kmap_cache);
+
+static void kmap_cache_add(struct page *page, unsigned long vaddr)
+{
+	struct kmap_cache *kc = &__get_cpu_var(kmap_cache);
+
+	kc->page[kc->next] = page;
+	kc->nr[kc->next] = PKMAP_NR(vaddr);
+	kc->next = (kc->next + 1) % KMAP_CACHE_SIZE;
+}
+
+/*
+ * Returns the pkmap address @page is mapped at, or 0. Called with
+ * kmap_lock held.
+ */
+static unsigned long pkmap_lookup(struct page *page)
 {
+	struct kmap_cache *kc = &__get_cpu_var(kmap_cache);
+	unsigned long vaddr;
 	int i;
-	int need_flush = 0;
+
+	for (i = 0; i < KMAP_CACHE_SIZE; i++) {
+		unsigned int nr = kc->nr[i];
+
+		/* a non-zero count means the pte is present */
+		if (kc->page[i] == page && pkmap_count[nr] &&
+		    pte_page(pkmap_page_table[nr]) == page)
+			return PKMAP_ADDR(nr);
+	}
+
+	vaddr = (unsigned long)page_address(page);
+	if (vaddr)
+		kmap_cache_add(page, vaddr);
+	return vaddr;
+}
+
+/*
+ * Unmaps all unused entries and flushes the TLB for the range they span.
+ * Returns whether any entry was freed.
+ */
+static int flush_all_zero_pkmaps(void)
+{
+	int i;
+	int first = LAST_PKMAP, last = 0;
 
 	flush_cache_kmaps();
 
@@ -129,10 +185,16 @@ static void flush_all_zero_pkmaps(void)
 			  &pkmap_page_table[i]);
 
 		set_page_address(page, NULL);
-		need_flush = 1;
+		if (i < first)
+			first = i;
+		last = i;
 	}
-	if (need_flush)
-		flush_tlb_kernel_range(PKMAP_ADDR(0), PKMAP_ADDR(LAST_PKMAP));
+	if (first == LAST_PKMAP)
+		return 0;
+
+	flush_tlb_kernel_range(PKMAP_ADDR(first), PKMAP_ADDR(last + 1));
+	__count_vm_event(KMAP_FLUSH);
+	return 1;
 }
 
 /**
@@ -155,15 +217,21 @@ start:
 	/* Find an empty entry */
 	for (;;) {
 		last_pkmap_nr = (last_pkmap_nr + 1) & LAST_PKMAP_MASK;
-		if (!last_pkmap_nr) {
-			flush_all_zero_pkmaps();
-			count = LAST_PKMAP;
-		}
 		if (!pkmap_count[last_pkmap_nr])
 			break;	/* Found a usable entry */
 		if (--count)
 			continue;
 
+		/*
+		 * A whole lap without a usable entry: only now unmap the
+		 * unused ones, with a single TLB flush for all of them.
+		 * Until then they stay mapped and can be reused as is.
+		 */
+		if (flush_all_zero_pkmaps()) {
+			count = LAST_PKMAP;
+			continue;
+		}
+
 		/*
 		 * Sleep for somebody else to unmap their entries
 		 */
@@ -191,6 +259,7 @@ start:
 
 	pkmap_count[last_pkmap_nr] = 1;
 	set_page_address(page, (void *)vaddr);
+	kmap_cache_add(page, vaddr);
 
 	return vaddr;
 }
@@ -212,9 +281,13 @@ void *kmap_high(struct page *page)
 	 * after we have the lock.
 	 */
 	lock_kmap();
-	vaddr = (unsigned long)page_address(page);
-	if (!vaddr)
+	vaddr = pkmap_lookup(page);
+	if (vaddr) {
+		__count_vm_event(KMAP_HIT);
+	} else {
 		vaddr = map_new_virtual(page);
+		__count_vm_event(KMAP_MISS);
+	}
 	pkmap_count[PKMAP_NR(vaddr)]++;
 	BUG_ON(pkmap_count[PKMAP_NR(vaddr)] < 2);
 	unlock_kmap();
@@ -239,8 +312,9 @@ void *kmap_high_get(struct page *page)
 	unsigned long vaddr, flags;
 
 	lock_kmap_any(flags);
-	vaddr = (unsigned long)page_address(page);
+	vaddr = pkmap_lookup(page);
 	if (vaddr) {
+		__count_vm_event(KMAP_HIT);
 		BUG_ON(pkmap_count[PKMAP_NR(vaddr)] < 1);
 		pkmap_count[PKMAP_NR(vaddr)]++;
 	}
@@ -264,7 +338,7 @@ void kunmap_high(struct page *page)
 	int need_wakeup;
 
 	lock_kmap_any(flags);
-	vaddr = (unsigned long)page_address(page);
+	vaddr = pkmap_lookup(page);
 	BUG_ON(!vaddr);
 	nr = PKMAP_NR(vaddr);
 
@@ -135,6 +135,11 @@ struct compact_control {
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
 	struct zone *zone;
 	bool contended;			/* True if a lock was contended */
+	bool kcompactd;			/* Run by kcompactd */
+	bool proactive;			/* Compact until the fragmentation
+					 * score is low, see kcompactd
+					 */
+	unsigned long nr_migrated;	/* Number of pages migrated */
 };
 
 unsigned long
@@ -36,6 +36,7 @@
 #include <linux/hash.h>
 #include <linux/freezer.h>
 #include <linux/oom.h>
+#include <linux/seq_file.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -86,12 +87,22 @@
  * @mm_list: link into the mm_slots list, rooted in ksm_mm_head
  * @rmap_list: head for this mm_slot's singly-linked list of rmap_items
  * @mm: the mm that this information is valid for
+ * @pages_scanned: number of pages compared against the trees
+ * @pages_skipped: number of volatile pages skipped by the scan backoff
+ * @pages_merged: number of pages merged into a ksm page or the zero page
+ * @zero_pages_merged: number of pages merged into the zero page
+ * @scan_ns: time spent comparing and merging the pages of this mm
  */
 struct mm_slot {
 	struct hlist_node link;
 	struct list_head mm_list;
 	struct rmap_item *rmap_list;
 	struct mm_struct *mm;
+	unsigned long pages_scanned;
+	unsigned long pages_skipped;
+	unsigned long pages_merged;
+	unsigned long zero_pages_merged;
+	u64 scan_ns;
 };
 
 /**
@@ -129,6 +140,8 @@ struct stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @skip_scans: number of full scans this volatile page is still skipped for
+ * @volatility: number of times in a row the checksum was found changed
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -139,6 +152,8 @@ struct rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	unsigned short skip_scans;	/* when volatile */
+	unsigned char volatility;
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -189,6 +204,29 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Merge pages full of zeroes into the zero page instead of a ksm page */
+static bool ksm_use_zero_pages __read_mostly = true;
+
+/*
+ * A page whose checksum changed between two scans is skipped for the
+ * next 2^n - 1 full scans, n being the number of times in a row it was
+ * found changed, up to this limit. 0 disables the backoff.
+ */
+static unsigned int ksm_max_volatile_backoff = 5;
+#define KSM_MAX_VOLATILE_BACKOFF	15
+
+/* Hash only a sample of each page when looking for volatile pages */
+static bool ksm_sampled_checksum __read_mostly = true;
+
+/* Checksums of the zero page, full and sampled */
+static u32 zero_checksum[2] __read_mostly;
+
+/* The number of volatile pages skipped by the scan backoff */
+static unsigned long ksm_pages_skipped;
+
+/* The number of pages merged into the zero page */
+static unsigned long ksm_zero_pages_merged;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -673,15 +711,48 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
-static u32 calc_checksum(struct page *page)
+/*
+ * The sampled checksum hashes KSM_CHECKSUM_CHUNKS cache lines spread over
+ * the page rather than the whole of it. A change it misses only lets a
+ * volatile page into the unstable tree: merging always compares the
+ * full pages.
+ */
+#define KSM_CHECKSUM_CHUNKS		8
+#define KSM_CHECKSUM_CHUNK_WORDS	16
+
+static u32 __calc_checksum(struct page *page, bool sampled)
 {
-	u32 checksum;
-	void *addr = kmap_atomic(page);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	u32 checksum = 17;
+	u32 *addr = kmap_atomic(page);
+	int i;
+
+	if (sampled) {
+		for (i = 0; i < KSM_CHECKSUM_CHUNKS; i++)
+			checksum = jhash2(addr + i * (PAGE_SIZE / 4 /
+						      KSM_CHECKSUM_CHUNKS),
+					  KSM_CHECKSUM_CHUNK_WORDS, checksum);
+	} else {
+		checksum = jhash2(addr, PAGE_SIZE / 4, checksum);
+	}
 	kunmap_atomic(addr);
 	return checksum;
 }
 
+static inline u32 calc_checksum(struct page *page)
+{
+	return __calc_checksum(page, ksm_sampled_checksum);
+}
+
+static inline u32 calc_zero_checksum(void)
+{
+	return zero_checksum[ksm_sampled_checksum];
+}
+
+static inline bool is_ksm_zero_page(struct page *page, unsigned long addr)
+{
+	return page == ZERO_PAGE(addr);
+}
+
 static int memcmp_pages(struct page *page1, struct page *page2)
 {
 	char *addr1, *addr2;
@@ -773,6 +844,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *ptep;
+	pte_t newpte;
 	spinlock_t *ptl;
 	unsigned long addr;
 	int err = -EFAULT;
@@ -800,12 +872,20 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	if (!is_ksm_zero_page(kpage, addr)) {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	} else {
+		/* Mapped like by do_anonymous_page(), no rmap nor refcount */
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+		dec_mm_counter(mm, MM_ANONPAGES);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -850,6 +930,7 @@ static int page_trans_compound_anon_split(struct page *page)
  * @vma: the vma that holds the pte pointing to page
  * @page: the PageAnon page that we want to replace with kpage
  * @kpage: the PageKsm page that we want to map instead of page,
+ *         the zero page if page only holds zeroes,
  *         or NULL the first time when we want to use page as kpage.
  *
  * This function returns 0 if the pages were merged, -EFAULT otherwise.
@@ -1174,6 +1255,8 @@ static void stable_tree_append(struct rmap_item *rmap_item,
  */
 static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 {
+	/* The scan cursor is on the mm of rmap_item */
+	struct mm_slot *mm_slot = ksm_scan.mm_slot;
 	struct rmap_item *tree_rmap_item;
 	struct page *tree_page = NULL;
 	struct stable_node *stable_node;
@@ -1195,6 +1278,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			lock_page(kpage);
 			stable_tree_append(rmap_item, page_stable_node(kpage));
 			unlock_page(kpage);
+			mm_slot->pages_merged++;
 		}
 		put_page(kpage);
 		return;
@@ -1209,8 +1293,40 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
+		/*
+		 * Back off exponentially from pages that keep changing;
+		 * a page seen for the first time is not skipped.
+		 */
+		rmap_item->skip_scans = (1 << rmap_item->volatility) - 1;
+		if (rmap_item->volatility < ksm_max_volatile_backoff)
+			rmap_item->volatility++;
 		return;
 	}
+	rmap_item->volatility = 0;
+
+	/*
+	 * A page full of zeroes is merged into the zero page right away,
+	 * without going through the trees.
+	 */
+	if (ksm_use_zero_pages && checksum == calc_zero_checksum()) {
+		struct mm_struct *mm = rmap_item->mm;
+		struct vm_area_struct *vma;
+
+		err = -EFAULT;
+		down_read(&mm->mmap_sem);
+		vma = find_mergeable_vma(mm, rmap_item->address);
+		if (vma && !(vma->vm_flags & VM_LOCKED))
+			err = try_to_merge_one_page(vma, page,
+					ZERO_PAGE(rmap_item->address));
+		up_read(&mm->mmap_sem);
+		if (!err) {
+			mm_slot->pages_merged++;
+			mm_slot->zero_pages_merged++;
+			ksm_zero_pages_merged++;
+			return;
+		}
+		/* Not all zeroes after all: go on with the trees */
+	}
 
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
@@ -1231,6 +1347,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			if (stable_node) {
 				stable_tree_append(tree_rmap_item, stable_node);
 				stable_tree_append(rmap_item, stable_node);
+				mm_slot->pages_merged++;
 			}
 			unlock_page(kpage);
 
@@ -1276,6 +1393,23 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * A volatile page is skipped, without being checksummed again, for the
+ * number of full scans its backoff was set to by cmp_and_merge_page().
+ */
+static bool should_skip_rmap_item(struct page *page,
+				  struct rmap_item *rmap_item,
+				  struct mm_slot *mm_slot)
+{
+	if (!rmap_item->skip_scans || PageKsm(page))
+		return false;
+
+	rmap_item->skip_scans--;
+	mm_slot->pages_skipped++;
+	ksm_pages_skipped++;
+	return true;
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1351,6 +1485,12 @@ next_mm:
 					ksm_scan.rmap_list =
 							&rmap_item->rmap_list;
 					ksm_scan.address += PAGE_SIZE;
+					if (should_skip_rmap_item(*page,
+							rmap_item, slot)) {
+						put_page(*page);
+						cond_resched();
+						continue;
+					}
 				} else
 					put_page(*page);
 				up_read(&mm->mmap_sem);
@@ -1421,8 +1561,14 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
-		if (!PageKsm(page) || !in_stable_tree(rmap_item))
+		if (!PageKsm(page) || !in_stable_tree(rmap_item)) {
+			struct mm_slot *mm_slot = ksm_scan.mm_slot;
+			u64 start = local_clock();
+
 			cmp_and_merge_page(page, rmap_item);
+			mm_slot->scan_ns += local_clock() - start;
+			mm_slot->pages_scanned++;
+		}
 		put_page(page);
 	}
 }
@@ -1530,6 +1676,28 @@ int __ksm_enter(struct mm_struct *mm)
 	return 0;
 }
 
+/*
+ * ksm_mm_stat - show the scan statistics of @mm, for /proc/<pid>/ksm_stat
+ */
+void ksm_mm_stat(struct seq_file *m, struct mm_struct *mm)
+{
+	struct mm_slot *mm_slot;
+	struct mm_slot stat = { };
+
+	spin_lock(&ksm_mmlist_lock);
+	mm_slot = get_mm_slot(mm);
+	if (mm_slot)
+		stat = *mm_slot;
+	spin_unlock(&ksm_mmlist_lock);
+
+	seq_printf(m, "pages_scanned %lu\n", stat.pages_scanned);
+	seq_printf(m, "pages_skipped %lu\n", stat.pages_skipped);
+	seq_printf(m, "pages_merged %lu\n", stat.pages_merged);
+	seq_printf(m, "zero_pages_merged %lu\n", stat.zero_pages_merged);
+	seq_printf(m, "scan_time_us %llu\n",
+		   (unsigned long long)div_u64(stat.scan_ns, NSEC_PER_USEC));
+}
+
 void __ksm_exit(struct mm_struct *mm)
 {
 	struct mm_slot *mm_slot;
@@ -1964,6 +2132,90 @@ static ssize_t pages_volatile_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(pages_volatile);
 
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long value;
+	int err;
+
+	err = strict_strtoul(buf, 10, &value);
+	if (err || value > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = value;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
+static ssize_t max_volatile_backoff_show(struct kobject *kobj,
+					 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_max_volatile_backoff);
+}
+
+static ssize_t max_volatile_backoff_store(struct kobject *kobj,
+					  struct kobj_attribute *attr,
+					  const char *buf, size_t count)
+{
+	unsigned long value;
+	int err;
+
+	err = strict_strtoul(buf, 10, &value);
+	if (err || value > KSM_MAX_VOLATILE_BACKOFF)
+		return -EINVAL;
+
+	ksm_max_volatile_backoff = value;
+
+	return count;
+}
+KSM_ATTR(max_volatile_backoff);
+
+static ssize_t sampled_checksum_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_sampled_checksum);
+}
+
+static ssize_t sampled_checksum_store(struct kobject *kobj,
+				      struct kobj_attribute *attr,
+				      const char *buf, size_t count)
+{
+	unsigned long value;
+	int err;
+
+	err = strict_strtoul(buf, 10, &value);
+	if (err || value > 1)
+		return -EINVAL;
+
+	/* Every page looks volatile once when this changes */
+	ksm_sampled_checksum = value;
+
+	return count;
+}
+KSM_ATTR(sampled_checksum);
+
 static ssize_t full_scans_show(struct kobject *kobj,
 			       struct kobj_attribute *attr, char *buf)
 {
@@ -1980,6 +2232,11 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_skipped_attr.attr,
+	&zero_pages_merged_attr.attr,
+	&use_zero_pages_attr.attr,
+	&max_volatile_backoff_attr.attr,
+	&sampled_checksum_attr.attr,
 	NULL,
 };
 
@@ -1998,6 +2255,9 @@ static int __init ksm_init(void)
 	if (err)
 		goto out;
 
+	zero_checksum[0] = __calc_checksum(ZERO_PAGE(0), false);
+	zero_checksum[1] = __calc_checksum(ZERO_PAGE(0), true);
+
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		printk(KERN_ERR "ksm: creating kthread failed\n");
@@ -39,6 +39,7 @@
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/swapops.h>
+#include <linux/shmem_fs.h>
 #include <linux/spinlock.h>
 #include <linux/eventfd.h>
 #include <linux/sort.h>
@@ -5205,17 +5206,20 @@ static struct page *mc_handle_file_pte(struct vm_area_struct *vma,
 		pgoff = pte_to_pgoff(ptent);
 
 	/* page is moved even if it's not RSS of this task(page-faulted). */
-	page = find_get_page(mapping, pgoff);
+	page = find_get_entry(mapping, pgoff);
 
 #ifdef CONFIG_SWAP
 	/* shmem/tmpfs may report page out on swap: account for that too. */
-	if (radix_tree_exceptional_entry(page)) {
+	if (radix_tree_exceptional_entry(page) && shmem_mapping(mapping)) {
 		swp_entry_t swap = radix_to_swp_entry(page);
 		if (do_swap_account)
 			*entry = swap;
 		page = find_get_page(&swapper_space, swap.val);
 	}
 #endif
+	/* Shadow entry of an evicted page */
+	if (radix_tree_exceptional_entry(page))
+		page = NULL;
 	return page;
 }
 
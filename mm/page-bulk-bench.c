@@ -0,0 +1,169 @@
+/*
+ * mm/page-bulk-bench.c
+ *
+ * Compare the throughput of single page allocation and freeing with
+ * alloc_pages_bulk() and free_pages_bulk(). Writing 1 to
+ * <debugfs>/page-bulk-bench/run runs the benchmark with the nr_pages and
+ * loops set in the same directory and prints the results, in pages per
+ * second, to the kernel log.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/mutex.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
+
+static struct dentry *bench_dir;
+static DEFINE_MUTEX(bench_mutex);
+
+/* pages allocated per iteration */
+static u32 nr_pages = 256;
+
+/* number of iterations */
+static u32 loops = 1000;
+
+static u64 pages_per_sec(unsigned long pages, u64 ns)
+{
+	return ns ? div64_u64((u64)pages * NSEC_PER_SEC, ns) : 0;
+}
+
+static void bench_report(const char *name, unsigned long pages,
+			 u64 alloc_ns, u64 free_ns)
+{
+	pr_info("page-bulk-bench: %-6s alloc %llu pages/s, free %llu pages/s\n",
+		name, pages_per_sec(pages, alloc_ns),
+		pages_per_sec(pages, free_ns));
+}
+
+static int bench_single(struct page **pages)
+{
+	u64 alloc_ns = 0, free_ns = 0, t;
+	unsigned long done = 0, i, nr;
+	unsigned int loop;
+
+	for (loop = 0; loop < loops; loop++) {
+		t = local_clock();
+		for (nr = 0; nr < nr_pages; nr++) {
+			pages[nr] = alloc_page(GFP_KERNEL);
+			if (!pages[nr])
+				break;
+		}
+		alloc_ns += local_clock() - t;
+
+		t = local_clock();
+		for (i = 0; i < nr; i++)
+			__free_page(pages[i]);
+		free_ns += local_clock() - t;
+
+		done += nr;
+		if (nr < nr_pages)
+			return -ENOMEM;
+		cond_resched();
+	}
+
+	bench_report("single", done, alloc_ns, free_ns);
+	return 0;
+}
+
+static int bench_bulk(struct page **pages)
+{
+	u64 alloc_ns = 0, free_ns = 0, t;
+	unsigned long done = 0, nr;
+	unsigned int loop;
+
+	for (loop = 0; loop < loops; loop++) {
+		t = local_clock();
+		nr = alloc_pages_bulk(GFP_KERNEL, nr_pages, pages);
+		alloc_ns += local_clock() - t;
+
+		t = local_clock();
+		free_pages_bulk(pages, nr);
+		free_ns += local_clock() - t;
+
+		done += nr;
+		if (nr < nr_pages)
+			return -ENOMEM;
+		cond_resched();
+	}
+
+	bench_report("bulk", done, alloc_ns, free_ns);
+	return 0;
+}
+
+static int bench_run(void *data, u64 val)
+{
+	struct page **pages;
+	int ret;
+
+	if (val != 1)
+		return -EINVAL;
+
+	mutex_lock(&bench_mutex);
+	ret = -EINVAL;
+	if (!nr_pages || nr_pages > ULONG_MAX / sizeof(*pages) || !loops)
+		goto out;
+
+	ret = -ENOMEM;
+	pages = vmalloc(nr_pages * sizeof(*pages));
+	if (!pages)
+		goto out;
+
+	ret = bench_single(pages);
+	if (!ret)
+		ret = bench_bulk(pages);
+	if (ret)
+		pr_err("page-bulk-bench: out of memory\n");
+
+	vfree(pages);
+out:
+	mutex_unlock(&bench_mutex);
+	return ret;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(bench_run_fops, NULL, bench_run, "%llu\n");
+
+static void page_bulk_bench_exit(void)
+{
+	debugfs_remove_recursive(bench_dir);
+}
+
+static int __init page_bulk_bench_init(void)
+{
+	struct dentry *dentry;
+
+	bench_dir = debugfs_create_dir("page-bulk-bench", NULL);
+	if (!bench_dir)
+		return -ENOMEM;
+
+	dentry = debugfs_create_u32("nr_pages", 0600, bench_dir, &nr_pages);
+	if (!dentry)
+		goto fail;
+
+	dentry = debugfs_create_u32("loops", 0600, bench_dir, &loops);
+	if (!dentry)
+		goto fail;
+
+	dentry = debugfs_create_file("run", 0200, bench_dir, NULL,
+				     &bench_run_fops);
+	if (!dentry)
+		goto fail;
+
+	return 0;
+fail:
+	page_bulk_bench_exit();
+	return -ENOMEM;
+}
+
+module_init(page_bulk_bench_init);
+module_exit(page_bulk_bench_exit);
+MODULE_LICENSE("GPL");
@@ -776,6 +776,20 @@ void __free_pages_bootmem(struct page *page, unsigned int order)
 }
 
 #ifdef CONFIG_CMA
+/*
+ * Movable allocations that do not ask for CMA memory with __GFP_CMA, page
+ * cache in particular, fall back to MIGRATE_CMA pageblocks only while this
+ * is set. Such pages are often pinned for I/O or kept busy, and are what
+ * makes contiguous allocations fail or wait; clearing it keeps CMA areas
+ * for the anonymous pages of user space.
+ */
+int sysctl_cma_movable_fallback __read_mostly = 1;
+
+static inline bool gfp_allows_cma(gfp_t gfp_flags)
+{
+	return sysctl_cma_movable_fallback || (gfp_flags & __GFP_CMA);
+}
+
 bool is_cma_pageblock(struct page *page)
 {
 	return get_pageblock_migratetype(page) == MIGRATE_CMA;
@@ -928,6 +942,13 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
  * This array describes the order lists are fallen back to when
  * the free lists for the desirable migrate type are depleted
  */
+#ifndef CONFIG_CMA
+static inline bool gfp_allows_cma(gfp_t gfp_flags)
+{
+	return true;
+}
+#endif
+
 static int fallbacks[MIGRATE_TYPES][4] = {
 	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,     MIGRATE_RESERVE },
 	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE,     MIGRATE_RESERVE },
@@ -1045,6 +1066,13 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			if (migratetype == MIGRATE_RESERVE)
 				break;
 
+#ifdef CONFIG_CMA
+			/* __GFP_CMA allocations tried CMA pageblocks first */
+			if (is_migrate_cma(migratetype) &&
+			    !sysctl_cma_movable_fallback)
+				continue;
+#endif
+
 			area = &(zone->free_area[current_order]);
 			if (list_empty(&area->free_list[migratetype]))
 				continue;
@@ -1359,25 +1387,15 @@ void mark_free_pages(struct zone *zone)
 #endif /* CONFIG_PM */
 
 /*
- * Free a 0-order page
- * cold == 1 ? free a cold page : free a hot page
+ * Put a prepared 0-order page on the per-cpu list of its zone, with
+ * interrupts disabled. page_private() holds its pageblock migratetype.
  */
-void free_hot_cold_page(struct page *page, int cold)
+static void __free_hot_cold_page(struct page *page, int cold)
 {
 	struct zone *zone = page_zone(page);
 	struct per_cpu_pages *pcp;
-	unsigned long flags;
-	int migratetype;
-	int wasMlocked = __TestClearPageMlocked(page);
-
-	if (!free_pages_prepare(page, 0))
-		return;
+	int migratetype = page_private(page);
 
-	migratetype = get_pageblock_migratetype(page);
-	set_page_private(page, migratetype);
-	local_irq_save(flags);
-	if (unlikely(wasMlocked))
-		free_page_mlock(page);
 	__count_vm_event(PGFREE);
 
 	/*
@@ -1391,7 +1409,7 @@ void free_hot_cold_page(struct page *page, int cold)
 		if (unlikely(migratetype == MIGRATE_ISOLATE) ||
 			     is_migrate_cma(migratetype)) {
 			free_one_page(zone, page, 0, migratetype);
-			goto out;
+			return;
 		}
 		migratetype = MIGRATE_MOVABLE;
 	}
@@ -1406,23 +1424,95 @@ void free_hot_cold_page(struct page *page, int cold)
 		free_pcppages_bulk(zone, pcp->batch, pcp);
 		pcp->count -= pcp->batch;
 	}
+}
 
-out:
+/*
+ * Free a 0-order page
+ * cold == 1 ? free a cold page : free a hot page
+ */
+void free_hot_cold_page(struct page *page, int cold)
+{
+	unsigned long flags;
+	int wasMlocked = __TestClearPageMlocked(page);
+
+	if (!free_pages_prepare(page, 0))
+		return;
+
+	set_page_private(page, get_pageblock_migratetype(page));
+	local_irq_save(flags);
+	if (unlikely(wasMlocked))
+		free_page_mlock(page);
+	__free_hot_cold_page(page, cold);
 	local_irq_restore(flags);
 }
 
+/*
+ * Pages moved to or from the per-cpu lists per interrupt disabled section
+ * when freeing or allocating in bulk, to bound the interrupt latency.
+ */
+#define PCP_BULK_BATCH		64
+
 /*
  * Free a list of 0-order pages
+ *
+ * The pages are prepared first, then moved to the per-cpu lists with
+ * interrupts disabled once per PCP_BULK_BATCH pages rather than once
+ * per page.
  */
 void free_hot_cold_page_list(struct list_head *list, int cold)
 {
 	struct page *page, *next;
+	unsigned long flags;
+	int nr = 0;
 
 	list_for_each_entry_safe(page, next, list, lru) {
 		trace_mm_page_free_batched(page, cold);
-		free_hot_cold_page(page, cold);
+		/* Rare, leave these to the single page path */
+		if (unlikely(PageMlocked(page))) {
+			list_del(&page->lru);
+			free_hot_cold_page(page, cold);
+			continue;
+		}
+		if (!free_pages_prepare(page, 0)) {
+			list_del(&page->lru);
+			continue;
+		}
+		set_page_private(page, get_pageblock_migratetype(page));
+	}
+
+	local_irq_save(flags);
+	list_for_each_entry_safe(page, next, list, lru) {
+		__free_hot_cold_page(page, cold);
+		if (++nr % PCP_BULK_BATCH == 0) {
+			local_irq_restore(flags);
+			local_irq_save(flags);
+		}
+	}
+	local_irq_restore(flags);
+}
+
+/**
+ * free_pages_bulk - release an array of 0-order pages
+ * @pages: the pages
+ * @nr_pages: number of pages in @pages
+ *
+ * Drops a reference to each page, like __free_page(), and frees the pages
+ * whose count reached zero as a batch, see free_hot_cold_page_list().
+ */
+void free_pages_bulk(struct page **pages, unsigned long nr_pages)
+{
+	LIST_HEAD(list);
+	unsigned long i;
+
+	for (i = 0; i < nr_pages; i++) {
+		if (put_page_testzero(pages[i]))
+			list_add_tail(&pages[i]->lru, &list);
 	}
+
+	if (!list_empty(&list))
+		free_hot_cold_page_list(&list, 0);
 }
+EXPORT_SYMBOL(free_pages_bulk);
 
 /*
  * split_page takes a non-compound higher-order page, and splits it into
@@ -1519,6 +1609,30 @@ int split_free_page(struct page *page)
 	return nr_pages;
 }
 
+#ifdef CONFIG_CMA
+static struct page *pcp_first_non_cma(struct list_head *list, int cold)
+{
+	struct page *page;
+
+	if (cold) {
+		list_for_each_entry_reverse(page, list, lru)
+			if (!is_cma_pageblock(page))
+				return page;
+	} else {
+		list_for_each_entry(page, list, lru)
+			if (!is_cma_pageblock(page))
+				return page;
+	}
+
+	return NULL;
+}
+#else
+static inline struct page *pcp_first_non_cma(struct list_head *list, int cold)
+{
+	return NULL;
+}
+#endif
+
 /*
  * Really, prep_compound_page() should be called from __rmqueue_bulk().  But
  * we cheat by calling it from here, in the order > 0 path.  Saves a branch
@@ -1555,8 +1669,25 @@ again:
 		else
 			page = list_entry(list->next, struct page, lru);
 
-		list_del(&page->lru);
-		pcp->count--;
+		/*
+		 * The list also holds the CMA pages of __GFP_CMA allocations,
+		 * look past them or go to the buddy lists if needed.
+		 */
+		if (!gfp_allows_cma(gfp_flags) && is_cma_pageblock(page))
+			page = pcp_first_non_cma(list, cold);
+
+		if (page) {
+			list_del(&page->lru);
+			pcp->count--;
+		} else {
+			spin_lock(&zone->lock);
+			page = __rmqueue(zone, 0, migratetype);
+			spin_unlock(&zone->lock);
+			if (!page)
+				goto failed;
+			__mod_zone_freepage_state(zone, -1,
+					get_pageblock_migratetype(page));
+		}
 	} else {
 		if (unlikely(gfp_flags & __GFP_NOFAIL)) {
 			/*
@@ -1938,6 +2069,8 @@ zonelist_scan:
 			int ret;
 
 			mark = zone->watermark[alloc_flags & ALLOC_WMARK_MASK];
+			if ((alloc_flags & ALLOC_WMARK_MASK) != ALLOC_WMARK_MIN)
+				mark += zone->watermark_boost;
 			if (zone_watermark_ok(zone, order, mark,
 				    classzone_idx, alloc_flags))
 				goto try_this_zone;
@@ -2369,7 +2502,8 @@ gfp_to_alloc_flags(gfp_t gfp_mask)
 			alloc_flags |= ALLOC_NO_WATERMARKS;
 	}
 #ifdef CONFIG_CMA
-	if (allocflags_to_migratetype(gfp_mask) == MIGRATE_MOVABLE)
+	if (allocflags_to_migratetype(gfp_mask) == MIGRATE_MOVABLE &&
+	    gfp_allows_cma(gfp_mask))
 		alloc_flags |= ALLOC_CMA;
 #endif
 	return alloc_flags;
@@ -2634,7 +2768,8 @@ retry_cpuset:
 		goto out;
 
 #ifdef CONFIG_CMA
-	if (allocflags_to_migratetype(gfp_mask) == MIGRATE_MOVABLE)
+	if (allocflags_to_migratetype(gfp_mask) == MIGRATE_MOVABLE &&
+	    gfp_allows_cma(gfp_mask))
 		alloc_flags |= ALLOC_CMA;
 #endif
 	/* First allocation attempt */
@@ -2662,6 +2797,118 @@ out:
 }
 EXPORT_SYMBOL(__alloc_pages_nodemask);
 
+/**
+ * alloc_pages_bulk - allocate a number of 0-order pages at once
+ * @gfp_mask: GFP flags for the allocation
+ * @nr_pages: number of pages to allocate
+ * @pages: array the pages are stored in
+ *
+ * As long as the preferred zone stays above its low watermark with
+ * @nr_pages to spare, the pages are taken from its per-cpu list with
+ * interrupts disabled once per PCP_BULK_BATCH pages, refilling the list
+ * from the buddy lists under a single hold of the zone lock per refill.
+ * Otherwise, and for
+ * whatever could not be allocated that way, the pages are allocated one
+ * at a time with alloc_pages(), which reclaims or compacts as needed.
+ *
+ * Returns the number of pages stored in @pages, less than @nr_pages only
+ * when memory ran out.
+ */
+unsigned long alloc_pages_bulk(gfp_t gfp_mask, unsigned long nr_pages,
+			       struct page **pages)
+{
+	enum zone_type high_zoneidx = gfp_zone(gfp_mask);
+	int migratetype = allocflags_to_migratetype(gfp_mask);
+	int cold = !!(gfp_mask & __GFP_COLD);
+	int alloc_flags = ALLOC_WMARK_LOW;
+	struct zonelist *zonelist;
+	struct zone *zone;
+	struct per_cpu_pages *pcp;
+	struct list_head *list;
+	struct page *page;
+	unsigned long flags, nr = 0, end, i, j;
+	bool empty = false;
+
+	gfp_mask &= gfp_allowed_mask;
+	might_sleep_if(gfp_mask & __GFP_WAIT);
+
+	zonelist = node_zonelist(numa_node_id(), gfp_mask);
+	first_zones_zonelist(zonelist, high_zoneidx,
+			     &cpuset_current_mems_allowed, &zone);
+	if (!zone || nr_pages < 2 ||
+	    !cpuset_zone_allowed_softwall(zone, gfp_mask))
+		goto single;
+
+#ifdef CONFIG_CMA
+	if (migratetype == MIGRATE_MOVABLE && gfp_allows_cma(gfp_mask))
+		alloc_flags |= ALLOC_CMA;
+#endif
+	if (!zone_watermark_ok(zone, 0, low_wmark_pages(zone) + nr_pages,
+			       zone_idx(zone), alloc_flags))
+		goto single;
+
+	while (nr < nr_pages && !empty) {
+		end = min(nr_pages, nr + PCP_BULK_BATCH);
+
+		local_irq_save(flags);
+		pcp = &this_cpu_ptr(zone->pageset)->pcp;
+		list = &pcp->lists[migratetype];
+		while (nr < end) {
+			if (list_empty(list)) {
+				pcp->count += rmqueue_bulk(zone, 0,
+						max_t(unsigned long,
+						      pcp->batch, end - nr),
+						list, migratetype, cold,
+						gfp_mask & __GFP_CMA);
+				if (list_empty(list)) {
+					empty = true;
+					break;
+				}
+			}
+
+			if (cold)
+				page = list_entry(list->prev, struct page, lru);
+			else
+				page = list_entry(list->next, struct page, lru);
+			if (!gfp_allows_cma(gfp_mask) &&
+			    is_cma_pageblock(page)) {
+				page = pcp_first_non_cma(list, cold);
+				if (!page) {
+					empty = true;
+					break;
+				}
+			}
+
+			list_del(&page->lru);
+			pcp->count--;
+			__count_zone_vm_events(PGALLOC, zone, 1);
+			zone_statistics(zone, zone, gfp_mask);
+			pages[nr++] = page;
+		}
+		local_irq_restore(flags);
+	}
+
+	/* Drop the pages that fail the checks, like buffered_rmqueue() */
+	for (i = 0, j = 0; i < nr; i++) {
+		VM_BUG_ON(bad_range(zone, pages[i]));
+		if (prep_new_page(pages[i], 0, gfp_mask))
+			continue;
+		trace_mm_page_alloc(pages[i], 0, gfp_mask, migratetype);
+		pages[j++] = pages[i];
+	}
+	nr = j;
+
+single:
+	for (; nr < nr_pages; nr++) {
+		pages[nr] = alloc_pages(gfp_mask, 0);
+		if (!pages[nr])
+			break;
+	}
+
+	return nr;
+}
+EXPORT_SYMBOL(alloc_pages_bulk);
+
 /*
  * Common helper functions.
  */
@@ -4541,6 +4788,9 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 	pgdat->nr_zones = 0;
 	init_waitqueue_head(&pgdat->kswapd_wait);
 	pgdat->kswapd_max_order = 0;
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat_page_cgroup_init(pgdat);
 
 	for (j = 0; j < MAX_NR_ZONES; j++) {
@@ -5856,9 +6106,20 @@ __alloc_contig_migrate_alloc(struct page *page, unsigned long private,
 	return alloc_page(gfp_mask);
 }
 
-/* [start, end) must belong to a single zone. */
+/*
+ * Pages isolated before each call to migrate_pages(). Migrating bigger
+ * batches amortizes the reclaim of clean pages and the TLB flushes.
+ */
+#define CONTIG_MIGRATE_BATCH	(4 * COMPACT_CLUSTER_MAX)
+
+/*
+ * [start, end) must belong to a single zone. task is the task allocating
+ * the range, whose fatal signals abort the migration also when it is
+ * done from a worker.
+ */
 static int __alloc_contig_migrate_range(struct compact_control *cc,
-					unsigned long start, unsigned long end)
+					unsigned long start, unsigned long end,
+					struct task_struct *task)
 {
 	/* This function is based on compact_zone() from compaction.c. */
 	unsigned long nr_reclaimed;
@@ -5866,19 +6127,32 @@ static int __alloc_contig_migrate_range(struct compact_control *cc,
 	unsigned int tries = 0;
 	int ret = 0;
 
-	migrate_prep();
-
 	while (pfn < end || !list_empty(&cc->migratepages)) {
-		if (fatal_signal_pending(current)) {
+		if (fatal_signal_pending(task)) {
 			ret = -EINTR;
 			break;
 		}
 
 		if (list_empty(&cc->migratepages)) {
+			LIST_HEAD(batch);
+
 			cc->nr_migratepages = 0;
-			pfn = isolate_migratepages_range(cc->zone, cc,
-							 pfn, end, true);
-			if (!pfn) {
+			while (pfn < end &&
+			       cc->nr_migratepages < CONTIG_MIGRATE_BATCH) {
+				/*
+				 * Each call accounts the whole of
+				 * cc->migratepages as isolated, so it
+				 * must only hold the pages of this call.
+				 */
+				pfn = isolate_migratepages_range(cc->zone, cc,
+								 pfn, end, true);
+				list_splice_tail_init(&cc->migratepages,
+						      &batch);
+				if (!pfn || fatal_signal_pending(task))
+					break;
+			}
+			list_splice(&batch, &cc->migratepages);
+			if (!pfn || fatal_signal_pending(task)) {
 				ret = -EINTR;
 				break;
 			}
@@ -5901,6 +6175,77 @@ static int __alloc_contig_migrate_range(struct compact_control *cc,
 	return ret > 0 ? 0 : ret;
 }
 
+/*
+ * Ranges spanning several pageblocks are split in up to one chunk per
+ * online CPU, and the chunks are migrated in parallel: migration mostly
+ * waits on page locks and writeback, so a busy page in one chunk does
+ * not hold up the others.
+ */
+struct contig_migrate_work {
+	struct work_struct work;
+	struct compact_control cc;
+	struct task_struct *task;
+	unsigned long start;
+	unsigned long end;
+	int ret;
+};
+
+static void contig_migrate_workfn(struct work_struct *work)
+{
+	struct contig_migrate_work *w =
+		container_of(work, struct contig_migrate_work, work);
+
+	w->ret = __alloc_contig_migrate_range(&w->cc, w->start, w->end,
+					      w->task);
+}
+
+static int alloc_contig_migrate_range(struct compact_control *cc,
+				      unsigned long start, unsigned long end)
+{
+	struct contig_migrate_work *works;
+	unsigned long chunk, pfn;
+	int nr_chunks, i, ret;
+
+	migrate_prep();
+
+	nr_chunks = min_t(unsigned long, num_online_cpus(),
+			  DIV_ROUND_UP(end - start, pageblock_nr_pages));
+	if (nr_chunks <= 1)
+		return __alloc_contig_migrate_range(cc, start, end, current);
+
+	works = kcalloc(nr_chunks - 1, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return __alloc_contig_migrate_range(cc, start, end, current);
+
+	chunk = ALIGN(DIV_ROUND_UP(end - start, nr_chunks), pageblock_nr_pages);
+	pfn = start + chunk;
+	for (i = 0; i < nr_chunks - 1 && pfn < end; i++, pfn += chunk) {
+		struct contig_migrate_work *w = &works[i];
+
+		w->cc = *cc;
+		INIT_LIST_HEAD(&w->cc.migratepages);
+		w->task = current;
+		w->start = pfn;
+		w->end = min(pfn + chunk, end);
+		INIT_WORK(&w->work, contig_migrate_workfn);
+		queue_work(system_unbound_wq, &w->work);
+	}
+	nr_chunks = i;
+
+	/* The first chunk is migrated by the caller */
+	ret = __alloc_contig_migrate_range(cc, start, min(start + chunk, end),
+					   current);
+
+	for (i = 0; i < nr_chunks; i++) {
+		flush_work(&works[i].work);
+		if (!ret)
+			ret = works[i].ret;
+	}
+	kfree(works);
+
+	return ret;
+}
+
 /**
  * alloc_contig_range() -- tries to allocate given range of pages
  * @start:	start PFN to allocate
@@ -5968,7 +6313,7 @@ int alloc_contig_range(unsigned long start, unsigned long end,
 
 	zone->cma_alloc = 1;
 
-	ret = __alloc_contig_migrate_range(&cc, start, end);
+	ret = alloc_contig_migrate_range(&cc, start, end);
 	if (ret)
 		goto done;
 
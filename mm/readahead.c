@@ -17,6 +17,19 @@
 #include <linux/task_io_accounting_ops.h>
 #include <linux/pagevec.h>
 #include <linux/pagemap.h>
+#include <linux/slab.h>
+#include <linux/file.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
+#include <linux/uaccess.h>
+
+/*
+ * Files that have been read from start to end before, such as the
+ * executables and libraries read on every application start, are given a
+ * larger readahead window.
+ */
+#define RA_FULL_READ_SCALE	4
 
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
@@ -26,6 +39,8 @@ void
 file_ra_state_init(struct file_ra_state *ra, struct address_space *mapping)
 {
 	ra->ra_pages = mapping->backing_dev_info->ra_pages;
+	if (test_bit(AS_FULL_READ, &mapping->flags))
+		ra->ra_pages *= RA_FULL_READ_SCALE;
 	ra->prev_pos = -1;
 }
 EXPORT_SYMBOL_GPL(file_ra_state_init);
@@ -177,7 +192,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		rcu_read_lock();
 		page = radix_tree_lookup(&mapping->page_tree, page_offset);
 		rcu_read_unlock();
-		if (page)
+		if (page && !radix_tree_exceptional_entry(page))
 			continue;
 
 		page = page_cache_alloc_readahead(mapping);
@@ -354,7 +369,7 @@ static pgoff_t count_history_pages(struct address_space *mapping,
 	pgoff_t head;
 
 	rcu_read_lock();
-	head = radix_tree_prev_hole(&mapping->page_tree, offset - 1, max);
+	head = page_cache_prev_hole(mapping, offset - 1, max);
 	rcu_read_unlock();
 
 	return offset - 1 - head;
@@ -394,6 +409,100 @@ static int try_context_readahead(struct address_space *mapping,
 	return 1;
 }
 
+/*
+ * Remember that the file has been read whole once the readahead window
+ * reaches the end of the file with every page before it cached, so that
+ * the next opens get a larger window, see file_ra_state_init(). A window
+ * starting at the beginning of the file says nothing about the file being
+ * read whole, small files fit into the very first one.
+ */
+static void ra_check_full_read(struct address_space *mapping,
+			       struct file_ra_state *ra)
+{
+	loff_t isize = i_size_read(mapping->host);
+
+	if (test_bit(AS_FULL_READ, &mapping->flags))
+		return;
+
+	if (!isize || !ra->start ||
+	    ra->start + ra->size <= (isize - 1) >> PAGE_CACHE_SHIFT)
+		return;
+
+	if (count_history_pages(mapping, ra, ra->start,
+				ra->start) < ra->start)
+		return;
+
+	set_bit(AS_FULL_READ, &mapping->flags);
+}
+
+/*
+ * Consecutive random reads needed before a pattern is acted upon
+ */
+#define RA_PATTERN_HITS		2
+
+/*
+ * Most strided reads issued ahead of a strided reader
+ */
+#define RA_STRIDE_MAX		8
+
+/*
+ * Random reads that still follow a pattern: at a constant stride from
+ * each other, e.g. walking a table of fixed size records, or clustered
+ * within a readahead window, e.g. faulting in the scattered parts of an
+ * APK that are used on launch. Once a pattern has been seen on enough
+ * consecutive reads, read the next strides ahead, or read around the
+ * cluster.
+ */
+static unsigned long
+pattern_readahead(struct address_space *mapping,
+		  struct file_ra_state *ra, struct file *filp,
+		  pgoff_t offset, unsigned long req_size,
+		  unsigned long max)
+{
+	long delta = offset - ra->prev_start;
+	unsigned long nr = 0;
+	long next;
+	int i, n;
+
+	ra->prev_start = offset;
+
+	if (delta == ra->stride) {
+		if (ra->stride_hits < RA_PATTERN_HITS)
+			ra->stride_hits++;
+	} else {
+		ra->stride = delta;
+		ra->stride_hits = 0;
+	}
+
+	if (abs(delta) < max) {
+		if (ra->cluster_hits < RA_PATTERN_HITS)
+			ra->cluster_hits++;
+	} else
+		ra->cluster_hits = 0;
+
+	if (ra->stride_hits >= RA_PATTERN_HITS &&
+	    abs(ra->stride) >= req_size) {
+		n = min_t(unsigned long, RA_STRIDE_MAX, max / 2 / req_size);
+		next = offset;
+		for (i = 0; i < n; i++) {
+			next += ra->stride;
+			if (next < 0)
+				break;
+			nr += __do_page_cache_readahead(mapping, filp, next,
+							req_size, 0);
+		}
+		return nr;
+	}
+
+	if (ra->cluster_hits >= RA_PATTERN_HITS) {
+		n = max / 2;
+		next = max_t(long, 0, offset - n / 2);
+		return __do_page_cache_readahead(mapping, filp, next, n, 0);
+	}
+
+	return 0;
+}
+
 /*
  * A minimal readahead algorithm for trivial sequential/random reads.
  */
@@ -433,7 +542,7 @@ ondemand_readahead(struct address_space *mapping,
 		pgoff_t start;
 
 		rcu_read_lock();
-		start = radix_tree_next_hole(&mapping->page_tree, offset+1,max);
+		start = page_cache_next_hole(mapping, offset+1,max);
 		rcu_read_unlock();
 
 		if (!start || start - offset > max)
@@ -468,9 +577,11 @@ ondemand_readahead(struct address_space *mapping,
 
 	/*
 	 * standalone, small random read
-	 * Read as is, and do not pollute the readahead state.
+	 * Read as is, and do not pollute the readahead state. Only the
+	 * pattern of random reads is tracked.
 	 */
-	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
+	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0) +
+		pattern_readahead(mapping, ra, filp, offset, req_size, max);
 
 initial_readahead:
 	ra->start = offset;
@@ -488,9 +599,34 @@ readit:
 		ra->size += ra->async_size;
 	}
 
+	ra_check_full_read(mapping, ra);
+
 	return ra_submit(ra, mapping, filp);
 }
 
+/*
+ * mmap read-around of the page fault at @offset, see do_sync_mmap_readahead().
+ * Faults that missed too often in this file get no read-around, @lotsamiss,
+ * but the pattern of those random faults is still followed.
+ */
+void page_cache_mmap_readaround(struct address_space *mapping,
+				struct file_ra_state *ra, struct file *filp,
+				pgoff_t offset, bool lotsamiss)
+{
+	unsigned long max = max_sane_readahead(ra->ra_pages);
+
+	if (lotsamiss) {
+		pattern_readahead(mapping, ra, filp, offset, 1, max);
+		return;
+	}
+
+	ra->start = max_t(long, 0, offset - max / 2);
+	ra->size = max;
+	ra->async_size = max / 4;
+	ra_check_full_read(mapping, ra);
+	ra_submit(ra, mapping, filp);
+}
+
 /**
  * page_cache_sync_readahead - generic file readahead
  * @mapping: address_space which holds the pagecache and I/O vectors
@@ -567,3 +703,216 @@ page_cache_async_readahead(struct address_space *mapping,
 	ondemand_readahead(mapping, ra, filp, true, offset, req_size);
 }
 EXPORT_SYMBOL_GPL(page_cache_async_readahead);
+
+#ifdef CONFIG_READAHEAD_PREFETCH
+/*
+ * Prefetch list
+ *
+ * Userspace writes lines of the form "<path> [<offset> [<length>]]" to
+ * /proc/readahead_prefetch, offset and length in bytes, a missing or zero
+ * length meaning up to the end of the file. Files are opened with the
+ * credentials of the writer, and the ranges read into the page cache
+ * asynchronously in the order they were written. Reading the file shows
+ * how many pages were already cached (hits) and how many had to be read
+ * (misses).
+ */
+struct ra_prefetch {
+	struct list_head list;
+	struct file *file;
+	pgoff_t start;
+	unsigned long nr_pages;
+};
+
+static LIST_HEAD(ra_prefetch_list);
+static DEFINE_SPINLOCK(ra_prefetch_lock);
+
+static struct {
+	unsigned long requests;
+	unsigned long errors;
+	unsigned long pending;
+	unsigned long hits;
+	unsigned long misses;
+} ra_prefetch_stats;
+
+static void ra_prefetch_one(struct ra_prefetch *p)
+{
+	struct address_space *mapping = p->file->f_mapping;
+	loff_t isize = i_size_read(mapping->host);
+	unsigned long nr_pages = 0, nr_read = 0;
+	pgoff_t end;
+	int ret;
+
+	if (isize && p->start <= (isize - 1) >> PAGE_CACHE_SHIFT) {
+		end = (isize - 1) >> PAGE_CACHE_SHIFT;
+		nr_pages = min_t(unsigned long, p->nr_pages,
+				 end - p->start + 1);
+		nr_pages = max_sane_readahead(nr_pages);
+		ret = force_page_cache_readahead(mapping, p->file,
+						 p->start, nr_pages);
+		if (ret > 0)
+			nr_read = ret;
+	}
+
+	spin_lock(&ra_prefetch_lock);
+	ra_prefetch_stats.pending--;
+	ra_prefetch_stats.misses += nr_read;
+	ra_prefetch_stats.hits += nr_pages - min(nr_pages, nr_read);
+	spin_unlock(&ra_prefetch_lock);
+
+	fput(p->file);
+	kfree(p);
+}
+
+static void ra_prefetch_workfn(struct work_struct *work)
+{
+	struct ra_prefetch *p;
+
+	for (;;) {
+		p = NULL;
+		spin_lock(&ra_prefetch_lock);
+		if (!list_empty(&ra_prefetch_list)) {
+			p = list_first_entry(&ra_prefetch_list,
+					     struct ra_prefetch, list);
+			list_del(&p->list);
+		}
+		spin_unlock(&ra_prefetch_lock);
+
+		if (!p)
+			break;
+
+		ra_prefetch_one(p);
+		cond_resched();
+	}
+}
+
+static DECLARE_WORK(ra_prefetch_work, ra_prefetch_workfn);
+
+static int ra_prefetch_parse(char *line)
+{
+	struct ra_prefetch *p;
+	char *path, *arg;
+	u64 offset = 0, len = 0;
+	struct file *file;
+
+	path = strsep(&line, " \t");
+	if (!*path)
+		return 0;
+
+	arg = strsep(&line, " \t");
+	if (arg && *arg && kstrtoull(arg, 0, &offset))
+		return -EINVAL;
+	arg = strsep(&line, " \t");
+	if (arg && *arg && kstrtoull(arg, 0, &len))
+		return -EINVAL;
+
+	p = kmalloc(sizeof(*p), GFP_KERNEL);
+	if (!p)
+		return -ENOMEM;
+
+	file = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(file)) {
+		kfree(p);
+		spin_lock(&ra_prefetch_lock);
+		ra_prefetch_stats.errors++;
+		spin_unlock(&ra_prefetch_lock);
+		return 0;
+	}
+
+	p->file = file;
+	p->start = offset >> PAGE_CACHE_SHIFT;
+	if (len)
+		p->nr_pages = ((offset + len - 1) >> PAGE_CACHE_SHIFT) -
+			p->start + 1;
+	else
+		p->nr_pages = ULONG_MAX;
+
+	spin_lock(&ra_prefetch_lock);
+	list_add_tail(&p->list, &ra_prefetch_list);
+	ra_prefetch_stats.requests++;
+	ra_prefetch_stats.pending++;
+	spin_unlock(&ra_prefetch_lock);
+
+	return 0;
+}
+
+static ssize_t ra_prefetch_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	char *kbuf, *line, *next;
+	size_t len = min_t(size_t, count, PAGE_SIZE - 1);
+	int ret = 0;
+
+	kbuf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!kbuf)
+		return -ENOMEM;
+
+	if (copy_from_user(kbuf, buf, len)) {
+		ret = -EFAULT;
+		goto out;
+	}
+	kbuf[len] = '\0';
+
+	/* Only consume complete lines from a truncated write */
+	if (len < count) {
+		line = strrchr(kbuf, '\n');
+		if (!line) {
+			ret = -EINVAL;
+			goto out;
+		}
+		len = line - kbuf + 1;
+		line[1] = '\0';
+	}
+
+	next = kbuf;
+	while ((line = strsep(&next, "\n")) != NULL) {
+		ret = ra_prefetch_parse(strim(line));
+		if (ret) {
+			/* Report the lines already queued as written */
+			if (line != kbuf) {
+				len = line - kbuf;
+				ret = 0;
+			}
+			break;
+		}
+	}
+
+	queue_work(system_unbound_wq, &ra_prefetch_work);
+out:
+	kfree(kbuf);
+	return ret ? ret : len;
+}
+
+static int ra_prefetch_show(struct seq_file *m, void *v)
+{
+	spin_lock(&ra_prefetch_lock);
+	seq_printf(m, "requests %lu\n", ra_prefetch_stats.requests);
+	seq_printf(m, "errors %lu\n", ra_prefetch_stats.errors);
+	seq_printf(m, "pending %lu\n", ra_prefetch_stats.pending);
+	seq_printf(m, "hits %lu\n", ra_prefetch_stats.hits);
+	seq_printf(m, "misses %lu\n", ra_prefetch_stats.misses);
+	spin_unlock(&ra_prefetch_lock);
+
+	return 0;
+}
+
+static int ra_prefetch_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ra_prefetch_show, NULL);
+}
+
+static const struct file_operations ra_prefetch_fops = {
+	.open		= ra_prefetch_open,
+	.read		= seq_read,
+	.write		= ra_prefetch_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init ra_prefetch_init(void)
+{
+	proc_create("readahead_prefetch", S_IRUSR | S_IWUSR, NULL,
+		    &ra_prefetch_fops);
+	return 0;
+}
+module_init(ra_prefetch_init);
+#endif /* CONFIG_READAHEAD_PREFETCH */
@@ -666,6 +666,32 @@ void kmem_cache_free(struct kmem_cache *c, void *b)
 }
 EXPORT_SYMBOL(kmem_cache_free);
 
+void kmem_cache_free_bulk(struct kmem_cache *c, size_t nr, void **p)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++)
+		kmem_cache_free(c, p[i]);
+}
+EXPORT_SYMBOL(kmem_cache_free_bulk);
+
+int kmem_cache_alloc_bulk(struct kmem_cache *c, gfp_t flags, size_t nr,
+			  void **p)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++) {
+		p[i] = kmem_cache_alloc(c, flags);
+		if (!p[i]) {
+			kmem_cache_free_bulk(c, i, p);
+			return 0;
+		}
+	}
+
+	return nr;
+}
+EXPORT_SYMBOL(kmem_cache_alloc_bulk);
+
 unsigned int kmem_cache_size(struct kmem_cache *c)
 {
 	return c->size;
@@ -0,0 +1,225 @@
+/*
+ * mm/slub-bench.c
+ *
+ * Microbenchmark of the SLUB fast paths. For every kmalloc cache size it
+ * reports the cost per object, in nanoseconds, of:
+ *
+ *  - kmalloc() followed by kfree() on the same cpu,
+ *  - kmalloc() on one cpu and kfree() on another one, which defeats the
+ *    lockless free path,
+ *  - kmem_cache_alloc_bulk() and kmem_cache_free_bulk().
+ *
+ * Writing 1 to <debugfs>/slub-bench/run runs the benchmark with the
+ * nr_objs and loops set in the same directory and prints the results to
+ * the kernel log.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/sched.h>
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/workqueue.h>
+#include <linux/math64.h>
+
+static struct dentry *bench_dir;
+static DEFINE_MUTEX(bench_mutex);
+
+/* objects allocated per iteration */
+static u32 nr_objs = 256;
+
+/* number of iterations */
+static u32 loops = 1000;
+
+struct bench {
+	size_t size;
+	void **objs;
+	u64 alloc_ns;
+	u64 free_ns;
+};
+
+static long bench_kmalloc(void *arg)
+{
+	struct bench *b = arg;
+	unsigned int i;
+	u64 t;
+
+	t = local_clock();
+	for (i = 0; i < nr_objs; i++) {
+		b->objs[i] = kmalloc(b->size, GFP_KERNEL);
+		if (!b->objs[i])
+			break;
+	}
+	b->alloc_ns += local_clock() - t;
+
+	if (i < nr_objs) {
+		while (i--)
+			kfree(b->objs[i]);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static long bench_kfree(void *arg)
+{
+	struct bench *b = arg;
+	unsigned int i;
+	u64 t;
+
+	t = local_clock();
+	for (i = 0; i < nr_objs; i++)
+		kfree(b->objs[i]);
+	b->free_ns += local_clock() - t;
+
+	return 0;
+}
+
+static long bench_alloc_bulk(void *arg)
+{
+	struct bench *b = arg;
+	u64 t;
+	int nr;
+
+	t = local_clock();
+	nr = kmem_cache_alloc_bulk(kmalloc_slab(b->size), GFP_KERNEL,
+				   nr_objs, b->objs);
+	b->alloc_ns += local_clock() - t;
+
+	return nr ? 0 : -ENOMEM;
+}
+
+static long bench_free_bulk(void *arg)
+{
+	struct bench *b = arg;
+	u64 t;
+
+	t = local_clock();
+	kmem_cache_free_bulk(kmalloc_slab(b->size), nr_objs, b->objs);
+	b->free_ns += local_clock() - t;
+
+	return 0;
+}
+
+/* Run @alloc_fn on @acpu and @free_fn on @fcpu, @loops times */
+static int bench_run(struct bench *b, const char *name,
+		     long (*alloc_fn)(void *), int acpu,
+		     long (*free_fn)(void *), int fcpu)
+{
+	unsigned long objs = (unsigned long)nr_objs * loops;
+	unsigned int loop;
+	long ret;
+
+	b->alloc_ns = b->free_ns = 0;
+	for (loop = 0; loop < loops; loop++) {
+		ret = work_on_cpu(acpu, alloc_fn, b);
+		if (ret)
+			return ret;
+		work_on_cpu(fcpu, free_fn, b);
+		cond_resched();
+	}
+
+	pr_info("slub-bench: %5zu bytes %-10s alloc %4llu ns free %4llu ns\n",
+		b->size, name, div64_u64(b->alloc_ns, objs),
+		div64_u64(b->free_ns, objs));
+	return 0;
+}
+
+static int slub_bench(void)
+{
+	struct bench b;
+	int cpu, other;
+	int ret = 0;
+
+	if (!nr_objs || nr_objs > ULONG_MAX / sizeof(void *) || !loops)
+		return -EINVAL;
+
+	b.objs = vmalloc(nr_objs * sizeof(void *));
+	if (!b.objs)
+		return -ENOMEM;
+
+	get_online_cpus();
+	cpu = cpumask_first(cpu_online_mask);
+	other = cpumask_next(cpu, cpu_online_mask);
+	if (other >= nr_cpu_ids)
+		other = -1;
+
+	for (b.size = 8; b.size <= SLUB_MAX_SIZE; b.size <<= 1) {
+		ret = bench_run(&b, "same-cpu", bench_kmalloc, cpu,
+				bench_kfree, cpu);
+		if (!ret && other >= 0)
+			ret = bench_run(&b, "cross-cpu", bench_kmalloc, cpu,
+					bench_kfree, other);
+		if (!ret)
+			ret = bench_run(&b, "bulk", bench_alloc_bulk, cpu,
+					bench_free_bulk, cpu);
+		if (ret) {
+			pr_err("slub-bench: out of memory\n");
+			break;
+		}
+	}
+	put_online_cpus();
+
+	vfree(b.objs);
+	return ret;
+}
+
+static int slub_bench_run(void *data, u64 val)
+{
+	int ret;
+
+	if (val != 1)
+		return -EINVAL;
+
+	mutex_lock(&bench_mutex);
+	ret = slub_bench();
+	mutex_unlock(&bench_mutex);
+
+	return ret;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(bench_run_fops, NULL, slub_bench_run, "%llu\n");
+
+static void slub_bench_exit(void)
+{
+	debugfs_remove_recursive(bench_dir);
+}
+
+static int __init slub_bench_init(void)
+{
+	struct dentry *dentry;
+
+	bench_dir = debugfs_create_dir("slub-bench", NULL);
+	if (!bench_dir)
+		return -ENOMEM;
+
+	dentry = debugfs_create_u32("nr_objs", 0600, bench_dir, &nr_objs);
+	if (!dentry)
+		goto fail;
+
+	dentry = debugfs_create_u32("loops", 0600, bench_dir, &loops);
+	if (!dentry)
+		goto fail;
+
+	dentry = debugfs_create_file("run", 0200, bench_dir, NULL,
+				     &bench_run_fops);
+	if (!dentry)
+		goto fail;
+
+	return 0;
+fail:
+	slub_bench_exit();
+	return -ENOMEM;
+}
+
+module_init(slub_bench_init);
+module_exit(slub_bench_exit);
+MODULE_LICENSE("GPL");
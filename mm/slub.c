@@ -2615,6 +2615,109 @@ void kmem_cache_free(struct kmem_cache *s, void *x)
 }
 EXPORT_SYMBOL(kmem_cache_free);
 
+/*
+ * Bulk freeing. Objects belonging to the current cpu slab are put on the
+ * lockless freelist with interrupts disabled, so the whole batch costs a
+ * single transaction id update instead of one cmpxchg_double per object.
+ * Other objects go through the regular slow path.
+ */
+void kmem_cache_free_bulk(struct kmem_cache *s, size_t nr, void **p)
+{
+	struct kmem_cache_cpu *c;
+	struct page *page;
+	size_t i;
+
+	local_irq_disable();
+	c = this_cpu_ptr(s->cpu_slab);
+
+	for (i = 0; i < nr; i++) {
+		void **object = p[i];
+
+		page = virt_to_head_page(object);
+		slab_free_hook(s, object);
+
+		if (c->page == page) {
+			set_freepointer(s, object, c->freelist);
+			c->freelist = object;
+			stat(s, FREE_FASTPATH);
+		} else {
+			/* Fail any lockless operation racing with us */
+			c->tid = next_tid(c->tid);
+			local_irq_enable();
+			__slab_free(s, page, object, _RET_IP_);
+			local_irq_disable();
+			c = this_cpu_ptr(s->cpu_slab);
+		}
+		trace_kmem_cache_free(_RET_IP_, object);
+	}
+
+	c->tid = next_tid(c->tid);
+	local_irq_enable();
+}
+EXPORT_SYMBOL(kmem_cache_free_bulk);
+
+/*
+ * Bulk allocation, the counterpart of kmem_cache_free_bulk(). Objects are
+ * taken from the lockless freelist with interrupts disabled, the slow path
+ * refills it when it runs out. Either all @nr objects are allocated and
+ * @nr is returned, or nothing is allocated and 0 is returned.
+ */
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t gfpflags, size_t nr,
+			  void **p)
+{
+	struct kmem_cache_cpu *c;
+	size_t i, j;
+	int ret = nr;
+
+	if (slab_pre_alloc_hook(s, gfpflags))
+		return 0;
+
+	local_irq_disable();
+	c = this_cpu_ptr(s->cpu_slab);
+
+	for (i = 0; i < nr; i++) {
+		void *object = c->freelist;
+
+		if (unlikely(!object)) {
+			/* Fail any lockless operation racing with us */
+			c->tid = next_tid(c->tid);
+			local_irq_enable();
+
+			p[i] = __slab_alloc(s, gfpflags, NUMA_NO_NODE,
+					    _RET_IP_, c);
+			if (unlikely(!p[i])) {
+				ret = 0;
+				goto out;
+			}
+
+			local_irq_disable();
+			c = this_cpu_ptr(s->cpu_slab);
+			continue;
+		}
+
+		c->freelist = get_freepointer(s, object);
+		p[i] = object;
+		stat(s, ALLOC_FASTPATH);
+	}
+
+	c->tid = next_tid(c->tid);
+	local_irq_enable();
+out:
+	for (j = 0; j < i; j++) {
+		if (unlikely(gfpflags & __GFP_ZERO) && ret)
+			memset(p[j], 0, s->objsize);
+		slab_post_alloc_hook(s, gfpflags, p[j]);
+		trace_kmem_cache_alloc(_RET_IP_, p[j], s->objsize, s->size,
+				       gfpflags);
+	}
+
+	if (unlikely(!ret))
+		kmem_cache_free_bulk(s, i, p);
+
+	return ret;
+}
+EXPORT_SYMBOL(kmem_cache_alloc_bulk);
+
 /*
  * Object placement in a slab is made very easy because we always start at
  * offset 0. If we tune the size of the object to the alignment then we can
@@ -183,6 +183,43 @@ int invalidate_inode_page(struct page *page)
 	return invalidate_complete_page(mapping, page);
 }
 
+/*
+ * Remove the shadow entries that reclaim left in place of evicted pages
+ * between @start and @end, see mm/workingset.c.
+ */
+static void truncate_shadow_entries(struct address_space *mapping,
+				    pgoff_t start, pgoff_t end)
+{
+	void **slots[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
+	pgoff_t index = start;
+	unsigned int i, nr;
+
+	while (index <= end && mapping->nrshadows) {
+		spin_lock_irq(&mapping->tree_lock);
+		nr = radix_tree_gang_lookup_slot(&mapping->page_tree, slots,
+						 indices, index, PAGEVEC_SIZE);
+		for (i = 0; i < nr && indices[i] <= end; i++) {
+			void *entry;
+
+			entry = radix_tree_deref_slot_protected(slots[i],
+							&mapping->tree_lock);
+			if (!radix_tree_exceptional_entry(entry))
+				continue;
+			radix_tree_delete(&mapping->page_tree, indices[i]);
+			mapping->nrshadows--;
+		}
+		spin_unlock_irq(&mapping->tree_lock);
+
+		if (i < PAGEVEC_SIZE)
+			break;
+		index = indices[i - 1] + 1;
+		if (!index)
+			break;
+		cond_resched();
+	}
+}
+
 /**
  * truncate_inode_pages_range - truncate range of pages specified by start & end byte offsets
  * @mapping: mapping to truncate
@@ -214,7 +251,7 @@ void truncate_inode_pages_range(struct address_space *mapping,
 	int i;
 
 	cleancache_invalidate_inode(mapping);
-	if (mapping->nrpages == 0)
+	if (mapping->nrpages == 0 && mapping->nrshadows == 0)
 		return;
 
 	BUG_ON((lend & (PAGE_CACHE_SIZE - 1)) != (PAGE_CACHE_SIZE - 1));
@@ -292,6 +329,7 @@ void truncate_inode_pages_range(struct address_space *mapping,
 		mem_cgroup_uncharge_end();
 		index++;
 	}
+	truncate_shadow_entries(mapping, start, end);
 	cleancache_invalidate_inode(mapping);
 }
 EXPORT_SYMBOL(truncate_inode_pages_range);
@@ -400,7 +438,7 @@ invalidate_complete_page2(struct address_space *mapping, struct page *page)
 
 	clear_page_mlock(page);
 	BUG_ON(page_has_private(page));
-	__delete_from_page_cache(page);
+	__delete_from_page_cache(page, NULL);
 	spin_unlock_irq(&mapping->tree_lock);
 	mem_cgroup_uncharge_cache_page(page);
 
@@ -0,0 +1,251 @@
+/*
+ * mm/vmalloc-bench.c
+ *
+ * Stress the vmap area allocator from all online cpus at once. For a
+ * range of sizes, one thread per cpu repeatedly maps and unmaps
+ * kernel virtual memory, with vmalloc()/vfree() and with vmap()/vunmap()
+ * of pages allocated up front, which leaves out the page allocator. The
+ * average and worst case latency of every call is printed, in
+ * nanoseconds, for the slowest cpu. Writing 1 to <debugfs>/vmalloc-bench/run
+ * runs the benchmark with the loops and max_pages set in the same
+ * directory.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/mutex.h>
+#include <linux/mm.h>
+#include <linux/gfp.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/math64.h>
+
+static struct dentry *bench_dir;
+static DEFINE_MUTEX(bench_mutex);
+
+/* mappings per cpu and size */
+static u32 loops = 10000;
+
+/* largest mapping, in pages */
+static u32 max_pages = 256;
+
+struct bench_thread {
+	unsigned int nr_pages;
+	bool use_vmap;
+	struct page **pages;
+	u64 map_ns;
+	u64 unmap_ns;
+	u64 max_ns;
+	int ret;
+};
+
+static DECLARE_COMPLETION(bench_go);
+static DECLARE_COMPLETION(bench_done);
+static atomic_t bench_running;
+
+static void *bench_map(struct bench_thread *bt)
+{
+	if (bt->use_vmap)
+		return vmap(bt->pages, bt->nr_pages, VM_MAP, PAGE_KERNEL);
+	return vmalloc(bt->nr_pages << PAGE_SHIFT);
+}
+
+static void bench_unmap(struct bench_thread *bt, void *addr)
+{
+	if (bt->use_vmap)
+		vunmap(addr);
+	else
+		vfree(addr);
+}
+
+static int bench_thread_fn(void *arg)
+{
+	struct bench_thread *bt = arg;
+	unsigned int i;
+	u64 t0, t1, t2;
+	void *addr;
+
+	wait_for_completion(&bench_go);
+
+	for (i = 0; i < loops; i++) {
+		t0 = local_clock();
+		addr = bench_map(bt);
+		t1 = local_clock();
+		if (!addr) {
+			bt->ret = -ENOMEM;
+			break;
+		}
+		bench_unmap(bt, addr);
+		t2 = local_clock();
+
+		bt->map_ns += t1 - t0;
+		bt->unmap_ns += t2 - t1;
+		bt->max_ns = max(bt->max_ns, t1 - t0);
+		cond_resched();
+	}
+
+	if (atomic_dec_and_test(&bench_running))
+		complete(&bench_done);
+	return 0;
+}
+
+static int bench_run(struct bench_thread *threads, unsigned int nr_pages,
+		     bool use_vmap)
+{
+	struct bench_thread *slowest = NULL;
+	int cpu, ret = 0;
+
+	INIT_COMPLETION(bench_go);
+	INIT_COMPLETION(bench_done);
+	atomic_set(&bench_running, 1);
+
+	for_each_online_cpu(cpu) {
+		struct bench_thread *bt = &threads[cpu];
+		struct task_struct *task;
+
+		bt->nr_pages = nr_pages;
+		bt->use_vmap = use_vmap;
+		bt->map_ns = bt->unmap_ns = bt->max_ns = 0;
+		bt->ret = 0;
+
+		task = kthread_create(bench_thread_fn, bt, "vmalloc-bench/%d",
+				      cpu);
+		if (IS_ERR(task)) {
+			ret = PTR_ERR(task);
+			break;
+		}
+		kthread_bind(task, cpu);
+		atomic_inc(&bench_running);
+		wake_up_process(task);
+	}
+
+	/* start all threads together, then drop the initial reference */
+	complete_all(&bench_go);
+	if (!atomic_dec_and_test(&bench_running))
+		wait_for_completion(&bench_done);
+	if (ret)
+		return ret;
+
+	for_each_online_cpu(cpu) {
+		struct bench_thread *bt = &threads[cpu];
+
+		if (bt->ret)
+			return bt->ret;
+		if (!slowest || bt->map_ns > slowest->map_ns)
+			slowest = bt;
+	}
+
+	pr_info("vmalloc-bench: %4u pages %-7s map %6llu ns (max %7llu) unmap %6llu ns, %u cpus\n",
+		nr_pages, use_vmap ? "vmap" : "vmalloc",
+		div_u64(slowest->map_ns, loops), slowest->max_ns,
+		div_u64(slowest->unmap_ns, loops), num_online_cpus());
+	return 0;
+}
+
+static int vmalloc_bench(void)
+{
+	struct bench_thread *threads;
+	unsigned int nr_pages, i;
+	struct page **pages;
+	int cpu, ret = -ENOMEM;
+
+	if (!loops || !max_pages || max_pages > INT_MAX)
+		return -EINVAL;
+
+	threads = kcalloc(nr_cpu_ids, sizeof(*threads), GFP_KERNEL);
+	pages = kcalloc(max_pages, sizeof(*pages), GFP_KERNEL);
+	if (!threads || !pages)
+		goto out;
+
+	/* vmap() does not care about aliases, every slot maps one page */
+	pages[0] = alloc_page(GFP_KERNEL);
+	if (!pages[0])
+		goto out;
+	for (i = 1; i < max_pages; i++)
+		pages[i] = pages[0];
+
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		threads[cpu].pages = pages;
+
+	for (nr_pages = 1; nr_pages <= max_pages; nr_pages <<= 1) {
+		ret = bench_run(threads, nr_pages, false);
+		if (!ret)
+			ret = bench_run(threads, nr_pages, true);
+		if (ret) {
+			pr_err("vmalloc-bench: %u pages failed: %d\n",
+			       nr_pages, ret);
+			break;
+		}
+	}
+	put_online_cpus();
+
+	__free_page(pages[0]);
+out:
+	kfree(pages);
+	kfree(threads);
+	return ret;
+}
+
+static int vmalloc_bench_run(void *data, u64 val)
+{
+	int ret;
+
+	if (val != 1)
+		return -EINVAL;
+
+	mutex_lock(&bench_mutex);
+	ret = vmalloc_bench();
+	mutex_unlock(&bench_mutex);
+
+	return ret;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(bench_run_fops, NULL, vmalloc_bench_run, "%llu\n");
+
+static void vmalloc_bench_exit(void)
+{
+	debugfs_remove_recursive(bench_dir);
+}
+
+static int __init vmalloc_bench_init(void)
+{
+	struct dentry *dentry;
+
+	bench_dir = debugfs_create_dir("vmalloc-bench", NULL);
+	if (!bench_dir)
+		return -ENOMEM;
+
+	dentry = debugfs_create_u32("loops", 0600, bench_dir, &loops);
+	if (!dentry)
+		goto fail;
+
+	dentry = debugfs_create_u32("max_pages", 0600, bench_dir, &max_pages);
+	if (!dentry)
+		goto fail;
+
+	dentry = debugfs_create_file("run", 0200, bench_dir, NULL,
+				     &bench_run_fops);
+	if (!dentry)
+		goto fail;
+
+	return 0;
+fail:
+	vmalloc_bench_exit();
+	return -ENOMEM;
+}
+
+module_init(vmalloc_bench_init);
+module_exit(vmalloc_bench_exit);
+MODULE_LICENSE("GPL");
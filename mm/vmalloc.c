@@ -302,6 +302,23 @@ static unsigned long cached_align;
 
 static unsigned long vmap_area_pcpu_hole;
 
+/*
+ * Free areas of common sizes are kept aside after their lazy purge, still
+ * in the tree, so that the next allocation of the same size can take one
+ * without walking the tree under vmap_area_lock. Class n holds areas of
+ * 2^n up to 2^(n+1) - 1 pages; an area is only handed out for an exact
+ * size match. The areas are unmapped and flushed from the TLB already.
+ * They are given back to the tree when an allocation runs out of space.
+ */
+#define VMAP_SIZE_CLASSES	11	/* up to 8MB with 4K pages */
+#define VMAP_SIZE_CACHE_DEPTH	8
+#define VMAP_SIZE_CACHE_PAGES	(8UL * 1024 * 1024 / PAGE_SIZE)
+
+static DEFINE_SPINLOCK(vmap_size_cache_lock);
+static struct vmap_area *vmap_size_cache[VMAP_SIZE_CLASSES][VMAP_SIZE_CACHE_DEPTH];
+static unsigned int vmap_size_cache_nr[VMAP_SIZE_CLASSES];
+static unsigned long vmap_size_cache_pages;
+
 static struct vmap_area *__find_vmap_area(unsigned long addr)
 {
 	struct rb_node *n = vmap_area_root.rb_node;
@@ -355,6 +372,86 @@ static void __insert_vmap_area(struct vmap_area *va)
 
 static void purge_vmap_area_lazy(void);
 
+static struct vmap_area *vmap_size_cache_get(unsigned long size,
+				unsigned long align,
+				unsigned long vstart, unsigned long vend)
+{
+	unsigned long nr_pages = size >> PAGE_SHIFT;
+	struct vmap_area *va = NULL;
+	int class = ilog2(nr_pages);
+	int i;
+
+	/* unlocked peek, a miss only costs the regular path */
+	if (class >= VMAP_SIZE_CLASSES || !vmap_size_cache_nr[class])
+		return NULL;
+
+	spin_lock(&vmap_size_cache_lock);
+	for (i = vmap_size_cache_nr[class] - 1; i >= 0; i--) {
+		struct vmap_area *tmp = vmap_size_cache[class][i];
+
+		if (tmp->va_end - tmp->va_start != size ||
+		    tmp->va_start & (align - 1) ||
+		    tmp->va_start < vstart || tmp->va_end > vend)
+			continue;
+
+		va = tmp;
+		vmap_size_cache[class][i] =
+			vmap_size_cache[class][--vmap_size_cache_nr[class]];
+		vmap_size_cache_pages -= nr_pages;
+		break;
+	}
+	spin_unlock(&vmap_size_cache_lock);
+
+	return va;
+}
+
+/*
+ * Keep a purged area for reuse. Returns false if it has to be freed.
+ */
+static bool vmap_size_cache_put(struct vmap_area *va)
+{
+	unsigned long nr_pages = (va->va_end - va->va_start) >> PAGE_SHIFT;
+	int class = ilog2(nr_pages);
+	bool ret = false;
+
+	if (class >= VMAP_SIZE_CLASSES)
+		return false;
+
+	spin_lock(&vmap_size_cache_lock);
+	if (vmap_size_cache_nr[class] < VMAP_SIZE_CACHE_DEPTH &&
+	    vmap_size_cache_pages + nr_pages <= VMAP_SIZE_CACHE_PAGES) {
+		vmap_size_cache[class][vmap_size_cache_nr[class]++] = va;
+		vmap_size_cache_pages += nr_pages;
+		ret = true;
+	}
+	spin_unlock(&vmap_size_cache_lock);
+
+	return ret;
+}
+
+static void __free_vmap_area(struct vmap_area *va);
+
+/*
+ * Give all cached areas back to the tree
+ */
+static void vmap_size_cache_drain(void)
+{
+	int class;
+
+	spin_lock(&vmap_area_lock);
+	spin_lock(&vmap_size_cache_lock);
+	for (class = 0; class < VMAP_SIZE_CLASSES; class++) {
+		while (vmap_size_cache_nr[class]) {
+			unsigned int i = --vmap_size_cache_nr[class];
+
+			__free_vmap_area(vmap_size_cache[class][i]);
+		}
+	}
+	vmap_size_cache_pages = 0;
+	spin_unlock(&vmap_size_cache_lock);
+	spin_unlock(&vmap_area_lock);
+}
+
 /*
  * Allocate a region of KVA of the specified size and alignment, within the
  * vstart and vend.
@@ -374,6 +471,16 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 	BUG_ON(size & ~PAGE_MASK);
 	BUG_ON(!is_power_of_2(align));
 
+	va = vmap_size_cache_get(size, align, vstart, vend);
+	if (va) {
+		/* lookups and purges read these under vmap_area_lock */
+		spin_lock(&vmap_area_lock);
+		va->flags = 0;
+		va->vm = NULL;
+		spin_unlock(&vmap_area_lock);
+		return va;
+	}
+
 	va = kmalloc_node(sizeof(struct vmap_area),
 			gfp_mask & GFP_RECLAIM_MASK, node);
 	if (unlikely(!va))
@@ -470,7 +577,9 @@ found:
 overflow:
 	spin_unlock(&vmap_area_lock);
 	if (!purged) {
+		/* the purge refills the cache, drain it after */
 		purge_vmap_area_lazy();
+		vmap_size_cache_drain();
 		purged = 1;
 		goto retry;
 	}
@@ -556,6 +665,13 @@ static void vmap_debug_free_range(unsigned long start, unsigned long end)
 #endif
 }
 
+/*
+ * Overrides lazy_max_pages() when set, in kilobytes. A lower threshold
+ * purges, and refills the size class cache, more often at the price of
+ * more TLB flushes.
+ */
+int sysctl_vmap_lazy_max_kb __read_mostly;
+
 /*
  * lazy_max_pages is the maximum amount of virtual address space we gather up
  * before attempting to purge with a TLB flush.
@@ -576,6 +692,9 @@ static unsigned long lazy_max_pages(void)
 {
 	unsigned int log;
 
+	if (sysctl_vmap_lazy_max_kb)
+		return sysctl_vmap_lazy_max_kb >> (PAGE_SHIFT - 10);
+
 	log = fls(num_online_cpus());
 
 	return log * (32UL * 1024 * 1024 / PAGE_SIZE);
@@ -651,8 +770,10 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 
 	if (nr) {
 		spin_lock(&vmap_area_lock);
-		list_for_each_entry_safe(va, n_va, &valist, purge_list)
-			__free_vmap_area(va);
+		list_for_each_entry_safe(va, n_va, &valist, purge_list) {
+			if (!vmap_size_cache_put(va))
+				__free_vmap_area(va);
+		}
 		spin_unlock(&vmap_area_lock);
 	}
 	spin_unlock(&purge_lock);
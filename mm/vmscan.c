@@ -139,6 +139,19 @@ struct mem_cgroup_zone {
 int vm_swappiness = 60;
 long vm_total_pages;	/* The total number of pages which the VM controls */
 
+/*
+ * How far direct reclaim may raise the low and high watermarks of a zone,
+ * in fractions of 10,000 of its high watermark. 0 disables boosting.
+ */
+int watermark_boost_factor __read_mostly;
+
+/*
+ * kswapd isolates this many pages per lru_lock round trip instead of
+ * SWAP_CLUSTER_MAX. Nobody is waiting on it, so the longer hold of the
+ * lock is paid back by fewer acquisitions while it catches up.
+ */
+#define KSWAPD_ISOLATE_BATCH	(4 * SWAP_CLUSTER_MAX)
+
 static LIST_HEAD(shrinker_list);
 static DECLARE_RWSEM(shrinker_rwsem);
 
@@ -491,9 +504,11 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
 
 /*
  * Same as remove_mapping, but if the page is removed from the mapping, it
- * gets returned with a refcount of 0.
+ * gets returned with a refcount of 0. @reclaimed tells whether the page is
+ * being evicted by reclaim, in which case a shadow entry is left behind.
  */
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -539,10 +554,17 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 		swapcache_free(swap, page);
 	} else {
 		void (*freepage)(struct page *);
+		void *shadow = NULL;
 
 		freepage = mapping->a_ops->freepage;
 
-		__delete_from_page_cache(page);
+		/*
+		 * Remember when the page was evicted so that a refault can
+		 * be detected, see mm/workingset.c.
+		 */
+		if (reclaimed && page_is_file_cache(page))
+			shadow = workingset_eviction(mapping, page);
+		__delete_from_page_cache(page, shadow);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
 
@@ -565,7 +587,7 @@ cannot_free:
  */
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		/*
 		 * Unfreezing the refcount with 1 rather than 2 effectively
 		 * drops the pagecache ref for us without requiring another
@@ -914,7 +936,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
 
 		/*
@@ -1854,8 +1876,11 @@ static void shrink_mem_cgroup_zone(struct mem_cgroup_zone *mz,
 	enum lru_list lru;
 	unsigned long nr_reclaimed, nr_scanned;
 	unsigned long nr_to_reclaim = sc->nr_to_reclaim;
+	unsigned long batch;
 	struct blk_plug plug;
 
+	batch = current_is_kswapd() ? KSWAPD_ISOLATE_BATCH : SWAP_CLUSTER_MAX;
+
 restart:
 	nr_reclaimed = 0;
 	nr_scanned = sc->nr_scanned;
@@ -1866,8 +1891,7 @@ restart:
 					nr[LRU_INACTIVE_FILE]) {
 		for_each_evictable_lru(lru) {
 			if (nr[lru]) {
-				nr_to_scan = min_t(unsigned long,
-						   nr[lru], SWAP_CLUSTER_MAX);
+				nr_to_scan = min(nr[lru], batch);
 				nr[lru] -= nr_to_scan;
 
 				nr_reclaimed += shrink_list(lru, nr_to_scan,
@@ -2194,10 +2218,55 @@ out:
 	return 0;
 }
 
+/*
+ * Direct reclaim stalls the allocating task, which is as likely as not
+ * the one drawing the UI. When it happens, raise the low and high
+ * watermarks of the zones the allocation may use and kick kswapd: it
+ * then reclaims further ahead, and the allocations that follow find free
+ * pages instead of reclaiming, and swapping, themselves. Each stall adds
+ * the distance between the min and high watermarks, up to
+ * watermark_boost_factor. kswapd drops the boost once it is done with
+ * the node. Updates race with other direct reclaimers and kswapd; a lost
+ * update only makes the boost smaller.
+ */
+static void boost_watermarks(struct zonelist *zonelist, int order,
+			     gfp_t gfp_mask, nodemask_t *nodemask)
+{
+	enum zone_type high_zoneidx = gfp_zone(gfp_mask);
+	int factor = ACCESS_ONCE(watermark_boost_factor);
+	struct zoneref *z;
+	struct zone *zone;
+
+	if (!factor)
+		return;
+
+	for_each_zone_zonelist_nodemask(zone, z, zonelist, high_zoneidx,
+					nodemask) {
+		unsigned long high = zone->watermark[WMARK_HIGH];
+		unsigned long boost;
+
+		if (!populated_zone(zone))
+			continue;
+
+		boost = zone->watermark_boost + high - zone->watermark[WMARK_MIN];
+		zone->watermark_boost = min(boost, mult_frac(high, factor, 10000));
+		wakeup_kswapd(zone, order, high_zoneidx);
+	}
+}
+
+static void kswapd_clear_boost(pg_data_t *pgdat)
+{
+	int i;
+
+	for (i = 0; i < pgdat->nr_zones; i++)
+		pgdat->node_zones[i].watermark_boost = 0;
+}
+
 unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 				gfp_t gfp_mask, nodemask_t *nodemask)
 {
 	unsigned long nr_reclaimed;
+	u64 start;
 	struct scan_control sc = {
 		.gfp_mask = gfp_mask,
 		.may_writepage = !laptop_mode,
@@ -2221,9 +2290,14 @@ unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 				sc.may_writepage,
 				gfp_mask);
 
+	boost_watermarks(zonelist, order, gfp_mask, nodemask);
+
+	start = local_clock();
 	nr_reclaimed = do_try_to_free_pages(zonelist, &sc, &shrink);
 
 	trace_mm_vmscan_direct_reclaim_end(nr_reclaimed);
+	trace_mm_vmscan_direct_reclaim_stall(order, nr_reclaimed,
+					     local_clock() - start);
 
 	return nr_reclaimed;
 }
@@ -2698,8 +2772,11 @@ out:
 		 * back to sleep. High-order users can still perform direct
 		 * reclaim if they wish.
 		 */
-		if (sc.nr_reclaimed < SWAP_CLUSTER_MAX)
+		if (sc.nr_reclaimed < SWAP_CLUSTER_MAX) {
 			order = sc.order = 0;
+			/* Don't keep scanning for a boost that can't be met */
+			kswapd_clear_boost(pgdat);
+		}
 
 		goto loop_again;
 	}
@@ -2731,9 +2808,11 @@ out:
 		}
 
 		if (zones_need_compaction)
-			compact_pgdat(pgdat, order);
+			wakeup_kcompactd(pgdat, order, *classzone_idx);
 	}
 
+	kswapd_clear_boost(pgdat);
+
 	/*
 	 * Return the order we were reclaiming at so sleeping_prematurely()
 	 * makes a decision on the order we were last reclaiming at. However,
@@ -0,0 +1,122 @@
+/*
+ * mm/workingset.c - workingset detection for the page cache
+ *
+ * The file LRU lists are balanced by scan ratios alone. A workload whose
+ * working set is a little bigger than the inactive list, such as switching
+ * back and forth between a few applications, therefore keeps evicting
+ * pages from the inactive list that it needs again shortly after, without
+ * these pages ever getting the second access that would promote them to
+ * the active list.
+ *
+ * To tell these refaults apart, every zone counts the evictions and
+ * activations on its file LRU in inactive_age. When a page cache page is
+ * reclaimed, the current value is stored in the page cache radix tree
+ * slot of the page, as an exceptional "shadow" entry. When the page is
+ * read back in, the difference between the current inactive_age and the
+ * stored one, the refault distance, is the number of pages that left the
+ * inactive list while the page was out of memory. Had the inactive list
+ * been that much bigger, the page would have been accessed a second time
+ * while still cached. That space can only come from the active list: if
+ * the refault distance is smaller than the active file list, the page
+ * competes with the active pages and is put straight on the active list.
+ *
+ * Shadow entries are removed when a page takes the slot again, or when
+ * the mapping is truncated or its inode evicted.
+ */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/fs.h>
+#include <linux/radix-tree.h>
+
+/*
+ * The zone of the evicted page is packed next to the eviction counter,
+ * in the bits left by the exceptional entry marker.
+ */
+#define EVICTION_SHIFT	(RADIX_TREE_EXCEPTIONAL_SHIFT + \
+			 NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK	(~0UL >> EVICTION_SHIFT)
+
+static void *pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	eviction = (eviction << RADIX_TREE_EXCEPTIONAL_SHIFT);
+
+	return (void *)(eviction | RADIX_TREE_EXCEPTIONAL_ENTRY);
+}
+
+static void unpack_shadow(void *shadow, struct zone **zone,
+			  unsigned long *distance)
+{
+	unsigned long entry = (unsigned long)shadow;
+	unsigned long eviction;
+	unsigned long refault;
+	int zid, nid;
+
+	entry >>= RADIX_TREE_EXCEPTIONAL_SHIFT;
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+	eviction = entry;
+
+	*zone = NODE_DATA(nid)->node_zones + zid;
+
+	/*
+	 * The counter wraps around within the bits available, so is the
+	 * distance to the current value.
+	 */
+	refault = atomic_long_read(&(*zone)->inactive_age);
+	*distance = (refault - eviction) & EVICTION_MASK;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Returns a shadow entry to be stored in @mapping->page_tree in place
+ * of the evicted @page so that a later refault can be detected.
+ */
+void *workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long eviction;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	return pack_shadow(eviction, zone);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @shadow: shadow entry of the evicted page
+ *
+ * Calculates the refault distance of the page and counts the refault.
+ *
+ * Returns %true if the page should be activated, %false otherwise.
+ */
+bool workingset_refault(void *shadow)
+{
+	unsigned long refault_distance;
+	struct zone *zone;
+
+	unpack_shadow(shadow, &zone, &refault_distance);
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+
+	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
@@ -33,6 +33,7 @@
 #include <linux/rbtree.h>
 #include <linux/swap.h>
 #include <linux/crypto.h>
+#include <crypto/compress.h>
 #include <linux/mempool.h>
 #include <linux/zsmalloc.h>
 
@@ -106,34 +107,7 @@ module_param_named(max_compression_ratio,
 * compression functions
 **********************************/
 /* per-cpu compression transforms */
-static struct crypto_comp * __percpu *zswap_comp_pcpu_tfms;
-
-enum comp_op {
-	ZSWAP_COMPOP_COMPRESS,
-	ZSWAP_COMPOP_DECOMPRESS
-};
-
-static int zswap_comp_op(enum comp_op op, const u8 *src, unsigned int slen,
-				u8 *dst, unsigned int *dlen)
-{
-	struct crypto_comp *tfm;
-	int ret;
-
-	tfm = *per_cpu_ptr(zswap_comp_pcpu_tfms, get_cpu());
-	switch (op) {
-	case ZSWAP_COMPOP_COMPRESS:
-		ret = crypto_comp_compress(tfm, src, slen, dst, dlen);
-		break;
-	case ZSWAP_COMPOP_DECOMPRESS:
-		ret = crypto_comp_decompress(tfm, src, slen, dst, dlen);
-		break;
-	default:
-		ret = -EINVAL;
-	}
-
-	put_cpu();
-	return ret;
-}
+static struct crypto_comp_pool *zswap_comp_pool;
 
 static int __init zswap_comp_init(void)
 {
@@ -148,17 +122,18 @@ static int __init zswap_comp_init(void)
 	pr_info("using %s compressor\n", zswap_compressor);
 
 	/* alloc percpu transforms */
-	zswap_comp_pcpu_tfms = alloc_percpu(struct crypto_comp *);
-	if (!zswap_comp_pcpu_tfms)
-		return -ENOMEM;
+	zswap_comp_pool = crypto_alloc_comp_pool(zswap_compressor, 0, 0, 0);
+	if (IS_ERR(zswap_comp_pool)) {
+		pr_err("can't allocate compressor transforms\n");
+		return PTR_ERR(zswap_comp_pool);
+	}
 	return 0;
 }
 
 static void zswap_comp_exit(void)
 {
 	/* free percpu transforms */
-	if (zswap_comp_pcpu_tfms)
-		free_percpu(zswap_comp_pcpu_tfms);
+	crypto_free_comp_pool(zswap_comp_pool);
 }
 
 /*********************************
@@ -311,33 +286,19 @@ static DEFINE_PER_CPU(u8 *, zswap_dstmem);
 
 static int __zswap_cpu_notifier(unsigned long action, unsigned long cpu)
 {
-	struct crypto_comp *tfm;
 	u8 *dst;
 
 	switch (action) {
 	case CPU_UP_PREPARE:
-		tfm = crypto_alloc_comp(zswap_compressor, 0, 0);
-		if (IS_ERR(tfm)) {
-			pr_err("can't allocate compressor transform\n");
-			return NOTIFY_BAD;
-		}
-		*per_cpu_ptr(zswap_comp_pcpu_tfms, cpu) = tfm;
 		dst = (u8 *)__get_free_pages(GFP_KERNEL, 1);
 		if (!dst) {
 			pr_err("can't allocate compressor buffer\n");
-			crypto_free_comp(tfm);
-			*per_cpu_ptr(zswap_comp_pcpu_tfms, cpu) = NULL;
 			return NOTIFY_BAD;
 		}
 		per_cpu(zswap_dstmem, cpu) = dst;
 		break;
 	case CPU_DEAD:
 	case CPU_UP_CANCELED:
-		tfm = *per_cpu_ptr(zswap_comp_pcpu_tfms, cpu);
-		if (tfm) {
-			crypto_free_comp(tfm);
-			*per_cpu_ptr(zswap_comp_pcpu_tfms, cpu) = NULL;
-		}
 		dst = per_cpu(zswap_dstmem, cpu);
 		if (dst) {
 			free_pages((unsigned long)dst, 1);
@@ -598,8 +559,8 @@ static int zswap_writeback_entry(struct zswap_tree *tree, struct zswap_entry *en
 		dlen = PAGE_SIZE;
 		src = zs_map_object(tree->pool, entry->handle, ZS_MM_RO);
 		dst = kmap_atomic(page);
-		ret = zswap_comp_op(ZSWAP_COMPOP_DECOMPRESS, src, entry->length,
-				dst, &dlen);
+		ret = crypto_comp_pool_decompress(zswap_comp_pool, src,
+						  entry->length, dst, &dlen);
 		kunmap_atomic(dst);
 		zs_unmap_object(tree->pool, entry->handle);
 		BUG_ON(ret);
@@ -795,7 +756,8 @@ static int zswap_frontswap_store(unsigned type, pgoff_t offset,
 	/* compress */
 	dst = get_cpu_var(zswap_dstmem);
 	src = kmap_atomic(page);
-	ret = zswap_comp_op(ZSWAP_COMPOP_COMPRESS, src, PAGE_SIZE, dst, &dlen);
+	ret = crypto_comp_pool_compress(zswap_comp_pool, src, PAGE_SIZE, dst,
+					&dlen);
 	kunmap_atomic(src);
 	if (ret) {
 		ret = -EINVAL;
@@ -931,8 +893,8 @@ static int zswap_frontswap_load(unsigned type, pgoff_t offset,
 	dlen = PAGE_SIZE;
 	src = zs_map_object(tree->pool, entry->handle, ZS_MM_RO);
 	dst = kmap_atomic(page);
-	zswap_comp_op(ZSWAP_COMPOP_DECOMPRESS, src, entry->length,
-		dst, &dlen);
+	crypto_comp_pool_decompress(zswap_comp_pool, src, entry->length,
+				    dst, &dlen);
 	kunmap_atomic(dst);
 	zs_unmap_object(tree->pool, entry->handle);
 
@@ -0,0 +1,487 @@
+/*
+ * afalg_bench: compare AF_ALG skcipher throughput with in-process AES
+ *
+ * Encrypts a buffer with cbc(aes) repeatedly, through
+ *
+ *   local	a plain C table-driven AES, the same algorithm as aes-generic
+ *   copy	sendmsg() and recvmsg() on an AF_ALG socket
+ *   splice	vmsplice() into a pipe, splice() to the socket and back out
+ *		into a second pipe, which is drained with splice() to
+ *		/dev/null, so the data is never copied through user space
+ *   aio	sendmsg() followed by several recvmsg() requests submitted
+ *		with io_submit(), which the kernel runs concurrently
+ *
+ * and prints MB/s for each. The kernel algorithm can be chosen with -a,
+ * e.g. -a "cbc(aes-generic)" to compare like for like.
+ *
+ * Copyright (C) 2012
+ *
+ * Licensed under the terms of the GNU GPL License version 2.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/aio_abi.h>
+#include <linux/if_alg.h>
+
+#ifndef AF_ALG
+#define AF_ALG		38
+#endif
+#ifndef SOL_ALG
+#define SOL_ALG		279
+#endif
+
+#define AES_BLOCK_SIZE	16
+
+static const char *alg_name = "cbc(aes)";
+static size_t buf_size = 65536;
+static double seconds = 3;
+static int aio_depth = 8;
+
+static unsigned char key[16] = "0123456789abcdef";
+static unsigned char iv[AES_BLOCK_SIZE];
+
+/* in-process AES-128 */
+
+static uint8_t sbox[256];
+static uint32_t ft[4][256];
+
+struct aes_ctx {
+	uint32_t rk[44];
+};
+
+static uint8_t xtime(uint8_t x)
+{
+	return (x << 1) ^ ((x & 0x80) ? 0x1b : 0);
+}
+
+static void aes_gen_tables(void)
+{
+	uint8_t p = 1, q = 1, s;
+	uint32_t t;
+	int i;
+
+	/* walk the multiplicative group with generator 3 */
+	do {
+		p ^= xtime(p);
+		q ^= q << 1;
+		q ^= q << 2;
+		q ^= q << 4;
+		if (q & 0x80)
+			q ^= 0x09;
+		s = q ^ (q << 1 | q >> 7) ^ (q << 2 | q >> 6) ^
+		    (q << 3 | q >> 5) ^ (q << 4 | q >> 4);
+		sbox[p] = s ^ 0x63;
+	} while (p != 1);
+	sbox[0] = 0x63;
+
+	for (i = 0; i < 256; i++) {
+		s = sbox[i];
+		t = xtime(s) | s << 8 | s << 16 | (uint32_t)(xtime(s) ^ s) << 24;
+		ft[0][i] = t;
+		ft[1][i] = t << 8 | t >> 24;
+		ft[2][i] = t << 16 | t >> 16;
+		ft[3][i] = t << 24 | t >> 8;
+	}
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static uint32_t sub_word(uint32_t w)
+{
+	return sbox[w & 0xff] | sbox[w >> 8 & 0xff] << 8 |
+	       sbox[w >> 16 & 0xff] << 16 | (uint32_t)sbox[w >> 24] << 24;
+}
+
+static void aes_set_key(struct aes_ctx *ctx, const uint8_t *in_key)
+{
+	uint8_t rcon = 1;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		ctx->rk[i] = get_le32(in_key + 4 * i);
+	for (i = 4; i < 44; i++) {
+		uint32_t t = ctx->rk[i - 1];
+
+		if (!(i % 4)) {
+			t = sub_word(t >> 8 | t << 24) ^ rcon;
+			rcon = xtime(rcon);
+		}
+		ctx->rk[i] = ctx->rk[i - 4] ^ t;
+	}
+}
+
+#define ROUND(o, i, k)							\
+	o##0 = ft[0][i##0 & 0xff] ^ ft[1][i##1 >> 8 & 0xff] ^		\
+	       ft[2][i##2 >> 16 & 0xff] ^ ft[3][i##3 >> 24] ^ (k)[0];	\
+	o##1 = ft[0][i##1 & 0xff] ^ ft[1][i##2 >> 8 & 0xff] ^		\
+	       ft[2][i##3 >> 16 & 0xff] ^ ft[3][i##0 >> 24] ^ (k)[1];	\
+	o##2 = ft[0][i##2 & 0xff] ^ ft[1][i##3 >> 8 & 0xff] ^		\
+	       ft[2][i##0 >> 16 & 0xff] ^ ft[3][i##1 >> 24] ^ (k)[2];	\
+	o##3 = ft[0][i##3 & 0xff] ^ ft[1][i##0 >> 8 & 0xff] ^		\
+	       ft[2][i##1 >> 16 & 0xff] ^ ft[3][i##2 >> 24] ^ (k)[3]
+
+#define LAST(o, i0, i1, i2, i3, k)					\
+	(o) = (sbox[(i0) & 0xff] | sbox[(i1) >> 8 & 0xff] << 8 |	\
+	       sbox[(i2) >> 16 & 0xff] << 16 |				\
+	       (uint32_t)sbox[(i3) >> 24] << 24) ^ (k)
+
+static void aes_encrypt(const struct aes_ctx *ctx, uint8_t *out,
+			const uint8_t *in)
+{
+	const uint32_t *rk = ctx->rk;
+	uint32_t a0, a1, a2, a3, b0, b1, b2, b3;
+	int r;
+
+	a0 = get_le32(in) ^ rk[0];
+	a1 = get_le32(in + 4) ^ rk[1];
+	a2 = get_le32(in + 8) ^ rk[2];
+	a3 = get_le32(in + 12) ^ rk[3];
+
+	for (r = 1; r < 9; r += 2) {
+		ROUND(b, a, rk + 4 * r);
+		ROUND(a, b, rk + 4 * r + 4);
+	}
+	ROUND(b, a, rk + 36);
+
+	LAST(a0, b0, b1, b2, b3, rk[40]);
+	LAST(a1, b1, b2, b3, b0, rk[41]);
+	LAST(a2, b2, b3, b0, b1, rk[42]);
+	LAST(a3, b3, b0, b1, b2, rk[43]);
+
+	put_le32(out, a0);
+	put_le32(out + 4, a1);
+	put_le32(out + 8, a2);
+	put_le32(out + 12, a3);
+}
+
+static void aes_cbc_encrypt(const struct aes_ctx *ctx, uint8_t *dst,
+			    const uint8_t *src, size_t len, const uint8_t *civ)
+{
+	uint8_t blk[AES_BLOCK_SIZE];
+	const uint8_t *prev = civ;
+	int i;
+
+	for (; len >= AES_BLOCK_SIZE; len -= AES_BLOCK_SIZE) {
+		for (i = 0; i < AES_BLOCK_SIZE; i++)
+			blk[i] = src[i] ^ prev[i];
+		aes_encrypt(ctx, dst, blk);
+		prev = dst;
+		src += AES_BLOCK_SIZE;
+		dst += AES_BLOCK_SIZE;
+	}
+}
+
+/* AF_ALG helpers */
+
+static void die(const char *msg)
+{
+	perror(msg);
+	exit(1);
+}
+
+static int alg_open(void)
+{
+	struct sockaddr_alg sa = {
+		.salg_family = AF_ALG,
+		.salg_type = "skcipher",
+	};
+	int tfmfd, opfd;
+
+	strncpy((char *)sa.salg_name, alg_name, sizeof(sa.salg_name) - 1);
+
+	tfmfd = socket(AF_ALG, SOCK_SEQPACKET, 0);
+	if (tfmfd < 0)
+		die("socket(AF_ALG)");
+	if (bind(tfmfd, (struct sockaddr *)&sa, sizeof(sa)))
+		die(alg_name);
+	if (setsockopt(tfmfd, SOL_ALG, ALG_SET_KEY, key, sizeof(key)))
+		die("ALG_SET_KEY");
+
+	opfd = accept(tfmfd, NULL, 0);
+	if (opfd < 0)
+		die("accept");
+	close(tfmfd);
+
+	return opfd;
+}
+
+/* Set operation and IV, and queue len bytes of buf unless it is NULL */
+static void alg_send(int opfd, void *buf, size_t len, int more)
+{
+	char cbuf[CMSG_SPACE(sizeof(int)) +
+		  CMSG_SPACE(sizeof(struct af_alg_iv) + AES_BLOCK_SIZE)];
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+	struct msghdr msg = {
+		.msg_control = cbuf,
+		.msg_controllen = sizeof(cbuf),
+		.msg_iov = &iov,
+		.msg_iovlen = buf ? 1 : 0,
+	};
+	struct af_alg_iv *aiv;
+	struct cmsghdr *cmsg;
+
+	memset(cbuf, 0, sizeof(cbuf));
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_ALG;
+	cmsg->cmsg_type = ALG_SET_OP;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	*(int *)CMSG_DATA(cmsg) = ALG_OP_ENCRYPT;
+
+	cmsg = CMSG_NXTHDR(&msg, cmsg);
+	cmsg->cmsg_level = SOL_ALG;
+	cmsg->cmsg_type = ALG_SET_IV;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(*aiv) + AES_BLOCK_SIZE);
+	aiv = (void *)CMSG_DATA(cmsg);
+	aiv->ivlen = AES_BLOCK_SIZE;
+	memcpy(aiv->iv, iv, AES_BLOCK_SIZE);
+
+	if (sendmsg(opfd, &msg, more ? MSG_MORE : 0) != (ssize_t)len)
+		die("sendmsg");
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, unsigned long long bytes, double t)
+{
+	printf("%-8s %10.1f MB/s\n", name, bytes / t / 1e6);
+}
+
+/* The tests, each runs for about the requested time */
+
+static void bench_local(unsigned char *src, unsigned char *dst)
+{
+	unsigned long long bytes = 0;
+	struct aes_ctx ctx;
+	double start = now(), t;
+
+	aes_set_key(&ctx, key);
+	do {
+		aes_cbc_encrypt(&ctx, dst, src, buf_size, iv);
+		bytes += buf_size;
+	} while ((t = now() - start) < seconds);
+
+	report("local", bytes, t);
+}
+
+static void bench_copy(unsigned char *src, unsigned char *dst)
+{
+	unsigned long long bytes = 0;
+	int opfd = alg_open();
+	double start = now(), t;
+	size_t done;
+	ssize_t n;
+
+	do {
+		/* the socket buffer may be smaller than the request */
+		for (done = 0; done < buf_size; done += n) {
+			size_t len = buf_size - done;
+
+			if (len > 16384)
+				len = 16384;
+			alg_send(opfd, src + done, len, 0);
+			n = read(opfd, dst + done, len);
+			if (n <= 0)
+				die("read");
+		}
+		bytes += buf_size;
+	} while ((t = now() - start) < seconds);
+
+	report("copy", bytes, t);
+	close(opfd);
+}
+
+static void bench_splice(unsigned char *src)
+{
+	unsigned long long bytes = 0;
+	int opfd = alg_open();
+	int in[2], out[2], null;
+	double start = now(), t;
+	size_t done;
+	ssize_t n, m;
+
+	if (pipe(in) || pipe(out))
+		die("pipe");
+	null = open("/dev/null", O_WRONLY);
+	if (null < 0)
+		die("/dev/null");
+
+	do {
+		for (done = 0; done < buf_size; done += n) {
+			struct iovec iov = {
+				.iov_base = src + done,
+				.iov_len = buf_size - done,
+			};
+
+			n = vmsplice(in[1], &iov, 1, 0);
+			if (n <= 0)
+				die("vmsplice");
+
+			alg_send(opfd, NULL, 0, 1);
+			if (splice(in[0], NULL, opfd, NULL, n, 0) != n)
+				die("splice to socket");
+			alg_send(opfd, NULL, 0, 0);
+
+			for (m = 0; m < n; ) {
+				ssize_t r = splice(opfd, NULL, out[1], NULL,
+						   n - m, 0);
+
+				if (r <= 0)
+					die("splice from socket");
+				if (splice(out[0], NULL, null, NULL, r, 0) != r)
+					die("splice to /dev/null");
+				m += r;
+			}
+		}
+		bytes += buf_size;
+	} while ((t = now() - start) < seconds);
+
+	report("splice", bytes, t);
+	close(null);
+	close(in[0]);
+	close(in[1]);
+	close(out[0]);
+	close(out[1]);
+	close(opfd);
+}
+
+static void bench_aio(unsigned char *src, unsigned char *dst)
+{
+	struct iocb *iocbs = calloc(aio_depth, sizeof(*iocbs));
+	struct iocb **iocbp = calloc(aio_depth, sizeof(*iocbp));
+	struct io_event *events = calloc(aio_depth, sizeof(*events));
+	size_t chunk = buf_size / aio_depth;
+	unsigned long long bytes = 0;
+	int opfd = alg_open();
+	double start = now(), t;
+	aio_context_t actx = 0;
+	int i, n;
+
+	if (!iocbs || !iocbp || !events)
+		die("calloc");
+	if (syscall(__NR_io_setup, aio_depth, &actx))
+		die("io_setup");
+
+	chunk -= chunk % AES_BLOCK_SIZE;
+	if (chunk > 16384)
+		chunk = 16384;
+
+	for (i = 0; i < aio_depth; i++) {
+		iocbs[i].aio_fildes = opfd;
+		iocbs[i].aio_lio_opcode = IOCB_CMD_PREAD;
+		iocbs[i].aio_buf = (unsigned long)(dst + i * chunk);
+		iocbs[i].aio_nbytes = chunk;
+		iocbp[i] = iocbs + i;
+	}
+
+	do {
+		/* each request consumes one chunk of what was queued */
+		for (i = 0; i < aio_depth; i++)
+			alg_send(opfd, src + i * chunk, chunk, i < aio_depth - 1);
+
+		if (syscall(__NR_io_submit, actx, aio_depth, iocbp) != aio_depth)
+			die("io_submit");
+
+		for (n = 0; n < aio_depth; ) {
+			int r = syscall(__NR_io_getevents, actx, 1,
+					aio_depth - n, events, NULL);
+
+			if (r < 0)
+				die("io_getevents");
+			for (i = 0; i < r; i++) {
+				if ((long long)events[i].res < 0) {
+					errno = -events[i].res;
+					die("aio read");
+				}
+				bytes += events[i].res;
+			}
+			n += r;
+		}
+	} while ((t = now() - start) < seconds);
+
+	report("aio", bytes, t);
+	syscall(__NR_io_destroy, actx);
+	close(opfd);
+	free(events);
+	free(iocbp);
+	free(iocbs);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-a alg] [-b bytes] [-t seconds] "
+		"[-d aio depth]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned char *src, *dst;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "a:b:t:d:")) != -1) {
+		switch (opt) {
+		case 'a':
+			alg_name = optarg;
+			break;
+		case 'b':
+			buf_size = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			seconds = atof(optarg);
+			break;
+		case 'd':
+			aio_depth = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	buf_size -= buf_size % AES_BLOCK_SIZE;
+	if (!buf_size || aio_depth < 1)
+		usage(argv[0]);
+
+	if (posix_memalign((void **)&src, 4096, buf_size) ||
+	    posix_memalign((void **)&dst, 4096, buf_size))
+		die("posix_memalign");
+	memset(src, 0x5a, buf_size);
+
+	aes_gen_tables();
+
+	printf("%s, %zu byte buffers\n", alg_name, buf_size);
+	bench_local(src, dst);
+	bench_copy(src, dst);
+	bench_splice(src);
+	bench_aio(src, dst);
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+#!/bin/bash
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# Governor comparison script for the cpufreq-bench microbenchmark.
+# Runs the same synthetic load/sleep patterns under every governor in
+# GOVERNORS, prints the average performance of every governor relative
+# to the performance governor for each pattern and plots the results.
+# Modify the general variables at the top to test other governors or
+# patterns.
+#
+
+GOVERNORS="interactive sched"
+CPU=0
+ROUNDS=20
+LOGDIR=/var/log/cpufreq-bench/compare
+
+# Synthetic workloads as "name:load:sleep:load_step:sleep_step" in us:
+#  bursty   - short bursts separated by long idle periods, like touch input
+#  periodic - 50% duty cycle at a frame rate like period
+#  ramp     - load growing while sleep shrinks, from idle to fully busy
+#  busy     - long busy periods with short breaks, like a compile job
+PATTERNS="bursty:2000:30000:0:0
+periodic:8000:8000:0:0
+ramp:1000:40000:2000:-2000
+busy:100000:5000:0:0"
+
+function measure()
+{
+    local name load sleep load_step sleep_step
+    local gov set
+
+    for pattern in $PATTERNS;do
+	IFS=: read name load sleep load_step sleep_step <<< "$pattern"
+	for gov in $GOVERNORS;do
+	    mkdir -p ${LOGDIR}/${name}/${gov}
+	    cpufreq-bench -c $CPU -g $gov -r $ROUNDS -l $load -s $sleep \
+		-x $load_step -y $sleep_step -o ${LOGDIR}/${name}/${gov}
+	    set=$(cat /sys/devices/system/cpu/cpu${CPU}/cpufreq/scaling_governor)
+	    if [ "$set" != "$gov" ];then
+		echo "WARNING: governor $gov could not be set, ran with $set"
+	    fi
+	done
+    done
+}
+
+function summarize()
+{
+    local name gov
+
+    printf "%-10s" "pattern"
+    for gov in $GOVERNORS;do
+	printf " %12s" $gov
+    done
+    echo
+    for pattern in $PATTERNS;do
+	name=${pattern%%:*}
+	printf "%-10s" $name
+	for gov in $GOVERNORS;do
+	    # last column is the runtime of the performance governor in
+	    # percent of the runtime under the tested governor
+	    awk '!/^#/ { sum += $NF; n++ }
+		 END { if (n) printf " %11.1f%%", sum / n;
+		       else printf " %12s", "-" }' \
+		${LOGDIR}/${name}/${gov}/*.log
+	done
+	echo
+    done
+}
+
+function create_plots()
+{
+    local name gov command
+
+    for pattern in $PATTERNS;do
+	name=${pattern%%:*}
+	command="cpufreq-bench_plot.sh -o \"${LOGDIR}/${name}\" -t \"Governor comparison - ${name}\""
+	for gov in $GOVERNORS;do
+	    command="${command} ${LOGDIR}/${name}/${gov}/* \"${gov}\""
+	done
+	echo $command
+	eval "$command"
+	echo
+    done
+}
+
+measure
+summarize
+create_plots
@@ -0,0 +1,567 @@
+/*
+ * energy-replay - replay a scheduling trace against the scheduler energy
+ * model and compare spreading with energy-aware placement.
+ *
+ * Copyright (c) 2013, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * The trace is the text output of ftrace with the sched_wakeup and
+ * sched_switch events enabled. It is turned into the list of run bursts
+ * of every task (wake-up time and time spent running until the task
+ * blocked again), which is then replayed on a model of the cpus with
+ * both placement policies. See Documentation/scheduler/sched-energy.txt.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+
+#define MAX_CPUS	8
+#define MAX_STATES	32
+#define SCALE		1024
+#define MARGIN		1280
+
+#define PERIOD_US	1024.0
+#define Y		0.978572	/* y^32 = 1/2 */
+
+#define STEP_US		100.0
+#define SLICE_US	3000.0
+#define WINDOW_US	10000.0
+
+struct cap_state {
+	unsigned long freq, cap, power;
+};
+
+struct cpu_model {
+	int nr_states;
+	struct cap_state states[MAX_STATES];
+	unsigned long idle_power, sleep_power;
+};
+
+struct burst {
+	int pid;
+	double wake;		/* us */
+	double work;		/* us at capacity SCALE */
+	double start;		/* us, set by the replay */
+	double remaining;	/* work left */
+	double slice;		/* time run since last picked */
+	unsigned long util;	/* estimate of the task when it woke */
+	struct burst *next;
+};
+
+struct task {
+	int pid;
+	int open;		/* a burst is in progress */
+	double wake, on, runtime;
+	double last_wake, last_work;
+	double avg;		/* decayed running average */
+	unsigned long util;	/* running average when last dequeued */
+	int prev_cpu;
+};
+
+struct cpu_sim {
+	struct burst *head, *tail;
+	unsigned long util;	/* sum of queued task estimates */
+	int state;
+	double window_work;
+	int window_busy;
+	int prev_window_busy;
+};
+
+struct result {
+	double energy;		/* mJ */
+	double duration;	/* s */
+	double lat_sum, lat_max;
+	unsigned long nr_bursts;
+	double busy[MAX_CPUS];
+};
+
+static struct cpu_model model[MAX_CPUS];
+static int nr_cpus;
+static unsigned int small_task_pct = 20;
+
+static struct burst *bursts;
+static unsigned long nr_bursts, max_bursts;
+
+static struct task *tasks;
+static int nr_tasks;
+
+static void die(const char *msg)
+{
+	fprintf(stderr, "energy-replay: %s\n", msg);
+	exit(1);
+}
+
+static void read_model(const char *path)
+{
+	char line[256];
+	FILE *f = fopen(path, "r");
+	int cpu;
+	unsigned long a, b, c;
+
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "cpu%d state %lu %lu %lu", &cpu, &a, &b, &c) == 4) {
+			if (cpu < 0 || cpu >= MAX_CPUS ||
+			    model[cpu].nr_states == MAX_STATES)
+				die("model too large");
+			model[cpu].states[model[cpu].nr_states].freq = a;
+			model[cpu].states[model[cpu].nr_states].cap = b;
+			model[cpu].states[model[cpu].nr_states].power = c;
+			model[cpu].nr_states++;
+		} else if (sscanf(line, "cpu%d idle %lu %lu", &cpu, &a, &b) == 3) {
+			if (cpu < 0 || cpu >= MAX_CPUS)
+				die("model too large");
+			model[cpu].idle_power = a;
+			model[cpu].sleep_power = b;
+		} else {
+			continue;
+		}
+		if (cpu >= nr_cpus)
+			nr_cpus = cpu + 1;
+	}
+	fclose(f);
+
+	for (cpu = 0; cpu < nr_cpus; cpu++)
+		if (!model[cpu].nr_states)
+			die("cpu without operating points in model");
+	if (!nr_cpus)
+		die("empty model");
+}
+
+static struct task *find_task(int pid)
+{
+	int i;
+
+	for (i = 0; i < nr_tasks; i++)
+		if (tasks[i].pid == pid)
+			return &tasks[i];
+
+	tasks = realloc(tasks, (nr_tasks + 1) * sizeof(*tasks));
+	if (!tasks)
+		die("out of memory");
+	memset(&tasks[nr_tasks], 0, sizeof(*tasks));
+	tasks[nr_tasks].pid = pid;
+	tasks[nr_tasks].prev_cpu = -1;
+	return &tasks[nr_tasks++];
+}
+
+static void add_burst(struct task *t)
+{
+	if (nr_bursts == max_bursts) {
+		max_bursts = max_bursts ? 2 * max_bursts : 4096;
+		bursts = realloc(bursts, max_bursts * sizeof(*bursts));
+		if (!bursts)
+			die("out of memory");
+	}
+	bursts[nr_bursts].pid = t->pid;
+	bursts[nr_bursts].wake = t->wake;
+	bursts[nr_bursts].work = t->runtime;
+	nr_bursts++;
+	t->open = 0;
+}
+
+/* The timestamp is the "secs.usecs:" field just before the event name */
+static int parse_ts(char *line, char *event, double *ts)
+{
+	char *p = event;
+
+	if (p - line < 2)
+		return -1;
+	p -= 2;
+	while (p > line && *p != ' ')
+		p--;
+	*ts = strtod(p, NULL) * 1e6;
+
+	return 0;
+}
+
+static int field(const char *s, const char *name, int *val)
+{
+	const char *p = strstr(s, name);
+
+	if (!p)
+		return -1;
+	*val = atoi(p + strlen(name));
+	return 0;
+}
+
+static void read_trace(const char *path)
+{
+	char line[1024];
+	FILE *f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+	char *ev, *st;
+	double ts;
+	int pid, next;
+	struct task *t;
+
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if ((ev = strstr(line, ": sched_wakeup"))) {
+			if (parse_ts(line, ev + 1, &ts) ||
+			    field(ev, " pid=", &pid) || !pid)
+				continue;
+			t = find_task(pid);
+			if (!t->open) {
+				t->open = 1;
+				t->wake = ts;
+				t->on = -1;
+				t->runtime = 0;
+			}
+		} else if ((ev = strstr(line, ": sched_switch:"))) {
+			if (parse_ts(line, ev + 1, &ts) ||
+			    field(ev, "prev_pid=", &pid) ||
+			    field(ev, "next_pid=", &next))
+				continue;
+
+			if (pid) {
+				t = find_task(pid);
+				if (t->open && t->on >= 0) {
+					t->runtime += ts - t->on;
+					t->on = -1;
+					st = strstr(ev, "prev_state=");
+					if (st && st[11] != 'R')
+						add_burst(t);
+				}
+			}
+			if (next) {
+				t = find_task(next);
+				if (!t->open) {
+					/* runnable since before the trace */
+					t->open = 1;
+					t->wake = ts;
+					t->runtime = 0;
+				}
+				t->on = ts;
+			}
+		}
+	}
+
+	if (f != stdin)
+		fclose(f);
+}
+
+static int cmp_burst(const void *a, const void *b)
+{
+	const struct burst *x = a, *y = b;
+
+	return x->wake < y->wake ? -1 : x->wake > y->wake;
+}
+
+static int fits(unsigned long util, unsigned long cap)
+{
+	return util * MARGIN <= cap * SCALE;
+}
+
+static unsigned long cost(int cpu, unsigned long util)
+{
+	struct cpu_model *m = &model[cpu];
+	unsigned long busy;
+	int i;
+
+	if (!util)
+		return m->sleep_power * SCALE;
+
+	for (i = 0; i < m->nr_states - 1; i++)
+		if (fits(util, m->states[i].cap))
+			break;
+
+	busy = util * SCALE / m->states[i].cap;
+	if (busy > SCALE)
+		busy = SCALE;
+
+	return m->states[i].power * busy + m->idle_power * (SCALE - busy);
+}
+
+static int place_spread(struct cpu_sim *cpus, struct task *t)
+{
+	double min = 0;
+	int i, best = -1;
+
+	if (t->prev_cpu >= 0 && !cpus[t->prev_cpu].head)
+		return t->prev_cpu;
+
+	for (i = 0; i < nr_cpus; i++) {
+		struct burst *b;
+		double load = 0;
+
+		if (!cpus[i].head)
+			return i;
+		for (b = cpus[i].head; b; b = b->next)
+			load += b->remaining;
+		if (best < 0 || load < min) {
+			min = load;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+static int place_energy(struct cpu_sim *cpus, struct task *t)
+{
+	long delta, min_delta = 0;
+	int i, best = -1;
+
+	if (t->util * 100 > small_task_pct * SCALE)
+		return place_spread(cpus, t);
+
+	for (i = 0; i < nr_cpus; i++) {
+		struct cpu_model *m = &model[i];
+		unsigned long util = cpus[i].util;
+
+		if (!fits(util + t->util, m->states[m->nr_states - 1].cap))
+			continue;
+
+		delta = cost(i, util + t->util) - cost(i, util);
+		if (best < 0 || delta < min_delta ||
+		    (delta == min_delta && i == t->prev_cpu)) {
+			min_delta = delta;
+			best = i;
+		}
+	}
+
+	return best < 0 ? place_spread(cpus, t) : best;
+}
+
+static void enqueue(struct cpu_sim *c, struct burst *b)
+{
+	b->next = NULL;
+	if (c->tail)
+		c->tail->next = b;
+	else
+		c->head = b;
+	c->tail = b;
+	c->util += b->util;
+}
+
+static struct burst *dequeue(struct cpu_sim *c)
+{
+	struct burst *b = c->head;
+
+	c->head = b->next;
+	if (!c->head)
+		c->tail = NULL;
+	c->util -= b->util;
+	return b;
+}
+
+static void replay(int energy_aware, struct result *res)
+{
+	struct cpu_sim cpus[MAX_CPUS];
+	unsigned long next = 0;
+	double now, end, next_window;
+	int i;
+
+	memset(cpus, 0, sizeof(cpus));
+	memset(res, 0, sizeof(*res));
+	for (i = 0; i < nr_tasks; i++) {
+		tasks[i].util = 0;
+		tasks[i].avg = 0;
+		tasks[i].last_wake = -1;
+		tasks[i].last_work = 0;
+		tasks[i].prev_cpu = -1;
+	}
+
+	if (!nr_bursts)
+		return;
+
+	now = bursts[0].wake;
+	end = bursts[nr_bursts - 1].wake;
+	next_window = now + WINDOW_US;
+
+	for (;;) {
+		int pending = 0;
+
+		/* Wake up the bursts due by now */
+		while (next < nr_bursts && bursts[next].wake <= now) {
+			struct burst *b = &bursts[next++];
+			struct task *t = find_task(b->pid);
+			int cpu;
+
+			/*
+			 * Same geometric decay as the kernel's per-entity load
+			 * tracking: the estimate used for placement is the one
+			 * left by the previous burst, the sleep is accounted on
+			 * enqueue.
+			 */
+			if (t->last_wake >= 0) {
+				double run = t->last_work / PERIOD_US;
+				double sleep = (b->wake - t->last_wake) /
+					       PERIOD_US - run;
+
+				t->avg = t->avg * pow(Y, run) +
+					 SCALE * (1 - pow(Y, run));
+				t->util = t->avg;
+				if (sleep > 0)
+					t->avg *= pow(Y, sleep);
+			}
+			t->last_wake = b->wake;
+			t->last_work = b->work;
+
+			cpu = energy_aware ? place_energy(cpus, t) :
+					     place_spread(cpus, t);
+			t->prev_cpu = cpu;
+
+			b->util = t->avg;
+			b->start = -1;
+			b->remaining = b->work;
+			b->slice = 0;
+			enqueue(&cpus[cpu], b);
+		}
+
+		for (i = 0; i < nr_cpus; i++) {
+			struct cpu_sim *c = &cpus[i];
+			struct cpu_model *m = &model[i];
+			double left = STEP_US, busy = 0;
+
+			while (c->head && left > 0) {
+				struct burst *b = c->head;
+				unsigned long cap = m->states[c->state].cap;
+				double run = b->remaining * SCALE / cap;
+
+				if (b->start < 0) {
+					b->start = now + STEP_US - left;
+					res->lat_sum += b->start - b->wake;
+					if (b->start - b->wake > res->lat_max)
+						res->lat_max = b->start - b->wake;
+					res->nr_bursts++;
+				}
+
+				if (run > left)
+					run = left;
+				if (run > SLICE_US - b->slice)
+					run = SLICE_US - b->slice;
+
+				b->remaining -= run * cap / SCALE;
+				b->slice += run;
+				c->window_work += run * cap / SCALE;
+				busy += run;
+				left -= run;
+
+				if (b->remaining <= 1e-6) {
+					dequeue(c);
+				} else if (b->slice >= SLICE_US) {
+					/* round robin between the queued bursts */
+					b->slice = 0;
+					dequeue(c);
+					enqueue(c, b);
+				}
+			}
+
+			if (busy > 0)
+				c->window_busy = 1;
+			res->busy[i] += busy;
+			res->energy += (busy * m->states[c->state].power +
+					(STEP_US - busy) *
+					(c->prev_window_busy || c->window_busy ?
+					 m->idle_power : m->sleep_power)) / 1e6;
+			if (c->head)
+				pending = 1;
+		}
+
+		now += STEP_US;
+
+		/* Governor: lowest operating point fitting the last window */
+		if (now >= next_window) {
+			for (i = 0; i < nr_cpus; i++) {
+				struct cpu_sim *c = &cpus[i];
+				struct cpu_model *m = &model[i];
+				unsigned long util = c->window_work * SCALE / WINDOW_US;
+
+				for (c->state = 0; c->state < m->nr_states - 1;
+				     c->state++)
+					if (fits(util, m->states[c->state].cap))
+						break;
+				c->prev_window_busy = c->window_busy;
+				c->window_busy = 0;
+				c->window_work = 0;
+			}
+			next_window += WINDOW_US;
+		}
+
+		if (now > end && !pending && next == nr_bursts)
+			break;
+	}
+
+	res->duration = (now - bursts[0].wake) / 1e6;
+}
+
+static void report(const char *name, struct result *r)
+{
+	double span = r->duration;
+	int i;
+
+	printf("%-14s energy %10.3f mJ  avg power %8.2f mW  latency avg %8.1f us max %8.1f us\n",
+	       name, r->energy, span > 0 ? r->energy / span : 0,
+	       r->nr_bursts ? r->lat_sum / r->nr_bursts : 0, r->lat_max);
+	printf("%-14s busy", "");
+	for (i = 0; i < nr_cpus; i++)
+		printf("  cpu%d %5.1f%%", i, span > 0 ? r->busy[i] * 1e2 / (span * 1e6) : 0);
+	printf("\n");
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: energy-replay [-m model] [-s small_task_pct] trace|-\n"
+		"  -m model   energy model (default /sys/kernel/debug/sched_energy)\n"
+		"  -s pct     small task threshold in percent (default 20)\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *model_path = "/sys/kernel/debug/sched_energy";
+	struct result spread, energy;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:s:h")) != -1) {
+		switch (opt) {
+		case 'm':
+			model_path = optarg;
+			break;
+		case 's':
+			small_task_pct = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc - 1)
+		usage();
+
+	read_model(model_path);
+	read_trace(argv[optind]);
+	qsort(bursts, nr_bursts, sizeof(*bursts), cmp_burst);
+
+	printf("%lu bursts from %d tasks on %d cpus\n", nr_bursts, nr_tasks, nr_cpus);
+	if (!nr_bursts)
+		return 0;
+
+	replay(0, &spread);
+	replay(1, &energy);
+
+	report("spread", &spread);
+	report("energy-aware", &energy);
+
+	return 0;
+}